@@ -0,0 +1,58 @@
+#include <WiFi.h>
+#include <TraccarClient.h>
+#include <TraccarFilter.h>
+#include <TraccarNmea.h>
+
+// Replace with your credentials
+const char* ssid = "YOUR_SSID";
+const char* pass = "YOUR_PASS";
+
+// GPS receiver on Serial2 (RX 16, TX 17)
+#define GPS_BAUD 9600
+
+traccar_client_t* client;
+traccar_filter_t* filter;
+traccar_nmea_t* nmea;
+
+traccar_position_t lastFix;
+bool haveFix = false;
+
+// Called from traccar_nmea_feed once all sentences of a fix are in
+void onFix(void* user, const traccar_position_t* pos) {
+  lastFix = *pos;
+  haveFix = true;
+}
+
+void setup() {
+  Serial.begin(115200);
+  Serial2.begin(GPS_BAUD, SERIAL_8N1, 16, 17);
+
+  WiFi.begin(ssid, pass);
+  while (WiFi.status() != WL_CONNECTED) {
+    delay(500);
+    Serial.print('.');
+  }
+  Serial.println("\nWiFi connected");
+
+  client = traccar_create("http://your.traccar.server", 5055, "device001");
+  filter = traccar_filter_create(25.0, 300000); // 25 m, heartbeat every 5 min
+  nmea = traccar_nmea_create(onFix, nullptr);
+}
+
+void loop() {
+  uint8_t buf[128];
+  int n = Serial2.available();
+  if (n > 0) {
+    n = Serial2.readBytes(buf, n < (int)sizeof(buf) ? n : (int)sizeof(buf));
+    traccar_nmea_feed(nmea, buf, n);
+  }
+
+  if (haveFix) {
+    haveFix = false;
+    if (lastFix.validFlag == 1 && traccar_filter_accept(filter, &lastFix)) {
+      int httpCode = 0;
+      bool ok = traccar_send_osmand(client, &lastFix, &httpCode);
+      Serial.printf("Fix %.6f,%.6f sent: %s (HTTP %d)\n", lastFix.latitude, lastFix.longitude, ok ? "OK" : "FAIL", httpCode);
+    }
+  }
+}
@@ -0,0 +1,173 @@
+// Track archive size and throughput: appends a synthetic week of 1 Hz driving and parking to a
+// traccar_archive_t and reports bytes per fix (next to the OsmAnd URL, the JSON object and the
+// store-and-forward queue's record for the same fixes), append and decode rates, a one-hour range
+// scan, and a range export built into JSON batch bodies. Decoded fixes are checked against the
+// originals at the wire precision.
+//
+//   traccar_bench_archive [path]          (default /tmp/traccar_bench.tca, removed afterwards)
+
+#include "TraccarArchive.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static const size_t kFixes = 7 * 86400; // a week at 1 Hz
+static const uint64_t kStart = 1700000000000ULL;
+static const char* const kCells[] = { "222,1,20345,1234567,-71", "222,1,20345,1234612,-75", "222,1,20346,1198034,-68" };
+
+static double secs(bench_clock::time_point a, bench_clock::time_point b) {
+  return std::chrono::duration<double>(b - a).count();
+}
+
+// Drives for 20-60 minutes, parks for 5-90, and so on; GPS noise on everything
+static std::vector<traccar_position_t> make_track() {
+  std::mt19937 rng(7);
+  std::normal_distribution<double> noise(0.0, 1.0);
+  std::vector<traccar_position_t> v(kFixes);
+  double lat = 45.4642, lon = 9.19, heading = 90, speed = 0, alt = 122, odo = 0, battery = 100;
+  size_t phase_end = 0;
+  bool driving = false;
+  for (size_t i = 0; i < kFixes; ++i) {
+    if (i == phase_end) {
+      driving = !driving;
+      phase_end = i + (driving ? 1200 + rng() % 2400 : 300 + rng() % 5100);
+    }
+    if (driving) {
+      speed = fmin(fmax(speed + noise(rng) * 2.0, 5.0), 90.0);
+      heading = fmod(heading + noise(rng) * 4.0 + 360.0, 360.0);
+      double m = speed / 3.6;
+      lat += cos(heading * 0.017453292519943295) * m / 111195.0;
+      lon += sin(heading * 0.017453292519943295) * m / (111195.0 * cos(lat * 0.017453292519943295));
+      alt += noise(rng) * 0.3;
+      odo += m;
+    } else {
+      speed = 0;
+    }
+    traccar_position_t& p = v[i];
+    p = traccar_position_t();
+    p.latitude = lat + noise(rng) * 2e-6;
+    p.longitude = lon + noise(rng) * 2e-6;
+    p.altitudeMeters = alt + noise(rng) * 0.5;
+    p.speedKmh = speed;
+    p.headingDeg = heading;
+    p.hdop = 0.8 + (i / 600 % 5) * 0.1;
+    p.accuracyMeters = 3.0 + (i / 300 % 4);
+    p.odometer = odo;
+    p.timestampMs = kStart + i * 1000ULL + (rng() % 50 == 0 ? rng() % 40 : 0); // occasional late fix
+    battery = driving ? fmin(battery + 0.001, 100) : battery - 0.0005;
+    p.batteryPercent = (int32_t)battery;
+    p.charging = driving;
+    p.validFlag = 1;
+    p.cell = kCells[i / 900 % 3];
+    if (i + 1 == phase_end) p.eventName = driving ? "ignitionOff" : "ignitionOn";
+  }
+  return v;
+}
+
+struct Check {
+  const std::vector<traccar_position_t>* track;
+  size_t next;
+  size_t bad;
+};
+
+static bool same_at(double a, double b, double scale) {
+  return isnan(a) ? isnan(b) : llround(a * scale) == llround(b * scale);
+}
+
+static bool check_cb(void* user, const traccar_position_t* p, size_t n) {
+  Check* c = (Check*)user;
+  for (size_t i = 0; i < n; ++i, ++c->next) {
+    const traccar_position_t& e = (*c->track)[c->next];
+    bool ok = e.timestampMs == p[i].timestampMs && same_at(e.latitude, p[i].latitude, 1e7) &&
+              same_at(e.longitude, p[i].longitude, 1e7) && same_at(e.altitudeMeters, p[i].altitudeMeters, 10) &&
+              same_at(e.speedKmh, p[i].speedKmh, 100) && same_at(e.headingDeg, p[i].headingDeg, 10) &&
+              same_at(e.odometer, p[i].odometer, 10) && e.batteryPercent == p[i].batteryPercent &&
+              e.charging == p[i].charging && e.validFlag == p[i].validFlag && !strcmp(e.cell, p[i].cell) &&
+              !e.eventName == !p[i].eventName;
+    if (!ok) ++c->bad;
+  }
+  return true;
+}
+
+static volatile double g_sink; // keeps the decode from being optimized out
+
+static bool count_cb(void*, const traccar_position_t* p, size_t n) {
+  g_sink = p[n - 1].latitude;
+  return true;
+}
+
+struct Export {
+  traccar_client_t* client;
+  std::vector<char> body;
+  size_t bytes;
+};
+
+static bool export_cb(void* user, const traccar_position_t* p, size_t n) {
+  Export* e = (Export*)user;
+  for (size_t at = 0; at < n;) {
+    size_t fit = 0;
+    e->bytes += traccar_build_json_batch_body(e->client, p + at, n - at, e->body.data(), e->body.size(), &fit);
+    at += fit ? fit : 1;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* path = argc > 1 ? argv[1] : "/tmp/traccar_bench.tca";
+  unlink(path);
+  std::vector<traccar_position_t> track = make_track();
+
+  traccar_client_t* client = traccar_create("http://bench.invalid", 5055, "bench-device");
+  double url = 0, json = 0, queue = 0;
+  char buf[2048];
+  for (size_t i = 0; i < kFixes; i += 97) {
+    url += (double)traccar_build_osmand_url(client, &track[i], buf, sizeof(buf));
+    json += (double)traccar_build_json_body(client, &track[i], buf, sizeof(buf));
+    size_t strings = strlen(track[i].cell) + 1 + (track[i].eventName ? strlen(track[i].eventName) + 1 : 0);
+    queue += (double)((24 + 96 + strings + 7) & ~(size_t)7); // record header, fixed part, strings
+  }
+  double samples = (double)((kFixes + 96) / 97);
+
+  traccar_archive_t* a = traccar_archive_open(path);
+  if (!a) { perror(path); return 1; }
+  bench_clock::time_point t0 = bench_clock::now();
+  for (const traccar_position_t& p : track) traccar_archive_append(a, &p);
+  traccar_archive_flush(a);
+  bench_clock::time_point t1 = bench_clock::now();
+  uint64_t bytes = traccar_archive_bytes(a);
+
+  Check c = { &track, 0, 0 };
+  traccar_archive_scan(a, 0, UINT64_MAX, check_cb, &c);
+  bench_clock::time_point t2 = bench_clock::now();
+  size_t decoded = traccar_archive_scan(a, 0, UINT64_MAX, count_cb, nullptr);
+  bench_clock::time_point t3 = bench_clock::now();
+  uint64_t from = kStart + 3 * 86400000ULL + 12 * 3600000ULL;
+  size_t hour = traccar_archive_scan(a, from, from + 3600000ULL, count_cb, nullptr);
+  bench_clock::time_point t4 = bench_clock::now();
+  Export e = { client, std::vector<char>(64 * 1024), 0 };
+  size_t exported = traccar_archive_scan(a, from, from + 86400000ULL, export_cb, &e);
+  bench_clock::time_point t5 = bench_clock::now();
+
+  printf("%zu fixes (a week at 1 Hz), %s\n", kFixes, path);
+  printf("bytes/fix: archive %.2f, OsmAnd URL %.1f, JSON object %.1f, queue record %.1f\n",
+         (double)bytes / kFixes, url / samples, json / samples, queue / samples);
+  printf("append:    %.2f M fixes/s (%.1f MB/s of positions)\n", kFixes / secs(t0, t1) / 1e6,
+         kFixes * sizeof(traccar_position_t) / secs(t0, t1) / 1e6);
+  printf("scan:      %.2f M fixes/s (%.1f MB/s of archive)\n", decoded / secs(t2, t3) / 1e6,
+         bytes / secs(t2, t3) / 1e6);
+  printf("1 h range: %zu fixes in %.1f us\n", hour, secs(t3, t4) * 1e6);
+  printf("1 d export to JSON batches: %zu fixes, %.1f MB in %.1f ms\n", exported, e.bytes / 1e6, secs(t4, t5) * 1e3);
+  printf("round trip: %zu of %zu fixes differ\n", c.bad + (kFixes - c.next), kFixes);
+  traccar_archive_close(a);
+  traccar_destroy(client);
+  unlink(path);
+  return 0;
+}
@@ -0,0 +1,255 @@
+// Encoder throughput on the host: encodes/s, bytes/s and heap allocations per encode for the
+// OsmAnd URL (contiguous and scatter-gather), OsmAnd form body, JSON body and Codec 8 packet
+// builders over a few realistic position mixes, and for the C++ API (Traccar.hpp) appending into
+// a reused std::string. The "json-string" row is the JSON body as the library built it before the
+// C encoder: String += concatenation and String(double, n) temporaries, replayed on the host with
+// a stand-in for Arduino's String that allocates as WString does. (That the send paths allocate
+// nothing is checked by traccar_tests against the stand-in server.)
+//
+//   traccar_bench_encode [iterations]   (default 1000000 per builder and mix)
+
+#include "Traccar.hpp"
+#include "TraccarClient.h"
+#include "TraccarCodec8.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+// Allocation counting: glibc lets the program interpose malloc and forward to the real one
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t, size_t);
+extern "C" void* __libc_realloc(void*, size_t);
+static unsigned long g_allocs = 0;
+extern "C" void* malloc(size_t n) { ++g_allocs; return __libc_malloc(n); }
+extern "C" void* calloc(size_t n, size_t m) { ++g_allocs; return __libc_calloc(n, m); }
+extern "C" void* realloc(void* p, size_t n) { ++g_allocs; return __libc_realloc(p, n); }
+#define BENCH_COUNTS_ALLOCS 1
+#else
+static unsigned long g_allocs = 0;
+#define BENCH_COUNTS_ALLOCS 0
+#endif
+
+typedef size_t (*build_fn)(traccar_client_t*, const traccar_position_t*, char*, size_t);
+
+// One-record Codec 8 packet, so its row compares with the per-request text encodings
+static size_t build_codec8(traccar_client_t*, const traccar_position_t* pos, char* out, size_t out_size) {
+  return traccar_codec8_build_packet(pos, 1, (uint8_t*)out, out_size, nullptr);
+}
+
+// OsmAnd URL as scatter-gather pieces: only the fields are written, the cached prefix is referenced
+static size_t build_osmand_iov(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
+  traccar_iovec_t iov[2];
+  return traccar_build_osmand_url_iov(c, pos, nullptr, iov, out, out_size);
+}
+
+// Arduino's String as far as the old JSON path used it: a heap buffer reallocated to the exact
+// new length when it grows (WString::reserve), and number constructors formatting into a stack
+// buffer (dtostrf / itoa) and copying it to the heap
+class LegacyString {
+public:
+  LegacyString() {}
+  explicit LegacyString(const char* s) { *this += s; }
+  LegacyString(double v, int decimals) { char buf[33]; snprintf(buf, sizeof(buf), "%.*f", decimals, v); *this += buf; }
+  explicit LegacyString(int v) { char buf[12]; snprintf(buf, sizeof(buf), "%d", v); *this += buf; }
+  LegacyString(const LegacyString&) = delete;
+  ~LegacyString() { free(buf_); }
+  void reserve(size_t n) {
+    if (n <= cap_) return;
+    buf_ = (char*)realloc(buf_, n + 1);
+    cap_ = n;
+  }
+  LegacyString& operator+=(const char* s) {
+    size_t n = strlen(s);
+    reserve(len_ + n);
+    memcpy(buf_ + len_, s, n + 1);
+    len_ += n;
+    return *this;
+  }
+  LegacyString& operator+=(const LegacyString& s) { return s.len_ ? *this += s.buf_ : *this; }
+  size_t length() const { return len_; }
+  const char* c_str() const { return buf_ ? buf_ : ""; }
+private:
+  char* buf_ = nullptr;
+  size_t cap_ = 0, len_ = 0;
+};
+
+static const char* g_legacy_id = "bench-device";
+
+// traccar_send_json's body before the C encoder, statement for statement (strings unescaped, as
+// they were); the result is copied out like the other builders' output
+static size_t build_json_string(traccar_client_t*, const traccar_position_t* pos, char* out, size_t out_size) {
+  LegacyString tsIso;
+  if (pos->timestampMs) {
+    time_t sec = (time_t)(pos->timestampMs / 1000ULL);
+    struct tm tmv; gmtime_r(&sec, &tmv);
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday,
+             tmv.tm_hour, tmv.tm_min, tmv.tm_sec, (int)(pos->timestampMs % 1000ULL));
+    tsIso += buf;
+  }
+  LegacyString body; body.reserve(384);
+  body += "{";
+  body += "\"id\":\""; body += g_legacy_id; body += "\"";
+  if (!isnan(pos->latitude)) { body += ",\"lat\":"; body += LegacyString(pos->latitude, 7); }
+  if (!isnan(pos->longitude)) { body += ",\"lon\":"; body += LegacyString(pos->longitude, 7); }
+  if (!isnan(pos->altitudeMeters)) { body += ",\"altitude\":"; body += LegacyString(pos->altitudeMeters, 1); }
+  if (!isnan(pos->speedKmh)) { body += ",\"speed\":"; body += LegacyString((int)round(pos->speedKmh / 1.852)); }
+  if (!isnan(pos->headingDeg)) { body += ",\"heading\":"; body += LegacyString(pos->headingDeg, 1); }
+  if (!isnan(pos->hdop)) { body += ",\"hdop\":"; body += LegacyString(pos->hdop, 2); }
+  if (!isnan(pos->accuracyMeters)) { body += ",\"accuracy\":"; body += LegacyString(pos->accuracyMeters, 1); }
+  if (pos->validFlag >= 0) { body += ",\"valid\":"; body += (pos->validFlag ? "true" : "false"); }
+  if (tsIso.length()) { body += ",\"timestamp\":\""; body += tsIso; body += "\""; }
+  if (!isnan(pos->odometer)) { body += ",\"odometer\":"; body += LegacyString(pos->odometer, 1); }
+  if (pos->batteryPercent >= 0) { body += ",\"batt\":"; body += LegacyString(pos->batteryPercent); }
+  if (pos->charging) { body += ",\"charge\":true"; }
+  if (pos->eventName && *pos->eventName) { body += ",\"event\":\""; body += pos->eventName; body += "\""; }
+  if (pos->activityType && *pos->activityType) { body += ",\"activity\":\""; body += pos->activityType; body += "\""; }
+  if (pos->driverUniqueId && *pos->driverUniqueId) { body += ",\"driverUniqueId\":\""; body += pos->driverUniqueId; body += "\""; }
+  if (pos->cell && *pos->cell) { body += ",\"cell\":\""; body += pos->cell; body += "\""; }
+  if (pos->wifi && *pos->wifi) { body += ",\"wifi\":\""; body += pos->wifi; body += "\""; }
+  body += "}";
+  size_t n = body.length();
+  if (out_size) {
+    size_t k = n < out_size ? n : out_size - 1;
+    memcpy(out, body.c_str(), k);
+    out[k] = '\0';
+  }
+  return n;
+}
+
+static traccar_position_t empty_position() {
+  traccar_position_t p = {};
+  p.latitude = NAN; p.longitude = NAN; p.altitudeMeters = NAN; p.speedKmh = NAN;
+  p.headingDeg = NAN; p.hdop = NAN; p.accuracyMeters = NAN; p.odometer = NAN;
+  p.batteryPercent = -1; p.validFlag = -1;
+  return p;
+}
+
+static traccar_position_t minimal_position() {
+  traccar_position_t p = empty_position();
+  p.latitude = 45.4642035; p.longitude = 9.1899817;
+  p.timestampMs = 1700000000000ULL;
+  return p;
+}
+
+static traccar_position_t full_position() {
+  traccar_position_t p = minimal_position();
+  p.altitudeMeters = 122.4; p.speedKmh = 48.3; p.headingDeg = 271.5; p.hdop = 0.87;
+  p.accuracyMeters = 3.2; p.odometer = 1523456.7;
+  p.batteryPercent = 78; p.charging = true; p.validFlag = 1;
+  p.driverUniqueId = "driver-0042";
+  p.cell = "222,1,20345,1234567,-71";
+  p.wifi = "a4:2b:b0:11:22:33,-62";
+  p.eventName = "motionchange";
+  p.activityType = "in_vehicle";
+  return p;
+}
+
+static traccar_position_t radio_position() {
+  traccar_position_t p = minimal_position();
+  p.speedKmh = 12.0; p.batteryPercent = 55;
+  p.cell = "222,1,20345,1234567,-71;222,1,20345,1234568,-80;222,1,20346,1234901,-85;"
+           "222,10,31001,7654321,-90;222,10,31001,7654322,-97";
+  p.wifi = "a4:2b:b0:11:22:33,-62;a4:2b:b0:11:22:34,-64;00:1a:2b:3c:4d:5e,-70;"
+           "f0:9f:c2:10:20:30,-73;f0:9f:c2:10:20:31,-75;c8:3a:35:aa:bb:cc,-78;"
+           "c8:3a:35:aa:bb:cd,-81;10:fe:ed:01:02:03,-84;10:fe:ed:01:02:04,-88;"
+           "60:45:cb:9a:8b:7c,-91";
+  return p;
+}
+
+static void run(const char* builder, build_fn fn, const char* mix, traccar_client_t* c,
+                traccar_position_t pos, long iterations) {
+  char out[2048];
+  size_t bytes = 0;
+  unsigned long allocs0 = g_allocs;
+  auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) {
+    pos.timestampMs += 1000; // keep the work from being hoisted out of the loop
+    bytes += fn(c, &pos, out, sizeof(out));
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  unsigned long allocs = g_allocs - allocs0;
+  double s = std::chrono::duration<double>(t1 - t0).count();
+  printf("%-11s %-8s %8.1f ns %12.0f enc/s %9.1f MB/s %6zu B", builder, mix, s / iterations * 1e9,
+         iterations / s, bytes / s / 1e6, bytes / (size_t)iterations);
+  if (BENCH_COUNTS_ALLOCS) printf(" %8.3f alloc/enc", (double)allocs / iterations);
+  printf("\n");
+}
+
+// The same position as a traccar::Position, its text fields viewing the original strings
+static traccar::Position cpp_position(const traccar_position_t& p) {
+  traccar::Position cp;
+  cp.fix = p;
+  if (p.driverUniqueId) cp.driverUniqueId = p.driverUniqueId;
+  if (p.cell) cp.cell = p.cell;
+  if (p.wifi) cp.wifi = p.wifi;
+  if (p.eventName) cp.eventName = p.eventName;
+  if (p.activityType) cp.activityType = p.activityType;
+  return cp;
+}
+
+typedef size_t (traccar::Client::*append_fn)(const traccar::Position&, std::string&) const;
+
+static void run_cpp(const char* builder, append_fn fn, const char* mix, const traccar::Client& client,
+                    traccar::Position pos, long iterations) {
+  std::string out;
+  size_t bytes = 0;
+  (client.*fn)(pos, out); // first call sizes the string
+  unsigned long allocs0 = g_allocs;
+  auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) {
+    pos.fix.timestampMs += 1000;
+    out.clear();
+    bytes += (client.*fn)(pos, out);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  unsigned long allocs = g_allocs - allocs0;
+  double s = std::chrono::duration<double>(t1 - t0).count();
+  printf("%-11s %-8s %8.1f ns %12.0f enc/s %9.1f MB/s %6zu B", builder, mix, s / iterations * 1e9,
+         iterations / s, bytes / s / 1e6, bytes / (size_t)iterations);
+  if (BENCH_COUNTS_ALLOCS) printf(" %8.3f alloc/enc", (double)allocs / iterations);
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  if (iterations <= 0) iterations = 1;
+  traccar_client_t* c = traccar_create("http://demo.traccar.org", 5055, "bench-device");
+  if (!c) { fprintf(stderr, "traccar_create failed\n"); return 1; }
+
+  struct { const char* name; build_fn fn; } builders[] = {
+    { "osmand", traccar_build_osmand_url },
+    { "osmand-iov", build_osmand_iov },
+    { "form", traccar_build_osmand_form_body },
+    { "json", traccar_build_json_body },
+    { "json-string", build_json_string },
+    { "codec8", build_codec8 },
+  };
+  struct { const char* name; traccar_position_t pos; } mixes[] = {
+    { "minimal", minimal_position() },
+    { "full", full_position() },
+    { "radio", radio_position() },
+  };
+
+  printf("%ld iterations per row%s\n", iterations, BENCH_COUNTS_ALLOCS ? "" : " (allocation counting unavailable)");
+  for (size_t b = 0; b < sizeof(builders) / sizeof(builders[0]); ++b)
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m)
+      run(builders[b].name, builders[b].fn, mixes[m].name, c, mixes[m].pos, iterations);
+
+  traccar::Client client("http://demo.traccar.org", 5055, "bench-device");
+  struct { const char* name; append_fn fn; } appenders[] = {
+    { "c++osmand", &traccar::Client::appendOsmAndUrl },
+    { "c++json", &traccar::Client::appendJson },
+  };
+  for (size_t b = 0; b < sizeof(appenders) / sizeof(appenders[0]); ++b)
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m)
+      run_cpp(appenders[b].name, appenders[b].fn, mixes[m].name, client, cpp_position(mixes[m].pos), iterations);
+
+  traccar_destroy(c);
+  return 0;
+}
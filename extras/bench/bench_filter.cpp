@@ -0,0 +1,173 @@
+// Replays tracks through the reporting filter and reports how many fixes would be uploaded and
+// how far the path the server draws (straight lines between uploaded fixes) strays from the
+// original fixes.
+//
+//   traccar_bench_filter [track.csv ...]
+//
+// CSV lines are "timestamp_ms,lat,lon,speed_kmh,heading_deg" (empty speed/heading = unknown).
+// Without files, synthetic 1 Hz tracks are generated: parked, city and highway driving.
+
+#include "TraccarFilter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const double kEarth = 6371008.8;
+static const double kRad = 0.017453292519943295;
+
+struct Track {
+  std::string name;
+  std::vector<traccar_position_t> fixes;
+};
+
+static traccar_position_t make_fix(uint64_t t, double lat, double lon, double speed, double heading) {
+  traccar_position_t p = {};
+  p.latitude = lat; p.longitude = lon; p.speedKmh = speed; p.headingDeg = heading;
+  p.altitudeMeters = NAN; p.hdop = NAN; p.accuracyMeters = NAN; p.odometer = NAN;
+  p.timestampMs = t; p.batteryPercent = -1; p.validFlag = -1;
+  return p;
+}
+
+static double distance_m(double lat1, double lon1, double lat2, double lon2) {
+  double x = (lon2 - lon1) * kRad * cos((lat1 + lat2) * 0.5 * kRad);
+  double y = (lat2 - lat1) * kRad;
+  return sqrt(x * x + y * y) * kEarth;
+}
+
+// ----------------- Synthetic tracks -----------------
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+static double uniform() { g_rng ^= g_rng << 13; g_rng ^= g_rng >> 7; g_rng ^= g_rng << 17; return (g_rng >> 11) * (1.0 / 9007199254740992.0); }
+static double gauss() { return sqrt(-2.0 * log(uniform() + 1e-300)) * cos(2.0 * M_PI * uniform()); }
+
+// Moves a simulated vehicle in local metres and samples it once a second with GPS noise
+struct Sim {
+  Track track;
+  double x = 0, y = 0, heading = 0, speed = 0; // m, m, degrees, km/h
+  uint64_t t = 1700000000000ULL;
+  double noise_m;
+
+  Sim(const char* name, double noise) : noise_m(noise) { track.name = name; }
+
+  void step(double target_speed, double turn_rate) {
+    speed += std::max(-8.0, std::min(6.0, target_speed - speed)); // km/h per second
+    heading = fmod(heading + turn_rate + 360.0, 360.0);
+    double v = speed / 3.6;
+    x += v * sin(heading * kRad);
+    y += v * cos(heading * kRad);
+    t += 1000;
+    double nx = x + gauss() * noise_m, ny = y + gauss() * noise_m;
+    double lat0 = 45.4642, lon0 = 9.19;
+    double lat = lat0 + ny / kEarth / kRad;
+    double lon = lon0 + nx / (kEarth * cos(lat0 * kRad)) / kRad;
+    double h = speed > 3.0 ? fmod(heading + gauss() * 3.0 + 360.0, 360.0) : uniform() * 360.0;
+    track.fixes.push_back(make_fix(t, lat, lon, std::max(0.0, speed + gauss()), h));
+  }
+};
+
+static Track parked_track() {
+  Sim s("parked", 3.0);
+  for (int i = 0; i < 3600; ++i) s.step(0, 0);
+  return s.track;
+}
+
+static Track city_track() {
+  Sim s("city", 3.0);
+  for (int block = 0; block < 60; ++block) {
+    double len = 100 + uniform() * 300, target = 30 + uniform() * 20, run = 0;
+    while (run < len) { s.step(target, gauss() * 0.3); run += s.speed / 3.6; }
+    if (uniform() < 0.3) for (int i = 0; i < 30; ++i) s.step(0, 0); // traffic light
+    double turn = (uniform() < 0.5 ? 90.0 : -90.0) / 6.0;
+    for (int i = 0; i < 6; ++i) s.step(18, turn);
+  }
+  return s.track;
+}
+
+static Track highway_track() {
+  Sim s("highway", 2.0);
+  double curve = 0;
+  for (int i = 0; i < 1800; ++i) {
+    if (i % 120 == 0) curve = uniform() < 0.5 ? 0.0 : gauss() * 0.25;
+    s.step(110 + gauss() * 2, curve);
+  }
+  return s.track;
+}
+
+static bool load_csv(const char* path, Track* track) {
+  FILE* fp = fopen(path, "r");
+  if (!fp) return false;
+  track->name = path;
+  char line[256];
+  while (fgets(line, sizeof(line), fp)) {
+    char* p = line;
+    char* fields[5] = {};
+    for (int i = 0; i < 5 && p; ++i) { fields[i] = p; p = strchr(p, ','); if (p) *p++ = '\0'; }
+    if (!fields[2] || !(line[0] >= '0' && line[0] <= '9')) continue; // header or malformed
+    double speed = (fields[3] && *fields[3] && *fields[3] != '\n') ? atof(fields[3]) : NAN;
+    double heading = (fields[4] && *fields[4] && *fields[4] != '\n') ? atof(fields[4]) : NAN;
+    track->fixes.push_back(make_fix(strtoull(fields[0], nullptr, 10), atof(fields[1]), atof(fields[2]), speed, heading));
+  }
+  fclose(fp);
+  return !track->fixes.empty();
+}
+
+// ----------------- Replay -----------------
+
+static void replay(const Track& track, double max_error_m, uint32_t max_interval_ms) {
+  traccar_filter_t* f = traccar_filter_create(max_error_m, max_interval_ms);
+  std::vector<size_t> sent;
+  for (size_t i = 0; i < track.fixes.size(); ++i)
+    if (traccar_filter_accept(f, &track.fixes[i])) sent.push_back(i);
+  traccar_filter_destroy(f);
+  // The end of a track is reported anyway (the heartbeat would send it), so it closes the path
+  if (sent.back() != track.fixes.size() - 1) sent.push_back(track.fixes.size() - 1);
+
+  // Error of each original fix against the polyline through the uploaded fixes, by time
+  std::vector<double> err;
+  size_t k = 0;
+  for (size_t i = 0; i < track.fixes.size(); ++i) {
+    while (k + 1 < sent.size() && sent[k + 1] <= i) ++k;
+    const traccar_position_t& a = track.fixes[sent[k]];
+    const traccar_position_t& p = track.fixes[i];
+    double lat = a.latitude, lon = a.longitude;
+    if (k + 1 < sent.size() && sent[k] < i) {
+      const traccar_position_t& b = track.fixes[sent[k + 1]];
+      double u = (double)(p.timestampMs - a.timestampMs) / (double)(b.timestampMs - a.timestampMs);
+      lat += (b.latitude - a.latitude) * u;
+      lon += (b.longitude - a.longitude) * u;
+    }
+    err.push_back(distance_m(lat, lon, p.latitude, p.longitude));
+  }
+  double sum = 0;
+  for (double e : err) sum += e;
+  std::vector<double> sorted(err);
+  std::sort(sorted.begin(), sorted.end());
+  printf("%-10s %6.0f m %5u s %7zu %6zu %7.1fx %8.1f m %8.1f m %8.1f m\n", track.name.c_str(), max_error_m,
+         max_interval_ms / 1000, track.fixes.size(), sent.size(), (double)track.fixes.size() / sent.size(),
+         sum / err.size(), sorted[sorted.size() * 95 / 100], sorted.back());
+}
+
+int main(int argc, char** argv) {
+  std::vector<Track> tracks;
+  for (int i = 1; i < argc; ++i) {
+    Track t;
+    if (load_csv(argv[i], &t)) tracks.push_back(t);
+    else fprintf(stderr, "skipping %s\n", argv[i]);
+  }
+  if (tracks.empty()) {
+    tracks.push_back(parked_track());
+    tracks.push_back(city_track());
+    tracks.push_back(highway_track());
+  }
+  printf("%-10s %8s %7s %7s %6s %8s %10s %10s %10s\n", "track", "bound", "beat", "fixes", "sent", "reduce",
+         "mean err", "p95 err", "max err");
+  const double bounds[] = { 10, 25, 50 };
+  for (const Track& t : tracks)
+    for (double b : bounds) replay(t, b, 300000);
+  return 0;
+}
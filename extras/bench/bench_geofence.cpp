@@ -0,0 +1,161 @@
+// Builds the geofence index over 10k and 100k fences (circles and 8-32 vertex polygons of 50-500 m,
+// scattered over a 50 km city) and reports build time, memory, and the time per point query and
+// per traccar_geofence_update along a random walk, against a linear scan over every fence. The
+// scan's answers are also compared with the index's.
+//
+//   traccar_bench_geofence
+
+#include "TraccarGeofence.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+static const double kEarth = 6371008.8;
+static const double kRad = 0.017453292519943295;
+static const double kLat = 45.4642, kLon = 9.19; // city centre
+static const double kCityM = 50000.0;
+static const int kQueries = 1000000;
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+struct Fences {
+  std::vector<traccar_fence_t> defs;
+  std::vector<std::vector<double>> points;
+};
+
+static Fences make_fences(size_t n, std::mt19937& rng) {
+  std::uniform_real_distribution<double> pos(-0.5, 0.5), unit(0.0, 1.0);
+  double m_lat = 1.0 / (kEarth * kRad), m_lon = m_lat / cos(kLat * kRad);
+  Fences f;
+  f.defs.resize(n);
+  f.points.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    traccar_fence_t& d = f.defs[i];
+    d = traccar_fence_t();
+    d.id = (uint32_t)i + 1;
+    d.latitude = kLat + pos(rng) * kCityM * m_lat;
+    d.longitude = kLon + pos(rng) * kCityM * m_lon;
+    double r = 50.0 + unit(rng) * 450.0;
+    if (i % 2) {
+      d.radiusMeters = r;
+      continue;
+    }
+    size_t k = 8 + rng() % 25; // a star-shaped polygon around the centre
+    std::vector<double>& p = f.points[i];
+    for (size_t v = 0; v < k; ++v) {
+      double a = 2 * M_PI * v / k, rv = r * (0.5 + 0.5 * unit(rng));
+      p.push_back(d.latitude + sin(a) * rv * m_lat);
+      p.push_back(d.longitude + cos(a) * rv * m_lon);
+    }
+    d.points = p.data();
+    d.pointCount = k;
+  }
+  return f;
+}
+
+// The linear scan, in double precision
+static bool scan_contains(const traccar_fence_t& d, double lat, double lon) {
+  if (d.pointCount == 0) {
+    double dy = (lat - d.latitude) * kRad, dx = (lon - d.longitude) * kRad * cos(d.latitude * kRad);
+    return sqrt(dx * dx + dy * dy) * kEarth <= d.radiusMeters;
+  }
+  bool in = false;
+  for (size_t i = 0, j = d.pointCount - 1; i < d.pointCount; j = i++) {
+    double yi = d.points[2 * i], xi = d.points[2 * i + 1], yj = d.points[2 * j], xj = d.points[2 * j + 1];
+    if ((yi > lat) != (yj > lat) && lon < (xj - xi) * (lat - yi) / (yj - yi) + xi) in = !in;
+  }
+  return in;
+}
+
+static size_t scan(const Fences& f, double lat, double lon, uint32_t* ids, size_t max) {
+  size_t n = 0;
+  for (const traccar_fence_t& d : f.defs) {
+    if (!scan_contains(d, lat, lon)) continue;
+    if (n < max) ids[n] = d.id;
+    ++n;
+  }
+  return n;
+}
+
+static void run(size_t count) {
+  std::mt19937 rng(42);
+  Fences f = make_fences(count, rng);
+
+  uint64_t t0 = now_ns();
+  traccar_geofence_t* g = traccar_geofence_create(f.defs.data(), f.defs.size(), nullptr);
+  uint64_t t1 = now_ns();
+  if (!g) { fprintf(stderr, "traccar_geofence_create failed\n"); exit(1); }
+
+  // Uniform points over the city, then a 1 Hz walk at 15 m/s
+  std::uniform_real_distribution<double> pos(-0.5, 0.5);
+  double m_lat = 1.0 / (kEarth * kRad), m_lon = m_lat / cos(kLat * kRad);
+  std::vector<double> pts(2 * kQueries), walk(2 * kQueries);
+  for (int i = 0; i < kQueries; ++i) {
+    pts[2 * i] = kLat + pos(rng) * kCityM * m_lat;
+    pts[2 * i + 1] = kLon + pos(rng) * kCityM * m_lon;
+  }
+  double lat = kLat, lon = kLon, heading = 0;
+  for (int i = 0; i < kQueries; ++i) {
+    heading += pos(rng) * 0.5;
+    lat += cos(heading) * 15.0 * m_lat;
+    lon += sin(heading) * 15.0 * m_lon;
+    if (fabs(lat - kLat) > 0.5 * kCityM * m_lat || fabs(lon - kLon) > 0.5 * kCityM * m_lon) heading += M_PI;
+    walk[2 * i] = lat;
+    walk[2 * i + 1] = lon;
+  }
+
+  uint32_t ids[TRACCAR_GEOFENCE_MAX_INSIDE];
+  size_t hits = 0;
+  uint64_t t2 = now_ns();
+  for (int i = 0; i < kQueries; ++i) hits += traccar_geofence_query(g, pts[2 * i], pts[2 * i + 1], ids, 0);
+  uint64_t t3 = now_ns();
+
+  size_t events = 0;
+  traccar_geofence_event_t ev[8];
+  uint64_t t4 = now_ns();
+  for (int i = 0; i < kQueries; ++i) {
+    traccar_position_t p = {};
+    p.latitude = walk[2 * i];
+    p.longitude = walk[2 * i + 1];
+    events += traccar_geofence_update(g, &p, ev, 8);
+  }
+  uint64_t t5 = now_ns();
+
+  // The scan is slow: time and check it on a sample
+  int sample = count > 20000 ? 2000 : 20000;
+  size_t mismatches = 0;
+  uint32_t a[TRACCAR_GEOFENCE_MAX_INSIDE], b[TRACCAR_GEOFENCE_MAX_INSIDE];
+  uint64_t scan_ns = 0;
+  for (int i = 0; i < sample; ++i) {
+    uint64_t s0 = now_ns();
+    size_t nb = scan(f, pts[2 * i], pts[2 * i + 1], b, TRACCAR_GEOFENCE_MAX_INSIDE);
+    scan_ns += now_ns() - s0;
+    size_t na = traccar_geofence_query(g, pts[2 * i], pts[2 * i + 1], a, TRACCAR_GEOFENCE_MAX_INSIDE);
+    std::sort(a, a + std::min(na, (size_t)TRACCAR_GEOFENCE_MAX_INSIDE));
+    std::sort(b, b + std::min(nb, (size_t)TRACCAR_GEOFENCE_MAX_INSIDE));
+    if (na != nb || !std::equal(a, a + std::min(na, (size_t)TRACCAR_GEOFENCE_MAX_INSIDE), b)) ++mismatches;
+  }
+
+  printf("%8zu %9.1f %9.2f %9.1f %9.1f %11.0f %9.3f %8zu %10zu\n", count, (t1 - t0) / 1e6,
+         traccar_geofence_memory(g) / 1048576.0, (double)(t3 - t2) / kQueries, (double)(t5 - t4) / kQueries,
+         (double)scan_ns / sample, (double)hits / kQueries, events, mismatches);
+  traccar_geofence_destroy(g);
+}
+
+int main() {
+  printf("%d uniform queries and %d walk updates per row; the linear scan on a sample\n", kQueries, kQueries);
+  printf("%8s %9s %9s %9s %9s %11s %9s %8s %10s\n", "fences", "build ms", "MiB", "query ns", "update ns",
+         "scan ns", "hits/q", "events", "mismatches");
+  run(10000);
+  run(100000);
+  return 0;
+}
@@ -0,0 +1,153 @@
+// NMEA ingestion throughput: feeds a log through traccar_nmea_t in chunks of several sizes (one
+// byte is a UART read per interrupt, 4 KB a file read) and reports MB/s, sentences/s and
+// positions/s, next to the usual strtok/atof line-by-line glue for comparison.
+//
+//   traccar_bench_nmea [log.nmea ...]
+//
+// Without files, a synthetic 10 Hz log of about 8 MB is generated: GGA, GSA, 3 GSV, RMC and VTG
+// per fix, as a multi-constellation receiver sends them.
+
+#include "TraccarNmea.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static const int kSyntheticFixes = 20000;
+
+static void add_sentence(std::string& log, const char* body) {
+  uint8_t x = 0;
+  for (const char* p = body; *p; ++p) x ^= (uint8_t)*p;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", x);
+  log += '$';
+  log += body;
+  log += tail;
+}
+
+static std::string synthetic_log() {
+  std::string log;
+  char s[128];
+  double lat = 4527.852, lon = 911.398;
+  for (int i = 0; i < kSyntheticFixes; ++i) {
+    int cs = i % 10, t = 43200 + i / 10;
+    char tm[16];
+    snprintf(tm, sizeof(tm), "%02d%02d%02d.%d0", t / 3600, t / 60 % 60, t % 60, cs);
+    lat += 0.0004; lon += 0.0003;
+    snprintf(s, sizeof(s), "GNGGA,%s,%.5f,N,%010.5f,E,1,12,0.8,122.4,M,47.3,M,,", tm, lat, lon);
+    add_sentence(log, s);
+    add_sentence(log, "GNGSA,A,3,02,05,13,15,18,20,23,29,,,,,1.4,0.8,1.1,1");
+    add_sentence(log, "GPGSV,3,1,11,02,42,108,44,05,61,290,47,13,20,051,38,15,25,171,41,1");
+    add_sentence(log, "GPGSV,3,2,11,18,34,247,42,20,13,320,36,23,07,034,31,29,55,152,46,1");
+    add_sentence(log, "GPGSV,3,3,11,25,03,212,,26,11,288,29,31,02,198,,1");
+    snprintf(s, sizeof(s), "GNRMC,%s,A,%.5f,N,%010.5f,E,26.1,36.8,141123,,,A,V", tm, lat, lon);
+    add_sentence(log, s);
+    add_sentence(log, "GNVTG,36.8,T,,M,26.1,N,48.3,K,A");
+  }
+  return log;
+}
+
+static std::string read_file(const char* path) {
+  std::string data;
+  FILE* f = fopen(path, "rb");
+  if (!f) { fprintf(stderr, "%s: cannot open\n", path); exit(1); }
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+  fclose(f);
+  return data;
+}
+
+static double g_sink;
+
+static void on_fix(void*, const traccar_position_t* pos) {
+  g_sink += pos->latitude;
+}
+
+static void report(const char* name, double s, size_t bytes, uint64_t sentences, uint64_t positions) {
+  printf("%-12s %9.1f MB/s %12.0f sentences/s %12.0f positions/s (%llu positions)\n", name, bytes / s / 1e6,
+         sentences / s, positions / s, (unsigned long long)positions);
+}
+
+static void bench_chunks(const std::string& log, size_t chunk, const char* name) {
+  traccar_nmea_t* nmea = traccar_nmea_create(on_fix, nullptr);
+  if (!nmea) { fprintf(stderr, "traccar_nmea_create failed\n"); exit(1); }
+  const char* p = log.data();
+  size_t left = log.size();
+  auto t0 = bench_clock::now();
+  while (left) {
+    size_t n = left < chunk ? left : chunk;
+    traccar_nmea_feed(nmea, p, n);
+    p += n;
+    left -= n;
+  }
+  traccar_nmea_flush(nmea);
+  double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+  traccar_nmea_counts_t counts;
+  traccar_nmea_get_counts(nmea, &counts);
+  report(name, s, log.size(), counts.sentences, counts.positions);
+  if (counts.checksum_errors || counts.dropped)
+    printf("             %llu checksum errors, %llu dropped\n", (unsigned long long)counts.checksum_errors,
+           (unsigned long long)counts.dropped);
+  traccar_nmea_destroy(nmea);
+}
+
+// What applications write today: copy a line, strtok it, atof the fields, one position per RMC
+static void bench_glue(const std::string& log) {
+  uint64_t sentences = 0, positions = 0;
+  auto t0 = bench_clock::now();
+  size_t start = 0;
+  char line[256];
+  while (start < log.size()) {
+    size_t end = log.find('\n', start);
+    if (end == std::string::npos) end = log.size();
+    size_t len = end - start < sizeof(line) - 1 ? end - start : sizeof(line) - 1;
+    memcpy(line, log.data() + start, len);
+    line[len] = '\0';
+    start = end + 1;
+    char* star = strchr(line, '*');
+    if (line[0] != '$' || !star) continue;
+    uint8_t x = 0;
+    for (char* c = line + 1; c < star; ++c) x ^= (uint8_t)*c;
+    if (x != (uint8_t)strtol(star + 1, nullptr, 16)) continue;
+    *star = '\0';
+    ++sentences;
+    char* fields[24];
+    int n = 0;
+    for (char* tok = strtok(line, ","); tok && n < 24; tok = strtok(nullptr, ",")) fields[n++] = tok;
+    // strtok collapses empty fields, as the glue usually does not notice
+    if (n > 7 && strcmp(fields[0] + 3, "RMC") == 0) {
+      traccar_position_t pos = {};
+      double lat = atof(fields[3]), lon = atof(fields[5]);
+      pos.latitude = floor(lat / 100) + fmod(lat, 100) / 60;
+      pos.longitude = floor(lon / 100) + fmod(lon, 100) / 60;
+      pos.speedKmh = atof(fields[7]) * 1.852;
+      on_fix(nullptr, &pos);
+      ++positions;
+    }
+  }
+  double s = std::chrono::duration<double>(bench_clock::now() - t0).count();
+  report("strtok/atof", s, log.size(), sentences, positions);
+}
+
+int main(int argc, char** argv) {
+  std::string log;
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) log += read_file(argv[i]);
+  } else {
+    log = synthetic_log();
+  }
+  printf("%.1f MB of NMEA\n", log.size() / 1e6);
+  bench_chunks(log, 1, "1 B chunks");
+  bench_chunks(log, 64, "64 B chunks");
+  bench_chunks(log, 4096, "4 KB chunks");
+  bench_chunks(log, log.size(), "whole log");
+  bench_glue(log);
+  return g_sink == 12345.0; // keeps the callbacks from being optimized out
+}
@@ -0,0 +1,97 @@
+// Submission queue under contention: N producer threads submit positions into one background
+// sender; reports submit throughput, sampled submit latency and how fast the sender drains.
+//
+//   traccar_bench_sender [server_url [port [osmand|json]]]
+//
+// Without a server the client points at an https:// URL, which the host transport refuses
+// without any I/O: the sender drains batches as fast as it can take them, so the numbers show
+// the queue alone. With a server they include encoding and the network.
+
+#include "TraccarSender.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static const long kPerProducer = 200000;
+static const int kSampleEvery = 64; // latency is timed on every 64th submit
+
+static traccar_position_t bench_position(int producer) {
+  traccar_position_t p = {};
+  p.latitude = 45.4642035 + producer * 0.001; p.longitude = 9.1899817; p.altitudeMeters = 122.4;
+  p.speedKmh = 48.3; p.headingDeg = 271.5; p.hdop = 0.87; p.accuracyMeters = 3.2; p.odometer = NAN;
+  p.timestampMs = 1700000000000ULL; p.batteryPercent = 78; p.validFlag = 1;
+  p.cell = "222,1,20345,1234567,-71";
+  p.wifi = "a4:2b:b0:11:22:33,-62;a4:2b:b0:11:22:34,-64";
+  return p;
+}
+
+static void run(const char* url, uint16_t port, traccar_format_t format, int producers) {
+  traccar_client_t* c = traccar_create(url, port, "bench-device");
+  traccar_sender_t* s = traccar_sender_create(c, format, 1 << 16, nullptr, nullptr);
+  if (!c || !s) { fprintf(stderr, "setup failed\n"); exit(1); }
+  traccar_sender_set_max_batch(s, 128);
+
+  std::vector<std::vector<double>> samples(producers);
+  std::atomic<int> ready(0);
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < producers; ++t) {
+    threads.emplace_back([&, t] {
+      traccar_position_t p = bench_position(t);
+      samples[t].reserve(kPerProducer / kSampleEvery + 1);
+      ready++;
+      while (!go) {}
+      for (long i = 0; i < kPerProducer; ++i) {
+        p.timestampMs += 1000;
+        if (i % kSampleEvery == 0) {
+          auto t0 = bench_clock::now();
+          traccar_sender_submit(s, &p);
+          samples[t].push_back(std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count());
+        } else {
+          traccar_sender_submit(s, &p);
+        }
+      }
+    });
+  }
+  while (ready < producers) {}
+  auto t0 = bench_clock::now();
+  go = true;
+  for (auto& th : threads) th.join();
+  auto t1 = bench_clock::now();
+  traccar_sender_flush(s, 60000);
+  auto t2 = bench_clock::now();
+
+  traccar_sender_counts_t n;
+  traccar_sender_get_counts(s, &n);
+  std::vector<double> all;
+  for (auto& v : samples) all.insert(all.end(), v.begin(), v.end());
+  std::sort(all.begin(), all.end());
+  double submit_s = std::chrono::duration<double>(t1 - t0).count();
+  double drain_s = std::chrono::duration<double>(t2 - t0).count();
+  long total = kPerProducer * producers;
+  printf("%9d %12.0f %8.0f %8.0f %9.0f %11.1f%% %12.0f %9.1f\n", producers, total / submit_s,
+         all[all.size() / 2], all[all.size() * 99 / 100], all[all.size() * 999 / 1000],
+         100.0 * n.full / total, (n.delivered + n.failed) / drain_s,
+         n.batches ? (double)(n.delivered + n.failed) / n.batches : 0.0);
+  traccar_sender_destroy(s);
+  traccar_destroy(c);
+}
+
+int main(int argc, char** argv) {
+  const char* url = argc > 1 ? argv[1] : "https://bench.invalid";
+  uint16_t port = argc > 2 ? (uint16_t)atoi(argv[2]) : 0;
+  traccar_format_t format = (argc > 3 && argv[3][0] == 'j') ? TRACCAR_FORMAT_JSON : TRACCAR_FORMAT_OSMAND;
+  printf("%ld submits per producer, %s, %u hardware threads\n", kPerProducer, url, std::thread::hardware_concurrency());
+  printf("%9s %12s %8s %8s %9s %12s %12s %9s\n", "producers", "submit/s", "p50 ns", "p99 ns", "p99.9 ns",
+         "ring full", "drained/s", "batch");
+  for (int producers = 1; producers <= 8; producers *= 2) run(url, port, format, producers);
+  return 0;
+}
@@ -0,0 +1,137 @@
+// Cross-process submission through the shared-memory ring: N forked producer processes submit
+// positions to an uploader running in this process; reports submit throughput and latency, and
+// the end-to-end latency from submit to the uploader handing the batch's outcome back.
+//
+//   traccar_bench_shm [server_url [port [osmand|json]]]
+//
+// As in traccar_bench_sender, without a server the client points at an https:// URL that the
+// host transport refuses without any I/O, so the numbers show the ring and the wakeups alone.
+// Each row runs paced (a submit every 20 us per producer: the uploader mostly sleeps and is woken
+// through the futex) and flat out (it mostly finds work without sleeping).
+
+#include "TraccarShm.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+static const long kPerProducer = 100000;
+static const int kSampleEvery = 16; // submit latency is timed on every 16th submit
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts); // system-wide, so comparable across the processes
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static traccar_position_t bench_position(int producer) {
+  traccar_position_t p = {};
+  p.latitude = 45.4642035 + producer * 0.001; p.longitude = 9.1899817; p.altitudeMeters = 122.4;
+  p.speedKmh = 48.3; p.headingDeg = 271.5; p.hdop = 0.87; p.accuracyMeters = 3.2; p.odometer = NAN;
+  p.timestampMs = 1700000000000ULL; p.batteryPercent = 78; p.validFlag = 1;
+  p.cell = "222,1,20345,1234567,-71";
+  p.wifi = "a4:2b:b0:11:22:33,-62;a4:2b:b0:11:22:34,-64";
+  return p;
+}
+
+// The submit time travels in odometer, which the uploader's callback turns into a latency
+static void on_batch(void* user, const traccar_position_t* positions, size_t n, const bool*, int) {
+  std::vector<double>* e2e = (std::vector<double>*)user;
+  uint64_t now = now_ns();
+  for (size_t i = 0; i < n; ++i) e2e->push_back((double)(now - (uint64_t)positions[i].odometer) / 1000.0);
+}
+
+static void producer_main(const char* name, int id, uint64_t gap_ns, float* samples) {
+  traccar_shm_producer_t* p = traccar_shm_open(name);
+  if (!p) _exit(1);
+  traccar_position_t pos = bench_position(id);
+  uint64_t next = now_ns();
+  for (long i = 0; i < kPerProducer; ++i) {
+    if (gap_ns) {
+      next += gap_ns;
+      while (now_ns() < next) {}
+    }
+    pos.timestampMs += 1000;
+    uint64_t t0 = now_ns();
+    pos.odometer = (double)t0;
+    traccar_shm_submit(p, &pos);
+    if (i % kSampleEvery == 0) samples[i / kSampleEvery] = (float)(now_ns() - t0);
+  }
+  traccar_shm_close(p);
+  _exit(0);
+}
+
+static double pct(std::vector<double>& v, double q) {
+  return v.empty() ? 0.0 : v[std::min(v.size() - 1, (size_t)(v.size() * q))];
+}
+
+static void run(const char* url, uint16_t port, traccar_format_t format, int producers, uint64_t gap_ns) {
+  char name[64];
+  snprintf(name, sizeof(name), "/traccar-bench-%d", (int)getpid());
+  traccar_client_t* c = traccar_create(url, port, "bench-device");
+  std::vector<double> e2e;
+  e2e.reserve(kPerProducer * producers);
+  traccar_shm_daemon_t* d = traccar_shm_daemon_create(name, c, format, 1 << 16, on_batch, &e2e);
+  if (!c || !d) { perror("setup failed"); exit(1); }
+  traccar_shm_daemon_set_max_batch(d, 128);
+  std::thread uploader([d] { traccar_shm_daemon_run(d); });
+
+  size_t per = kPerProducer / kSampleEvery + 1;
+  size_t bytes = per * producers * sizeof(float);
+  float* samples = (float*)mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (samples == MAP_FAILED) { perror("mmap"); exit(1); }
+
+  uint64_t t0 = now_ns();
+  std::vector<pid_t> pids;
+  for (int i = 0; i < producers; ++i) {
+    pid_t pid = fork();
+    if (pid == 0) producer_main(name, i, gap_ns, samples + per * i);
+    pids.push_back(pid);
+  }
+  for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+  uint64_t t1 = now_ns();
+  traccar_shm_counts_t n;
+  for (;;) { // until the uploader has taken everything
+    traccar_shm_daemon_get_counts(d, &n);
+    if (n.delivered + n.failed + n.skipped >= n.submitted) break;
+    usleep(1000);
+  }
+  traccar_shm_daemon_stop(d);
+  uploader.join();
+
+  std::vector<double> sub;
+  for (int i = 0; i < producers; ++i)
+    for (size_t k = 0; k < (size_t)(kPerProducer + kSampleEvery - 1) / kSampleEvery; ++k) sub.push_back(samples[per * i + k]);
+  std::sort(sub.begin(), sub.end());
+  std::sort(e2e.begin(), e2e.end());
+  long total = kPerProducer * producers;
+  printf("%9d %7s %12.0f %8.0f %8.0f %9.1f %9.1f %10.1f %9.1f%% %7.1f\n", producers, gap_ns ? "20 us" : "none",
+         total / ((t1 - t0) / 1e9), pct(sub, 0.5), pct(sub, 0.99), pct(e2e, 0.5), pct(e2e, 0.99), pct(e2e, 0.999),
+         100.0 * n.full / total, n.batches ? (double)(n.delivered + n.failed) / n.batches : 0.0);
+  munmap(samples, bytes);
+  traccar_shm_daemon_destroy(d);
+  traccar_destroy(c);
+}
+
+int main(int argc, char** argv) {
+  const char* url = argc > 1 ? argv[1] : "https://bench.invalid";
+  uint16_t port = argc > 2 ? (uint16_t)atoi(argv[2]) : 0;
+  traccar_format_t format = (argc > 3 && argv[3][0] == 'j') ? TRACCAR_FORMAT_JSON : TRACCAR_FORMAT_OSMAND;
+  printf("%ld submits per producer process, %s, %u hardware threads\n", kPerProducer, url,
+         std::thread::hardware_concurrency());
+  printf("%9s %7s %12s %8s %8s %9s %9s %10s %10s %7s\n", "producers", "pacing", "submit/s", "p50 ns", "p99 ns",
+         "e2e p50", "e2e p99", "e2e p99.9", "ring full", "batch");
+  printf("%9s %7s %12s %8s %8s %9s %9s %10s\n", "", "", "", "", "", "us", "us", "us");
+  for (int producers = 1; producers <= 8; producers *= 2) {
+    run(url, port, format, producers, 20000);
+    run(url, port, format, producers, 0);
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Host transport against a local mock Traccar listener (the stand-in server, in-process on a
+// loopback port, or a server given on the command line): blocking sends per second and their
+// latency for OsmAnd GET and JSON POST, once on one kept-alive connection and once with a new
+// connection (TCP handshake and teardown) per send; then traccar_send_async throughput as the
+// pipeline depth (unanswered requests on the wire) grows.
+//
+//   traccar_bench_transport [sends [server_url port]]   (default 20000 sends per row)
+
+#include "TraccarClient.h"
+#include "standin.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static traccar_position_t position() {
+  traccar_position_t p = {};
+  p.latitude = 45.4642035; p.longitude = 9.1899817; p.altitudeMeters = 122.4; p.speedKmh = 48.3;
+  p.headingDeg = 271.5; p.hdop = 0.87; p.accuracyMeters = 3.2; p.odometer = 1523456.7;
+  p.timestampMs = 1700000000000ULL; p.batteryPercent = 78; p.validFlag = 1;
+  return p;
+}
+
+static void run(const char* url, uint16_t port, traccar_format_t format, bool keep_alive, long sends) {
+  traccar_client_t* c = traccar_create(url, port, "bench-device");
+  traccar_set_keep_alive(c, keep_alive);
+  traccar_position_t p = position();
+  std::vector<float> lat_us;
+  lat_us.reserve((size_t)sends);
+  long ok = 0;
+  bench_clock::time_point t0 = bench_clock::now();
+  for (long i = 0; i < sends; ++i) {
+    p.timestampMs += 1000;
+    bench_clock::time_point s = bench_clock::now();
+    int code = 0;
+    bool sent = format == TRACCAR_FORMAT_JSON ? traccar_send_json(c, &p, &code) : traccar_send_osmand(c, &p, &code);
+    lat_us.push_back(std::chrono::duration<float, std::micro>(bench_clock::now() - s).count());
+    if (sent) ++ok;
+  }
+  double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+  traccar_stats_t st;
+  traccar_get_stats(c, &st);
+  std::sort(lat_us.begin(), lat_us.end());
+  printf("%-6s %-10s %10.0f sends/s %8.1f %8.1f %8.1f us %8llu %7ld/%ld\n", format == TRACCAR_FORMAT_JSON ? "json" : "osmand",
+         keep_alive ? "keep-alive" : "close", sends / secs, lat_us[lat_us.size() / 2], lat_us[lat_us.size() * 99 / 100],
+         lat_us.back(), (unsigned long long)st.connects, ok, sends);
+  traccar_destroy(c);
+}
+
+static void on_sent(traccar_client_t* c, void* user, int code) {
+  (void)c;
+  if (code == 200) ++*(long*)user;
+}
+
+// Keeps the async queue full and polls until every send is answered
+static void run_async(const char* url, uint16_t port, unsigned depth, long sends) {
+  traccar_client_t* c = traccar_create(url, port, "bench-device");
+  traccar_set_pipeline_depth(c, depth);
+  traccar_position_t p = position();
+  long ok = 0, queued = 0;
+  bench_clock::time_point t0 = bench_clock::now();
+  while (queued < sends || traccar_poll(c, 0) > 0) {
+    while (queued < sends) {
+      p.timestampMs += 1000;
+      if (!traccar_send_async(c, TRACCAR_FORMAT_OSMAND, &p, on_sent, &ok)) break;
+      ++queued;
+    }
+    traccar_poll(c, 100);
+  }
+  double secs = std::chrono::duration<double>(bench_clock::now() - t0).count();
+  traccar_stats_t st;
+  traccar_get_stats(c, &st);
+  printf("async  depth %-4u %10.0f sends/s %8llu %7ld/%ld\n", depth, sends / secs, (unsigned long long)st.connects, ok, sends);
+  traccar_destroy(c);
+}
+
+int main(int argc, char** argv) {
+  long sends = argc > 1 ? atol(argv[1]) : 20000;
+  if (sends <= 0) { fprintf(stderr, "usage: traccar_bench_transport [sends [server_url port]]\n"); return 2; }
+  static StandinServer server;
+  const char* url = "http://127.0.0.1";
+  uint16_t port;
+  if (argc > 3) {
+    url = argv[2];
+    port = (uint16_t)atoi(argv[3]);
+  } else {
+    if (!standin_start(&server, 0, true)) { perror("traccar_bench_transport: listen"); return 1; }
+    port = server.port;
+  }
+  printf("%ld blocking sends per row to %s:%u\n", sends, url, port);
+  printf("%-6s %-10s %18s %8s %8s %11s %8s %15s\n", "format", "connection", "rate", "p50", "p99", "max", "connects", "accepted");
+  for (int f = 0; f < 2; ++f)
+    for (int keep = 1; keep >= 0; --keep) run(url, port, f ? TRACCAR_FORMAT_JSON : TRACCAR_FORMAT_OSMAND, keep != 0, sends);
+  printf("\n%-17s %18s %8s %15s\n", "osmand pipelined", "rate", "connects", "accepted");
+  for (unsigned depth = 1; depth <= 32; depth *= 2) run_async(url, port, depth, sends);
+  standin_stop(&server);
+  return 0;
+}
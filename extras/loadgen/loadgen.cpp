@@ -0,0 +1,490 @@
+// Track replay load generator for sizing Traccar servers: simulates many devices replaying
+// recorded tracks against a server and reports the achieved rate, request latency percentiles
+// and the response codes.
+//
+//   traccar_loadgen [-u url] [-p port] [-n devices] [-x speedup] [-w workers] [-t seconds]
+//                   [-f osmand|json] [-T trace.json] [track.gpx|track.nmea|track.csv ...]
+//   traccar_loadgen -s port [-e fail_every]          (stand-in server only)
+//
+// Track files are memory-mapped and parsed in place: GPX <trkpt> elements, NMEA (merged into
+// fixes by traccar_nmea_t) or the CSV of traccar_bench_filter
+// ("timestamp_ms,lat,lon,speed_kmh,heading_deg").
+// Without files a synthetic 1 Hz loop is used. Device i replays track i % tracks from its own
+// starting fix at speedup times real time (0 = as fast as the workers go); fixes are stamped with
+// the time they are sent. The devices are spread over the workers, which send through one
+// traccar_fleet_t with a keep-alive connection per worker.
+//
+// Without -u the stand-in server runs in-process on a loopback port, so the tool runs in CI with
+// nothing else. It answers every request with an empty 200 (every fail_every-th with 500).
+//
+// -T records the stages of the last sends of each connection (traccar_fleet_set_trace) and writes
+// them as a Chrome trace (chrome://tracing, Perfetto), one thread per connection.
+
+#include "TraccarFleet.h"
+#include "TraccarNmea.h"
+#include "standin.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock load_clock;
+
+static const double kRad = 0.017453292519943295;
+
+struct Track {
+  std::string name;
+  std::vector<traccar_position_t> fixes;
+  double mean_interval_ms = 1000;
+};
+
+static traccar_position_t make_fix(uint64_t t, double lat, double lon) {
+  traccar_position_t p = {};
+  p.latitude = lat; p.longitude = lon; p.speedKmh = NAN; p.headingDeg = NAN;
+  p.altitudeMeters = NAN; p.hdop = NAN; p.accuracyMeters = NAN; p.odometer = NAN;
+  p.timestampMs = t; p.batteryPercent = -1; p.validFlag = 1;
+  return p;
+}
+
+// ----------------- Track files -----------------
+
+// Number at p (sign, digits, fraction, exponent) without reading past end; advances p
+static bool parse_num(const char*& p, const char* end, double* out) {
+  const char* s = p;
+  bool neg = false;
+  if (s < end && (*s == '-' || *s == '+')) neg = *s++ == '-';
+  double v = 0;
+  int digits = 0;
+  for (; s < end && *s >= '0' && *s <= '9'; ++s, ++digits) v = v * 10 + (*s - '0');
+  if (s < end && *s == '.') {
+    double scale = 0.1;
+    for (++s; s < end && *s >= '0' && *s <= '9'; ++s, ++digits, scale *= 0.1) v += (*s - '0') * scale;
+  }
+  if (!digits) return false;
+  if (s < end && (*s == 'e' || *s == 'E')) {
+    const char* e = s + 1;
+    bool eneg = false;
+    if (e < end && (*e == '-' || *e == '+')) eneg = *e++ == '-';
+    int x = 0, xd = 0;
+    for (; e < end && *e >= '0' && *e <= '9'; ++e, ++xd) x = x * 10 + (*e - '0');
+    if (xd) { v *= pow(10.0, eneg ? -x : x); s = e; }
+  }
+  *out = neg ? -v : v;
+  p = s;
+  return true;
+}
+
+static int parse_digits(const char* p, int n) {
+  int v = 0;
+  for (int i = 0; i < n; ++i) v = v * 10 + (p[i] - '0');
+  return v;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int y, int m, int d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+// "YYYY-MM-DDTHH:MM:SS[.fff][Z|+hh:mm]" in [p, end); 0 if malformed
+static uint64_t parse_iso_time(const char* p, const char* end) {
+  if (end - p < 19 || p[4] != '-' || p[7] != '-' || p[13] != ':' || p[16] != ':') return 0;
+  int64_t days = days_from_civil(parse_digits(p, 4), parse_digits(p + 5, 2), parse_digits(p + 8, 2));
+  int64_t ms = ((days * 24 + parse_digits(p + 11, 2)) * 60 + parse_digits(p + 14, 2)) * 60000 + parse_digits(p + 17, 2) * 1000;
+  const char* s = p + 19;
+  if (s < end && *s == '.') {
+    int scale = 100;
+    for (++s; s < end && *s >= '0' && *s <= '9'; ++s, scale /= 10) ms += (*s - '0') * scale;
+  }
+  if (end - s >= 6 && (*s == '+' || *s == '-')) {
+    int64_t off = (parse_digits(s + 1, 2) * 60 + parse_digits(s + 4, 2)) * 60000;
+    ms += *s == '+' ? -off : off;
+  }
+  return ms > 0 ? (uint64_t)ms : 0;
+}
+
+// Text of <tag>...</tag> within [p, end); false if absent
+static bool find_element(const char* p, const char* end, const char* tag, const char** text, const char** text_end) {
+  char open[32], close[32];
+  int on = snprintf(open, sizeof(open), "<%s>", tag), cn = snprintf(close, sizeof(close), "</%s>", tag);
+  const char* a = (const char*)memmem(p, end - p, open, on);
+  if (!a) return false;
+  a += on;
+  const char* b = (const char*)memmem(a, end - a, close, cn);
+  if (!b) return false;
+  *text = a; *text_end = b;
+  return true;
+}
+
+static bool find_attr(const char* p, const char* end, const char* name, double* out) {
+  char key[16];
+  int kn = snprintf(key, sizeof(key), " %s=", name);
+  const char* a = (const char*)memmem(p, end - p, key, kn);
+  if (!a || a + kn >= end) return false;
+  a += kn + 1; // past the quote
+  return parse_num(a, end, out);
+}
+
+static void load_gpx(const char* p, const char* end, Track* track) {
+  while ((p = (const char*)memmem(p, end - p, "<trkpt", 6)) != nullptr) {
+    const char* tag_end = (const char*)memchr(p, '>', end - p);
+    if (!tag_end) break;
+    const char* next = (const char*)memmem(tag_end, end - tag_end, "<trkpt", 6);
+    const char* close = (const char*)memmem(tag_end, (next ? next : end) - tag_end, "</trkpt>", 8);
+    const char* body_end = close ? close : tag_end;
+    double lat, lon, v;
+    if (find_attr(p, tag_end, "lat", &lat) && find_attr(p, tag_end, "lon", &lon)) {
+      const char *t, *te;
+      uint64_t ts = find_element(tag_end, body_end, "time", &t, &te) ? parse_iso_time(t, te) : 0;
+      traccar_position_t f = make_fix(ts, lat, lon);
+      if (find_element(tag_end, body_end, "ele", &t, &te) && parse_num(t, te, &v)) f.altitudeMeters = v;
+      if (find_element(tag_end, body_end, "speed", &t, &te) && parse_num(t, te, &v)) f.speedKmh = v * 3.6;
+      if (find_element(tag_end, body_end, "course", &t, &te) && parse_num(t, te, &v)) f.headingDeg = v;
+      if (find_element(tag_end, body_end, "hdop", &t, &te) && parse_num(t, te, &v)) f.hdop = v;
+      track->fixes.push_back(f);
+    }
+    p = tag_end;
+  }
+}
+
+static void on_nmea_fix(void* user, const traccar_position_t* pos) {
+  ((Track*)user)->fixes.push_back(*pos);
+}
+
+// Straight from the mapping through the library's NMEA parser
+static void load_nmea(const char* p, const char* end, Track* track) {
+  traccar_nmea_t* nmea = traccar_nmea_create(on_nmea_fix, track);
+  if (!nmea) return;
+  traccar_nmea_feed(nmea, p, (size_t)(end - p));
+  traccar_nmea_flush(nmea);
+  traccar_nmea_destroy(nmea);
+}
+
+static void load_csv(const char* p, const char* end, Track* track) {
+  while (p < end) {
+    const char* eol = (const char*)memchr(p, '\n', end - p);
+    const char* line_end = eol ? eol : end;
+    const char* s = p;
+    p = eol ? eol + 1 : end;
+    double v[5];
+    int n = 0;
+    for (; n < 5 && s < line_end; ++n) {
+      if (!parse_num(s, line_end, &v[n])) v[n] = NAN;
+      const char* comma = (const char*)memchr(s, ',', line_end - s);
+      if (!comma) { ++n; break; }
+      s = comma + 1;
+    }
+    if (n < 3 || isnan(v[0]) || isnan(v[1]) || isnan(v[2])) continue; // header or malformed
+    traccar_position_t f = make_fix((uint64_t)v[0], v[1], v[2]);
+    if (n > 3) f.speedKmh = v[3];
+    if (n > 4) f.headingDeg = v[4];
+    track->fixes.push_back(f);
+  }
+}
+
+// Maps the file and parses it in place by content: GPX, NMEA or CSV
+static bool load_track(const char* path, Track* track) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) map = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+  const char* p = (const char*)map;
+  const char* end = p + st.st_size;
+  track->name = path;
+  const char* first = p;
+  while (first < end && (*first == ' ' || *first == '\t' || *first == '\r' || *first == '\n')) ++first;
+  if (memmem(p, std::min<size_t>(end - p, 4096), "<gpx", 4)) load_gpx(p, end, track);
+  else if (first < end && *first == '$') load_nmea(p, end, track);
+  else load_csv(p, end, track);
+  munmap(map, (size_t)st.st_size);
+  return !track->fixes.empty();
+}
+
+// A 1 Hz loop of about 3 km around Milan at 36 km/h
+static Track synthetic_track() {
+  Track t;
+  t.name = "synthetic";
+  const double r = 500, lat0 = 45.4642, lon0 = 9.19;
+  for (int i = 0; i < 314; ++i) {
+    double a = i * 0.02;
+    traccar_position_t f = make_fix(1700000000000ULL + i * 1000ULL, lat0 + r * cos(a) / 6371008.8 / kRad,
+                                    lon0 + r * sin(a) / (6371008.8 * cos(lat0 * kRad)) / kRad);
+    f.speedKmh = 36; f.headingDeg = fmod(90 + a / kRad, 360); f.altitudeMeters = 122; f.hdop = 0.9;
+    t.fixes.push_back(f);
+  }
+  return t;
+}
+
+// Replay interval after fix k; the wrap back to the first fix takes the mean interval
+static double interval_ms(const Track& t, size_t k) {
+  if (k + 1 >= t.fixes.size()) return t.mean_interval_ms;
+  uint64_t a = t.fixes[k].timestampMs, b = t.fixes[k + 1].timestampMs;
+  if (!a || !b || b < a) return t.mean_interval_ms;
+  return std::min<double>((double)(b - a), 3600000);
+}
+
+static void finish_track(Track* t) {
+  const std::vector<traccar_position_t>& f = t->fixes;
+  if (f.size() > 1 && f.front().timestampMs && f.back().timestampMs > f.front().timestampMs)
+    t->mean_interval_ms = (double)(f.back().timestampMs - f.front().timestampMs) / (f.size() - 1);
+}
+
+// ----------------- Replay -----------------
+
+struct Device {
+  traccar_device_t handle;
+  const Track* track;
+  size_t next;     // fix sent next
+  double due_us;   // since the start
+};
+
+struct Worker {
+  std::vector<Device> devices;
+  std::vector<uint32_t> latency_us; // per send
+  std::vector<uint32_t> lag_us;     // send start behind its schedule
+  std::vector<uint64_t> codes;      // by code + kCodeBias
+};
+
+static const int kCodeBias = 16;
+static const int kCodeSlots = 600 + kCodeBias;
+
+static uint64_t wall_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void run_worker(Worker* w, traccar_fleet_t* fleet, traccar_format_t format, double speedup,
+                       load_clock::time_point start, load_clock::time_point deadline, std::atomic<uint64_t>* sent) {
+  // Earliest due device first; without a speedup the devices simply take turns
+  auto later = [w](size_t a, size_t b) { return w->devices[a].due_us > w->devices[b].due_us; };
+  std::vector<size_t> heap(w->devices.size());
+  for (size_t i = 0; i < heap.size(); ++i) heap[i] = i;
+  std::make_heap(heap.begin(), heap.end(), later);
+  w->codes.assign(kCodeSlots, 0);
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    Device& d = w->devices[heap.back()];
+    load_clock::time_point due = start + std::chrono::microseconds((int64_t)d.due_us);
+    if (due >= deadline) break;
+    if (speedup > 0 && due > load_clock::now()) std::this_thread::sleep_until(due);
+    traccar_position_t pos = d.track->fixes[d.next];
+    pos.timestampMs = wall_ms();
+    auto t0 = load_clock::now();
+    if (t0 >= deadline) break;
+    int code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+    traccar_fleet_send(fleet, d.handle, format, &pos, &code);
+    auto t1 = load_clock::now();
+    w->latency_us.push_back((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count());
+    if (speedup > 0) w->lag_us.push_back(t0 > due ? (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(t0 - due).count() : 0);
+    w->codes[std::max(0, std::min(kCodeSlots - 1, code + kCodeBias))]++;
+    sent->fetch_add(1, std::memory_order_relaxed);
+    d.due_us += speedup > 0 ? interval_ms(*d.track, d.next) * 1000.0 / speedup : 1;
+    d.next = (d.next + 1) % d.track->fixes.size();
+    std::push_heap(heap.begin(), heap.end(), later);
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t>& sorted, double q) {
+  if (sorted.empty()) return 0;
+  size_t i = (size_t)(q * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+static const char* code_name(int code) {
+  switch (code) {
+    case TRACCAR_HTTP_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case TRACCAR_HTTP_ERROR_SEND_FAILED: return "send failed";
+    case TRACCAR_HTTP_ERROR_NOT_CONNECTED: return "not connected";
+    case TRACCAR_HTTP_ERROR_CONNECTION_LOST: return "connection lost";
+    case TRACCAR_HTTP_ERROR_UNSUPPORTED: return "unsupported";
+    case TRACCAR_HTTP_ERROR_READ_TIMEOUT: return "read timeout";
+    default: return code < 0 ? "transport error" : nullptr;
+  }
+}
+
+static const size_t kTraceSpans = 8192; // per connection: the last ~2000 sends
+
+static void write_trace(traccar_fleet_t* fleet, const char* path) {
+  std::vector<char> doc(traccar_fleet_trace_export_chrome(fleet, nullptr, 0) + 1);
+  size_t n = traccar_fleet_trace_export_chrome(fleet, doc.data(), doc.size());
+  FILE* fp = fopen(path, "w");
+  if (!fp || fwrite(doc.data(), 1, n, fp) != n) perror(path);
+  else printf("trace    %.1f KB to %s\n", n / 1e3, path);
+  if (fp) fclose(fp);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: traccar_loadgen [-u url] [-p port] [-n devices] [-x speedup] [-w workers] [-t seconds]\n"
+          "                       [-f osmand|json] [-T trace.json] [track.gpx|track.nmea|track.csv ...]\n"
+          "       traccar_loadgen -s port [-e fail_every]\n");
+}
+
+int main(int argc, char** argv) {
+  const char* url = nullptr;
+  uint16_t port = 0;
+  size_t devices = 1000;
+  double speedup = 60;
+  unsigned workers = std::max(2u, std::thread::hardware_concurrency());
+  double seconds = 10;
+  traccar_format_t format = TRACCAR_FORMAT_OSMAND;
+  int serve_port = -1;
+  uint64_t fail_every = 0;
+  const char* trace_path = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "u:p:n:x:w:t:f:s:e:T:h")) != -1) {
+    switch (opt) {
+      case 'u': url = optarg; break;
+      case 'p': port = (uint16_t)atoi(optarg); break;
+      case 'n': devices = strtoul(optarg, nullptr, 10); break;
+      case 'x': speedup = atof(optarg); break;
+      case 'w': workers = (unsigned)atoi(optarg); break;
+      case 't': seconds = atof(optarg); break;
+      case 'f': format = optarg[0] == 'j' ? TRACCAR_FORMAT_JSON : TRACCAR_FORMAT_OSMAND; break;
+      case 's': serve_port = atoi(optarg); break;
+      case 'e': fail_every = strtoull(optarg, nullptr, 10); break;
+      case 'T': trace_path = optarg; break;
+      default: usage(); return 2;
+    }
+  }
+  if (devices == 0 || workers == 0 || seconds <= 0 || speedup < 0) { usage(); return 2; }
+
+  static StandinServer server;
+  server.fail_every = fail_every;
+  if (serve_port >= 0) {
+    if (!standin_start(&server, (uint16_t)serve_port, false)) { perror("traccar_loadgen: listen"); return 1; }
+    printf("stand-in server on port %u\n", server.port);
+    for (uint64_t last = 0;; ) {
+      sleep(1);
+      uint64_t n = server.requests.load(std::memory_order_relaxed);
+      if (n != last) printf("%10llu requests/s\n", (unsigned long long)(n - last));
+      fflush(stdout);
+      last = n;
+    }
+  }
+
+  std::vector<Track> tracks;
+  for (int i = optind; i < argc; ++i) {
+    Track t;
+    if (load_track(argv[i], &t)) tracks.push_back(std::move(t));
+    else fprintf(stderr, "skipping %s\n", argv[i]);
+  }
+  if (tracks.empty()) tracks.push_back(synthetic_track());
+  for (Track& t : tracks) finish_track(&t);
+
+  std::string target;
+  bool standin = !url;
+  if (standin) {
+    if (!standin_start(&server, 0, true)) { perror("traccar_loadgen: listen"); return 1; }
+    url = "http://127.0.0.1";
+    port = server.port;
+    target = "stand-in server";
+  }
+  traccar_fleet_t* fleet = traccar_fleet_create(url, port, workers);
+  if (!fleet) { fprintf(stderr, "traccar_fleet_create failed\n"); return 1; }
+  if (trace_path && !traccar_fleet_set_trace(fleet, kTraceSpans)) { fprintf(stderr, "traccar_fleet_set_trace failed\n"); return 1; }
+
+  // Devices start at spread-out fixes of their track, each at its own phase of the first interval
+  std::vector<Worker> ws(workers);
+  uint64_t rng = 0x9E3779B97F4A7C15ULL;
+  double target_rate = 0;
+  for (size_t i = 0; i < devices; ++i) {
+    char id[32];
+    snprintf(id, sizeof(id), "loadgen-%06zu", i);
+    Device d;
+    d.handle = traccar_fleet_device(fleet, id);
+    if (d.handle == TRACCAR_NO_DEVICE) { fprintf(stderr, "device table full at %zu\n", i); return 1; }
+    d.track = &tracks[i % tracks.size()];
+    rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+    d.next = (size_t)(rng % d.track->fixes.size());
+    d.due_us = speedup > 0 ? (double)(rng >> 32) / 4294967296.0 * interval_ms(*d.track, d.next) * 1000.0 / speedup : 0;
+    target_rate += speedup * 1000.0 / d.track->mean_interval_ms;
+    ws[i % workers].devices.push_back(d);
+  }
+  for (Worker& w : ws) {
+    size_t expect = speedup > 0 ? (size_t)(target_rate / workers * seconds * 1.2) + 1024 : 1 << 20;
+    w.latency_us.reserve(std::min<size_t>(expect, 64 << 20));
+    if (speedup > 0) w.lag_us.reserve(std::min<size_t>(expect, 64 << 20));
+  }
+
+  if (target.empty()) target = std::string(url) + (port ? ":" + std::to_string(port) : "");
+  printf("%zu devices, %zu tracks, %u workers, %s, %s -> %s\n", devices, tracks.size(), workers,
+         format == TRACCAR_FORMAT_JSON ? "json" : "osmand",
+         speedup > 0 ? (std::to_string((int)speedup) + "x real time (" + std::to_string((long)target_rate) + " fixes/s)").c_str()
+                     : "as fast as possible",
+         target.c_str());
+
+  std::atomic<uint64_t> sent(0);
+  auto start = load_clock::now();
+  auto deadline = start + std::chrono::microseconds((int64_t)(seconds * 1e6));
+  std::vector<std::thread> threads;
+  for (Worker& w : ws) threads.emplace_back(run_worker, &w, fleet, format, speedup, start, deadline, &sent);
+  uint64_t last = 0;
+  for (int s = 1; load_clock::now() + std::chrono::seconds(1) <= deadline; ++s) {
+    std::this_thread::sleep_until(start + std::chrono::seconds(s));
+    uint64_t n = sent.load(std::memory_order_relaxed);
+    printf("%5d s %10llu fixes/s\n", s, (unsigned long long)(n - last));
+    fflush(stdout);
+    last = n;
+  }
+  for (std::thread& t : threads) t.join();
+  double elapsed = std::chrono::duration<double>(load_clock::now() - start).count();
+
+  std::vector<uint32_t> latency, lag;
+  std::vector<uint64_t> codes(kCodeSlots, 0);
+  for (Worker& w : ws) {
+    latency.insert(latency.end(), w.latency_us.begin(), w.latency_us.end());
+    lag.insert(lag.end(), w.lag_us.begin(), w.lag_us.end());
+    for (int i = 0; i < kCodeSlots; ++i) codes[i] += w.codes[i];
+  }
+  std::sort(latency.begin(), latency.end());
+  std::sort(lag.begin(), lag.end());
+  traccar_stats_t st;
+  traccar_fleet_get_stats(fleet, &st);
+
+  double rate = latency.size() / elapsed;
+  printf("sent     %zu fixes in %.2f s: %.0f fixes/s", latency.size(), elapsed, rate);
+  if (speedup > 0) printf(" (%.1f%% of target)", 100.0 * rate / target_rate);
+  printf("\nlatency  p50 %u us  p90 %u us  p99 %u us  p99.9 %u us  max %u us\n", percentile(latency, 0.5),
+         percentile(latency, 0.9), percentile(latency, 0.99), percentile(latency, 0.999), latency.empty() ? 0 : latency.back());
+  if (speedup > 0)
+    printf("lag      p50 %u us  p99 %u us  max %u us (send start behind schedule)\n", percentile(lag, 0.5),
+           percentile(lag, 0.99), lag.empty() ? 0 : lag.back());
+  printf("encoded  %.1f MB (%.1f MB/s), %llu connects, %llu stale retries\n", st.bytes_encoded / 1e6,
+         st.bytes_encoded / 1e6 / elapsed, (unsigned long long)st.connects, (unsigned long long)st.retries);
+  printf("codes   ");
+  for (int i = 0; i < kCodeSlots; ++i) {
+    if (!codes[i]) continue;
+    int code = i - kCodeBias;
+    const char* name = code_name(code);
+    if (name) printf(" %d (%s): %llu", code, name, (unsigned long long)codes[i]);
+    else printf(" %d: %llu", code, (unsigned long long)codes[i]);
+  }
+  printf("\n");
+  if (standin) printf("server   %llu requests\n", (unsigned long long)server.requests.load());
+  if (trace_path) write_trace(fleet, trace_path);
+
+  traccar_fleet_destroy(fleet);
+  return codes[200 + kCodeBias] ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Upload daemon for multi-process gateways: owns one client (one connection) and sends what the
+// gateway's processes submit through the shared-memory ring of TraccarShm.h, in order and in
+// batches. SIGINT / SIGTERM stop it after one attempt at what was already submitted.
+//
+//   traccar_shmd -u url [-p port] -i device_id [-n name] [-c capacity] [-b max_batch]
+//                [-f osmand|json] [-v]
+//   traccar_shmd -S count [-n name]          (act as a producer: submit count test positions)
+//
+// To try it on one machine, point it at the load generator's stand-in server:
+//
+//   traccar_loadgen -s 5055 &
+//   traccar_shmd -u http://127.0.0.1 -p 5055 -i gateway-1 -v &
+//   traccar_shmd -S 1000
+
+#include "TraccarShm.h"
+
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static traccar_shm_daemon_t* g_daemon;
+
+static void on_signal(int) {
+  traccar_shm_daemon_stop(g_daemon);
+}
+
+static void on_batch(void*, const traccar_position_t*, size_t n, const bool* accepted, int http_code) {
+  size_t ok = 0;
+  for (size_t i = 0; i < n; ++i) ok += accepted[i];
+  printf("batch of %zu: %zu accepted, HTTP %d\n", n, ok, http_code);
+  fflush(stdout);
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: traccar_shmd -u url [-p port] -i device_id [-n name] [-c capacity] [-b max_batch]\n"
+          "                    [-f osmand|json] [-v]\n"
+          "       traccar_shmd -S count [-n name]\n");
+}
+
+// Producer mode: a slow walk north from Milan, one fix every 10 ms
+static int produce(const char* name, long count) {
+  traccar_shm_producer_t* p = traccar_shm_open(name);
+  if (!p) { fprintf(stderr, "traccar_shmd: no uploader on %s\n", name); return 1; }
+  long sent = 0, refused = 0;
+  for (long i = 0; i < count; ++i) {
+    traccar_position_t pos = {};
+    pos.latitude = 45.4642 + i * 1e-5; pos.longitude = 9.19; pos.speedKmh = 4.0; pos.headingDeg = 0;
+    pos.altitudeMeters = NAN; pos.hdop = NAN; pos.accuracyMeters = NAN; pos.odometer = NAN;
+    pos.timestampMs = (uint64_t)time(nullptr) * 1000ULL; pos.batteryPercent = -1; pos.validFlag = 1;
+    pos.eventName = i == 0 ? "start" : nullptr;
+    if (traccar_shm_submit(p, &pos)) ++sent;
+    else ++refused;
+    struct timespec ts = { 0, 10000000 };
+    nanosleep(&ts, nullptr);
+  }
+  traccar_shm_counts_t c;
+  traccar_shm_get_counts(p, &c);
+  printf("submitted %ld, refused %ld; ring: %llu submitted, %llu delivered, %llu failed\n", sent, refused,
+         (unsigned long long)c.submitted, (unsigned long long)c.delivered, (unsigned long long)c.failed);
+  traccar_shm_close(p);
+  return refused ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* url = nullptr;
+  const char* device = nullptr;
+  const char* name = "/traccar";
+  uint16_t port = 0;
+  size_t capacity = 4096, max_batch = 64;
+  traccar_format_t format = TRACCAR_FORMAT_OSMAND;
+  bool verbose = false;
+  long produce_count = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "u:p:i:n:c:b:f:vS:h")) != -1) {
+    switch (opt) {
+      case 'u': url = optarg; break;
+      case 'p': port = (uint16_t)atoi(optarg); break;
+      case 'i': device = optarg; break;
+      case 'n': name = optarg; break;
+      case 'c': capacity = strtoul(optarg, nullptr, 10); break;
+      case 'b': max_batch = strtoul(optarg, nullptr, 10); break;
+      case 'f': format = optarg[0] == 'j' ? TRACCAR_FORMAT_JSON : TRACCAR_FORMAT_OSMAND; break;
+      case 'v': verbose = true; break;
+      case 'S': produce_count = atol(optarg); break;
+      default: usage(); return 2;
+    }
+  }
+  if (produce_count > 0) return produce(name, produce_count);
+  if (!url || !device) { usage(); return 2; }
+
+  traccar_client_t* client = traccar_create(url, port, device);
+  if (!client) { fprintf(stderr, "traccar_shmd: traccar_create failed\n"); return 1; }
+  traccar_set_keep_alive(client, true);
+  g_daemon = traccar_shm_daemon_create(name, client, format, capacity, verbose ? on_batch : nullptr, nullptr);
+  if (!g_daemon) { perror("traccar_shmd: shared memory"); return 1; }
+  traccar_shm_daemon_set_max_batch(g_daemon, max_batch);
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;
+  sigaction(SIGINT, &sa, nullptr);
+  sigaction(SIGTERM, &sa, nullptr);
+
+  printf("uploading from %s to %s:%u as %s\n", name, url, port, device);
+  fflush(stdout);
+  traccar_shm_daemon_run(g_daemon);
+
+  traccar_shm_counts_t c;
+  traccar_shm_daemon_get_counts(g_daemon, &c);
+  printf("%llu submitted, %llu delivered, %llu failed in %llu batches, %llu refused (ring full), %llu skipped\n",
+         (unsigned long long)c.submitted, (unsigned long long)c.delivered, (unsigned long long)c.failed,
+         (unsigned long long)c.batches, (unsigned long long)c.full, (unsigned long long)c.skipped);
+  traccar_shm_daemon_destroy(g_daemon);
+  traccar_destroy(client);
+  return 0;
+}
@@ -0,0 +1,143 @@
+#include "standin.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+// Value of the header name in head[0..n), or nullptr
+static const char* header(const char* head, size_t n, const char* name) {
+  size_t len = strlen(name);
+  for (const char* p = head; p < head + n;) {
+    const char* eol = (const char*)memchr(p, '\n', head + n - p);
+    if (!eol) break;
+    if ((size_t)(eol - p) > len && p[len] == ':' && !strncasecmp(p, name, len)) {
+      p += len + 1;
+      while (*p == ' ') ++p;
+      return p;
+    }
+    p = eol + 1;
+  }
+  return nullptr;
+}
+
+static bool write_all(int fd, const char* p, size_t n) {
+  while (n) {
+    ssize_t w = write(fd, p, n);
+    if (w <= 0) return false;
+    p += w; n -= (size_t)w;
+  }
+  return true;
+}
+
+static void append_response(std::string* out, int code, bool close) {
+  char line[128];
+  snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nContent-Length: 0\r\n%s\r\n", code, code == 200 ? "OK" : "Error",
+           close ? "Connection: close\r\n" : "");
+  out->append(line);
+}
+
+// One connection; pipelined requests are answered with one write per read
+static void serve_connection(StandinServer* s, int fd) {
+  std::vector<char> in(65536);
+  std::string out;
+  size_t len = 0;
+  bool open = true;
+  while (open) {
+    if (len == in.size()) in.resize(in.size() * 2);
+    ssize_t n = read(fd, in.data() + len, in.size() - len);
+    if (n <= 0) break;
+    len += (size_t)n;
+    size_t pos = 0;
+    out.clear();
+    while (open) {
+      const char* head = in.data() + pos;
+      const char* e = (const char*)memmem(head, len - pos, "\r\n\r\n", 4);
+      if (!e) break;
+      size_t head_len = (size_t)(e - head) + 4;
+      const char* cl = header(head, head_len, "Content-Length");
+      size_t total = head_len + (cl ? strtoul(cl, nullptr, 10) : 0);
+      if (len - pos < total) break;
+      const char* conn = header(head, head_len, "Connection");
+      bool close = conn && !strncasecmp(conn, "close", 5);
+      if (s->record) {
+        std::lock_guard<std::mutex> g(s->lock);
+        s->received.emplace_back(head, total);
+      }
+      pos += total;
+      uint64_t k = s->requests.fetch_add(1, std::memory_order_relaxed) + 1;
+      int code = s->status.load(std::memory_order_relaxed);
+      if (s->fail_every && k % s->fail_every == 0) code = 500;
+      if (!code) { open = false; out.clear(); break; }
+      append_response(&out, code, close);
+      if (close) open = false;
+    }
+    memmove(in.data(), in.data() + pos, len - pos);
+    len -= pos;
+    if (!out.empty() && !write_all(fd, out.data(), out.size())) break;
+  }
+  std::lock_guard<std::mutex> g(s->lock);
+  // Closed under the lock, so standin_stop never shuts down a descriptor number reused since
+  s->conns.erase(std::find(s->conns.begin(), s->conns.end(), fd));
+  close(fd);
+  if (--s->active == 0) s->idle.notify_all();
+}
+
+bool standin_start(StandinServer* s, uint16_t port, bool loopback) {
+  s->fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (s->fd < 0) return false;
+  int one = 1;
+  setsockopt(s->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(loopback ? INADDR_LOOPBACK : INADDR_ANY);
+  socklen_t al = sizeof(a);
+  if (bind(s->fd, (struct sockaddr*)&a, sizeof(a)) != 0 || listen(s->fd, 1024) != 0 ||
+      getsockname(s->fd, (struct sockaddr*)&a, &al) != 0) {
+    close(s->fd);
+    s->fd = -1;
+    return false;
+  }
+  s->port = ntohs(a.sin_port);
+  s->stopping = false;
+  s->acceptor = std::thread([s] {
+    while (!s->stopping.load()) {
+      int c = accept(s->fd, nullptr, nullptr);
+      if (c < 0) continue;
+      int on = 1;
+      setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+      s->connections.fetch_add(1, std::memory_order_relaxed);
+      std::lock_guard<std::mutex> g(s->lock);
+      if (s->stopping.load()) { close(c); break; }
+      s->conns.push_back(c);
+      ++s->active;
+      std::thread(serve_connection, s, c).detach();
+    }
+  });
+  return true;
+}
+
+void standin_stop(StandinServer* s) {
+  if (s->fd < 0) return;
+  s->stopping = true;
+  shutdown(s->fd, SHUT_RDWR); // wakes accept
+  s->acceptor.join();
+  close(s->fd);
+  s->fd = -1;
+  std::unique_lock<std::mutex> g(s->lock);
+  for (int c : s->conns) shutdown(c, SHUT_RDWR); // wakes read; its thread closes it
+  s->idle.wait(g, [s] { return s->active == 0; });
+}
+
+StandinServer::~StandinServer() { standin_stop(this); }
+
+std::vector<std::string> standin_received(StandinServer* s) {
+  std::lock_guard<std::mutex> g(s->lock);
+  return s->received;
+}
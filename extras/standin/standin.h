@@ -0,0 +1,51 @@
+// In-process stand-in Traccar server for the load generator, the benchmarks and the tests: it
+// listens on a port, reads HTTP/1.1 requests (keep-alive and pipelined) and answers each with an
+// empty response, so the library's transport can be exercised with nothing else running.
+//
+//   StandinServer server;
+//   standin_start(&server, 0, true);          // any free loopback port: server.port
+//   traccar_create("http://127.0.0.1", server.port, "dev");
+//   ...
+//   standin_stop(&server);
+
+#ifndef TRACCAR_STANDIN_H
+#define TRACCAR_STANDIN_H
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct StandinServer {
+  uint16_t port = 0;
+  uint64_t fail_every = 0;           // every fail_every-th request is answered 500
+  std::atomic<int> status{200};      // answer to the others; 0 closes the connection unanswered
+  bool record = false;               // keep every request (head and body) in received
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> connections{0};
+  std::mutex lock;                   // guards received, conns and active
+  std::vector<std::string> received;
+
+  int fd = -1;
+  std::atomic<bool> stopping{false};
+  std::thread acceptor;
+  std::vector<int> conns;            // open connections, each served by its own thread
+  int active = 0;                    // connection threads still running
+  std::condition_variable idle;      // signalled when active drops to 0
+
+  ~StandinServer();                  // standin_stop
+};
+
+// Listens on port (0 = any free one; the port taken is left in s->port), on loopback only or
+// on every interface; false if the socket cannot be bound
+bool standin_start(StandinServer* s, uint16_t port, bool loopback);
+// Closes the listener and every connection and waits for the server threads
+void standin_stop(StandinServer* s);
+
+// Copy of the requests recorded so far (record = true)
+std::vector<std::string> standin_received(StandinServer* s);
+
+#endif // TRACCAR_STANDIN_H
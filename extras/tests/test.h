@@ -0,0 +1,51 @@
+// Minimal harness for traccar_tests: TEST(name) registers a case, CHECK* record a failure (file,
+// line, expression and, for the comparisons, both values) and let the case go on, REQUIRE ends it.
+//
+//   traccar_tests [filter]   (runs the cases whose name contains filter; exit status 1 on failure)
+
+#ifndef TRACCAR_TEST_H
+#define TRACCAR_TEST_H
+
+#include "TraccarClient.h"
+
+#include <math.h>
+#include <string>
+
+struct TestCase {
+  const char* name;
+  void (*fn)();
+  TestCase* next;
+  TestCase(const char* name, void (*fn)());
+};
+
+void test_fail(const char* file, int line, const char* what);
+void test_fail_int(const char* file, int line, const char* a, const char* b, long long va, long long vb);
+void test_fail_str(const char* file, int line, const char* a, const char* b, const std::string& va, const std::string& vb);
+bool test_failed(); // the running case has failed a check
+
+#define TEST(name) \
+  static void test_##name(); \
+  static TestCase test_case_##name(#name, test_##name); \
+  static void test_##name()
+
+#define CHECK(cond) do { if (!(cond)) test_fail(__FILE__, __LINE__, #cond); } while (0)
+#define CHECK_EQ(a, b) do { \
+    long long va_ = (long long)(a), vb_ = (long long)(b); \
+    if (va_ != vb_) test_fail_int(__FILE__, __LINE__, #a, #b, va_, vb_); \
+  } while (0)
+#define CHECK_STR(a, b) do { \
+    std::string va_(a), vb_(b); \
+    if (va_ != vb_) test_fail_str(__FILE__, __LINE__, #a, #b, va_, vb_); \
+  } while (0)
+#define REQUIRE(cond) do { if (!(cond)) { test_fail(__FILE__, __LINE__, #cond); return; } } while (0)
+
+// A position with every field omitted
+inline traccar_position_t test_empty_position() {
+  traccar_position_t p = {};
+  p.latitude = NAN; p.longitude = NAN; p.altitudeMeters = NAN; p.speedKmh = NAN;
+  p.headingDeg = NAN; p.hdop = NAN; p.accuracyMeters = NAN; p.odometer = NAN;
+  p.batteryPercent = -1; p.validFlag = -1;
+  return p;
+}
+
+#endif // TRACCAR_TEST_H
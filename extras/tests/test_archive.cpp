@@ -0,0 +1,182 @@
+// Track archive: a torn last block is dropped on open, a block that fails its CRC is skipped by
+// scans, range edges across the written blocks and the pending one, and an export resumed from
+// its cursor that neither repeats a fix sharing a millisecond nor misses one appended later with
+// an older timestamp.
+
+#include "test.h"
+#include "TraccarArchive.h"
+#include "standin.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+static std::string archive_path(const char* what) {
+  char path[96];
+  snprintf(path, sizeof(path), "/tmp/traccar-test-%s-%d.tca", what, (int)getpid());
+  unlink(path);
+  return path;
+}
+
+static traccar_position_t archive_position(uint64_t t_ms, int i) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.0 + i * 1e-4; p.longitude = 9.0; p.altitudeMeters = i; p.validFlag = 1;
+  p.timestampMs = t_ms;
+  return p;
+}
+
+// Fix i at 1000 * (i + 1) ms
+static bool append_range(traccar_archive_t* a, int from, int to) {
+  for (int i = from; i < to; ++i) {
+    traccar_position_t p = archive_position(1000ULL * (i + 1), i);
+    if (!traccar_archive_append(a, &p)) return false;
+  }
+  return true;
+}
+
+static bool collect_cb(void* user, const traccar_position_t* positions, size_t n) {
+  std::vector<int>* out = (std::vector<int>*)user;
+  for (size_t i = 0; i < n; ++i) out->push_back((int)positions[i].altitudeMeters);
+  return true;
+}
+
+// The fixes in [from_ms, to_ms), by number
+static std::vector<int> scan(traccar_archive_t* a, uint64_t from_ms, uint64_t to_ms) {
+  std::vector<int> got;
+  traccar_archive_scan(a, from_ms, to_ms, collect_cb, &got);
+  return got;
+}
+
+static std::vector<int> numbers(int from, int to) {
+  std::vector<int> v;
+  for (int i = from; i < to; ++i) v.push_back(i);
+  return v;
+}
+
+static void poke(const std::string& path, off_t at, uint8_t v) {
+  int fd = open(path.c_str(), O_WRONLY);
+  if (fd < 0 || pwrite(fd, &v, 1, at) != 1) test_fail(__FILE__, __LINE__, "poke");
+  if (fd >= 0) close(fd);
+}
+
+TEST(archive_torn_tail) {
+  const int B = TRACCAR_ARCHIVE_BLOCK;
+  struct { const char* what; bool truncate; } tears[] = { { "torn-cut", true }, { "torn-crc", false } };
+  for (const auto& tear : tears) {
+    std::string path = archive_path(tear.what);
+    traccar_archive_t* a = traccar_archive_open(path.c_str());
+    REQUIRE(a && append_range(a, 0, B) && traccar_archive_flush(a));
+    uint64_t one = traccar_archive_bytes(a);
+    REQUIRE(append_range(a, B, B + 10) && traccar_archive_flush(a));
+    uint64_t two = traccar_archive_bytes(a);
+    traccar_archive_close(a);
+    // The second block is cut short, or a byte of its columns never reached the disk
+    if (tear.truncate) CHECK(truncate(path.c_str(), (off_t)(two - 3)) == 0);
+    else poke(path, (off_t)(two - 2), 0xA5);
+    a = traccar_archive_open(path.c_str());
+    REQUIRE(a);
+    CHECK_EQ(traccar_archive_count(a), B);
+    CHECK_EQ(traccar_archive_bytes(a), one);
+    CHECK(scan(a, 0, UINT64_MAX) == numbers(0, B));
+    // Appending goes on where the intact blocks end
+    REQUIRE(append_range(a, B, B + 5) && traccar_archive_flush(a));
+    traccar_archive_close(a);
+    a = traccar_archive_open(path.c_str());
+    REQUIRE(a);
+    CHECK(scan(a, 0, UINT64_MAX) == numbers(0, B + 5));
+    traccar_archive_close(a);
+    unlink(path.c_str());
+  }
+}
+
+TEST(archive_bad_block) {
+  const int B = TRACCAR_ARCHIVE_BLOCK;
+  std::string path = archive_path("crc");
+  traccar_archive_t* a = traccar_archive_open(path.c_str());
+  REQUIRE(a);
+  uint64_t ends[4] = { traccar_archive_bytes(a) };
+  for (int b = 0; b < 3; ++b) {
+    REQUIRE(append_range(a, b * B, (b + 1) * B) && traccar_archive_flush(a));
+    ends[b + 1] = traccar_archive_bytes(a);
+  }
+  traccar_archive_close(a);
+  // A flipped byte in the middle of the second block: only the last block is checked on open
+  poke(path, (off_t)((ends[1] + ends[2]) / 2), 0xA5);
+  a = traccar_archive_open(path.c_str());
+  REQUIRE(a);
+  CHECK_EQ(traccar_archive_count(a), 3 * B);
+  std::vector<int> expect = numbers(0, B), last = numbers(2 * B, 3 * B);
+  expect.insert(expect.end(), last.begin(), last.end());
+  CHECK(scan(a, 0, UINT64_MAX) == expect);
+  CHECK(scan(a, 1000ULL * (B + 1), 1000ULL * (2 * B + 1)).empty()); // only the bad block
+  traccar_archive_close(a);
+  unlink(path.c_str());
+}
+
+TEST(archive_range_edges) {
+  const int B = TRACCAR_ARCHIVE_BLOCK;
+  std::string path = archive_path("range");
+  traccar_archive_t* a = traccar_archive_open(path.c_str());
+  REQUIRE(a && append_range(a, 0, B + 20)); // one written block, 20 fixes pending
+  CHECK_EQ(traccar_archive_count(a), B + 20);
+  auto ms = [](int i) { return 1000ULL * (i + 1); };
+  CHECK(scan(a, ms(B - 6), ms(B + 4)) == numbers(B - 6, B + 4)); // across the two
+  CHECK(scan(a, ms(B), ms(B + 19)) == numbers(B, B + 19));     // to_ms is the last pending one's
+  CHECK(scan(a, ms(B + 19), ms(B + 19) + 1) == numbers(B + 19, B + 20));
+  CHECK(scan(a, ms(0), ms(B)) == numbers(0, B));               // ends where the pending block starts
+  CHECK(scan(a, ms(B - 1), ms(B) + 1) == numbers(B - 1, B + 1));
+  CHECK(scan(a, ms(B + 20), UINT64_MAX).empty());
+  CHECK(scan(a, ms(5), ms(5)).empty());
+  // Written again after a flush, the same ranges give the same fixes
+  REQUIRE(traccar_archive_flush(a));
+  CHECK(scan(a, ms(B - 6), ms(B + 4)) == numbers(B - 6, B + 4));
+  CHECK(scan(a, ms(B), ms(B + 19)) == numbers(B, B + 19));
+  traccar_archive_close(a);
+  unlink(path.c_str());
+}
+
+TEST(archive_export_resume) {
+  StandinServer server;
+  server.fail_every = 8; // refused: the 8th, 16th, ... request
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  std::string path = archive_path("export");
+  traccar_archive_t* a = traccar_archive_open(path.c_str());
+  REQUIRE(a);
+  // Fixes share their millisecond two by two
+  for (int i = 0; i < 20; ++i) {
+    traccar_position_t p = archive_position(100000 + 1000ULL * (i / 2), i);
+    REQUIRE(traccar_archive_append(a, &p));
+  }
+  REQUIRE(traccar_archive_flush(a));
+  // Each export sends everything from the cursor on; the accepted prefix counts
+  uint64_t cursor = 0;
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 7);
+  CHECK_EQ(cursor, 7); // fix 7 shares its millisecond with the delivered fix 6
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 3);
+  CHECK_EQ(cursor, 10);
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 6);
+  CHECK_EQ(cursor, 16);
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 4);
+  CHECK_EQ(cursor, 20);
+  uint64_t requests = server.requests.load();
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 0);
+  CHECK_EQ(cursor, 20);
+  CHECK_EQ(server.requests.load(), requests); // nothing left to send
+  // A fix appended later with an older timestamp, still pending; its first request is the 48th
+  traccar_position_t late = archive_position(50000, 20);
+  REQUIRE(traccar_archive_append(a, &late));
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 0);
+  CHECK_EQ(cursor, 20);
+  CHECK_EQ(traccar_archive_export(a, 0, UINT64_MAX, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 1);
+  CHECK_EQ(cursor, 21);
+  // Out of the range, it is passed over: the cursor still moves to the end
+  cursor = 0;
+  CHECK_EQ(traccar_archive_export(a, 100000, 103000, c, TRACCAR_FORMAT_OSMAND, 64, &cursor), 6);
+  CHECK_EQ(cursor, 21);
+  traccar_archive_close(a);
+  traccar_destroy(c);
+  unlink(path.c_str());
+}
@@ -0,0 +1,113 @@
+// Async sends against the stand-in server: results in submission order, and callbacks that
+// queue, poll, change the server or destroy the client while other requests are pending.
+
+#include "test.h"
+#include "standin.h"
+
+#include <vector>
+
+struct AsyncLog {
+  traccar_client_t* client;
+  std::vector<int> codes;
+  int action;  // what the first callback does
+  uint16_t port;
+};
+
+enum { ACT_NONE, ACT_DESTROY, ACT_SET_HOST, ACT_SET_PORT, ACT_SEND_AND_POLL };
+
+static void on_sent(traccar_client_t* c, void* user, int code) {
+  AsyncLog* log = (AsyncLog*)user;
+  log->codes.push_back(code);
+  if (log->codes.size() != 1) return;
+  traccar_position_t p = test_empty_position();
+  p.timestampMs = 1;
+  switch (log->action) {
+    case ACT_DESTROY: traccar_destroy(c); log->client = nullptr; break;
+    case ACT_SET_HOST: traccar_set_host(c, "http://127.0.0.1"); break;
+    case ACT_SET_PORT: traccar_set_port(c, log->port); break;
+    case ACT_SEND_AND_POLL:
+      CHECK(traccar_send_async(c, TRACCAR_FORMAT_JSON, &p, on_sent, log));
+      traccar_poll(c, 0); // results it finds are reported by the outer poll, after this one
+      break;
+  }
+}
+
+// Queues n sends, waits for every result; the client may be gone afterwards
+static void run(StandinServer* server, AsyncLog* log, int n) {
+  log->client = traccar_create("http://127.0.0.1", server->port, "dev");
+  log->port = server->port;
+  if (log->action != ACT_NONE) traccar_set_pipeline_depth(log->client, 1); // one answer per poll: the rest still queued
+  traccar_position_t p = test_empty_position();
+  for (int i = 0; i < n; ++i) {
+    p.timestampMs = 1000ULL * (i + 1);
+    CHECK(traccar_send_async(log->client, TRACCAR_FORMAT_OSMAND, &p, on_sent, log));
+  }
+  for (int i = 0; i < 1000 && log->client && traccar_poll(log->client, 100) > 0; ++i) {}
+}
+
+TEST(async_results_in_order) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  server.fail_every = 3;
+  AsyncLog log = { nullptr, {}, ACT_NONE, 0 };
+  run(&server, &log, 9);
+  std::vector<int> want = { 200, 200, 500, 200, 200, 500, 200, 200, 500 };
+  CHECK(log.codes == want);
+  traccar_destroy(log.client);
+}
+
+TEST(async_callback_destroys_client) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  AsyncLog log = { nullptr, {}, ACT_DESTROY, 0 };
+  run(&server, &log, 6);
+  CHECK(!log.client);
+  // Every request is reported once: the first answered, the rest failed by the destroy
+  REQUIRE(log.codes.size() == 6);
+  CHECK_EQ(log.codes[0], 200);
+  for (size_t i = 1; i < log.codes.size(); ++i) CHECK_EQ(log.codes[i], TRACCAR_HTTP_ERROR_NOT_CONNECTED);
+}
+
+TEST(async_callback_changes_server) {
+  for (int action : { ACT_SET_HOST, ACT_SET_PORT }) {
+    StandinServer server;
+    REQUIRE(standin_start(&server, 0, true));
+    AsyncLog log = { nullptr, {}, action, 0 };
+    run(&server, &log, 6);
+    REQUIRE(log.codes.size() == 6);
+    CHECK_EQ(log.codes[0], 200);
+    for (size_t i = 1; i < log.codes.size(); ++i) CHECK_EQ(log.codes[i], TRACCAR_HTTP_ERROR_NOT_CONNECTED);
+    // The client still works against the new configuration
+    traccar_position_t p = test_empty_position();
+    p.timestampMs = 1;
+    log.action = ACT_NONE;
+    CHECK(traccar_send_async(log.client, TRACCAR_FORMAT_OSMAND, &p, on_sent, &log));
+    for (int i = 0; i < 100 && traccar_poll(log.client, 100) > 0; ++i) {}
+    CHECK_EQ(log.codes.back(), 200);
+    traccar_destroy(log.client);
+  }
+}
+
+TEST(async_callback_sends_and_polls) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  AsyncLog log = { nullptr, {}, ACT_SEND_AND_POLL, 0 };
+  run(&server, &log, 4);
+  CHECK_EQ(log.codes.size(), 5);
+  for (int code : log.codes) CHECK_EQ(code, 200);
+  traccar_destroy(log.client);
+}
+
+TEST(async_destroy_reports_pending) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  server.status = 0; // never answered
+  AsyncLog log = { nullptr, {}, ACT_DESTROY, 0 };
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_position_t p = test_empty_position();
+  for (int i = 0; i < 3; ++i) CHECK(traccar_send_async(c, TRACCAR_FORMAT_OSMAND, &p, on_sent, &log));
+  // The first result destroys the client again from inside traccar_destroy
+  traccar_destroy(c);
+  REQUIRE(log.codes.size() == 3);
+  for (int code : log.codes) CHECK_EQ(code, TRACCAR_HTTP_ERROR_NOT_CONNECTED);
+}
@@ -0,0 +1,258 @@
+// Codec 8 sender against a Teltonika stand-in on a loopback port: the login, the AVL record
+// layout decoded field by field, the CRC16 against a bitwise reference, and how partial, zero
+// and refused acknowledgements are handled.
+
+#include "test.h"
+#include "TraccarCodec8.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AvlRecord {
+  uint64_t timestamp;
+  int32_t lon, lat;
+  int16_t altitude;
+  uint16_t angle;
+  uint8_t satellites;
+  uint16_t speed;
+  std::map<int, uint64_t> io;
+};
+
+struct Codec8Server {
+  int fd = -1;
+  uint16_t port = 0;
+  std::thread thread;
+  std::atomic<bool> accept_imei{true};
+  std::atomic<size_t> ack_limit{255}; // acknowledge at most this many records of each packet
+  std::mutex lock;        // guards what follows
+  std::string imei;
+  std::vector<AvlRecord> records;
+  int logins = 0, packets = 0, malformed = 0;
+};
+
+static bool read_all(int fd, uint8_t* out, size_t n) {
+  while (n) {
+    ssize_t r = recv(fd, out, n, 0);
+    if (r <= 0) return false;
+    out += r; n -= (size_t)r;
+  }
+  return true;
+}
+
+static uint64_t be(const uint8_t*& p, int bytes) {
+  uint64_t v = 0;
+  while (bytes--) v = v << 8 | *p++;
+  return v;
+}
+
+// Bitwise CRC-16/IBM, as the Teltonika documentation gives it
+static uint16_t crc16_ref(const uint8_t* p, size_t n) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= p[i];
+    for (int b = 0; b < 8; ++b) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+// Decodes codec id .. second record count; false if the layout does not add up
+static bool decode_avl(const uint8_t* data, size_t len, std::vector<AvlRecord>* out) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + len;
+  if (len < 3 || *p++ != 0x08) return false;
+  size_t count = *p++;
+  for (size_t i = 0; i < count; ++i) {
+    if (end - p < 26) return false;
+    AvlRecord r;
+    r.timestamp = be(p, 8);
+    p++; // priority
+    r.lon = (int32_t)be(p, 4);
+    r.lat = (int32_t)be(p, 4);
+    r.altitude = (int16_t)be(p, 2);
+    r.angle = (uint16_t)be(p, 2);
+    r.satellites = (uint8_t)be(p, 1);
+    r.speed = (uint16_t)be(p, 2);
+    p++; // event io id
+    size_t total = *p++, seen = 0;
+    for (int size = 1; size <= 8; size *= 2) {
+      if (end - p < 1) return false;
+      size_t n = *p++;
+      if ((size_t)(end - p) < n * (1 + size)) return false;
+      for (size_t k = 0; k < n; ++k) {
+        int id = *p++;
+        r.io[id] = be(p, size);
+      }
+      seen += n;
+    }
+    if (seen != total) return false;
+    out->push_back(r);
+  }
+  return end - p == 1 && *p == count;
+}
+
+static void serve_connection(Codec8Server* s, int fd) {
+  uint8_t head[2];
+  if (!read_all(fd, head, 2)) return;
+  std::string imei((size_t)(head[0] << 8 | head[1]), '\0');
+  if (!read_all(fd, (uint8_t*)&imei[0], imei.size())) return;
+  {
+    std::lock_guard<std::mutex> g(s->lock);
+    s->imei = imei; s->logins++;
+  }
+  uint8_t reply = s->accept_imei ? 0x01 : 0x00;
+  if (send(fd, &reply, 1, MSG_NOSIGNAL) != 1 || !reply) return;
+  for (;;) {
+    uint8_t header[8];
+    if (!read_all(fd, header, 8)) return;
+    const uint8_t* h = header;
+    uint64_t preamble = be(h, 4), len = be(h, 4);
+    std::vector<uint8_t> data(len + 4);
+    if (preamble != 0 || len > 65536 || !read_all(fd, data.data(), data.size())) return;
+    const uint8_t* c = data.data() + len;
+    std::vector<AvlRecord> recs;
+    bool ok = be(c, 4) == crc16_ref(data.data(), len) && decode_avl(data.data(), len, &recs);
+    size_t limit = s->ack_limit, acked = ok ? (recs.size() < limit ? recs.size() : limit) : 0;
+    {
+      std::lock_guard<std::mutex> g(s->lock);
+      s->packets++;
+      if (!ok) s->malformed++;
+      s->records.insert(s->records.end(), recs.begin(), recs.begin() + acked);
+    }
+    uint8_t ack[4] = { (uint8_t)(acked >> 24), (uint8_t)(acked >> 16), (uint8_t)(acked >> 8), (uint8_t)acked };
+    if (send(fd, ack, 4, MSG_NOSIGNAL) != 4) return;
+  }
+}
+
+static bool codec8_start(Codec8Server* s) {
+  s->fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t alen = sizeof(addr);
+  if (s->fd < 0 || bind(s->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(s->fd, 4) != 0 ||
+      getsockname(s->fd, (struct sockaddr*)&addr, &alen) != 0) return false;
+  s->port = ntohs(addr.sin_port);
+  s->thread = std::thread([s] {
+    for (;;) {
+      int c = accept(s->fd, nullptr, nullptr);
+      if (c < 0) return;
+      serve_connection(s, c);
+      close(c);
+    }
+  });
+  return true;
+}
+
+static void codec8_stop(Codec8Server* s) {
+  shutdown(s->fd, SHUT_RDWR);
+  if (s->thread.joinable()) s->thread.join();
+  close(s->fd);
+}
+
+static traccar_position_t avl_position(int i) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.4642035 + i * 1e-4; p.longitude = -9.1899817 - i * 1e-4;
+  p.altitudeMeters = -12.6; p.headingDeg = 371.2; p.speedKmh = 48.6;
+  p.hdop = 0.87; p.batteryPercent = 140; p.odometer = 1523456.7;
+  p.timestampMs = 1700000000000ULL + 1000ULL * i;
+  p.validFlag = 1;
+  return p;
+}
+
+TEST(codec8_crc16) {
+  // The nibble table against the bitwise reference and the CRC-16/ARC check value
+  CHECK_EQ(crc16_ref((const uint8_t*)"123456789", 9), 0xBB3D);
+  std::vector<traccar_position_t> p;
+  for (int i = 0; i < 20; ++i) p.push_back(avl_position(i));
+  uint8_t buf[TRACCAR_CODEC8_PACKET_SIZE];
+  size_t count;
+  size_t len = traccar_codec8_build_packet(p.data(), p.size(), buf, sizeof(buf), &count);
+  REQUIRE(len > 15);
+  CHECK_EQ(count, 20);
+  const uint8_t* h = buf + 4;
+  size_t data_len = (size_t)be(h, 4);
+  CHECK_EQ(data_len + 12, len);
+  const uint8_t* c = buf + 8 + data_len;
+  CHECK_EQ(be(c, 4), crc16_ref(buf + 8, data_len));
+}
+
+TEST(codec8_record_layout) {
+  Codec8Server server;
+  REQUIRE(codec8_start(&server));
+  traccar_codec8_t* s = traccar_codec8_create("tcp://127.0.0.1", server.port, "356307042441013");
+  traccar_position_t p[3] = { avl_position(0), test_empty_position(), avl_position(2) };
+  p[1].timestampMs = 1700000001000ULL; // no fix, no IO elements
+  p[2].validFlag = 0;
+  p[2].headingDeg = -10.0; // negative and just below a full turn wrap into [0, 360)
+  p[1].headingDeg = 359.7;
+  int err = 1;
+  CHECK_EQ(traccar_codec8_send(s, p, 3, &err), 3);
+  CHECK_EQ(err, 0);
+  traccar_codec8_destroy(s);
+  codec8_stop(&server);
+
+  CHECK_STR(server.imei, "356307042441013");
+  CHECK_EQ(server.malformed, 0);
+  REQUIRE(server.records.size() == 3);
+  AvlRecord r = server.records[0];
+  CHECK_EQ(r.timestamp, 1700000000000ULL);
+  CHECK_EQ(r.lat, 454642035);
+  CHECK_EQ(r.lon, -91899817);
+  CHECK_EQ(r.altitude, -13);
+  CHECK_EQ(r.angle, 11);
+  CHECK_EQ(r.satellites, TRACCAR_CODEC8_SATELLITES);
+  CHECK_EQ(r.speed, 49);
+  CHECK_EQ(r.io.size(), 3);
+  CHECK_EQ(r.io[113], 100); // battery capped at 100 %
+  CHECK_EQ(r.io[182], 9);   // HDOP x10
+  CHECK_EQ(r.io[16], 1523457);
+  const AvlRecord& empty = server.records[1];
+  CHECK_EQ(empty.timestamp, 1700000001000ULL);
+  CHECK_EQ(empty.lat, 0);
+  CHECK_EQ(empty.lon, 0);
+  CHECK_EQ(empty.satellites, 0);
+  CHECK(empty.io.empty());
+  CHECK_EQ(empty.angle, 0);
+  CHECK_EQ(server.records[2].satellites, 0); // invalid fix
+  CHECK_EQ(server.records[2].angle, 350);
+}
+
+TEST(codec8_partial_and_refused_acks) {
+  Codec8Server server;
+  server.ack_limit = 7; // the rest of each packet has to go out again
+  REQUIRE(codec8_start(&server));
+  traccar_codec8_t* s = traccar_codec8_create("tcp://127.0.0.1", server.port, "356307042441013");
+  std::vector<traccar_position_t> p;
+  for (int i = 0; i < 100; ++i) p.push_back(avl_position(i));
+  int err = 1;
+  CHECK_EQ(traccar_codec8_send(s, p.data(), p.size(), &err), 100);
+  CHECK_EQ(err, 0);
+  {
+    std::lock_guard<std::mutex> g(server.lock);
+    REQUIRE(server.records.size() == 100);
+    for (size_t i = 0; i < 100; ++i) CHECK_EQ(server.records[i].timestamp, p[i].timestampMs); // in order, once each
+    CHECK_EQ(server.packets, 15); // ceil(100 / 7)
+    CHECK_EQ(server.logins, 1);   // one connection throughout
+  }
+  // Nothing acknowledged: the send stops there
+  server.ack_limit = 0;
+  CHECK_EQ(traccar_codec8_send(s, p.data(), p.size(), &err), 0);
+  CHECK_EQ(err, TRACCAR_HTTP_ERROR_SEND_FAILED);
+  traccar_codec8_destroy(s);
+  // A refused IMEI
+  server.accept_imei = false;
+  s = traccar_codec8_create("tcp://127.0.0.1", server.port, "000000000000000");
+  CHECK_EQ(traccar_codec8_send(s, p.data(), 1, &err), 0);
+  CHECK_EQ(err, TRACCAR_HTTP_ERROR_CONNECTION_REFUSED);
+  traccar_codec8_destroy(s);
+  codec8_stop(&server);
+}
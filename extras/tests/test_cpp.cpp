@@ -0,0 +1,107 @@
+// C++ API (Traccar.hpp): text fields as views that are not NUL-terminated, output identical to
+// the C builders, appending after existing content and past the stack buffer, the explicit
+// conversion to the C position, and no implicit one.
+
+#include "test.h"
+#include "Traccar.hpp"
+#include "TraccarFilter.h"
+
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+static_assert(!std::is_convertible_v<traccar::Position*, traccar_position_t*>,
+              "a Position must not reach a C API as a traccar_position_t, losing its texts");
+static_assert(!std::is_base_of_v<traccar_position_t, traccar::Position>, "composed, not derived");
+
+static std::string c_build(size_t (*fn)(traccar_client_t*, const traccar_position_t*, char*, size_t),
+                           traccar_client_t* c, const traccar_position_t& p) {
+  std::vector<char> buf(fn(c, &p, nullptr, 0) + 1);
+  fn(c, &p, buf.data(), buf.size());
+  return buf.data();
+}
+
+TEST(cpp_matches_c_builders) {
+  traccar::Client client("http://demo.traccar.org", 5055, "dev 1");
+  REQUIRE(client);
+  // Views into one buffer, none of them NUL-terminated where it ends
+  const std::string line = "driver-0042|222,1,20345|a4:2b:b0:11:22:33,-62|motionchange|in_vehicle";
+  std::string_view v(line);
+  traccar::Position pos;
+  pos.fix.latitude = 45.4642035; pos.fix.longitude = 9.1899817; pos.fix.speedKmh = 48.3;
+  pos.fix.timestampMs = 1700000000000ULL; pos.fix.batteryPercent = 78;
+  pos.driverUniqueId = v.substr(0, 11);
+  pos.cell = v.substr(12, 11);
+  pos.wifi = v.substr(24, 21);
+  pos.eventName = v.substr(46, 12);
+  pos.activityType = v.substr(59);
+  std::string storage;
+  traccar_position_t cp = pos.toC(storage);
+  CHECK_STR(cp.driverUniqueId, "driver-0042");
+  CHECK_STR(cp.cell, "222,1,20345");
+  CHECK_STR(cp.activityType, "in_vehicle");
+
+  std::string out = "prefix:";
+  CHECK_EQ(client.appendOsmAndUrl(pos, out), out.size() - 7);
+  CHECK_STR(out, "prefix:" + c_build(traccar_build_osmand_url, client.get(), cp));
+  out.clear();
+  client.appendOsmAndForm(pos, out);
+  CHECK_STR(out, c_build(traccar_build_osmand_form_body, client.get(), cp));
+  out.clear();
+  client.appendJson(pos, out);
+  CHECK_STR(out, c_build(traccar_build_json_body, client.get(), cp));
+  char buf[64];
+  size_t n = client.buildJson(pos, buf, sizeof(buf));
+  CHECK_EQ(n, out.size());
+  CHECK_STR(buf, out.substr(0, sizeof(buf) - 1));
+
+  // Empty views omit the field; toC leaves it nullptr
+  pos.cell = {};
+  cp = pos.toC(storage);
+  CHECK(cp.cell == nullptr);
+  CHECK_STR(cp.wifi, "a4:2b:b0:11:22:33,-62");
+}
+
+TEST(cpp_append_long_and_repeated) {
+  traccar::Client client("http://localhost", 0, "d");
+  std::string wifi;
+  for (int i = 0; i < 200; ++i) wifi += "a4:2b:b0:11:22:33,-62;";
+  traccar::Position pos;
+  pos.fix.timestampMs = 1;
+  pos.wifi = wifi;
+  std::string storage;
+  traccar_position_t cp = pos.toC(storage);
+  std::string want = c_build(traccar_build_json_body, client.get(), cp);
+  REQUIRE(want.size() > 4096);
+  std::string out;
+  for (int i = 0; i < 3; ++i) {
+    out.clear();
+    CHECK_EQ(client.appendJson(pos, out), want.size());
+    CHECK_STR(out, want);
+    CHECK_EQ(strlen(out.c_str()), out.size());
+  }
+  // Short ones after a long one, into the capacity it left
+  pos.wifi = {};
+  out += "|";
+  size_t before = out.size();
+  client.appendJson(pos, out);
+  CHECK_STR(out.substr(before), "{\"id\":\"d\",\"timestamp\":\"1970-01-01T00:00:00.001Z\"}");
+}
+
+TEST(cpp_to_c_for_other_apis) {
+  traccar::Position pos;
+  pos.fix.latitude = 45.0; pos.fix.longitude = 9.0; pos.fix.timestampMs = 1000;
+  pos.eventName = std::string_view("alarmXXX", 5);
+  std::string storage;
+  traccar_position_t cp = pos.toC(storage);
+  CHECK_STR(cp.eventName, "alarm");
+  // An event always passes the filter, which only sees it through the C form
+  traccar_filter_t* f = traccar_filter_create(1000.0, 0);
+  CHECK(traccar_filter_accept(f, &cp));
+  cp.timestampMs = 2000;
+  CHECK(traccar_filter_accept(f, &cp));
+  traccar_position_t plain = pos.fix;
+  plain.timestampMs = 3000;
+  CHECK(!traccar_filter_accept(f, &plain));
+  traccar_filter_destroy(f);
+}
@@ -0,0 +1,265 @@
+// Builders: exact OsmAnd URL, form and JSON output, configurations longer than the client's
+// inline block, truncation and the length query, the
+// fixed-point writer against printf (ties and out-of-range values included), and URL-encoding /
+// JSON escaping against byte-at-a-time reference encoders.
+
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+static traccar_position_t full_position() {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.4642035; p.longitude = 9.1899817;
+  p.altitudeMeters = 122.4; p.speedKmh = 48.3; p.headingDeg = 271.5; p.hdop = 0.87;
+  p.accuracyMeters = 3.2; p.odometer = 1523456.7;
+  p.timestampMs = 1700000000000ULL;
+  p.batteryPercent = 78; p.charging = true; p.validFlag = 1;
+  p.driverUniqueId = "driver-0042";
+  p.cell = "222,1,20345,1234567,-71";
+  p.wifi = "a4:2b:b0:11:22:33,-62";
+  p.eventName = "motionchange";
+  p.activityType = "in_vehicle";
+  return p;
+}
+
+static const char kFullFields[] =
+  "&lat=45.4642035&lon=9.1899817&altitude=122.4&hdop=0.87&speed=26&valid=true&timestamp=1700000000000"
+  "&accuracy=3.2&heading=271.5&batt=78&charge=true&driverUniqueId=driver-0042"
+  "&cell=222%2C1%2C20345%2C1234567%2C-71&wifi=a4%3A2b%3Ab0%3A11%3A22%3A33%2C-62&event=motionchange"
+  "&activity=in_vehicle&odometer=1523456.7";
+
+static std::string build(size_t (*fn)(traccar_client_t*, const traccar_position_t*, char*, size_t),
+                         traccar_client_t* c, const traccar_position_t& p) {
+  size_t n = fn(c, &p, nullptr, 0);
+  std::vector<char> buf(n + 1);
+  CHECK_EQ(fn(c, &p, buf.data(), buf.size()), n);
+  CHECK_EQ(strlen(buf.data()), n);
+  return std::string(buf.data(), n);
+}
+
+TEST(osmand_url_all_fields) {
+  traccar_client_t* c = traccar_create("http://demo.traccar.org", 5055, "dev 1");
+  traccar_position_t p = full_position();
+  CHECK_STR(build(traccar_build_osmand_url, c, p), std::string("http://demo.traccar.org:5055/?id=dev%201") + kFullFields);
+  traccar_set_base_path(c, "osmand");
+  CHECK_STR(build(traccar_build_osmand_url, c, p), std::string("http://demo.traccar.org:5055/osmand/?id=dev%201") + kFullFields);
+  traccar_destroy(c);
+}
+
+TEST(osmand_form_and_minimal) {
+  traccar_client_t* c = traccar_create("http://localhost", 0, "abc");
+  traccar_position_t p = full_position();
+  CHECK_STR(build(traccar_build_osmand_form_body, c, p), std::string("id=abc") + kFullFields);
+  p = test_empty_position();
+  p.latitude = -33.8688; p.longitude = 151.2093; p.timestampMs = 1;
+  CHECK_STR(build(traccar_build_osmand_url, c, p), "http://localhost/?id=abc&lat=-33.8688000&lon=151.2093000&timestamp=1");
+  p.batteryPercent = 0; p.validFlag = 0; p.speedKmh = 0.9;
+  CHECK_STR(build(traccar_build_osmand_form_body, c, p),
+            "id=abc&lat=-33.8688000&lon=151.2093000&speed=0&valid=false&timestamp=1&batt=0&charge=false");
+  traccar_destroy(c);
+}
+
+TEST(long_configuration) {
+  // Longer than TRACCAR_CONFIG_SIZE once encoded: kept in a block from the allocator
+  std::string host = "http://" + std::string(125, 'h') + ".example.com";
+  traccar_client_t* c = traccar_create(host.c_str(), 5055, "dev");
+  REQUIRE(c);
+  traccar_position_t p = test_empty_position();
+  p.timestampMs = 1;
+  CHECK_STR(build(traccar_build_osmand_url, c, p), host + ":5055/?id=dev&timestamp=1");
+  host = "http://" + std::string(205, 'g') + ".example.com";
+  traccar_set_host(c, host.c_str());
+  CHECK_STR(build(traccar_build_osmand_url, c, p), host + ":5055/?id=dev&timestamp=1");
+  std::string id(300, '"'), escaped;
+  for (int i = 0; i < 300; ++i) escaped += "\\\"";
+  traccar_set_device_id(c, id.c_str()); // from the heap block to a larger one
+  CHECK_STR(build(traccar_build_json_body, c, p), "{\"id\":\"" + escaped + "\",\"timestamp\":\"1970-01-01T00:00:00.001Z\"}");
+  // Back to the inline block
+  traccar_set_host(c, "http://localhost");
+  traccar_set_device_id(c, "abc");
+  CHECK_STR(build(traccar_build_osmand_url, c, p), "http://localhost:5055/?id=abc&timestamp=1");
+  traccar_destroy(c);
+}
+
+TEST(json_body) {
+  traccar_client_t* c = traccar_create("http://localhost", 8082, "dev\"1");
+  traccar_position_t p = full_position();
+  CHECK_STR(build(traccar_build_json_body, c, p),
+            "{\"id\":\"dev\\\"1\",\"lat\":45.4642035,\"lon\":9.1899817,\"altitude\":122.4,\"speed\":26,"
+            "\"heading\":271.5,\"hdop\":0.87,\"accuracy\":3.2,\"valid\":true,\"timestamp\":\"2023-11-14T22:13:20.000Z\","
+            "\"odometer\":1523456.7,\"batt\":78,\"charge\":true,\"event\":\"motionchange\",\"activity\":\"in_vehicle\","
+            "\"driverUniqueId\":\"driver-0042\",\"cell\":\"222,1,20345,1234567,-71\",\"wifi\":\"a4:2b:b0:11:22:33,-62\"}");
+  p = test_empty_position();
+  p.timestampMs = 1700000000123ULL; p.charging = true; // JSON sends charge without a battery level
+  CHECK_STR(build(traccar_build_json_body, c, p),
+            "{\"id\":\"dev\\\"1\",\"timestamp\":\"2023-11-14T22:13:20.123Z\",\"charge\":true}");
+  traccar_destroy(c);
+}
+
+TEST(json_batch_body) {
+  traccar_client_t* c = traccar_create("http://localhost", 0, "d");
+  traccar_position_t p[3];
+  for (int i = 0; i < 3; ++i) {
+    p[i] = test_empty_position();
+    p[i].timestampMs = 1000ULL * (i + 1);
+    p[i].speedKmh = 1.852 * i;
+  }
+  char out[256];
+  size_t count = 99;
+  size_t n = traccar_build_json_batch_body(c, p, 3, out, sizeof(out), &count);
+  CHECK_EQ(count, 3);
+  CHECK_STR(std::string(out, n),
+            "[{\"id\":\"d\",\"speed\":0,\"timestamp\":\"1970-01-01T00:00:01.000Z\"},"
+            "{\"id\":\"d\",\"speed\":1,\"timestamp\":\"1970-01-01T00:00:02.000Z\"},"
+            "{\"id\":\"d\",\"speed\":2,\"timestamp\":\"1970-01-01T00:00:03.000Z\"}]");
+  // Only whole elements: room for one and a half gives one
+  n = traccar_build_json_batch_body(c, p, 3, out, 90, &count);
+  CHECK_EQ(count, 1);
+  CHECK_STR(std::string(out, n), "[{\"id\":\"d\",\"speed\":0,\"timestamp\":\"1970-01-01T00:00:01.000Z\"}]");
+  traccar_destroy(c);
+}
+
+TEST(truncation_and_length_query) {
+  traccar_client_t* c = traccar_create("http://demo.traccar.org", 5055, "dev 1");
+  traccar_position_t p = full_position();
+  std::string full = build(traccar_build_osmand_url, c, p);
+  size_t (*const fns[])(traccar_client_t*, const traccar_position_t*, char*, size_t) = {
+    traccar_build_osmand_url, traccar_build_osmand_form_body, traccar_build_json_body };
+  for (auto fn : fns) {
+    std::string whole = build(fn, c, p);
+    for (size_t size = 1; size <= whole.size() + 1; ++size) {
+      std::vector<char> buf(size + 1, 'X');
+      size_t n = fn(c, &p, buf.data(), size);
+      CHECK_EQ(n, whole.size());                              // the full length, like snprintf
+      CHECK_STR(buf.data(), whole.substr(0, size - 1));        // cut to fit, NUL-terminated
+      CHECK_EQ(buf[size], 'X');                                // nothing written past out_size
+      if (test_failed()) return;
+    }
+  }
+  CHECK_EQ(traccar_build_osmand_url(c, &p, nullptr, 0), full.size());
+  // Scatter-gather: the cached prefix plus the fields in scratch
+  traccar_iovec_t iov[2];
+  char scratch[512];
+  size_t n = traccar_build_osmand_url_iov(c, &p, nullptr, iov, scratch, sizeof(scratch));
+  CHECK_EQ(n, full.size());
+  CHECK_STR(std::string((const char*)iov[0].base, iov[0].len) + std::string((const char*)iov[1].base, iov[1].len), full);
+  n = traccar_build_osmand_url_iov(c, &p, nullptr, iov, scratch, 16);
+  CHECK_EQ(n, full.size());
+  CHECK(iov[0].len + iov[1].len < n); // detectably cut
+  traccar_destroy(c);
+}
+
+// A form body with only the given field, against printf
+static void check_fixed(traccar_client_t* c, double v) {
+  struct { double traccar_position_t::*member; const char* key; int decimals; } fields[] = {
+    { &traccar_position_t::latitude, "lat", 7 }, { &traccar_position_t::altitudeMeters, "altitude", 1 },
+    { &traccar_position_t::hdop, "hdop", 2 } };
+  for (auto& f : fields) {
+    traccar_position_t p = test_empty_position();
+    p.timestampMs = 1;
+    p.*f.member = v;
+    char want[512], got[512];
+    snprintf(want, sizeof(want), "id=x&%s=%.*f&timestamp=1", f.key, f.decimals, v);
+    traccar_build_osmand_form_body(c, &p, got, sizeof(got));
+    CHECK_STR(got, want);
+  }
+}
+
+TEST(fixed_point_matches_printf) {
+  traccar_client_t* c = traccar_create("http://localhost", 0, "x");
+  // Exact binary ties round to even in printf; near-ties go by the exact binary value
+  const double ties[] = { 0.25, 0.125, 0.375, 2.5, 0.05, 0.15, 0.35, 2.675, 1.005, -0.25, -0.125, -0.0,
+                          -0.04, 0.00000005, 0.00000015, 45.00000005, 1.5, 1e9 + 0.5, 4294967295.5, 0.0 };
+  for (double v : ties) check_fixed(c, v);
+  std::mt19937_64 rng(1);
+  std::uniform_real_distribution<double> deg(-180.0, 180.0);
+  for (int i = 0; i < 20000 && !test_failed(); ++i) {
+    check_fixed(c, deg(rng));
+    check_fixed(c, (double)(int64_t)(rng() % 2000001 - 1000000) / 1024.0); // exact binary fractions, many ties
+    check_fixed(c, ldexp((double)(rng() >> 11), (int)(rng() % 80) - 60)); // across magnitudes
+  }
+  traccar_destroy(c);
+}
+
+// Any finite double is written in full, however long; infinities are omitted like NaN
+TEST(out_of_range_values) {
+  traccar_client_t* c = traccar_create("http://localhost", 0, "x");
+  const double huge[] = { 1e15, -1e15, 1e40, -1e300, 1.7976931348623157e308, -1.7976931348623157e308 };
+  for (double v : huge) check_fixed(c, v);
+  traccar_position_t p = test_empty_position();
+  p.timestampMs = 1; p.odometer = 1e40;
+  char want[512];
+  snprintf(want, sizeof(want), "id=x&timestamp=1&odometer=%.1f", 1e40);
+  CHECK_STR(build(traccar_build_osmand_form_body, c, p), want);
+  snprintf(want, sizeof(want), "{\"id\":\"x\",\"timestamp\":\"1970-01-01T00:00:00.001Z\",\"odometer\":%.1f}", 1e40);
+  CHECK_STR(build(traccar_build_json_body, c, p), want);
+  p.odometer = INFINITY; p.latitude = -INFINITY; p.hdop = INFINITY;
+  CHECK_STR(build(traccar_build_osmand_form_body, c, p), "id=x&timestamp=1");
+  CHECK_STR(build(traccar_build_json_body, c, p), "{\"id\":\"x\",\"timestamp\":\"1970-01-01T00:00:00.001Z\"}");
+  p = test_empty_position();
+  p.speedKmh = 1e30; p.timestampMs = 1;
+  CHECK_STR(build(traccar_build_osmand_form_body, c, p), "id=x&speed=2147483647&timestamp=1");
+  p.speedKmh = -1e30;
+  CHECK_STR(build(traccar_build_json_body, c, p),
+            "{\"id\":\"x\",\"speed\":-2147483648,\"timestamp\":\"1970-01-01T00:00:00.001Z\"}");
+  traccar_destroy(c);
+}
+
+static std::string ref_urlenc(const std::string& s) {
+  std::string r;
+  for (unsigned char ch : s) {
+    if (isalnum(ch) || ch == '-' || ch == '.' || ch == '_' || ch == '~') { r += (char)ch; continue; }
+    char h[4]; snprintf(h, sizeof(h), "%%%02X", ch);
+    r += h;
+  }
+  return r;
+}
+
+static std::string ref_json(const std::string& s) {
+  std::string r;
+  for (unsigned char ch : s) {
+    if (ch == '"') r += "\\\"";
+    else if (ch == '\\') r += "\\\\";
+    else if (ch == '\n') r += "\\n";
+    else if (ch == '\r') r += "\\r";
+    else if (ch == '\t') r += "\\t";
+    else if (ch < 0x20) { char h[8]; snprintf(h, sizeof(h), "\\u%04X", ch); r += h; }
+    else r += (char)ch;
+  }
+  return r;
+}
+
+TEST(escaping_matches_reference) {
+  traccar_client_t* c = traccar_create("http://localhost", 0, "x");
+  CHECK_STR(ref_json("a\"b\\c\n\x01\x1f\xc3\xa8"), "a\\\"b\\\\c\\n\\u0001\\u001F\xc3\xa8");
+  std::mt19937 rng(2);
+  const char alphabet[] = "abcXYZ019-._~ ,;:/?&=%+\"\\\n\t\r\x01\x1f\x7f\xc3\xa8";
+  for (int i = 0; i < 3000 && !test_failed(); ++i) {
+    std::string s(rng() % 80 + 1, ' ');
+    for (char& ch : s) ch = alphabet[rng() % (sizeof(alphabet) - 1)];
+    traccar_position_t p = test_empty_position();
+    p.timestampMs = 1;
+    p.eventName = s.c_str();
+    std::string url = build(traccar_build_osmand_form_body, c, p);
+    CHECK_STR(url, "id=x&timestamp=1&event=" + ref_urlenc(s));
+    std::string json = build(traccar_build_json_body, c, p);
+    CHECK_STR(json, "{\"id\":\"x\",\"timestamp\":\"1970-01-01T00:00:00.001Z\",\"event\":\"" + ref_json(s) + "\"}");
+    // Cut inside an escape sequence: the prefix of the full output, as for every other byte
+    size_t cut = json.size() / 2 + rng() % (json.size() / 2);
+    std::vector<char> buf(cut + 1);
+    CHECK_EQ(traccar_build_json_body(c, &p, buf.data(), buf.size()), json.size());
+    CHECK_STR(buf.data(), json.substr(0, cut));
+  }
+  // Text fields given by length may hold NULs
+  traccar_texts_t texts = {};
+  texts.eventName.data = "a\0b"; texts.eventName.size = 3;
+  traccar_position_t p = test_empty_position();
+  p.timestampMs = 1;
+  char out[128];
+  traccar_build_json_body_ex(c, &p, &texts, out, sizeof(out));
+  CHECK_STR(out, "{\"id\":\"x\",\"timestamp\":\"1970-01-01T00:00:00.001Z\",\"event\":\"a\\u0000b\"}");
+  traccar_destroy(c);
+}
@@ -0,0 +1,67 @@
+// Reporting filter: dead reckoning on straight tracks, turns, the heartbeat, and positions that
+// cross the antimeridian or run close to a pole.
+
+#include "test.h"
+#include "TraccarFilter.h"
+
+static traccar_position_t fix(double lat, double lon, double speed_kmh, double heading, uint64_t t_ms) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = lat; p.longitude = lon; p.speedKmh = speed_kmh; p.headingDeg = heading; p.timestampMs = t_ms;
+  return p;
+}
+
+TEST(filter_straight_turn_heartbeat) {
+  traccar_filter_t* f = traccar_filter_create(20.0, 60000);
+  traccar_position_t p = fix(45.0, 9.0, 36.0, 0.0, 1000);
+  CHECK(traccar_filter_accept(f, &p));
+  // 10 m/s due north: each second lies on the predicted track
+  int kept = 0;
+  for (int i = 1; i <= 30; ++i) {
+    p = fix(45.0 + i * 10.0 / 111195.0, 9.0, 36.0, 0.0, 1000 + i * 1000ULL);
+    kept += traccar_filter_accept(f, &p);
+  }
+  CHECK_EQ(kept, 0);
+  p.headingDeg = 90.0; // a turn is reported even on track
+  CHECK(traccar_filter_accept(f, &p));
+  p.timestampMs += 60000; p.speedKmh = 0; // heartbeat
+  CHECK(traccar_filter_accept(f, &p));
+  traccar_filter_destroy(f);
+}
+
+TEST(filter_across_antimeridian) {
+  traccar_filter_t* f = traccar_filter_create(50.0, 0);
+  // Parked on either side of 180 degrees, 22 m apart: not a move
+  traccar_position_t p = fix(0.0, 179.9999, 0.0, NAN, 1000);
+  CHECK(traccar_filter_accept(f, &p));
+  p = fix(0.0, -179.9999, 0.0, NAN, 2000);
+  CHECK(!traccar_filter_accept(f, &p));
+  // Driving east across it at 10 m/s stays on the predicted track
+  traccar_filter_reset(f);
+  p = fix(10.0, 179.9995, 36.0, 90.0, 1000);
+  CHECK(traccar_filter_accept(f, &p));
+  int kept = 0;
+  for (int i = 1; i <= 20; ++i) {
+    double lon = 179.9995 + i * 10.0 / (111195.0 * cos(10.0 * 0.017453292519943295));
+    p = fix(10.0, lon > 180.0 ? lon - 360.0 : lon, 36.0, 90.0, 1000 + i * 1000ULL);
+    kept += traccar_filter_accept(f, &p);
+  }
+  CHECK_EQ(kept, 0);
+  // Half a world away is still far
+  p = fix(10.0, 0.0, 36.0, 90.0, 30000);
+  CHECK(traccar_filter_accept(f, &p));
+  traccar_filter_destroy(f);
+}
+
+TEST(filter_near_pole) {
+  traccar_filter_t* f = traccar_filter_create(50.0, 0);
+  // 11 m from the pole heading east: the prediction stays bounded and within a few meters
+  traccar_position_t p = fix(89.9999, 179.99, 36.0, 90.0, 1000);
+  CHECK(traccar_filter_accept(f, &p));
+  p = fix(89.9999, -128.5, 36.0, 90.0, 2000);
+  CHECK(!traccar_filter_accept(f, &p));
+  p = fix(90.0, 0.0, 36.0, 90.0, 3000);
+  CHECK(!traccar_filter_accept(f, &p));
+  p = fix(89.99, 0.0, 36.0, 90.0, 4000); // 1.1 km away
+  CHECK(traccar_filter_accept(f, &p));
+  traccar_filter_destroy(f);
+}
@@ -0,0 +1,136 @@
+// Geofences: the first fix only primes the state (again after a reset), entries are reported
+// before exits, hysteresis keeps a circle and a polygon until the fix is that far outside, and
+// eventName is set from the first transition only when the fix has none.
+
+#include "test.h"
+#include "TraccarGeofence.h"
+
+#include <string>
+
+// A circle of 100 m around C (id 1) and a 100 m x 200 m box east of it (id 2) that overlaps the
+// circle from 80 m to 100 m east of C
+static const double C_LAT = 45.0, C_LON = 9.0;
+static const double M_PER_DEG = 6371008.8 * 0.017453292519943295;
+
+static double north(double m) { return C_LAT + m / M_PER_DEG; }
+static double east(double m) { return C_LON + m / (M_PER_DEG * cos(C_LAT * 0.017453292519943295)); }
+
+static const double box[] = {
+  north(-50), east(80), north(50), east(80), north(50), east(280), north(-50), east(280),
+};
+
+static traccar_geofence_t* fences() {
+  traccar_fence_t defs[2] = {};
+  defs[0].id = 1;
+  defs[0].latitude = C_LAT; defs[0].longitude = C_LON; defs[0].radiusMeters = 100;
+  defs[1].id = 2;
+  defs[1].points = box; defs[1].pointCount = 4;
+  defs[1].enterEvent = "inBox"; defs[1].exitEvent = "outBox";
+  return traccar_geofence_create(defs, 2, nullptr);
+}
+
+static traccar_position_t fix_at(double north_m, double east_m) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = north(north_m); p.longitude = east(east_m);
+  return p;
+}
+
+// Transitions of a fix at (north_m, east_m) from C, as "+id" / "-id", in the order reported
+static std::string move(traccar_geofence_t* g, double north_m, double east_m) {
+  traccar_position_t p = fix_at(north_m, east_m);
+  traccar_geofence_event_t ev[4];
+  size_t n = traccar_geofence_update(g, &p, ev, 4);
+  std::string s;
+  for (size_t i = 0; i < n && i < 4; ++i) s += (ev[i].enter ? "+" : "-") + std::to_string(ev[i].id);
+  return s;
+}
+
+TEST(geofence_first_fix_primes) {
+  traccar_geofence_t* g = fences();
+  REQUIRE(g);
+  traccar_position_t p = fix_at(0, 90); // in both
+  CHECK_EQ(traccar_geofence_update(g, &p, nullptr, 0), 0);
+  CHECK(p.eventName == nullptr);
+  CHECK_STR(move(g, 0, 90), "");
+  CHECK_STR(move(g, 0, 0), "-2");
+  // After a reset the next fix primes again, wherever it is
+  traccar_geofence_reset(g);
+  CHECK_STR(move(g, 0, 500), "");
+  CHECK_STR(move(g, 0, 0), "+1");
+  // A fix without coordinates changes nothing
+  traccar_position_t none = test_empty_position();
+  CHECK_EQ(traccar_geofence_update(g, &none, nullptr, 0), 0);
+  CHECK_STR(move(g, 0, 0), "");
+  traccar_geofence_destroy(g);
+}
+
+TEST(geofence_order) {
+  traccar_geofence_t* g = fences();
+  REQUIRE(g);
+  CHECK_STR(move(g, 0, 0), "");
+  // From the circle only to the box only: the entry comes first
+  traccar_position_t p = fix_at(0, 200);
+  traccar_geofence_event_t ev[4];
+  REQUIRE(traccar_geofence_update(g, &p, ev, 4) == 2);
+  CHECK_EQ(ev[0].id, 2);
+  CHECK(ev[0].enter);
+  CHECK_STR(ev[0].name, "inBox");
+  CHECK_EQ(ev[1].id, 1);
+  CHECK(!ev[1].enter);
+  CHECK_STR(ev[1].name, "geofenceExit");
+  CHECK_STR(p.eventName ? p.eventName : "", "inBox");
+  // Back, with room for one event: both are counted, the first is written
+  p = fix_at(0, 0);
+  ev[1].id = 99;
+  CHECK_EQ(traccar_geofence_update(g, &p, ev, 1), 2);
+  CHECK_EQ(ev[0].id, 1);
+  CHECK(ev[0].enter);
+  CHECK_EQ(ev[1].id, 99);
+  CHECK_STR(p.eventName ? p.eventName : "", "geofenceEnter");
+  traccar_geofence_destroy(g);
+}
+
+TEST(geofence_event_name) {
+  traccar_geofence_t* g = fences();
+  REQUIRE(g);
+  CHECK_STR(move(g, 0, 0), "");
+  traccar_position_t p = fix_at(0, 500);
+  p.eventName = "alarm";
+  CHECK_EQ(traccar_geofence_update(g, &p, nullptr, 0), 1);
+  CHECK_STR(p.eventName, "alarm"); // the fix's own event stays
+  p = fix_at(0, 0);
+  p.eventName = "";
+  CHECK_EQ(traccar_geofence_update(g, &p, nullptr, 0), 1);
+  CHECK_STR(p.eventName, "geofenceEnter"); // an empty one is filled
+  p = fix_at(0, 10);
+  CHECK_EQ(traccar_geofence_update(g, &p, nullptr, 0), 0);
+  CHECK(p.eventName == nullptr); // no transition, no event
+  traccar_geofence_destroy(g);
+}
+
+TEST(geofence_hysteresis) {
+  traccar_geofence_t* g = fences();
+  REQUIRE(g);
+  // Without it, 10 m outside the circle is out
+  CHECK_STR(move(g, 0, 0), "");
+  CHECK_STR(move(g, 110, 0), "-1");
+  CHECK_STR(move(g, 0, 0), "+1");
+
+  traccar_geofence_set_hysteresis(g, 20);
+  CHECK_STR(move(g, 110, 0), "");   // circle: 10 m outside, still in
+  CHECK_STR(move(g, 0, 0), "");
+  CHECK_STR(move(g, 125, 0), "-1"); // 25 m outside
+  CHECK_STR(move(g, 110, 0), "");   // the margin does not widen a fence the device is not in
+  CHECK_STR(move(g, 90, 0), "+1");
+
+  CHECK_STR(move(g, 0, 200), "+2-1");
+  CHECK_STR(move(g, 0, 290), "");   // polygon: 10 m past its east side
+  CHECK_STR(move(g, 60, 200), "");  // 10 m past its north side
+  CHECK_STR(move(g, 60, 290), "");  // 10 m off the corner
+  CHECK_STR(move(g, 0, 200), "");
+  CHECK_STR(move(g, 0, 310), "-2"); // 30 m past its east side
+  CHECK_STR(move(g, 0, 290), "");
+  CHECK_STR(move(g, 0, 270), "+2");
+  CHECK_STR(move(g, 75, 200), "-2"); // 25 m past its north side
+  traccar_geofence_destroy(g);
+}
@@ -0,0 +1,46 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static TestCase* g_first = nullptr;
+static TestCase** g_tail = &g_first;
+static int g_failures = 0; // checks failed by the running case
+
+TestCase::TestCase(const char* n, void (*f)()) : name(n), fn(f), next(nullptr) {
+  *g_tail = this; // in definition order within each file
+  g_tail = &next;
+}
+
+void test_fail(const char* file, int line, const char* what) {
+  fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, what);
+  ++g_failures;
+}
+
+void test_fail_int(const char* file, int line, const char* a, const char* b, long long va, long long vb) {
+  fprintf(stderr, "  %s:%d: %s == %s failed: %lld vs %lld\n", file, line, a, b, va, vb);
+  ++g_failures;
+}
+
+void test_fail_str(const char* file, int line, const char* a, const char* b, const std::string& va, const std::string& vb) {
+  fprintf(stderr, "  %s:%d: %s == %s failed:\n    \"%s\"\n    \"%s\"\n", file, line, a, b, va.c_str(), vb.c_str());
+  ++g_failures;
+}
+
+bool test_failed() { return g_failures != 0; }
+
+int main(int argc, char** argv) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  int run = 0, failed = 0;
+  for (TestCase* t = g_first; t; t = t->next) {
+    if (!strstr(t->name, filter)) continue;
+    g_failures = 0;
+    t->fn();
+    ++run;
+    if (g_failures) ++failed;
+    printf("%s %s\n", g_failures ? "FAIL" : "ok  ", t->name);
+    fflush(stdout);
+  }
+  printf("%d of %d tests passed\n", run - failed, run);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,91 @@
+// NMEA parser: which sentences make up a fix when a receiver repeats an untimed one (a GSA per
+// constellation), GGA's HDOP over GSA's, and receivers that lead each fix with GSA.
+
+#include "test.h"
+#include "TraccarNmea.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static void on_fix(void* user, const traccar_position_t* pos) {
+  ((std::vector<traccar_position_t>*)user)->push_back(*pos);
+}
+
+// "$body*hh\r\n"
+static std::string sentence(const std::string& body) {
+  unsigned x = 0;
+  for (char ch : body) x ^= (unsigned char)ch;
+  char tail[8];
+  snprintf(tail, sizeof(tail), "*%02X\r\n", x);
+  return "$" + body + tail;
+}
+
+static std::string rmc(int sec) {
+  char b[96];
+  snprintf(b, sizeof(b), "GNRMC,1200%02d.00,A,4807.038,N,01131.000,E,022.4,084.4,230394,,,A", sec);
+  return sentence(b);
+}
+
+static std::string gga(int sec, const char* hdop) {
+  char b[96];
+  snprintf(b, sizeof(b), "GNGGA,1200%02d.00,4807.038,N,01131.000,E,1,08,%s,545.4,M,46.9,M,,", sec, hdop);
+  return sentence(b);
+}
+
+static std::string gsa(const char* hdop) {
+  return sentence(std::string("GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,") + hdop + ",2.1");
+}
+
+static long long hdop100(const traccar_position_t& p) { return llround(p.hdop * 100); }
+
+TEST(nmea_repeated_gsa) {
+  std::vector<traccar_position_t> got;
+  traccar_nmea_t* n = traccar_nmea_create(on_fix, &got);
+  const char* gga_hdop[] = { "0.9", "2.9", "1.4", "3.3" };
+  const char* gsa_hdop[][2] = { { "1.10", "1.20" }, { "1.80", "1.90" }, { "2.10", "2.20" }, { "0.70", "0.80" } };
+  for (int i = 0; i < 4; ++i) {
+    std::string epoch = rmc(i) + gga(i, gga_hdop[i]) + gsa(gsa_hdop[i][0]) + gsa(gsa_hdop[i][1]);
+    traccar_nmea_feed(n, epoch.data(), epoch.size());
+    // Once the set of sentences is known, each fix goes out at its first GSA
+    if (i > 0) CHECK_EQ(got.size(), i + 1);
+  }
+  CHECK_EQ(traccar_nmea_flush(n), 0);
+  REQUIRE(got.size() == 4);
+  for (int i = 0; i < 4; ++i) {
+    CHECK_EQ(got[i].timestampMs, 764424000000ULL + 1000ULL * i);
+    CHECK_EQ(hdop100(got[i]), llround(atof(gga_hdop[i]) * 100)); // never a GSA's, nor a previous fix's
+    CHECK_EQ(got[i].validFlag, 1);
+  }
+  traccar_nmea_destroy(n);
+}
+
+TEST(nmea_gga_hdop_over_gsa) {
+  std::vector<traccar_position_t> got;
+  traccar_nmea_t* n = traccar_nmea_create(on_fix, &got);
+  // GSA ahead of GGA within the fix, and a fix whose GGA has no HDOP
+  std::string s = rmc(0) + gsa("1.50") + gga(0, "0.9") + rmc(1) + gsa("1.60") + gga(1, "") + rmc(2);
+  traccar_nmea_feed(n, s.data(), s.size());
+  traccar_nmea_flush(n);
+  REQUIRE(got.size() == 3);
+  CHECK_EQ(hdop100(got[0]), 90);
+  CHECK_EQ(hdop100(got[1]), 160);
+  CHECK(isnan(got[2].hdop));
+  traccar_nmea_destroy(n);
+}
+
+TEST(nmea_leading_gsa) {
+  std::vector<traccar_position_t> got;
+  traccar_nmea_t* n = traccar_nmea_create(on_fix, &got);
+  const char* gga_hdop[] = { "0.9", "2.9", "1.4" };
+  std::string s;
+  for (int i = 0; i < 3; ++i) s += gsa("5.00") + rmc(i) + gga(i, gga_hdop[i]);
+  traccar_nmea_feed(n, s.data(), s.size());
+  traccar_nmea_flush(n);
+  REQUIRE(got.size() == 3);
+  for (int i = 0; i < 3; ++i) {
+    CHECK_EQ(got[i].timestampMs, 764424000000ULL + 1000ULL * i);
+    CHECK_EQ(hdop100(got[i]), llround(atof(gga_hdop[i]) * 100));
+  }
+  traccar_nmea_destroy(n);
+}
@@ -0,0 +1,147 @@
+// Retry scheduler on a simulated clock against the stand-in server: backoff with equal jitter,
+// draining a backlog through a flaky server, the circuit breaker and its probe, and the expiry,
+// rejection and overflow counts.
+
+#include "test.h"
+#include "TraccarRetry.h"
+#include "standin.h"
+
+#include <set>
+
+static traccar_position_t fix(uint64_t t_ms) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.0; p.longitude = 9.0; p.timestampMs = t_ms;
+  return p;
+}
+
+TEST(retry_backoff_with_jitter) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  server.status = 503;
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_retry_t* r = traccar_retry_create(c, TRACCAR_FORMAT_OSMAND, 4);
+  traccar_retry_set_backoff(r, 1000, 8000);
+  traccar_retry_set_breaker(r, 0, 0);
+  traccar_position_t p = fix(1);
+  uint64_t now = 0;
+  REQUIRE(traccar_retry_submit(r, &p, now));
+  // Half of each delay is fixed, half random; it doubles per failure up to the cap
+  const uint64_t delays[] = { 1000, 2000, 4000, 8000, 8000, 8000 };
+  uint64_t attempts = 0;
+  for (uint64_t d : delays) {
+    uint64_t due = traccar_retry_next_due(r);
+    CHECK(due >= now + d / 2 && due <= now + d);
+    CHECK_EQ(traccar_retry_run(r, due - 1, 8), 0);
+    CHECK_EQ(server.requests.load(), attempts); // not yet
+    now = due;
+    CHECK_EQ(traccar_retry_run(r, now, 8), 0);
+    CHECK_EQ(server.requests.load(), ++attempts);
+  }
+  traccar_retry_counts_t counts;
+  traccar_retry_get_counts(r, &counts);
+  CHECK_EQ(counts.retried, 6);
+  CHECK_EQ(traccar_retry_pending(r), 1);
+  traccar_retry_destroy(r);
+  traccar_destroy(c);
+}
+
+TEST(retry_drains_through_flaky_server) {
+  StandinServer server;
+  server.fail_every = 3; // every third request answered 500
+  server.record = true;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_retry_t* r = traccar_retry_create(c, TRACCAR_FORMAT_OSMAND, 64);
+  traccar_retry_set_backoff(r, 1000, 30000);
+  for (uint64_t i = 0; i < 50; ++i) {
+    traccar_position_t p = fix(1700000000000ULL + i * 1000);
+    REQUIRE(traccar_retry_submit(r, &p, i * 100));
+  }
+  uint64_t now = 0;
+  while (traccar_retry_pending(r) && now < 3600000) {
+    now += 100;
+    traccar_retry_run(r, now, 4);
+  }
+  traccar_retry_counts_t counts;
+  traccar_retry_get_counts(r, &counts);
+  CHECK_EQ(traccar_retry_pending(r), 0);
+  CHECK_EQ(counts.delivered, 50);
+  CHECK_EQ(counts.retried, server.requests.load() - 50);
+  CHECK_EQ(counts.retried, 24); // 74 requests, every third answered 500
+  // Each fix reached the server with its own time
+  std::set<std::string> stamps;
+  for (const std::string& req : standin_received(&server)) {
+    size_t at = req.find("timestamp=");
+    REQUIRE(at != std::string::npos);
+    stamps.insert(req.substr(at, req.find_first_of(" &", at) - at));
+  }
+  CHECK_EQ(stamps.size(), 50);
+  traccar_retry_destroy(r);
+  traccar_destroy(c);
+}
+
+TEST(retry_breaker_opens_and_probes) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  server.status = 503;
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_retry_t* r = traccar_retry_create(c, TRACCAR_FORMAT_JSON, 16);
+  traccar_retry_set_backoff(r, 100, 1000);
+  traccar_retry_set_breaker(r, 3, 10000);
+  for (uint64_t i = 0; i < 10; ++i) {
+    traccar_position_t p = fix(1700000000000ULL + i);
+    REQUIRE(traccar_retry_submit(r, &p, 0));
+  }
+  // Three failures in a row open the breaker; nothing goes out while it is open
+  CHECK_EQ(traccar_retry_run(r, 1000, 10), 0);
+  CHECK_EQ(server.requests.load(), 3);
+  CHECK(traccar_retry_breaker_open(r, 1000));
+  CHECK_EQ(traccar_retry_next_due(r), 11000);
+  CHECK_EQ(traccar_retry_run(r, 10999, 10), 0);
+  CHECK_EQ(server.requests.load(), 3);
+  // A single failed probe reopens it
+  CHECK_EQ(traccar_retry_run(r, 11000, 10), 0);
+  CHECK_EQ(server.requests.load(), 4);
+  CHECK_EQ(traccar_retry_next_due(r), 21000);
+  // The server is back: the probe closes the breaker and the backlog drains
+  server.status = 200;
+  CHECK_EQ(traccar_retry_run(r, 21000, 10), 10);
+  CHECK(!traccar_retry_breaker_open(r, 21000));
+  traccar_retry_counts_t counts;
+  traccar_retry_get_counts(r, &counts);
+  CHECK_EQ(counts.breaker_trips, 2);
+  CHECK_EQ(counts.delivered, 10);
+  CHECK_EQ(traccar_retry_next_due(r), UINT64_MAX);
+  traccar_retry_destroy(r);
+  traccar_destroy(c);
+}
+
+TEST(retry_expiry_rejection_overflow) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  server.status = 503;
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_retry_t* r = traccar_retry_create(c, TRACCAR_FORMAT_OSMAND, 2);
+  traccar_retry_set_backoff(r, 1000, 1000);
+  traccar_retry_set_expiry(r, 5000);
+  traccar_retry_set_breaker(r, 0, 0);
+  traccar_position_t p = fix(1);
+  CHECK(traccar_retry_submit(r, &p, 0));
+  CHECK(traccar_retry_submit(r, &p, 0));
+  CHECK(!traccar_retry_submit(r, &p, 0)); // every slot taken
+  for (uint64_t now = 0; now <= 6000; now += 100) traccar_retry_run(r, now, 4);
+  traccar_retry_counts_t counts;
+  traccar_retry_get_counts(r, &counts);
+  CHECK_EQ(counts.overflowed, 1);
+  CHECK_EQ(counts.expired, 2);
+  CHECK_EQ(traccar_retry_pending(r), 0);
+  // A 4xx other than 408/429 is final
+  server.status = 400;
+  CHECK(traccar_retry_submit(r, &p, 10000));
+  traccar_retry_run(r, 11000, 4);
+  traccar_retry_get_counts(r, &counts);
+  CHECK_EQ(counts.rejected, 1);
+  CHECK_EQ(traccar_retry_pending(r), 0);
+  traccar_retry_destroy(r);
+  traccar_destroy(c);
+}
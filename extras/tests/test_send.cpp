@@ -0,0 +1,171 @@
+// Blocking senders against the stand-in server: every sender writes, parses the answer and keeps
+// the connection alive, and once warmed up none of them asks the client allocator for memory,
+// on success, on an error status or across a dropped connection. Requests too long for a fixed
+// buffer fail without being sent. A new timeout applies to the kept-alive connection. The fleet
+// sender with fields longer than its stack buffer.
+
+#include "test.h"
+#include "TraccarFleet.h"
+#include "standin.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <thread>
+
+static traccar_allocator_t g_arena_hooks;
+static unsigned long g_client_allocs = 0;
+static void* counting_alloc(void* user, size_t n) { ++g_client_allocs; return g_arena_hooks.alloc(user, n); }
+
+static traccar_position_t send_position(int i) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.4642035; p.longitude = 9.1899817; p.altitudeMeters = 122.4; p.speedKmh = 48.3;
+  p.hdop = 0.87; p.batteryPercent = 78; p.validFlag = 1;
+  p.timestampMs = 1700000000000ULL + 1000ULL * i;
+  p.driverUniqueId = "driver-0042";
+  p.wifi = "a4:2b:b0:11:22:33,-62";
+  return p;
+}
+
+// All five senders once; the number that reported success, each with the expected code
+static int send_round(traccar_client_t* c, const traccar_position_t* batch, size_t n, int want) {
+  bool accepted[16];
+  int ok = 0, code;
+  code = 0; ok += traccar_send_osmand(c, &batch[0], &code); CHECK_EQ(code, want);
+  code = 0; ok += traccar_send_osmand_form(c, &batch[0], &code); CHECK_EQ(code, want);
+  code = 0; ok += traccar_send_json(c, &batch[0], &code); CHECK_EQ(code, want);
+  code = 0; ok += traccar_send_json_batch(c, batch, n, accepted, &code); CHECK_EQ(code, want);
+  code = 0; ok += traccar_send_osmand_batch(c, batch, n, accepted, &code); CHECK_EQ(code, want);
+  return ok;
+}
+
+TEST(send_path_allocates_nothing) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  static unsigned char arena_buf[32768];
+  traccar_arena_t arena;
+  traccar_arena_init(&arena, arena_buf, sizeof(arena_buf));
+  g_arena_hooks = traccar_arena_allocator(&arena);
+  traccar_allocator_t hooks = { counting_alloc, nullptr, &arena };
+  traccar_client_t* c = traccar_create_ex("http://127.0.0.1", server.port, "dev", &hooks);
+  REQUIRE(c && traccar_set_batch_capacity(c, 8192));
+  traccar_position_t batch[16];
+  for (int i = 0; i < 16; ++i) batch[i] = send_position(i);
+
+  CHECK_EQ(send_round(c, batch, 16, 200), 5); // warm-up
+  unsigned long allocs0 = g_client_allocs;
+  for (int i = 0; i < 100 && !test_failed(); ++i) CHECK_EQ(send_round(c, batch, 16, 200), 5);
+  traccar_stats_t st;
+  traccar_get_stats(c, &st);
+  CHECK_EQ(st.connects, 1); // one kept-alive connection throughout
+  CHECK_EQ(server.requests.load(), 101 * (3 + 1 + 16));
+  // Refusals and a dropped connection take the same allocation-free paths
+  server.status = 500;
+  CHECK_EQ(send_round(c, batch, 4, 500), 0);
+  server.status = 0;
+  for (int i = 0; i < 3; ++i) {
+    int code = 0;
+    CHECK(!traccar_send_osmand(c, &batch[0], &code));
+    CHECK(code < 0);
+  }
+  server.status = 200;
+  CHECK_EQ(send_round(c, batch, 16, 200), 5);
+  CHECK_EQ(g_client_allocs - allocs0, 0);
+  traccar_destroy(c);
+}
+
+TEST(send_too_long_not_sent) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  REQUIRE(c && traccar_set_batch_capacity(c, 1024)); // fixed: the request cannot move to a larger one
+  std::string wifi;
+  for (int i = 0; i < 100; ++i) wifi += "a4:2b:b0:11:22:33,-62;";
+  traccar_position_t p = send_position(0);
+  p.wifi = wifi.c_str();
+  int code = 0;
+  CHECK(!traccar_send_osmand(c, &p, &code)); CHECK_EQ(code, TRACCAR_HTTP_ERROR_TRUNCATED);
+  code = 0;
+  CHECK(!traccar_send_json(c, &p, &code)); CHECK_EQ(code, TRACCAR_HTTP_ERROR_TRUNCATED);
+  CHECK(!traccar_send_async(c, TRACCAR_FORMAT_JSON, &p, nullptr, nullptr));
+  bool accepted[2] = { true, true };
+  code = 0;
+  CHECK(!traccar_send_json_batch(c, &p, 1, accepted, &code)); CHECK_EQ(code, TRACCAR_HTTP_ERROR_TRUNCATED);
+  code = 0;
+  CHECK(!traccar_send_osmand_batch(c, &p, 1, accepted, &code)); CHECK_EQ(code, TRACCAR_HTTP_ERROR_TRUNCATED);
+  CHECK(!accepted[0]);
+  traccar_stats_t st;
+  traccar_get_stats(c, &st);
+  CHECK_EQ(st.truncations, 3);
+  CHECK_EQ(st.connects, 0);
+  // What fits still goes out; of a batch, the part that fits, with the server's answer
+  traccar_position_t batch[2] = { send_position(1), p };
+  CHECK(!traccar_send_json_batch(c, batch, 2, accepted, &code)); CHECK_EQ(code, 200);
+  CHECK(accepted[0] && !accepted[1]);
+  p.wifi = "a4:2b:b0:11:22:33,-62";
+  CHECK(traccar_send_json(c, &p, &code)); CHECK_EQ(code, 200);
+  CHECK_EQ(server.requests.load(), 2);
+  traccar_destroy(c);
+}
+
+TEST(timeout_on_open_connection) {
+  // Answers the first request on the connection, then reads and never answers again
+  int lfd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t alen = sizeof(addr);
+  REQUIRE(bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(lfd, 1) == 0 &&
+          getsockname(lfd, (struct sockaddr*)&addr, &alen) == 0);
+  std::thread server([lfd] {
+    int fd = accept(lfd, nullptr, nullptr);
+    if (fd < 0) return;
+    char buf[4096];
+    if (recv(fd, buf, sizeof(buf), 0) > 0) {
+      const char ok[] = "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n";
+      send(fd, ok, sizeof(ok) - 1, MSG_NOSIGNAL);
+    }
+    while (recv(fd, buf, sizeof(buf), 0) > 0) {}
+    close(fd);
+  });
+  traccar_client_t* c = traccar_create("http://127.0.0.1", ntohs(addr.sin_port), "dev");
+  traccar_position_t p = send_position(0);
+  int code = 0;
+  CHECK(traccar_send_osmand(c, &p, &code)); // connection opened with the default 4 s
+  traccar_set_timeout_ms(c, 200);
+  auto t0 = std::chrono::steady_clock::now();
+  CHECK(!traccar_send_osmand(c, &p, &code));
+  CHECK_EQ(code, TRACCAR_HTTP_ERROR_READ_TIMEOUT);
+  CHECK(std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(2000));
+  traccar_destroy(c);
+  server.join();
+  close(lfd);
+}
+
+TEST(fleet_long_fields) {
+  StandinServer server;
+  server.record = true;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_fleet_t* f = traccar_fleet_create("http://127.0.0.1", server.port, 1);
+  traccar_device_t d = traccar_fleet_device(f, "dev-7");
+  // A wifi list far longer than the stack buffer goes through the pooled client's batch buffer
+  std::string wifi;
+  for (int i = 0; i < 400; ++i) wifi += "a4:2b:b0:11:22:33,-62;";
+  traccar_position_t p = send_position(0);
+  p.wifi = wifi.c_str();
+  for (traccar_format_t format : { TRACCAR_FORMAT_OSMAND, TRACCAR_FORMAT_JSON, TRACCAR_FORMAT_OSMAND }) {
+    int code = 0;
+    CHECK(traccar_fleet_send(f, d, format, &p, &code));
+    CHECK_EQ(code, 200);
+  }
+  std::vector<std::string> got = standin_received(&server);
+  REQUIRE(got.size() == 3);
+  CHECK(got[0].find("id=dev-7&lat=") != std::string::npos);
+  CHECK(got[1].find("\"wifi\":\"" + wifi + "\"}") != std::string::npos);
+  CHECK_EQ(got[2].size(), got[0].size());
+  traccar_fleet_destroy(f);
+}
@@ -0,0 +1,142 @@
+// Background sender against the stand-in server: positions submitted from several threads are
+// each delivered once and in the order every producer submitted them; a full ring refuses a
+// submit, flush waits for what was submitted before it, and destroy attempts everything left.
+
+#include "test.h"
+#include "TraccarSender.h"
+#include "standin.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Producer p's i-th position carries the timestamp (1000000000 + p * 1000000 + i) s; never 0,
+// which is sent as the current time
+static traccar_position_t sender_position(int producer, int i) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.0; p.longitude = 9.0;
+  p.timestampMs = (1000000000ULL + (uint64_t)producer * 1000000 + (uint64_t)i) * 1000;
+  return p;
+}
+
+template <typename F> static bool sender_eventually(F cond, int timeout_ms) {
+  for (int i = 0; i <= timeout_ms; ++i) {
+    if (cond()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+TEST(sender_producers) {
+  const int producers = 4, each = 500;
+  StandinServer server;
+  server.record = true;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  traccar_sender_t* s = traccar_sender_create(c, TRACCAR_FORMAT_OSMAND, 64, nullptr, nullptr);
+  REQUIRE(s);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([s, p] {
+      for (int i = 0; i < each; ++i) {
+        traccar_position_t pos = sender_position(p, i);
+        while (!traccar_sender_submit(s, &pos)) std::this_thread::yield(); // full: try again
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  CHECK(traccar_sender_flush(s, 10000));
+  traccar_sender_counts_t counts;
+  traccar_sender_get_counts(s, &counts);
+  CHECK_EQ(counts.submitted, producers * each);
+  CHECK_EQ(counts.delivered, producers * each);
+  CHECK_EQ(counts.failed, 0);
+
+  // Batches go one after the other, so requests are recorded in the order they were sent
+  std::vector<int> next(producers, 0);
+  size_t seen = 0;
+  for (const std::string& req : standin_received(&server)) {
+    size_t at = req.find("timestamp=");
+    REQUIRE(at != std::string::npos);
+    unsigned long long t = strtoull(req.c_str() + at + 10, nullptr, 10) / 1000 - 1000000000ULL;
+    int p = (int)(t / 1000000), i = (int)(t % 1000000);
+    REQUIRE(p < producers);
+    CHECK_EQ(i, next[p]); // neither repeated, skipped nor reordered
+    next[p] = i + 1;
+    ++seen;
+  }
+  CHECK_EQ(seen, producers * each);
+  traccar_sender_destroy(s);
+  traccar_destroy(c);
+}
+
+// Holds the sender thread inside its batch callback while closed
+struct SenderGate {
+  std::atomic<bool> open{true};
+  std::atomic<int> entered{0};
+  std::atomic<size_t> attempted{0};
+};
+
+static void gate_cb(void* user, const traccar_position_t*, size_t n, const bool*, int) {
+  SenderGate* g = (SenderGate*)user;
+  g->entered++;
+  while (!g->open) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  g->attempted += n;
+}
+
+TEST(sender_full_flush_destroy) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  SenderGate gate;
+  traccar_sender_t* s = traccar_sender_create(c, TRACCAR_FORMAT_OSMAND, 4, gate_cb, &gate);
+  REQUIRE(s);
+
+  // The first position is taken and held in its batch: its slot stays busy, 3 more fit
+  gate.open = false;
+  traccar_position_t pos = sender_position(0, 0);
+  REQUIRE(traccar_sender_submit(s, &pos));
+  REQUIRE(sender_eventually([&] { return gate.entered == 1; }, 2000));
+  for (int i = 1; i <= 3; ++i) {
+    pos = sender_position(0, i);
+    CHECK(traccar_sender_submit(s, &pos));
+  }
+  pos = sender_position(0, 4);
+  CHECK(!traccar_sender_submit(s, &pos));
+  traccar_sender_counts_t counts;
+  traccar_sender_get_counts(s, &counts);
+  CHECK_EQ(counts.submitted, 4);
+  CHECK_EQ(counts.full, 1);
+
+  // flush waits for the held batch and the three behind it
+  auto t0 = std::chrono::steady_clock::now();
+  CHECK(!traccar_sender_flush(s, 50));
+  CHECK(std::chrono::steady_clock::now() - t0 >= std::chrono::milliseconds(50));
+  gate.open = true;
+  CHECK(traccar_sender_flush(s, 5000));
+  CHECK_EQ(gate.attempted.load(), 4);
+  traccar_sender_get_counts(s, &counts);
+  CHECK_EQ(counts.delivered, 4);
+
+  // Destroyed with one batch held and a full ring behind it: all of it is still sent
+  gate.open = false;
+  int entered = gate.entered;
+  pos = sender_position(1, 0);
+  REQUIRE(traccar_sender_submit(s, &pos));
+  REQUIRE(sender_eventually([&] { return gate.entered == entered + 1; }, 2000));
+  for (int i = 1; i <= 3; ++i) {
+    pos = sender_position(1, i);
+    CHECK(traccar_sender_submit(s, &pos));
+  }
+  std::thread opener([&gate] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    gate.open = true;
+  });
+  traccar_sender_destroy(s);
+  opener.join();
+  CHECK_EQ(gate.attempted.load(), 8);
+  CHECK_EQ(server.requests.load(), 8);
+  traccar_destroy(c);
+}
@@ -0,0 +1,153 @@
+// Shared-memory ring: a producer stalled between claiming a slot and publishing it is skipped,
+// and its slot is not handed to the next lap while it may still write to it; producers notice
+// an uploader that crashed with the ring open, and a second uploader may only take over the name
+// of one that is gone.
+
+#include "test.h"
+#include "TraccarShm.h"
+#include "TraccarInternal.h"
+#include "standin.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <set>
+#include <thread>
+
+static traccar_position_t shm_position(uint64_t t_ms) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.0; p.longitude = 9.0; p.timestampMs = t_ms;
+  return p;
+}
+
+static std::string shm_name(const char* what) {
+  char name[64];
+  snprintf(name, sizeof(name), "/traccar-test-%s-%d", what, (int)getpid());
+  return name;
+}
+
+// Tries cond every millisecond until it holds, up to timeout_ms
+template <typename F> static bool eventually(F cond, int timeout_ms) {
+  for (int i = 0; i <= timeout_ms; ++i) {
+    if (cond()) return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return false;
+}
+
+TEST(shm_stalled_producer) {
+  StandinServer server;
+  server.record = true;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  std::string name = shm_name("stall");
+  traccar_shm_daemon_t* d = traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 4, nullptr, nullptr);
+  REQUIRE(d);
+  std::thread uploader([d] { traccar_shm_daemon_run(d); });
+  traccar_shm_producer_t* p = traccar_shm_open(name.c_str());
+  REQUIRE(p && traccar_shm_is_open(p));
+
+  // Ticket 0 is claimed and not published; 1..3 wait behind it until the uploader gives up on it
+  uint64_t stalled;
+  REQUIRE(tr_shm_claim(p, &stalled));
+  CHECK_EQ(stalled, 0);
+  for (uint64_t i = 1; i <= 3; ++i) {
+    traccar_position_t pos = shm_position(1000 * i);
+    CHECK(traccar_shm_submit(p, &pos));
+  }
+  traccar_shm_counts_t counts;
+  auto delivered = [&] { traccar_shm_get_counts(p, &counts); return counts.delivered; };
+  CHECK(eventually([&] { return delivered() == 3; }, TRACCAR_SHM_STALL_MS + 2000));
+  CHECK_EQ(counts.skipped, 1);
+  // Ticket 4 maps to the skipped slot, which its producer still holds: the ring is full there
+  traccar_position_t pos = shm_position(4000);
+  CHECK(!traccar_shm_submit(p, &pos));
+  // The stalled producer wakes up, finds the slot skipped and leaves it alone; then it is reused
+  traccar_position_t late = shm_position(999);
+  CHECK(!tr_shm_publish(p, stalled, &late));
+  CHECK(eventually([&] { return traccar_shm_submit(p, &pos); }, 1000));
+  CHECK(eventually([&] { return delivered() == 4; }, 1000));
+
+  traccar_shm_daemon_stop(d);
+  uploader.join();
+  std::set<std::string> stamps;
+  for (const std::string& req : standin_received(&server)) {
+    size_t at = req.find("timestamp=");
+    REQUIRE(at != std::string::npos);
+    stamps.insert(req.substr(at + 10, req.find_first_of(" &", at) - at - 10));
+  }
+  CHECK_EQ(stamps.size(), 4); // 1..4 s, never the late one
+  for (const std::string& t : stamps) CHECK(t.find(".999") == std::string::npos);
+  traccar_shm_close(p);
+  traccar_shm_daemon_destroy(d);
+  traccar_destroy(c);
+}
+
+TEST(shm_uploader_crash) {
+  std::string name = shm_name("crash");
+  int ready[2];
+  REQUIRE(pipe(ready) == 0);
+  pid_t child = fork();
+  REQUIRE(child >= 0);
+  if (child == 0) {
+    // An uploader that dies with the ring open
+    traccar_client_t* c = traccar_create("http://127.0.0.1", 9, "dev");
+    bool ok = traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 8, nullptr, nullptr) != nullptr;
+    char b = ok ? 1 : 0;
+    if (write(ready[1], &b, 1) != 1) {}
+    pause();
+    _exit(0);
+  }
+  close(ready[1]);
+  char b = 0;
+  CHECK(read(ready[0], &b, 1) == 1 && b == 1);
+  close(ready[0]);
+  traccar_shm_producer_t* p = traccar_shm_open(name.c_str());
+  REQUIRE(p);
+  CHECK(traccar_shm_is_open(p));
+  // Its heartbeat goes stale as it never runs, but its process is there
+  std::this_thread::sleep_for(std::chrono::milliseconds(TRACCAR_SHM_STALL_MS + 100));
+  traccar_position_t pos = shm_position(1000);
+  CHECK(traccar_shm_submit(p, &pos));
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  CHECK(!traccar_shm_is_open(p));
+  CHECK(!traccar_shm_submit(p, &pos));
+  traccar_shm_counts_t counts;
+  traccar_shm_get_counts(p, &counts);
+  CHECK_EQ(counts.submitted, 1);
+  CHECK_EQ(counts.full, 0);
+  traccar_shm_close(p);
+  // Its segment is stale: a new uploader replaces it
+  traccar_client_t* c = traccar_create("http://127.0.0.1", 9, "dev");
+  traccar_shm_daemon_t* d = traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 8, nullptr, nullptr);
+  CHECK(d != nullptr);
+  traccar_shm_daemon_destroy(d);
+  traccar_destroy(c);
+}
+
+TEST(shm_second_uploader) {
+  std::string name = shm_name("second");
+  traccar_client_t* c = traccar_create("http://127.0.0.1", 9, "dev");
+  traccar_shm_daemon_t* d = traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 8, nullptr, nullptr);
+  REQUIRE(d);
+  traccar_shm_producer_t* p = traccar_shm_open(name.c_str());
+  REQUIRE(p);
+  // The first uploader is alive: its segment stays, and its producers keep feeding it
+  errno = 0;
+  CHECK(traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 8, nullptr, nullptr) == nullptr);
+  CHECK_EQ(errno, EBUSY);
+  CHECK(traccar_shm_is_open(p));
+  traccar_position_t pos = shm_position(1000);
+  CHECK(traccar_shm_submit(p, &pos));
+  traccar_shm_close(p);
+  traccar_shm_daemon_destroy(d);
+  d = traccar_shm_daemon_create(name.c_str(), c, TRACCAR_FORMAT_OSMAND, 8, nullptr, nullptr);
+  CHECK(d != nullptr);
+  traccar_shm_daemon_destroy(d);
+  traccar_destroy(c);
+}
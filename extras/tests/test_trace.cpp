@@ -0,0 +1,182 @@
+// Tracing against the stand-in server: the stages of a send share its request number, a ring
+// that wrapped gives its spans back oldest first, and the Chrome export cut to any buffer size
+// still parses.
+
+#include "test.h"
+#include "standin.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+static traccar_position_t trace_position(int i) {
+  traccar_position_t p = test_empty_position();
+  p.latitude = 45.0; p.longitude = 9.0; p.timestampMs = 1700000000000ULL + 1000ULL * i;
+  return p;
+}
+
+static std::vector<traccar_span_t> spans(traccar_client_t* c, size_t max = 256) {
+  std::vector<traccar_span_t> v(max);
+  v.resize(traccar_get_spans(c, v.data(), max));
+  return v;
+}
+
+static std::string stages(const std::vector<traccar_span_t>& v, size_t from = 0) {
+  std::string s;
+  for (size_t i = from; i < v.size(); ++i) s += (char)('0' + v[i].stage);
+  return s;
+}
+
+// Minimal JSON checker: a value and nothing after it
+static bool json_value(const char*& p);
+
+static void json_ws(const char*& p) {
+  while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t') ++p;
+}
+
+static bool json_string(const char*& p) {
+  if (*p++ != '"') return false;
+  for (; *p && *p != '"'; ++p) {
+    if ((unsigned char)*p < 0x20) return false;
+    if (*p == '\\' && !*++p) return false;
+  }
+  return *p++ == '"';
+}
+
+static bool json_list(const char*& p, char close, bool members) {
+  ++p;
+  json_ws(p);
+  if (*p == close) { ++p; return true; }
+  for (;;) {
+    json_ws(p);
+    if (members) {
+      if (!json_string(p)) return false;
+      json_ws(p);
+      if (*p++ != ':') return false;
+    }
+    if (!json_value(p)) return false;
+    json_ws(p);
+    if (*p == close) { ++p; return true; }
+    if (*p++ != ',') return false;
+  }
+}
+
+static bool json_value(const char*& p) {
+  json_ws(p);
+  if (*p == '{') return json_list(p, '}', true);
+  if (*p == '[') return json_list(p, ']', false);
+  if (*p == '"') return json_string(p);
+  if (!strncmp(p, "true", 4) || !strncmp(p, "null", 4)) { p += 4; return true; }
+  if (!strncmp(p, "false", 5)) { p += 5; return true; }
+  const char* start = p;
+  if (*p == '-') ++p;
+  while ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E' || *p == '+' || *p == '-') ++p;
+  return p > start && p[-1] >= '0' && p[-1] <= '9';
+}
+
+static bool json_valid(const std::string& s) {
+  const char* p = s.c_str();
+  if (!json_value(p)) return false;
+  json_ws(p);
+  return *p == '\0';
+}
+
+TEST(trace_send_spans) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  REQUIRE(traccar_set_trace(c, 64));
+  traccar_position_t p = trace_position(0);
+  int code = 0;
+  REQUIRE(traccar_send_osmand(c, &p, &code));
+  // A new connection: build, resolve, connect, write, wait, read, then the send as a whole
+  std::vector<traccar_span_t> v = spans(c);
+  std::string expect = { '0' + TRACCAR_SPAN_BUILD, '0' + TRACCAR_SPAN_RESOLVE, '0' + TRACCAR_SPAN_CONNECT,
+                         '0' + TRACCAR_SPAN_WRITE, '0' + TRACCAR_SPAN_WAIT, '0' + TRACCAR_SPAN_READ, '0' + TRACCAR_SPAN_SEND };
+  CHECK_STR(stages(v), expect);
+  REQUIRE(!v.empty());
+  uint32_t request = v[0].request;
+  for (const traccar_span_t& s : v) {
+    CHECK_EQ(s.request, request);
+    CHECK_EQ(s.kind, TRACCAR_STATS_OSMAND);
+  }
+  CHECK_EQ(v.back().code, 200);
+  // The send spans all its stages
+  for (size_t i = 0; i + 1 < v.size(); ++i) {
+    CHECK(v[i].start_us >= v.back().start_us);
+    CHECK(v[i].start_us + v[i].duration_us <= v.back().start_us + v.back().duration_us);
+  }
+  // The kept-alive connection: no lookup nor connect, and the next number
+  REQUIRE(traccar_send_osmand(c, &p, &code));
+  v = spans(c);
+  std::string reuse = { '0' + TRACCAR_SPAN_BUILD, '0' + TRACCAR_SPAN_WRITE, '0' + TRACCAR_SPAN_WAIT,
+                        '0' + TRACCAR_SPAN_READ, '0' + TRACCAR_SPAN_SEND };
+  CHECK_STR(stages(v, expect.size()), reuse);
+  for (size_t i = expect.size(); i < v.size(); ++i) CHECK_EQ(v[i].request, request + 1);
+  traccar_destroy(c);
+}
+
+TEST(trace_ring_wraps) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  // 7 spans for the first send, 5 for each next one: 22 through a ring of 8
+  REQUIRE(traccar_set_trace(c, 8));
+  traccar_position_t p = trace_position(0);
+  for (int i = 0; i < 4; ++i) REQUIRE(traccar_send_osmand(c, &p, nullptr));
+  std::vector<traccar_span_t> v = spans(c);
+  REQUIRE(v.size() == 8);
+  std::string reuse = { '0' + TRACCAR_SPAN_BUILD, '0' + TRACCAR_SPAN_WRITE, '0' + TRACCAR_SPAN_WAIT,
+                        '0' + TRACCAR_SPAN_READ, '0' + TRACCAR_SPAN_SEND };
+  CHECK_STR(stages(v), reuse.substr(2) + reuse); // the end of the third send, then the fourth
+  for (size_t i = 0; i < v.size(); ++i) CHECK_EQ(v[i].request, v.back().request - (i < 3 ? 1 : 0));
+  // Fewer than recorded: the most recent ones, still oldest first
+  std::vector<traccar_span_t> last = spans(c, 3);
+  CHECK_STR(stages(last), reuse.substr(2));
+  CHECK_EQ(last.back().request, v.back().request);
+
+  // The export lists them in the same order
+  std::vector<char> doc(traccar_trace_export_chrome(c, nullptr, 0) + 1);
+  traccar_trace_export_chrome(c, doc.data(), doc.size());
+  std::string json = doc.data(), names;
+  const char* kNames[] = { "send osmand", "build", "resolve", "connect", "write", "wait", "read" };
+  for (size_t at = json.find("\"name\":\""); at != std::string::npos; at = json.find("\"name\":\"", at + 1)) {
+    std::string name = json.substr(at + 8, json.find('"', at + 8) - at - 8);
+    for (int k = 0; k < 7; ++k) if (name == kNames[k]) names += (char)('0' + k);
+  }
+  CHECK_STR(names, stages(v));
+  traccar_destroy(c);
+}
+
+TEST(trace_export_cut) {
+  StandinServer server;
+  REQUIRE(standin_start(&server, 0, true));
+  traccar_client_t* c = traccar_create("http://127.0.0.1", server.port, "dev");
+  REQUIRE(traccar_set_trace(c, 16)); // wrapped by the third send
+  traccar_position_t p = trace_position(0);
+  for (int i = 0; i < 3; ++i) REQUIRE(traccar_send_osmand(c, &p, nullptr));
+  size_t full = traccar_trace_export_chrome(c, nullptr, 0);
+  std::vector<char> buf(full + 1);
+  CHECK_EQ(traccar_trace_export_chrome(c, buf.data(), buf.size()), full);
+  CHECK(json_valid(buf.data()));
+  CHECK_EQ(strlen(buf.data()), full);
+  const size_t empty = strlen("{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}");
+  size_t prev = 0;
+  for (size_t size = 1; size <= full; ++size) {
+    memset(buf.data(), 'x', buf.size());
+    CHECK_EQ(traccar_trace_export_chrome(c, buf.data(), size), full);
+    std::string out = buf.data();
+    if (size <= empty) {
+      CHECK(out.empty());
+      continue;
+    }
+    if (!json_valid(out)) {
+      test_fail(__FILE__, __LINE__, ("not JSON at size " + std::to_string(size) + ": " + out).c_str());
+      break;
+    }
+    CHECK(out.size() < size);
+    CHECK(out.size() >= prev); // more room, never fewer events
+    prev = out.size();
+  }
+  traccar_destroy(c);
+}
@@ -0,0 +1,174 @@
+#ifndef TRACCAR_HPP
+#define TRACCAR_HPP
+
+// C++17 interface for host builds
+//
+// traccar::Position has std::string_view text fields, so a position can point straight into
+// received buffers or other strings without copying them or NUL-terminating them. Its numeric
+// fields are a traccar_position_t (fix, whose const char* members are unused), and
+// traccar::Client hands both to the C core in place: the builders encode straight into caller
+// memory or a caller-owned std::string, with no intermediate buffer or String. A Position is not
+// a traccar_position_t; the C APIs without a texts parameter take toC(storage).
+//
+//   traccar::Client client("http://demo.traccar.org", 5055, "123456");
+//   traccar::Position pos;
+//   pos.fix.latitude = 45.46; pos.fix.longitude = 9.19;
+//   pos.eventName = line.substr(0, 12);  // a view into line
+//   std::string url;
+//   client.appendOsmAndUrl(pos, url);
+
+#include "TraccarClient.h"
+
+#if __cplusplus < 201703L && (!defined(_MSVC_LANG) || _MSVC_LANG < 201703L)
+#error "Traccar.hpp requires C++17"
+#endif
+
+#include <math.h>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace traccar {
+
+enum class Format { OsmAnd = TRACCAR_FORMAT_OSMAND, Json = TRACCAR_FORMAT_JSON };
+
+struct Position {
+  traccar_position_t fix; // numeric fields; its text members are ignored, the views below count
+  // Empty omits
+  std::string_view driverUniqueId;
+  std::string_view cell;
+  std::string_view wifi;
+  std::string_view eventName;
+  std::string_view activityType;
+
+  Position() : fix{NAN, NAN, NAN, NAN, NAN, NAN, NAN, 0, -1, -1, false,
+                   nullptr, nullptr, nullptr, nullptr, nullptr, NAN} {}
+
+  traccar_texts_t texts() const {
+    return { text(driverUniqueId), text(cell), text(wifi), text(eventName), text(activityType) };
+  }
+
+  // The whole position as C sees it, for the APIs without a texts parameter (filter, queues,
+  // Codec 8): the text fields are copied NUL-terminated into storage, which must outlive the
+  // result and not change while it is used
+  traccar_position_t toC(std::string& storage) const {
+    const std::string_view* views[5] = { &driverUniqueId, &cell, &wifi, &eventName, &activityType };
+    size_t at[5], size = 0;
+    for (int i = 0; i < 5; ++i) { at[i] = size; size += views[i]->size() + 1; }
+    storage.assign(size, '\0');
+    traccar_position_t p = fix;
+    const char** fields[5] = { &p.driverUniqueId, &p.cell, &p.wifi, &p.eventName, &p.activityType };
+    for (int i = 0; i < 5; ++i) {
+      views[i]->copy(&storage[at[i]], views[i]->size());
+      *fields[i] = views[i]->empty() ? nullptr : storage.data() + at[i];
+    }
+    return p;
+  }
+
+private:
+  static traccar_text_t text(std::string_view s) { return { s.data(), s.size() }; }
+};
+
+// Owns a traccar_client_t; movable, not copyable. Empty (false) if creation failed.
+class Client {
+public:
+  Client() = default;
+  Client(std::string_view hostUrl, uint16_t port, std::string_view deviceId,
+         const traccar_allocator_t* allocator = nullptr)
+    : _core(traccar_create_ex(std::string(hostUrl).c_str(), port, std::string(deviceId).c_str(), allocator)) {}
+  ~Client() { traccar_destroy(_core); }
+
+  Client(Client&& other) noexcept : _core(std::exchange(other._core, nullptr)) {}
+  Client& operator=(Client&& other) noexcept {
+    if (this != &other) {
+      traccar_destroy(_core);
+      _core = std::exchange(other._core, nullptr);
+    }
+    return *this;
+  }
+  Client(const Client&) = delete;
+  Client& operator=(const Client&) = delete;
+
+  explicit operator bool() const { return _core != nullptr; }
+  traccar_client_t* get() const { return _core; }
+
+  void setHost(std::string_view hostUrl) { traccar_set_host(_core, std::string(hostUrl).c_str()); }
+  void setPort(uint16_t port) { traccar_set_port(_core, port); }
+  void setDeviceId(std::string_view deviceId) { traccar_set_device_id(_core, std::string(deviceId).c_str()); }
+  void setBasePath(std::string_view basePath) { traccar_set_base_path(_core, std::string(basePath).c_str()); }
+  void setTimeoutMs(uint16_t timeoutMs) { traccar_set_timeout_ms(_core, timeoutMs); }
+  void setKeepAlive(bool enabled) { traccar_set_keep_alive(_core, enabled); }
+
+  // Into out[0..size), NUL-terminated and cut to fit like the C builders; returns the full length
+  size_t buildOsmAndUrl(const Position& pos, char* out, size_t size) const {
+    traccar_texts_t t = pos.texts();
+    return traccar_build_osmand_url_ex(_core, &pos.fix, &t, out, size);
+  }
+  size_t buildOsmAndForm(const Position& pos, char* out, size_t size) const {
+    traccar_texts_t t = pos.texts();
+    return traccar_build_osmand_form_body_ex(_core, &pos.fix, &t, out, size);
+  }
+  size_t buildJson(const Position& pos, char* out, size_t size) const {
+    traccar_texts_t t = pos.texts();
+    return traccar_build_json_body_ex(_core, &pos.fix, &t, out, size);
+  }
+
+  // Appended to out, which grows as needed (reusing one string keeps this allocation-free);
+  // returns the bytes appended
+  size_t appendOsmAndUrl(const Position& pos, std::string& out) const { return append(traccar_build_osmand_url_ex, pos, out); }
+  size_t appendOsmAndForm(const Position& pos, std::string& out) const { return append(traccar_build_osmand_form_body_ex, pos, out); }
+  size_t appendJson(const Position& pos, std::string& out) const { return append(traccar_build_json_body_ex, pos, out); }
+
+  bool send(Format format, const Position& pos, int* outHttpCode = nullptr) const {
+    traccar_texts_t t = pos.texts();
+    return traccar_send_ex(_core, (traccar_format_t)format, &pos.fix, &t, outHttpCode);
+  }
+  bool sendOsmAnd(const Position& pos, int* outHttpCode = nullptr) const { return send(Format::OsmAnd, pos, outHttpCode); }
+  bool sendJson(const Position& pos, int* outHttpCode = nullptr) const { return send(Format::Json, pos, outHttpCode); }
+
+  traccar_stats_t stats() const {
+    traccar_stats_t s;
+    traccar_get_stats(_core, &s);
+    return s;
+  }
+
+private:
+  typedef size_t (*build_fn)(traccar_client_t*, const traccar_position_t*, const traccar_texts_t*, char*, size_t);
+
+  // Encodes straight into the string's spare room where std::string allows writing it without
+  // zero-filling first (resize_and_overwrite, C++23); otherwise into a stack buffer that is then
+  // appended, resizing only for results longer than that. A result that did not fit is redone
+  // once at its full length.
+  size_t append(build_fn build, const Position& pos, std::string& out) const {
+    traccar_texts_t t = pos.texts();
+    size_t base = out.size();
+#if defined(__cpp_lib_string_resize_and_overwrite)
+    size_t room = out.capacity() - base >= 256 ? out.capacity() - base : 512;
+    for (;;) {
+      size_t n = 0;
+      out.resize_and_overwrite(base + room + 1, [&](char* p, size_t) {
+        n = build(_core, &pos.fix, &t, p + base, room + 1);
+        return base + (n <= room ? n : 0);
+      });
+      if (n <= room) return n;
+      room = n;
+    }
+#else
+    char buf[2048]; // host builds: ample for any position short of very long wifi/cell lists
+    size_t n = build(_core, &pos.fix, &t, buf, sizeof(buf));
+    if (n < sizeof(buf)) {
+      out.append(buf, n);
+      return n;
+    }
+    out.resize(base + n);
+    build(_core, &pos.fix, &t, &out[base], n + 1); // writes the NUL over the string's terminator
+    return n;
+#endif
+  }
+
+  traccar_client_t* _core = nullptr;
+};
+
+} // namespace traccar
+
+#endif // TRACCAR_HPP
@@ -0,0 +1,583 @@
+#include "TraccarArchive.h"
+#include "TraccarInternal.h"
+
+#if TRACCAR_HAVE_POSIX
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+// File layout: [file header][block]...; a block is [tr_block_hdr_t][column 0]...[column N-1].
+// Blocks are only ever appended, so only the last one can be torn.
+#define TR_ARCHIVE_MAGIC    0x41435254u // "TRCA"
+#define TR_ARCHIVE_VERSION  1u
+#define TR_BLOCK_MAGIC      0x4B4C4254u // "TBLK"
+#define TR_ARCHIVE_NSTR     5
+#define TR_ARCHIVE_NNUM     8
+#define TR_ARCHIVE_STR_MAX  0xFFFF      // longer strings are not archived
+#define TR_QMAX             4611686018427387904.0 // 2^62: quantized values are clamped to +-this
+
+// Columns of a block, each a stream of varints (the text column also holds string bytes)
+enum {
+  TR_COL_FLAGS,   // runs of flags words: run length, word
+  TR_COL_TIME,    // timestampMs: delta of delta, zigzag
+  TR_COL_NUM,     // TR_ARCHIVE_NNUM columns of fixed-point doubles: delta, zigzag (present ones only)
+  TR_COL_BATT = TR_COL_NUM + TR_ARCHIVE_NNUM, // batteryPercent: delta, zigzag
+  TR_COL_TEXT,    // present strings: 0 = as in the previous fix that had it, else length + 1 and the bytes with the NUL
+  TR_COLS
+};
+
+// Flags word of a fix
+#define TR_F_NUM(k)    (1u << (k))   // double k present
+#define TR_F_BATT      (1u << 8)
+#define TR_F_VALID_SHIFT 9           // 2 bits: validFlag + 1 (0 omit, 1 false, 2 true)
+#define TR_F_CHARGING  (1u << 11)
+#define TR_F_STR(i)    (1u << (12 + (i)))
+
+typedef struct tr_archive_hdr_s {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t block;    // TRACCAR_ARCHIVE_BLOCK it was written with
+  uint32_t reserved;
+} tr_archive_hdr_t;
+
+typedef struct tr_block_hdr_s {
+  uint32_t magic;
+  uint32_t count;
+  uint64_t min_ts, max_ts;
+  uint32_t len[TR_COLS];
+  uint32_t crc;      // over the columns
+  uint32_t hdr_crc;  // over the fields above
+} tr_block_hdr_t;
+
+typedef struct tr_block_ref_s {
+  uint64_t min_ts, max_ts;
+  uint64_t offset;   // of the header
+  uint64_t first;    // ordinal of its first fix
+  uint32_t count;
+  uint32_t len[TR_COLS];
+  uint32_t crc;
+} tr_block_ref_t;
+
+typedef struct tr_col_s {
+  uint8_t* data;
+  size_t len, cap;
+} tr_col_t;
+
+// Fixed-point scale of each double column, the precision of the wire formats
+static const double kScale[TR_ARCHIVE_NNUM] = { 1e7, 1e7, 10, 100, 10, 100, 10, 10 };
+
+struct traccar_archive_s {
+  int fd;
+  uint64_t end;               // file size: where the next block goes
+  // Index of the written blocks
+  tr_block_ref_t* blocks;
+  size_t block_count, block_cap;
+  uint64_t written;           // fixes in them
+  // Pending block, encoded as it is appended
+  tr_col_t cols[TR_COLS];
+  uint32_t count;
+  uint64_t min_ts, max_ts;
+  uint64_t prev_ts, prev_delta;
+  int64_t prev_num[TR_ARCHIVE_NNUM];
+  int32_t prev_batt;
+  uint32_t run_word, run_len; // open run of flags words, written when it ends
+  size_t prev_str[TR_ARCHIVE_NSTR], prev_str_len[TR_ARCHIVE_NSTR]; // in cols[TR_COL_TEXT]; len 0 = none
+  // Scan state
+  uint8_t* read_buf;
+  size_t read_cap;
+  traccar_position_t* decoded; // TRACCAR_ARCHIVE_BLOCK
+  uint64_t* ordinals;          // of the decoded fixes handed to the callback
+};
+
+static inline double tr_pos_num(const traccar_position_t* p, int k) {
+  switch (k) {
+    case 0: return p->latitude;
+    case 1: return p->longitude;
+    case 2: return p->altitudeMeters;
+    case 3: return p->speedKmh;
+    case 4: return p->headingDeg;
+    case 5: return p->hdop;
+    case 6: return p->accuracyMeters;
+    default: return p->odometer;
+  }
+}
+
+static inline const char* tr_pos_str(const traccar_position_t* p, int i) {
+  switch (i) {
+    case 0: return p->driverUniqueId;
+    case 1: return p->cell;
+    case 2: return p->wifi;
+    case 3: return p->eventName;
+    default: return p->activityType;
+  }
+}
+
+// ----------------- Varints -----------------
+
+static inline uint64_t tr_zigzag(uint64_t v) {
+  return (v << 1) ^ (uint64_t)((int64_t)v >> 63);
+}
+
+static inline uint64_t tr_unzigzag(uint64_t v) {
+  return (v >> 1) ^ (0 - (v & 1));
+}
+
+// The caller has reserved 10 bytes
+static inline void tr_put_varint(tr_col_t* c, uint64_t v) {
+  uint8_t* p = c->data + c->len;
+  while (v >= 0x80) {
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  c->len = (size_t)(p - c->data);
+}
+
+static inline bool tr_get_varint(const uint8_t** p, const uint8_t* end, uint64_t* v) {
+  const uint8_t* q = *p;
+  if (q < end && *q < 0x80) { // one byte: most deltas
+    *v = *q;
+    *p = q + 1;
+    return true;
+  }
+  uint64_t r = 0;
+  for (int shift = 0; q < end && shift < 64; shift += 7) {
+    uint8_t b = *q++;
+    r |= (uint64_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      *v = r;
+      *p = q;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool tr_col_reserve(tr_col_t* c, size_t n) {
+  if (c->cap - c->len >= n) return true;
+  size_t cap = c->cap ? c->cap : 256;
+  while (cap - c->len < n) cap *= 2;
+  uint8_t* data = (uint8_t*)realloc(c->data, cap);
+  if (!data) return false;
+  c->data = data;
+  c->cap = cap;
+  return true;
+}
+
+static inline int64_t tr_quantize(double v, double scale) {
+  double q = round(v * scale);
+  if (q > TR_QMAX) q = TR_QMAX;
+  if (q < -TR_QMAX) q = -TR_QMAX;
+  return (int64_t)q;
+}
+
+// ----------------- Decoding -----------------
+
+// Decodes count fixes from the columns into out; strings point into the text column. false if the
+// columns are malformed.
+static bool tr_decode_block(const uint8_t* const* cols, const uint32_t* len, uint32_t count, traccar_position_t* out) {
+  const uint8_t* p[TR_COLS];
+  const uint8_t* end[TR_COLS];
+  for (int c = 0; c < TR_COLS; ++c) {
+    p[c] = cols[c];
+    end[c] = cols[c] + len[c];
+  }
+  uint64_t ts = 0, delta = 0, v;
+  int64_t num[TR_ARCHIVE_NNUM] = {};
+  int32_t batt = 0;
+  const char* prev_str[TR_ARCHIVE_NSTR] = {};
+  uint32_t word = 0;
+  uint64_t run = 0;
+  for (uint32_t n = 0; n < count; ++n) {
+    traccar_position_t* o = &out[n];
+    if (run == 0) {
+      if (!tr_get_varint(&p[TR_COL_FLAGS], end[TR_COL_FLAGS], &run) || run == 0 ||
+          !tr_get_varint(&p[TR_COL_FLAGS], end[TR_COL_FLAGS], &v)) return false;
+      word = (uint32_t)v;
+    }
+    --run;
+    if (!tr_get_varint(&p[TR_COL_TIME], end[TR_COL_TIME], &v)) return false;
+    delta += tr_unzigzag(v);
+    ts += delta;
+    o->timestampMs = ts;
+    double d[TR_ARCHIVE_NNUM];
+    for (int k = 0; k < TR_ARCHIVE_NNUM; ++k) {
+      d[k] = NAN;
+      if (!(word & TR_F_NUM(k))) continue;
+      if (!tr_get_varint(&p[TR_COL_NUM + k], end[TR_COL_NUM + k], &v)) return false;
+      num[k] = (int64_t)((uint64_t)num[k] + tr_unzigzag(v));
+      d[k] = (double)num[k] / kScale[k];
+    }
+    o->latitude = d[0]; o->longitude = d[1]; o->altitudeMeters = d[2]; o->speedKmh = d[3];
+    o->headingDeg = d[4]; o->hdop = d[5]; o->accuracyMeters = d[6]; o->odometer = d[7];
+    o->batteryPercent = -1;
+    if (word & TR_F_BATT) {
+      if (!tr_get_varint(&p[TR_COL_BATT], end[TR_COL_BATT], &v)) return false;
+      batt = (int32_t)((uint32_t)batt + (uint32_t)tr_unzigzag(v));
+      o->batteryPercent = batt;
+    }
+    o->validFlag = (int32_t)((word >> TR_F_VALID_SHIFT) & 3) - 1;
+    o->charging = (word & TR_F_CHARGING) != 0;
+    const char* s[TR_ARCHIVE_NSTR] = {};
+    for (int i = 0; i < TR_ARCHIVE_NSTR; ++i) {
+      if (!(word & TR_F_STR(i))) continue;
+      if (!tr_get_varint(&p[TR_COL_TEXT], end[TR_COL_TEXT], &v)) return false;
+      if (v == 0) {
+        if (!prev_str[i]) return false;
+        s[i] = prev_str[i];
+        continue;
+      }
+      if (v > (uint64_t)(end[TR_COL_TEXT] - p[TR_COL_TEXT]) || p[TR_COL_TEXT][v - 1] != 0) return false;
+      s[i] = prev_str[i] = (const char*)p[TR_COL_TEXT];
+      p[TR_COL_TEXT] += v;
+    }
+    o->driverUniqueId = s[0]; o->cell = s[1]; o->wifi = s[2]; o->eventName = s[3]; o->activityType = s[4];
+  }
+  return true;
+}
+
+// ----------------- Writing -----------------
+
+static void tr_pending_reset(traccar_archive_t* a) {
+  for (int c = 0; c < TR_COLS; ++c) a->cols[c].len = 0;
+  a->count = 0;
+  a->min_ts = UINT64_MAX;
+  a->max_ts = 0;
+  a->prev_ts = a->prev_delta = 0;
+  memset(a->prev_num, 0, sizeof(a->prev_num));
+  a->prev_batt = 0;
+  a->run_word = a->run_len = 0;
+  memset(a->prev_str_len, 0, sizeof(a->prev_str_len));
+}
+
+// Writes the open run of flags words; the flags column has room for it (reserved by each append)
+static void tr_close_run(traccar_archive_t* a) {
+  if (!a->run_len) return;
+  tr_put_varint(&a->cols[TR_COL_FLAGS], a->run_len);
+  tr_put_varint(&a->cols[TR_COL_FLAGS], a->run_word);
+}
+
+static bool tr_index_push(traccar_archive_t* a, const tr_block_hdr_t* h, uint64_t offset) {
+  if (a->block_count == a->block_cap) {
+    size_t cap = a->block_cap ? a->block_cap * 2 : 64;
+    tr_block_ref_t* b = (tr_block_ref_t*)realloc(a->blocks, cap * sizeof(*b));
+    if (!b) return false;
+    a->blocks = b;
+    a->block_cap = cap;
+  }
+  tr_block_ref_t* r = &a->blocks[a->block_count++];
+  r->min_ts = h->min_ts;
+  r->max_ts = h->max_ts;
+  r->offset = offset;
+  r->first = a->written;
+  r->count = h->count;
+  memcpy(r->len, h->len, sizeof(r->len));
+  r->crc = h->crc;
+  a->written += h->count;
+  return true;
+}
+
+// Writes the pending fixes as one block with one pwritev
+static bool tr_write_block(traccar_archive_t* a) {
+  if (!a->count) return true;
+  size_t flags_len = a->cols[TR_COL_FLAGS].len;
+  tr_close_run(a);
+  tr_block_hdr_t h;
+  memset(&h, 0, sizeof(h));
+  h.magic = TR_BLOCK_MAGIC;
+  h.count = a->count;
+  h.min_ts = a->min_ts;
+  h.max_ts = a->max_ts;
+  struct iovec iov[1 + TR_COLS];
+  iov[0].iov_base = &h;
+  iov[0].iov_len = sizeof(h);
+  uint32_t crc_len = 0;
+  for (int c = 0; c < TR_COLS; ++c) {
+    h.len[c] = (uint32_t)a->cols[c].len;
+    crc_len += h.len[c];
+    iov[1 + c].iov_base = a->cols[c].data;
+    iov[1 + c].iov_len = a->cols[c].len;
+  }
+  for (int c = 0; c < TR_COLS; ++c) h.crc = tr_crc32(a->cols[c].data, a->cols[c].len, h.crc);
+  h.hdr_crc = tr_crc32((const uint8_t*)&h, offsetof(tr_block_hdr_t, hdr_crc));
+  ssize_t total = (ssize_t)(sizeof(h) + crc_len);
+  if (pwritev(a->fd, iov, 1 + TR_COLS, (off_t)a->end) != total || !tr_index_push(a, &h, a->end)) {
+    if (ftruncate(a->fd, (off_t)a->end) != 0) {} // drop what was written of it
+    a->cols[TR_COL_FLAGS].len = flags_len;       // the run stays open
+    return false;
+  }
+  a->end += (uint64_t)total;
+  tr_pending_reset(a);
+  return true;
+}
+
+bool traccar_archive_append(traccar_archive_t* a, const traccar_position_t* pos) {
+  if (!a || !pos) return false;
+  if (a->count == TRACCAR_ARCHIVE_BLOCK && !tr_write_block(a)) return false;
+  size_t slen[TR_ARCHIVE_NSTR], text = 0;
+  for (int i = 0; i < TR_ARCHIVE_NSTR; ++i) {
+    const char* s = tr_pos_str(pos, i);
+    slen[i] = (s && *s) ? strlen(s) : 0;
+    if (slen[i] > TR_ARCHIVE_STR_MAX) slen[i] = 0;
+    text += slen[i] ? slen[i] + 1 + 3 : 0;
+  }
+  // Room for the widest varints first, so a fix is never half encoded
+  bool ok = tr_col_reserve(&a->cols[TR_COL_FLAGS], 40) && tr_col_reserve(&a->cols[TR_COL_TEXT], text);
+  for (int c = TR_COL_TIME; c < TR_COL_TEXT && ok; ++c) ok = tr_col_reserve(&a->cols[c], 10);
+  if (!ok) return false;
+
+  uint32_t word = 0;
+  for (int k = 0; k < TR_ARCHIVE_NNUM; ++k) {
+    double v = tr_pos_num(pos, k);
+    if (!isfinite(v)) continue;
+    word |= TR_F_NUM(k);
+    int64_t q = tr_quantize(v, kScale[k]);
+    tr_put_varint(&a->cols[TR_COL_NUM + k], tr_zigzag((uint64_t)q - (uint64_t)a->prev_num[k]));
+    a->prev_num[k] = q;
+  }
+  if (pos->batteryPercent >= 0) {
+    word |= TR_F_BATT;
+    tr_put_varint(&a->cols[TR_COL_BATT], tr_zigzag((uint64_t)(int64_t)pos->batteryPercent - (uint64_t)(int64_t)a->prev_batt));
+    a->prev_batt = pos->batteryPercent;
+  }
+  word |= (uint32_t)(pos->validFlag < 0 ? 0 : pos->validFlag == 0 ? 1 : 2) << TR_F_VALID_SHIFT;
+  if (pos->charging) word |= TR_F_CHARGING;
+  tr_col_t* t = &a->cols[TR_COL_TEXT];
+  for (int i = 0; i < TR_ARCHIVE_NSTR; ++i) {
+    if (!slen[i]) continue;
+    word |= TR_F_STR(i);
+    const char* s = tr_pos_str(pos, i);
+    if (a->prev_str_len[i] == slen[i] && memcmp(t->data + a->prev_str[i], s, slen[i]) == 0) {
+      tr_put_varint(t, 0);
+      continue;
+    }
+    tr_put_varint(t, slen[i] + 1);
+    a->prev_str[i] = t->len;
+    a->prev_str_len[i] = slen[i];
+    memcpy(t->data + t->len, s, slen[i] + 1);
+    t->len += slen[i] + 1;
+  }
+
+  uint64_t delta = pos->timestampMs - a->prev_ts;
+  tr_put_varint(&a->cols[TR_COL_TIME], tr_zigzag(delta - a->prev_delta));
+  a->prev_ts = pos->timestampMs;
+  a->prev_delta = delta;
+  if (pos->timestampMs < a->min_ts) a->min_ts = pos->timestampMs;
+  if (pos->timestampMs > a->max_ts) a->max_ts = pos->timestampMs;
+
+  if (a->run_len && word == a->run_word) {
+    a->run_len++;
+  } else {
+    tr_close_run(a);
+    a->run_word = word;
+    a->run_len = 1;
+  }
+  a->count++;
+  return true;
+}
+
+bool traccar_archive_flush(traccar_archive_t* a) {
+  return a && tr_write_block(a);
+}
+
+bool traccar_archive_sync(traccar_archive_t* a) {
+  return traccar_archive_flush(a) && fsync(a->fd) == 0;
+}
+
+// ----------------- Open / close -----------------
+
+// Rebuilds the index from the block headers; the columns are read only for the last block, the
+// only one a crash can have torn
+static void tr_archive_recover(traccar_archive_t* a, uint64_t size) {
+  uint64_t off = sizeof(tr_archive_hdr_t);
+  while (off + sizeof(tr_block_hdr_t) <= size) {
+    tr_block_hdr_t h;
+    if (pread(a->fd, &h, sizeof(h), (off_t)off) != (ssize_t)sizeof(h)) break;
+    if (h.magic != TR_BLOCK_MAGIC || h.hdr_crc != tr_crc32((const uint8_t*)&h, offsetof(tr_block_hdr_t, hdr_crc)) ||
+        h.count == 0 || h.count > TRACCAR_ARCHIVE_BLOCK) break;
+    uint64_t len = 0;
+    for (int c = 0; c < TR_COLS; ++c) len += h.len[c];
+    uint64_t next = off + sizeof(h) + len;
+    if (next > size) break;
+    if (next == size) {
+      uint8_t* buf = (uint8_t*)malloc(len ? (size_t)len : 1);
+      bool good = buf && pread(a->fd, buf, (size_t)len, (off_t)(off + sizeof(h))) == (ssize_t)len &&
+                  tr_crc32(buf, (size_t)len) == h.crc;
+      free(buf);
+      if (!good) break;
+    }
+    if (!tr_index_push(a, &h, off)) break;
+    off = next;
+  }
+  if (off < size && ftruncate(a->fd, (off_t)off) != 0) {}
+  a->end = off;
+}
+
+traccar_archive_t* traccar_archive_open(const char* path) {
+  if (!path) return nullptr;
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0) { close(fd); return nullptr; }
+  tr_archive_hdr_t hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  if ((size_t)st.st_size < sizeof(hdr)) {
+    // New (or torn before its header was written)
+    hdr.magic = TR_ARCHIVE_MAGIC;
+    hdr.version = TR_ARCHIVE_VERSION;
+    hdr.block = TRACCAR_ARCHIVE_BLOCK;
+    if (ftruncate(fd, 0) != 0 || pwrite(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr)) { close(fd); return nullptr; }
+    st.st_size = sizeof(hdr);
+  } else if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || hdr.magic != TR_ARCHIVE_MAGIC ||
+             hdr.version != TR_ARCHIVE_VERSION || hdr.block > TRACCAR_ARCHIVE_BLOCK) {
+    close(fd); // not an archive this build can read: left untouched
+    return nullptr;
+  }
+  traccar_archive_t* a = (traccar_archive_t*)calloc(1, sizeof(*a));
+  if (a) a->decoded = (traccar_position_t*)malloc(TRACCAR_ARCHIVE_BLOCK * sizeof(traccar_position_t));
+  if (a) a->ordinals = (uint64_t*)malloc(TRACCAR_ARCHIVE_BLOCK * sizeof(uint64_t));
+  if (!a || !a->decoded || !a->ordinals) {
+    if (a) free(a->decoded);
+    free(a);
+    close(fd);
+    return nullptr;
+  }
+  a->fd = fd;
+  tr_pending_reset(a);
+  tr_archive_recover(a, (uint64_t)st.st_size);
+  return a;
+}
+
+void traccar_archive_close(traccar_archive_t* a) {
+  if (!a) return;
+  tr_write_block(a);
+  close(a->fd);
+  for (int c = 0; c < TR_COLS; ++c) free(a->cols[c].data);
+  free(a->blocks);
+  free(a->read_buf);
+  free(a->decoded);
+  free(a->ordinals);
+  free(a);
+}
+
+size_t traccar_archive_count(const traccar_archive_t* a) {
+  return a ? (size_t)(a->written + a->count) : 0;
+}
+
+uint64_t traccar_archive_bytes(const traccar_archive_t* a) {
+  return a ? a->end : 0;
+}
+
+// ----------------- Scans -----------------
+
+// Keeps the decoded fixes in the range from ordinal first on, in order, and hands them to cb;
+// a->ordinals[i] is the ordinal of the i-th one passed
+static bool tr_deliver(traccar_archive_t* a, uint32_t count, uint64_t block_first, uint64_t from_ms, uint64_t to_ms,
+                       uint64_t first, traccar_archive_cb cb, void* user, size_t* passed) {
+  size_t n = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t ts = a->decoded[i].timestampMs;
+    if (ts < from_ms || ts >= to_ms || block_first + i < first) continue;
+    if (n != i) a->decoded[n] = a->decoded[i];
+    a->ordinals[n] = block_first + i;
+    ++n;
+  }
+  if (!n) return true;
+  *passed += n;
+  return cb(user, a->decoded, n);
+}
+
+// traccar_archive_scan, skipping the fixes before ordinal first
+static size_t tr_scan(traccar_archive_t* a, uint64_t from_ms, uint64_t to_ms, uint64_t first,
+                      traccar_archive_cb cb, void* user) {
+  size_t passed = 0;
+  for (size_t b = 0; b < a->block_count; ++b) {
+    const tr_block_ref_t* r = &a->blocks[b];
+    if (r->max_ts < from_ms || r->min_ts >= to_ms || r->first + r->count <= first) continue;
+    size_t len = 0;
+    for (int c = 0; c < TR_COLS; ++c) len += r->len[c];
+    if (len > a->read_cap) {
+      uint8_t* buf = (uint8_t*)realloc(a->read_buf, len);
+      if (!buf) return passed;
+      a->read_buf = buf;
+      a->read_cap = len;
+    }
+    if (pread(a->fd, a->read_buf, len, (off_t)(r->offset + sizeof(tr_block_hdr_t))) != (ssize_t)len ||
+        tr_crc32(a->read_buf, len) != r->crc) continue;
+    const uint8_t* cols[TR_COLS];
+    size_t at = 0;
+    for (int c = 0; c < TR_COLS; ++c) {
+      cols[c] = a->read_buf + at;
+      at += r->len[c];
+    }
+    if (!tr_decode_block(cols, r->len, r->count, a->decoded)) continue;
+    if (!tr_deliver(a, r->count, r->first, from_ms, to_ms, first, cb, user, &passed)) return passed;
+  }
+  // The pending block, with its open run of flags words closed for the decoder only
+  if (a->count && a->max_ts >= from_ms && a->min_ts < to_ms && a->written + a->count > first) {
+    size_t flags_len = a->cols[TR_COL_FLAGS].len;
+    tr_close_run(a);
+    const uint8_t* cols[TR_COLS];
+    uint32_t len[TR_COLS];
+    for (int c = 0; c < TR_COLS; ++c) {
+      cols[c] = a->cols[c].data;
+      len[c] = (uint32_t)a->cols[c].len;
+    }
+    bool ok = tr_decode_block(cols, len, a->count, a->decoded);
+    a->cols[TR_COL_FLAGS].len = flags_len;
+    if (ok) tr_deliver(a, a->count, a->written, from_ms, to_ms, first, cb, user, &passed);
+  }
+  return passed;
+}
+
+size_t traccar_archive_scan(traccar_archive_t* a, uint64_t from_ms, uint64_t to_ms,
+                            traccar_archive_cb cb, void* user) {
+  if (!a || !cb || from_ms >= to_ms) return 0;
+  return tr_scan(a, from_ms, to_ms, 0, cb, user);
+}
+
+typedef struct tr_export_s {
+  traccar_archive_t* archive;
+  traccar_client_t* client;
+  traccar_format_t format;
+  size_t max_batch;
+  size_t delivered;
+  uint64_t resume;   // ordinal of the first fix not delivered
+} tr_export_t;
+
+static bool tr_export_cb(void* user, const traccar_position_t* positions, size_t n) {
+  tr_export_t* e = (tr_export_t*)user;
+  bool accepted[TRACCAR_ARCHIVE_BLOCK];
+  for (size_t at = 0; at < n; at += e->max_batch) {
+    size_t m = n - at < e->max_batch ? n - at : e->max_batch;
+    if (e->format == TRACCAR_FORMAT_JSON) traccar_send_json_batch(e->client, positions + at, m, accepted, nullptr);
+    else traccar_send_osmand_batch(e->client, positions + at, m, accepted, nullptr);
+    // Only the accepted prefix counts, so a resumed export keeps the order
+    size_t k = 0;
+    while (k < m && accepted[k]) ++k;
+    e->delivered += k;
+    if (k < m) {
+      e->resume = e->archive->ordinals[at + k];
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t traccar_archive_export(traccar_archive_t* a, uint64_t from_ms, uint64_t to_ms,
+                              traccar_client_t* client, traccar_format_t format, size_t max_batch,
+                              uint64_t* cursor) {
+  uint64_t first = cursor ? *cursor : 0;
+  tr_export_t e = { a, client, format, max_batch, 0, a ? a->written + a->count : first };
+  if (e.max_batch == 0 || e.max_batch > TRACCAR_ARCHIVE_BLOCK) e.max_batch = TRACCAR_ARCHIVE_BLOCK;
+  if (a && client && from_ms < to_ms) tr_scan(a, from_ms, to_ms, first, tr_export_cb, &e);
+  if (cursor) *cursor = e.resume;
+  return e.delivered;
+}
+
+#endif // TRACCAR_HAVE_POSIX
@@ -0,0 +1,72 @@
+#ifndef TRACCAR_ARCHIVE_H
+#define TRACCAR_ARCHIVE_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Compact on-disk track archive for long offline periods (POSIX builds only)
+//
+// Positions are appended to a file in blocks of TRACCAR_ARCHIVE_BLOCK fixes, each field in its own
+// column: numbers as fixed-point at the precision the encoders send (1e-7 degrees for coordinates),
+// delta and zigzag varint coded against the previous fix, timestamps as deltas of deltas, and the
+// presence bits, validFlag and charging packed into one flags word per fix, stored as runs. A
+// string equal to the previous fix's costs one byte. A typical fix takes 10-15 bytes instead of
+// the few hundred of its OsmAnd URL or JSON object. Each block carries its time range and a CRC;
+// the time ranges are kept in memory as the index of range scans, which hand decoded positions
+// straight to the batch senders:
+//
+//   traccar_archive_t* a = traccar_archive_open("/data/track.tca");
+//   traccar_archive_append(a, &pos);                    // buffered; written a block at a time
+//   traccar_archive_export(a, from_ms, to_ms, client, TRACCAR_FORMAT_JSON, 64, &cursor);
+typedef struct traccar_archive_s traccar_archive_t;
+
+// Fixes per block: the unit of writing, of the time index and of decoding
+#ifndef TRACCAR_ARCHIVE_BLOCK
+#define TRACCAR_ARCHIVE_BLOCK 256
+#endif
+
+// Opens (or creates) the archive; a block torn by a crash at the end of the file is dropped
+traccar_archive_t* traccar_archive_open(const char* path);
+// Writes the pending fixes and closes the file
+void traccar_archive_close(traccar_archive_t* archive);
+
+// Appends one position; no syscall except when a block fills up. Returns false if writing a full
+// block failed (the block is kept and written again by the next append or flush).
+bool traccar_archive_append(traccar_archive_t* archive, const traccar_position_t* pos);
+// Writes the pending fixes as a (short) block, so a crash cannot lose them; false on error
+bool traccar_archive_flush(traccar_archive_t* archive);
+// traccar_archive_flush, then fsync (blocking)
+bool traccar_archive_sync(traccar_archive_t* archive);
+
+size_t traccar_archive_count(const traccar_archive_t* archive);  // fixes, pending ones included
+uint64_t traccar_archive_bytes(const traccar_archive_t* archive); // file size
+
+// Called with runs of decoded positions, in the order they were appended; the positions and their
+// strings are valid until it returns, and it must not append to the archive. Return false to stop
+// the scan.
+typedef bool (*traccar_archive_cb)(void* user, const traccar_position_t* positions, size_t n);
+
+// Passes the positions with from_ms <= timestampMs < to_ms, pending ones included, to cb; blocks
+// outside the range are not read. Blocks that fail their CRC are skipped. Returns the number of
+// positions passed.
+size_t traccar_archive_scan(traccar_archive_t* archive, uint64_t from_ms, uint64_t to_ms,
+                            traccar_archive_cb cb, void* user);
+
+// Fixes are numbered in the order they were appended, from 0 to traccar_archive_count - 1.
+// Sends the positions of the range in order, from the fix numbered *cursor on (from the first if
+// cursor is nullptr), max_batch (at most TRACCAR_ARCHIVE_BLOCK) per request, until one is not
+// accepted. Returns the number delivered and sets *cursor to the number of the first position not
+// delivered, or to traccar_archive_count if all were: passing it back resumes the export without
+// sending anything twice or missing a fix appended since, whatever its timestamp.
+size_t traccar_archive_export(traccar_archive_t* archive, uint64_t from_ms, uint64_t to_ms,
+                              traccar_client_t* client, traccar_format_t format, size_t max_batch,
+                              uint64_t* cursor);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_ARCHIVE_H
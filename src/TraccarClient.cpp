@@ -1,371 +1,2477 @@
 #include "TraccarClient.h"
+#include "TraccarInternal.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
 #include <time.h>
 
+#if TRACCAR_SIMD && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define TR_SIMD_SSE2 1
+#elif TRACCAR_SIMD && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TR_SIMD_NEON 1
+#endif
+
 #ifdef ARDUINO
 #include <Arduino.h>
 #include <HTTPClient.h>
+#include <new>
+#elif TRACCAR_HAVE_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+#endif
+
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+typedef struct tr_async_s tr_async_t;
+static bool tr_async_free(traccar_client_t* c, bool destroying);
+static void tr_socket_timeouts(int fd, uint16_t timeout_ms);
+#endif
+
+struct traccar_client_s {
+  traccar_allocator_t allocator; // alloc == nullptr: malloc/free
+  const char* host;      // includes scheme, e.g. http://example
+  uint16_t port;         // 5055
+  const char* device_id; // id
+  const char* base_path; // "/"
+  bool debug;
+  uint16_t timeout_ms;
+  bool keep_alive; // reuse the connection across sends
+  unsigned pipeline_depth; // max unanswered async requests
+  char* batch_buf; // growable batch body, kept between sends
+  size_t batch_cap;
+  bool batch_fixed; // traccar_set_batch_capacity: never grown
+  // Encoded request prefixes, rebuilt by tr_configure whenever the configuration changes
+  const char* base_url;     // scheme://host:port/base_path/
+  size_t base_url_len;
+  size_t path_off;          // request target (origin-form) offset in base_url
+  const char* url_prefix;   // base_url?id=<url-encoded id>
+  size_t url_prefix_len;
+  const char* form_prefix;  // id=<url-encoded id>
+  size_t form_prefix_len;
+  const char* json_prefix;  // {"id":"<escaped id>"
+  size_t json_prefix_len;
+  const char* conn_name;    // host name to connect to
+  uint16_t conn_port;
+  bool conn_ok;             // false for schemes the transport cannot handle (https on host builds)
+#ifdef ARDUINO
+  HTTPClient* http; // persistent, created on first send
+  String* http_url; // URL handed to http->begin, reassigned in place; created with http
+  bool http_at_base; // http is set up for base_url on a live kept-alive connection
+#elif TRACCAR_HAVE_POSIX
+  int fd;          // persistent connection, -1 when closed
+  tr_async_t* async; // async send state, created on first use
+#endif
+#if TRACCAR_STATS
+  traccar_stats_t stats;
+#endif
+#if TRACCAR_TRACE
+  traccar_span_t* trace;    // ring of trace_cap spans, nullptr when not tracing
+  size_t trace_cap;
+  uint64_t trace_count;     // spans recorded
+  uint32_t trace_request;   // number of the current send
+  uint8_t trace_kind;       // its TRACCAR_STATS_* kind
+#endif
+  char* config_heap;        // the configuration when it outgrows config, else nullptr
+  char config[TRACCAR_CONFIG_SIZE]; // host, device id, base path and the prefixes above
+};
+
+// NaN omits a field; so does an infinity, which neither wire format can carry
+static inline bool tr_is_provided(double v) {
+  return isfinite(v);
+}
+
+// Every allocation of a client goes through its allocator
+static void* tr_alloc(const traccar_client_t* c, size_t n) {
+  return c->allocator.alloc ? c->allocator.alloc(c->allocator.user, n) : malloc(n);
+}
+
+static void tr_free(const traccar_client_t* c, void* p) {
+  if (!p) return;
+  if (!c->allocator.alloc) free(p);
+  else if (c->allocator.free) c->allocator.free(c->allocator.user, p);
+}
+
+static inline void* tr_realloc(const traccar_client_t* c, void* p, size_t old_size, size_t n) {
+  if (!c->allocator.alloc) return realloc(p, n);
+  void* q = c->allocator.alloc(c->allocator.user, n);
+  if (!q) return nullptr;
+  if (p) memcpy(q, p, old_size < n ? old_size : n);
+  tr_free(c, p);
+  return q;
+}
+
+size_t tr_append_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n) {
+  if (*idx >= out_size) { *idx += n; return 0; }
+  size_t avail = out_size - *idx;
+  size_t tocpy = (n < avail ? n : avail - 1);
+  if (tocpy > 0) memcpy(out + *idx, s, tocpy);
+  *idx += n;
+  out[(*idx < out_size) ? *idx : out_size-1] = '\0';
+  return tocpy;
+}
+
+static inline size_t tr_append(char* out, size_t out_size, size_t* idx, const char* s) {
+  return tr_append_n(out, out_size, idx, s, strlen(s));
+}
+
+// ----------------- Number formatting -----------------
+// Integer/fixed-point writers used instead of snprintf on the encode path. Each returns the
+// number of characters written to buf (no NUL) and produces exactly what printf would.
+
+#define TR_NUM_MAX 32     // enough for the integers and for fixed-point values below TR_FIXED_BIG
+#define TR_FIXED_BIG 1e15 // from here "%.*f" can take up to 309 digits before the point
+#define TR_FIXED_MAX 330  // "-", 309 digits, ".", 9 decimals and the NUL
+
+static size_t tr_fmt_u64(char* buf, uint64_t v) {
+  char tmp[20]; size_t n = 0;
+  do { tmp[n++] = (char)('0' + v % 10); v /= 10; } while (v);
+  for (size_t i = 0; i < n; ++i) buf[i] = tmp[n - 1 - i];
+  return n;
+}
+
+static size_t tr_fmt_i32(char* buf, int32_t v) {
+  if (v >= 0) return tr_fmt_u64(buf, (uint64_t)v);
+  buf[0] = '-';
+  return 1 + tr_fmt_u64(buf + 1, (uint64_t)(-(int64_t)v));
+}
+
+// Zero-padded to width digits
+static inline void tr_fmt_pad(char* buf, uint32_t v, int width) {
+  for (int i = width - 1; i >= 0; --i) { buf[i] = (char)('0' + v % 10); v /= 10; }
+}
+
+// printf("%.*f", decimals, v) for |v| < TR_FIXED_BIG (or not finite), decimals 0..9. The value is
+// scaled and rounded in double precision; when the result lies too close to a rounding boundary
+// to be sure (or is out of range) the exact snprintf conversion decides, so output always
+// matches printf including its tie handling.
+static size_t tr_fmt_fixed(char* buf, double v, int decimals) {
+  static const double kPow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+  static const uint64_t kPow10u[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+                                      10000000ULL, 100000000ULL, 1000000000ULL };
+  if (decimals >= 0 && decimals <= 9) {
+    double scaled = fabs(v) * kPow10[decimals];
+    // error of the product stays below 5e-7 in this range, well inside the 1e-6 guard
+    if (scaled < 4e9) {
+      double whole = floor(scaled);
+      double frac = scaled - whole;
+      if (fabs(frac - 0.5) > 1e-6) {
+        uint64_t r = (uint64_t)whole + (frac > 0.5 ? 1 : 0);
+        size_t n = 0;
+        if (signbit(v)) buf[n++] = '-';
+        n += tr_fmt_u64(buf + n, r / kPow10u[decimals]);
+        if (decimals) {
+          buf[n++] = '.';
+          tr_fmt_pad(buf + n, (uint32_t)(r % kPow10u[decimals]), decimals);
+          n += (size_t)decimals;
+        }
+        return n;
+      }
+    }
+  }
+  int n = snprintf(buf, TR_NUM_MAX, "%.*f", decimals, v);
+  return (n > 0 && n < TR_NUM_MAX) ? (size_t)n : 0;
+}
+
+// Formats straight into the output when there is room, otherwise through a small buffer. Huge
+// values (an odometer of 1e40) are rare enough for plain snprintf into a buffer that holds any
+// double.
+static void tr_append_fixed(char* out, size_t out_size, size_t* idx, double v, int decimals) {
+  if (fabs(v) >= TR_FIXED_BIG) {
+    char big[TR_FIXED_MAX];
+    int n = snprintf(big, sizeof(big), "%.*f", decimals, v);
+    tr_append_n(out, out_size, idx, big, n > 0 ? ((size_t)n < sizeof(big) ? (size_t)n : sizeof(big) - 1) : 0);
+    return;
+  }
+  if (*idx < out_size && out_size - *idx > TR_NUM_MAX) {
+    *idx += tr_fmt_fixed(out + *idx, v, decimals);
+    out[*idx] = '\0';
+    return;
+  }
+  char buf[TR_NUM_MAX]; size_t n = tr_fmt_fixed(buf, v, decimals);
+  tr_append_n(out, out_size, idx, buf, n);
+}
+
+static void tr_append_u64(char* out, size_t out_size, size_t* idx, uint64_t v) {
+  char buf[TR_NUM_MAX]; size_t n = tr_fmt_u64(buf, v);
+  tr_append_n(out, out_size, idx, buf, n);
+}
+
+static void tr_append_i32(char* out, size_t out_size, size_t* idx, int32_t v) {
+  char buf[TR_NUM_MAX]; size_t n = tr_fmt_i32(buf, v);
+  tr_append_n(out, out_size, idx, buf, n);
+}
+
+static inline int32_t tr_speed_knots(double speedKmh) {
+#if TRACCAR_SPEED_ROUND_DOWN
+  double knots = floor(speedKmh / 1.852); // convert km/h to knots, rounded down
+#else
+  double knots = round(speedKmh / 1.852); // convert km/h to knots, rounded
+#endif
+  return knots >= 2147483647.0 ? INT32_MAX : knots <= -2147483648.0 ? INT32_MIN : (int32_t)knots; // no UB on garbage
+}
+
+// ----------------- Escaping -----------------
+// Each kernel writes the encoding of s[0..n) at dst, which has room for the worst case, and
+// returns its length. With SSE2 or NEON, 16-byte blocks that need no escaping (most of a wifi or
+// cell list between separators, nearly all of a JSON string) are checked with one vector compare
+// and copied whole; other bytes go through a table-free test and are written in place.
+
+#define TR_URLENC_MAX 3   // output bytes per input byte, at most
+#define TR_JSONESC_MAX 6
+#define TR_ESC_CHUNK 32   // input bytes per pass through the stack buffer near the end of out
+
+static const char kTrHex[] = "0123456789ABCDEF";
+
+static inline bool tr_is_unreserved(unsigned char c) {
+  unsigned char l = (unsigned char)(c | 0x20);
+  return (unsigned char)(l - 'a') < 26 || (unsigned char)(c - '0') < 10 || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static inline bool tr_is_json_plain(unsigned char c) {
+  return c >= 0x20 && c != '"' && c != '\\';
+}
+
+#if TR_SIMD_SSE2
+// The esc16 functions return the bytes of s[0..16) that need escaping as a mask with
+// TR_SIMD_LANE_BITS bits per byte (movemask on SSE2; NEON has none and narrows to nibbles)
+#define TR_SIMD_LANE_BITS 1
+
+// Bytes in [lo, lo + width), unsigned: a biased signed compare, SSE2 having no unsigned one
+static inline __m128i tr_in_range16(__m128i v, char lo, int width) {
+  __m128i biased = _mm_add_epi8(_mm_sub_epi8(v, _mm_set1_epi8(lo)), _mm_set1_epi8((char)0x80));
+  return _mm_cmplt_epi8(biased, _mm_set1_epi8((char)(0x80 + width)));
+}
+
+static inline uint64_t tr_urlenc_esc16(const unsigned char* s) {
+  __m128i v = _mm_loadu_si128((const __m128i*)s);
+  __m128i ok = _mm_or_si128(tr_in_range16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26), tr_in_range16(v, '0', 10));
+  ok = _mm_or_si128(ok, _mm_or_si128(tr_in_range16(v, '-', 2), // '-' '.'
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~')))));
+  return (uint64_t)(~_mm_movemask_epi8(ok) & 0xFFFF);
+}
+
+static inline uint64_t tr_json_esc16(const unsigned char* s) {
+  __m128i v = _mm_loadu_si128((const __m128i*)s);
+  __m128i esc = _mm_or_si128(tr_in_range16(v, 0, 0x20),
+                             _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+  return (uint64_t)_mm_movemask_epi8(esc);
+}
+#elif TR_SIMD_NEON
+#define TR_SIMD_LANE_BITS 4
+
+static inline uint8x16_t tr_in_range16(uint8x16_t v, uint8_t lo, uint8_t width) {
+  return vcltq_u8(vsubq_u8(v, vdupq_n_u8(lo)), vdupq_n_u8(width));
+}
+
+// 0xFF/0x00 lanes to a nibble per byte
+static inline uint64_t tr_lane_mask16(uint8x16_t m) {
+  return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+}
+
+static inline uint64_t tr_urlenc_esc16(const unsigned char* s) {
+  uint8x16_t v = vld1q_u8(s);
+  uint8x16_t ok = vorrq_u8(tr_in_range16(vorrq_u8(v, vdupq_n_u8(0x20)), 'a', 26), tr_in_range16(v, '0', 10));
+  ok = vorrq_u8(ok, vorrq_u8(tr_in_range16(v, '-', 2), vorrq_u8(vceqq_u8(v, vdupq_n_u8('_')), vceqq_u8(v, vdupq_n_u8('~')))));
+  return tr_lane_mask16(vmvnq_u8(ok));
+}
+
+static inline uint64_t tr_json_esc16(const unsigned char* s) {
+  uint8x16_t v = vld1q_u8(s);
+  uint8x16_t esc = vorrq_u8(vcltq_u8(v, vdupq_n_u8(0x20)), vorrq_u8(vceqq_u8(v, vdupq_n_u8('"')), vceqq_u8(v, vdupq_n_u8('\\'))));
+  return tr_lane_mask16(esc);
+}
+#endif
+
+static inline char* tr_urlenc_hex(char* d, unsigned char c) {
+  d[0] = '%'; d[1] = kTrHex[c >> 4]; d[2] = kTrHex[c & 0xF];
+  return d + 3;
+}
+
+static inline char* tr_json_escape(char* d, unsigned char c) {
+  d[0] = '\\';
+  switch (c) {
+    case '"': d[1] = '"'; return d + 2;
+    case '\\': d[1] = '\\'; return d + 2;
+    case '\n': d[1] = 'n'; return d + 2;
+    case '\r': d[1] = 'r'; return d + 2;
+    case '\t': d[1] = 't'; return d + 2;
+    default:
+      d[1] = 'u'; d[2] = '0'; d[3] = '0'; d[4] = kTrHex[c >> 4]; d[5] = kTrHex[c & 0xF];
+      return d + 6;
+  }
+}
+
+static size_t tr_urlenc_kernel(char* dst, const unsigned char* s, size_t n) {
+  char* d = dst;
+  size_t i = 0;
+#ifdef TR_SIMD_LANE_BITS
+  for (; i + 16 <= n; i += 16) {
+    uint64_t esc = tr_urlenc_esc16(s + i);
+    if (!esc) { memcpy(d, s + i, 16); d += 16; continue; }
+    for (int k = 0; k < 16; ++k, esc >>= TR_SIMD_LANE_BITS) {
+      if (esc & 1) d = tr_urlenc_hex(d, s[i + k]);
+      else *d++ = (char)s[i + k];
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    if (tr_is_unreserved(s[i])) *d++ = (char)s[i];
+    else d = tr_urlenc_hex(d, s[i]);
+  }
+  return (size_t)(d - dst);
+}
+
+static size_t tr_json_kernel(char* dst, const unsigned char* s, size_t n) {
+  char* d = dst;
+  size_t i = 0;
+#ifdef TR_SIMD_LANE_BITS
+  for (; i + 16 <= n; i += 16) {
+    uint64_t esc = tr_json_esc16(s + i);
+    if (!esc) { memcpy(d, s + i, 16); d += 16; continue; }
+    for (int k = 0; k < 16; ++k, esc >>= TR_SIMD_LANE_BITS) {
+      if (esc & 1) d = tr_json_escape(d, s[i + k]);
+      else *d++ = (char)s[i + k];
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    if (tr_is_json_plain(s[i])) *d++ = (char)s[i];
+    else d = tr_json_escape(d, s[i]);
+  }
+  return (size_t)(d - dst);
+}
+
+// Encodes straight into out while the worst case fits, otherwise TR_ESC_CHUNK bytes at a time
+// through a stack buffer and tr_append_n, which cuts and counts exactly as appending each
+// escape sequence would
+static inline void tr_append_escaped(char* out, size_t out_size, size_t* idx, const char* s, size_t n,
+                                     size_t worst, size_t (*kernel)(char*, const unsigned char*, size_t)) {
+  const unsigned char* p = (const unsigned char*)s;
+  while (n) {
+    if (*idx < out_size && (out_size - *idx - 1) / worst >= n) {
+      *idx += kernel(out + *idx, p, n);
+      out[*idx] = '\0';
+      return;
+    }
+    char tmp[TR_ESC_CHUNK * TR_JSONESC_MAX];
+    size_t k = n < TR_ESC_CHUNK ? n : TR_ESC_CHUNK;
+    tr_append_n(out, out_size, idx, tmp, kernel(tmp, p, k));
+    p += k;
+    n -= k;
+  }
+}
+
+void tr_append_urlenc_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n) {
+  tr_append_escaped(out, out_size, idx, s, n, TR_URLENC_MAX, tr_urlenc_kernel);
+}
+
+// JSON string contents: escapes quotes, backslashes and control characters
+void tr_append_json_str_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n) {
+  tr_append_escaped(out, out_size, idx, s, n, TR_JSONESC_MAX, tr_json_kernel);
+}
+
+void tr_append_urlenc(char* out, size_t out_size, size_t* idx, const char* s) {
+  if (s) tr_append_urlenc_n(out, out_size, idx, s, strlen(s));
+}
+
+void tr_append_json_str(char* out, size_t out_size, size_t* idx, const char* s) {
+  if (s) tr_append_json_str_n(out, out_size, idx, s, strlen(s));
+}
+
+static void tr_build_base_url(const char* host, uint16_t port, const char* base_path, char* out, size_t out_size, size_t* idx) {
+  size_t start = *idx;
+  if (*host) tr_append(out, out_size, idx, host);
+  if (port) { tr_append(out, out_size, idx, ":"); tr_append_u64(out, out_size, idx, port); }
+  if (*base_path) {
+    if (base_path[0] != '/') tr_append(out, out_size, idx, "/");
+    tr_append(out, out_size, idx, base_path);
+  }
+  if (*idx == start || *idx > out_size || out[*idx-1] != '/') tr_append(out, out_size, idx, "/");
+}
+
+static bool tr_has_prefix_ci(const char* s, const char* prefix) {
+  for (; *prefix; ++s, ++prefix) {
+    char a = *s, b = *prefix;
+    if (a >= 'A' && a <= 'Z') a = (char)(a - 'A' + 'a');
+    if (a != b) return false;
+  }
+  return true;
+}
+
+// Terminates the current string and starts the next one right after it
+static void tr_append_nul(char* out, size_t out_size, size_t* idx) {
+  if (*idx + 1 >= out_size) return;
+  out[(*idx)++] = '\0';
+  out[*idx] = '\0';
+}
+
+typedef struct tr_config_layout_s {
+  size_t id_off, path_off, base_off, base_len, url_off, form_off, json_off, name_off;
+  uint16_t conn_port;
+  bool conn_ok;
+} tr_config_layout_t;
+
+// Lays out the configuration strings and everything encoded from them in out; returns the bytes
+// used, or 0 if something was cut short
+static size_t tr_config_build(const char* host, uint16_t port, const char* device_id, const char* base_path,
+                              char* out, size_t size, tr_config_layout_t* l) {
+  size_t idx = 0;
+  out[0] = '\0';
+  tr_append(out, size, &idx, host);
+  tr_append_nul(out, size, &idx);
+  l->id_off = idx;
+  tr_append(out, size, &idx, device_id);
+  tr_append_nul(out, size, &idx);
+  l->path_off = idx;
+  tr_append(out, size, &idx, base_path);
+  tr_append_nul(out, size, &idx);
+  l->base_off = idx;
+  tr_build_base_url(host, port, base_path, out, size, &idx);
+  l->base_len = idx - l->base_off;
+  tr_append_nul(out, size, &idx);
+  l->url_off = idx;
+  tr_append_n(out, size, &idx, out + l->base_off, l->base_len);
+  tr_append(out, size, &idx, "?");
+  l->form_off = idx;
+  tr_append(out, size, &idx, "id=");
+  tr_append_urlenc(out, size, &idx, device_id);
+  tr_append_nul(out, size, &idx);
+  l->json_off = idx;
+  tr_append(out, size, &idx, "{\"id\":\"");
+  tr_append_json_str(out, size, &idx, device_id);
+  tr_append(out, size, &idx, "\"");
+  tr_append_nul(out, size, &idx);
+  // Host name and port for the socket transport: "http://name[:port]"
+  const char* h = host;
+  bool ok = !tr_has_prefix_ci(h, "https://");
+  if (tr_has_prefix_ci(h, "http://")) h += 7;
+  size_t hn = strcspn(h, ":/");
+  l->conn_port = (h[hn] == ':') ? (uint16_t)atoi(h + hn + 1) : 80;
+  if (port) l->conn_port = port;
+  l->conn_ok = ok && hn > 0;
+  l->name_off = idx;
+  tr_append_n(out, size, &idx, h, hn);
+  tr_append_nul(out, size, &idx);
+  return idx + 1 < size ? idx : 0;
+}
+
+// Lays out the configuration in c->config, so a send only has to encode the position fields. A
+// configuration too long for it (a long host name or device id) goes in one block from the
+// client's allocator instead. The arguments may point into the current block: the new one is
+// built aside and replaces it only once complete. False only if that block cannot be had.
+static bool tr_configure(traccar_client_t* c, const char* host, uint16_t port, const char* device_id,
+                         const char* base_path) {
+  char tmp[TRACCAR_CONFIG_SIZE];
+  tr_config_layout_t l;
+  size_t cap = sizeof(tmp);
+  char* heap = nullptr;
+  size_t n = tr_config_build(host, port, device_id, base_path, tmp, cap, &l);
+  while (!n) {
+    tr_free(c, heap);
+    cap *= 2;
+    heap = (char*)tr_alloc(c, cap);
+    if (!heap) return false;
+    n = tr_config_build(host, port, device_id, base_path, heap, cap, &l);
+  }
+  char* block = heap;
+  if (!heap) {
+    block = c->config;
+    memcpy(block, tmp, n);
+  }
+  tr_free(c, c->config_heap);
+  c->config_heap = heap;
+  c->host = block;
+  c->port = port;
+  c->device_id = block + l.id_off;
+  c->base_path = block + l.path_off;
+  c->base_url = block + l.base_off; c->base_url_len = l.base_len;
+  const char* scheme = strstr(c->base_url, "://");
+  const char* path = strchr(scheme ? scheme + 3 : c->base_url, '/');
+  c->path_off = path ? (size_t)(path - c->base_url) : 0;
+  c->url_prefix = block + l.url_off; c->url_prefix_len = l.json_off - 1 - l.url_off; // form_prefix is its tail
+  c->form_prefix = block + l.form_off; c->form_prefix_len = l.json_off - 1 - l.form_off;
+  c->json_prefix = block + l.json_off; c->json_prefix_len = l.name_off - 1 - l.json_off;
+  c->conn_name = block + l.name_off;
+  c->conn_port = l.conn_port;
+  c->conn_ok = l.conn_ok;
+#ifdef ARDUINO
+  c->http_at_base = false;
+#endif
+  return true;
+}
+
+void tr_copy_position(traccar_position_t* dst, const traccar_position_t* src, char* strings, size_t size) {
+  *dst = *src;
+  const char** fields[5] = { &dst->driverUniqueId, &dst->cell, &dst->wifi, &dst->eventName, &dst->activityType };
+  size_t used = 0;
+  for (int i = 0; i < 5; ++i) {
+    const char* v = *fields[i];
+    *fields[i] = nullptr;
+    if (!v) continue;
+    size_t n = strlen(v) + 1;
+    if (n > size - used) continue;
+    memcpy(strings + used, v, n);
+    *fields[i] = strings + used;
+    used += n;
+  }
+}
+
+uint32_t tr_crc32(const uint8_t* p, size_t n, uint32_t crc) {
+  static const uint32_t tbl[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= p[i];
+    crc = (crc >> 4) ^ tbl[crc & 0xF];
+    crc = (crc >> 4) ^ tbl[crc & 0xF];
+  }
+  return ~crc;
+}
+
+uint64_t tr_now_ms_or_0() {
+  time_t now = time(nullptr);
+  if (now > 100000) return (uint64_t)now * 1000ULL;
+  return 0;
+}
+
+// ----------------- Statistics -----------------
+
+// Monotonic microseconds; only differences are used (tr_elapsed_us)
+static inline uint64_t tr_clock_us() {
+#ifdef ARDUINO
+  return micros();
+#elif TRACCAR_HAVE_POSIX
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+#else
+  return 0;
+#endif
+}
+
+static inline uint64_t tr_diff_us(uint64_t start, uint64_t end) {
+#ifdef ARDUINO
+  return (uint32_t)((uint32_t)end - (uint32_t)start); // micros() wraps every ~71 minutes
+#else
+  return end - start;
+#endif
+}
+
+static inline uint64_t tr_elapsed_us(uint64_t start) {
+  return tr_diff_us(start, tr_clock_us());
+}
+
+#if TRACCAR_STATS
+// Single writer: a relaxed load and store is enough for readers on other threads to see whole
+// values, without a locked read-modify-write on the send path
+static inline void tr_stat_store(uint64_t* v, uint64_t x) {
+#if TRACCAR_HAVE_POSIX
+  __atomic_store_n(v, x, __ATOMIC_RELAXED);
+#else
+  *v = x;
+#endif
+}
+
+static inline void tr_stat_add(uint64_t* v, uint64_t n) { tr_stat_store(v, *v + n); }
+
+static inline uint64_t tr_stat_clock() { return tr_clock_us(); }
+
+static void tr_stat_latency(traccar_histogram_t* h, uint64_t start) {
+  uint64_t us = tr_elapsed_us(start);
+  uint64_t v = us >> 6;
+  unsigned b = v ? 64 - (unsigned)__builtin_clzll(v) : 0;
+  if (b >= TRACCAR_LATENCY_BUCKETS) b = TRACCAR_LATENCY_BUCKETS - 1;
+  tr_stat_add(&h->buckets[b], 1);
+  tr_stat_add(&h->count, 1);
+  tr_stat_add(&h->sum_us, us);
+  if (us > h->max_us) tr_stat_store(&h->max_us, us);
+}
+
+void tr_stat_request(traccar_client_t* c, int kind, size_t positions, size_t bytes, bool truncated) {
+  tr_stat_add(&c->stats.requests[kind], 1);
+  tr_stat_add(&c->stats.positions[kind], positions);
+  tr_stat_add(&c->stats.bytes_encoded, bytes);
+  if (truncated) tr_stat_add(&c->stats.truncations, 1);
+}
+
+static void tr_stat_result(traccar_client_t* c, int code) {
+  if (code < 0) tr_stat_add(&c->stats.errors[-code < 12 ? -code : 0], 1);
+  else tr_stat_add(&c->stats.status[code < 600 ? code / 100 : 0], 1);
+}
+
+static inline void tr_stat_rtt(traccar_client_t* c, uint64_t start) {
+  tr_stat_latency(&c->stats.request_latency, start);
+}
+
+// A result; its latency is recorded when the server answered
+static inline void tr_stat_response(traccar_client_t* c, int code, uint64_t start) {
+  tr_stat_result(c, code);
+  if (code >= 0) tr_stat_rtt(c, start);
+}
+
+static inline void tr_stat_connect(traccar_client_t* c, uint64_t start) {
+  tr_stat_add(&c->stats.connects, 1);
+  tr_stat_latency(&c->stats.connect_latency, start);
+}
+
+static inline void tr_stat_retry(traccar_client_t* c, size_t n) { tr_stat_add(&c->stats.retries, n); }
+#else
+static inline uint64_t tr_stat_clock() { return 0; }
+void tr_stat_request(traccar_client_t*, int, size_t, size_t, bool) {}
+static inline void tr_stat_result(traccar_client_t*, int) {}
+static inline void tr_stat_rtt(traccar_client_t*, uint64_t) {}
+static inline void tr_stat_response(traccar_client_t*, int, uint64_t) {}
+static inline void tr_stat_connect(traccar_client_t*, uint64_t) {}
+static inline void tr_stat_retry(traccar_client_t*, size_t) {}
+#endif
+
+void traccar_get_stats(const traccar_client_t* c, traccar_stats_t* out) {
+  if (!out) return;
+  memset(out, 0, sizeof(*out));
+#if TRACCAR_STATS
+  if (!c) return;
+  const uint64_t* src = (const uint64_t*)&c->stats;
+  uint64_t* dst = (uint64_t*)out;
+  for (size_t i = 0; i < sizeof(*out) / sizeof(uint64_t); ++i) {
+#if TRACCAR_HAVE_POSIX
+    dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+#else
+    dst[i] = src[i];
+#endif
+  }
+#else
+  (void)c;
 #endif
+}
+
+void traccar_reset_stats(traccar_client_t* c) {
+#if TRACCAR_STATS
+  if (c) memset(&c->stats, 0, sizeof(c->stats));
+#else
+  (void)c;
+#endif
+}
+
+void traccar_stats_merge(traccar_stats_t* into, const traccar_stats_t* from) {
+  if (!into || !from) return;
+  uint64_t connect_max = into->connect_latency.max_us > from->connect_latency.max_us ? into->connect_latency.max_us : from->connect_latency.max_us;
+  uint64_t request_max = into->request_latency.max_us > from->request_latency.max_us ? into->request_latency.max_us : from->request_latency.max_us;
+  uint64_t* dst = (uint64_t*)into;
+  const uint64_t* src = (const uint64_t*)from;
+  for (size_t i = 0; i < sizeof(*into) / sizeof(uint64_t); ++i) dst[i] += src[i];
+  into->connect_latency.max_us = connect_max;
+  into->request_latency.max_us = request_max;
+}
+
+uint64_t traccar_histogram_percentile(const traccar_histogram_t* h, double q) {
+  if (!h || h->count == 0) return 0;
+  double r = ceil(q * (double)h->count);
+  uint64_t rank = r < 1 ? 1 : r > (double)h->count ? h->count : (uint64_t)r;
+  uint64_t seen = 0;
+  for (unsigned b = 0; b + 1 < TRACCAR_LATENCY_BUCKETS; ++b) {
+    seen += h->buckets[b];
+    if (seen >= rank) return (64ULL << b) < h->max_us ? (64ULL << b) : h->max_us;
+  }
+  return h->max_us;
+}
+
+void traccar_arena_init(traccar_arena_t* arena, void* buf, size_t size) {
+  if (!arena) return;
+  arena->base = (uint8_t*)buf;
+  arena->size = buf ? size : 0;
+  arena->used = 0;
+}
+
+// ----------------- Tracing -----------------
+
+#if TRACCAR_TRACE
+// Clock reading for the start of a stage; 0 (and no reading) when not tracing
+static inline uint64_t tr_trace_clock(const traccar_client_t* c) {
+  return c->trace ? tr_clock_us() : 0;
+}
+
+static void tr_trace_record(traccar_client_t* c, int stage, uint64_t start, uint64_t end, int code) {
+  traccar_span_t* s = &c->trace[c->trace_count++ % c->trace_cap];
+  uint64_t us = tr_diff_us(start, end);
+  s->start_us = start;
+  s->duration_us = us > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)us;
+  s->request = c->trace_request;
+  s->stage = (uint8_t)stage;
+  s->kind = c->trace_kind;
+  s->code = (int16_t)(code < -32768 ? -32768 : code > 32767 ? 32767 : code);
+}
+
+// Records a stage from start until now; returns now, the start of the next stage
+static inline uint64_t tr_trace_span(traccar_client_t* c, int stage, uint64_t start, int code) {
+  if (!c->trace) return 0;
+  uint64_t now = tr_clock_us();
+  tr_trace_record(c, stage, start, now, code);
+  return now;
+}
+
+uint64_t tr_trace_begin(traccar_client_t* c, int kind) {
+  if (!c->trace) return 0;
+  c->trace_request++;
+  c->trace_kind = (uint8_t)kind;
+  return tr_clock_us();
+}
+
+void tr_trace_send(traccar_client_t* c, uint64_t start, int code) {
+  tr_trace_span(c, TRACCAR_SPAN_SEND, start, code);
+}
+#else
+static inline uint64_t tr_trace_clock(const traccar_client_t*) { return 0; }
+static inline void tr_trace_record(traccar_client_t*, int, uint64_t, uint64_t, int) {}
+static inline uint64_t tr_trace_span(traccar_client_t*, int, uint64_t, int) { return 0; }
+uint64_t tr_trace_begin(traccar_client_t*, int) { return 0; }
+void tr_trace_send(traccar_client_t*, uint64_t, int) {}
+#endif
+
+bool traccar_set_trace(traccar_client_t* c, size_t capacity) {
+  if (!c) return false;
+#if TRACCAR_TRACE
+  tr_free(c, c->trace);
+  c->trace = nullptr;
+  c->trace_cap = 0;
+  c->trace_count = 0;
+  if (!capacity) return true;
+  if (capacity > SIZE_MAX / sizeof(traccar_span_t)) return false;
+  c->trace = (traccar_span_t*)tr_alloc(c, capacity * sizeof(traccar_span_t));
+  if (!c->trace) return false;
+  c->trace_cap = capacity;
+  return true;
+#else
+  return capacity == 0;
+#endif
+}
+
+size_t traccar_get_spans(const traccar_client_t* c, traccar_span_t* out, size_t max) {
+#if TRACCAR_TRACE
+  if (!c || !out || !c->trace) return 0;
+  uint64_t n = c->trace_count < c->trace_cap ? c->trace_count : c->trace_cap;
+  if (n > max) n = max;
+  for (uint64_t i = c->trace_count - n, k = 0; i < c->trace_count; ++i, ++k) out[k] = c->trace[i % c->trace_cap];
+  return (size_t)n;
+#else
+  (void)c; (void)out; (void)max;
+  return 0;
+#endif
+}
+
+static const char* const kSpanNames[TRACCAR_SPAN_STAGES] = {
+  "send", "build", "resolve", "connect", "write", "wait", "read", "exchange" };
+static const char* const kSendNames[TRACCAR_STATS_KINDS] = { "send osmand", "send form", "send json" };
+
+size_t traccar_trace_events_json(const traccar_span_t* spans, size_t n, uint32_t tid, char* out, size_t out_size) {
+  size_t idx = 0;
+  if (out && out_size) out[0] = '\0';
+  else out_size = 0;
+  for (size_t i = 0; spans && i < n; ++i) {
+    const traccar_span_t* s = &spans[i];
+    const char* name = s->stage == TRACCAR_SPAN_SEND && s->kind < TRACCAR_STATS_KINDS ? kSendNames[s->kind]
+                       : s->stage < TRACCAR_SPAN_STAGES ? kSpanNames[s->stage] : "span";
+    tr_append(out, out_size, &idx, i ? ",{\"name\":\"" : "{\"name\":\"");
+    tr_append(out, out_size, &idx, name);
+    tr_append(out, out_size, &idx, "\",\"cat\":\"traccar\",\"ph\":\"X\",\"ts\":");
+    tr_append_u64(out, out_size, &idx, s->start_us);
+    tr_append(out, out_size, &idx, ",\"dur\":");
+    tr_append_u64(out, out_size, &idx, s->duration_us);
+    tr_append(out, out_size, &idx, ",\"pid\":1,\"tid\":");
+    tr_append_u64(out, out_size, &idx, tid);
+    tr_append(out, out_size, &idx, ",\"args\":{\"request\":");
+    tr_append_u64(out, out_size, &idx, s->request);
+    if (s->code) {
+      tr_append(out, out_size, &idx, ",\"code\":");
+      tr_append_i32(out, out_size, &idx, s->code);
+    }
+    tr_append(out, out_size, &idx, "}}");
+  }
+  return idx;
+}
+
+static const char kChromeHead[] = "{\"traceEvents\":[";
+static const char kChromeTail[] = "],\"displayTimeUnit\":\"ms\"}";
+
+void tr_chrome_begin(tr_chrome_t* d, char* out, size_t out_size) {
+  d->out = out;
+  d->idx = 0;
+  d->total = sizeof(kChromeHead) - 1;
+  d->events = 0;
+  // Events must end before keep so that the tail still fits with the NUL
+  d->keep = out && out_size > sizeof(kChromeHead) - 1 + sizeof(kChromeTail) - 1 ? out_size - (sizeof(kChromeTail) - 1) : 0;
+  d->cut = d->keep == 0;
+  if (out && out_size) out[0] = '\0';
+  if (!d->cut) tr_append_n(out, d->keep, &d->idx, kChromeHead, sizeof(kChromeHead) - 1);
+}
+
+void tr_chrome_events(tr_chrome_t* d, const traccar_span_t* spans, size_t n, uint32_t tid) {
+  for (size_t i = 0; spans && i < n; ++i) {
+    size_t sep = d->events++ ? 1 : 0;
+    bool room = !d->cut && d->idx + sep < d->keep;
+    size_t len = traccar_trace_events_json(&spans[i], 1, tid, room ? d->out + d->idx + sep : nullptr,
+                                           room ? d->keep - d->idx - sep : 0);
+    d->total += sep + len;
+    if (d->cut) continue;
+    if (d->idx + sep + len < d->keep) {
+      if (sep) d->out[d->idx] = ',';
+      d->idx += sep + len;
+    } else {
+      d->cut = true; // this one and the rest are left out
+      d->out[d->idx] = '\0';
+    }
+  }
+}
+
+size_t tr_chrome_end(tr_chrome_t* d) {
+  if (d->keep) tr_append_n(d->out, d->keep + sizeof(kChromeTail) - 1, &d->idx, kChromeTail, sizeof(kChromeTail) - 1);
+  return d->total + sizeof(kChromeTail) - 1;
+}
+
+size_t traccar_trace_export_chrome(const traccar_client_t* c, char* out, size_t out_size) {
+  tr_chrome_t d;
+  tr_chrome_begin(&d, out, out_size);
+#if TRACCAR_TRACE
+  if (c && c->trace) {
+    // Formatted in place from the ring: its two halves, oldest first
+    uint64_t n = c->trace_count < c->trace_cap ? c->trace_count : c->trace_cap;
+    size_t first = (size_t)((c->trace_count - n) % c->trace_cap);
+    size_t head = (size_t)n < c->trace_cap - first ? (size_t)n : c->trace_cap - first;
+    tr_chrome_events(&d, c->trace + first, head, 1);
+    tr_chrome_events(&d, c->trace, (size_t)n - head, 1);
+  }
+#else
+  (void)c;
+#endif
+  return tr_chrome_end(&d);
+}
+
+static void* tr_arena_alloc(void* user, size_t size) {
+  traccar_arena_t* a = (traccar_arena_t*)user;
+  const size_t align = alignof(max_align_t);
+  size_t start = a->used + (align - ((uintptr_t)a->base + a->used) % align) % align;
+  if (start > a->size || size > a->size - start) return nullptr;
+  a->used = start + size;
+  return a->base + start;
+}
+
+traccar_allocator_t traccar_arena_allocator(traccar_arena_t* arena) {
+  traccar_allocator_t al = { tr_arena_alloc, nullptr, arena };
+  return al;
+}
+
+size_t traccar_client_size(void) {
+  return sizeof(traccar_client_t);
+}
+
+traccar_client_t* traccar_create(const char* host_url, uint16_t port, const char* device_id) {
+  return traccar_create_ex(host_url, port, device_id, nullptr);
+}
+
+traccar_client_t* traccar_create_ex(const char* host_url, uint16_t port, const char* device_id,
+                                    const traccar_allocator_t* allocator) {
+  if (!host_url || !device_id) return nullptr;
+  traccar_allocator_t al = {};
+  if (allocator && allocator->alloc) al = *allocator;
+  void* mem = al.alloc ? al.alloc(al.user, sizeof(traccar_client_t)) : malloc(sizeof(traccar_client_t));
+  if (!mem) return nullptr;
+  traccar_client_t* c = (traccar_client_t*)memset(mem, 0, sizeof(traccar_client_t));
+  c->allocator = al;
+  c->debug = false;
+  c->timeout_ms = 4000;
+  c->keep_alive = true;
+  c->pipeline_depth = 8;
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+  c->fd = -1;
+#endif
+  if (!tr_configure(c, host_url, port, device_id, "/")) {
+    traccar_destroy(c);
+    return nullptr;
+  }
+  return c;
+}
+
+void traccar_destroy(traccar_client_t* c) {
+  if (!c) return;
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+  if (tr_async_free(c, true)) return; // from a send callback: finished once the callback returns
+#endif
+  traccar_disconnect(c);
+#ifdef ARDUINO
+  if (c->http) {
+    c->http->~HTTPClient();
+    tr_free(c, c->http);
+    c->http_url->~String();
+    tr_free(c, c->http_url);
+  }
+#endif
+  tr_free(c, c->batch_buf);
+  tr_free(c, c->config_heap);
+#if TRACCAR_TRACE
+  tr_free(c, c->trace);
+#endif
+  tr_free(c, c);
+}
+
+void traccar_set_host(traccar_client_t* c, const char* host_url) {
+  if (!c) return;
+  traccar_disconnect(c);
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+  if (tr_async_free(c, false)) return; // queued requests were encoded for the old server; a callback destroyed c
+#endif
+  tr_configure(c, host_url ? host_url : "", c->port, c->device_id, c->base_path);
+}
+
+void traccar_set_port(traccar_client_t* c, uint16_t port) {
+  if (!c) return;
+  traccar_disconnect(c);
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+  if (tr_async_free(c, false)) return; // queued requests were encoded for the old server; a callback destroyed c
+#endif
+  tr_configure(c, c->host, port, c->device_id, c->base_path);
+}
+
+void traccar_set_device_id(traccar_client_t* c, const char* device_id) {
+  if (!c) return;
+  tr_configure(c, c->host, c->port, device_id ? device_id : "", c->base_path);
+}
+
+void traccar_set_base_path(traccar_client_t* c, const char* base_path) {
+  if (!c) return;
+  tr_configure(c, c->host, c->port, c->device_id, (base_path && *base_path) ? base_path : "/");
+}
+
+void traccar_set_debug(traccar_client_t* c, bool enabled) {
+  if (!c) return;
+  c->debug = enabled;
+}
+
+void traccar_set_timeout_ms(traccar_client_t* c, uint16_t timeout_ms) {
+  if (!c) return;
+  c->timeout_ms = timeout_ms;
+#if !defined(ARDUINO) && TRACCAR_HAVE_POSIX
+  if (c->fd >= 0) tr_socket_timeouts(c->fd, timeout_ms); // the kept-alive connection, not only the next one
+#endif
+}
+
+void traccar_set_pipeline_depth(traccar_client_t* c, unsigned depth) {
+  if (!c) return;
+  if (depth < 1) depth = 1;
+  if (depth > TRACCAR_ASYNC_QUEUE_SIZE) depth = TRACCAR_ASYNC_QUEUE_SIZE;
+  c->pipeline_depth = depth;
+}
+
+void traccar_set_keep_alive(traccar_client_t* c, bool enabled) {
+  if (!c) return;
+  c->keep_alive = enabled;
+  if (!enabled) traccar_disconnect(c);
+}
+
+// Gregorian date from days since 1970-01-01 (H. Hinnant's civil_from_days)
+static void tr_civil_from_days(int64_t z, int* y, unsigned* m, unsigned* d) {
+  z += 719468;
+  int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  unsigned doe = (unsigned)(z - era * 146097);
+  unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned mp = (5 * doy + 2) / 153;
+  *d = doy - (153 * mp + 2) / 5 + 1;
+  *m = mp < 10 ? mp + 3 : mp - 9;
+  *y = (int)(yoe + era * 400) + (*m <= 2);
+}
+
+// "YYYY-MM-DDThh:mm:ss.mmmZ" (24 chars); empty for 0
+static size_t tr_format_iso8601_buf(uint64_t epochMs, char* out, size_t out_size) {
+  if (epochMs == 0 || out_size < 25) { if (out_size) out[0] = '\0'; return 0; }
+  uint64_t sec = epochMs / 1000ULL;
+  uint32_t sod = (uint32_t)(sec % 86400ULL);
+  int y; unsigned mo, d;
+  tr_civil_from_days((int64_t)(sec / 86400ULL), &y, &mo, &d);
+  if (y > 9999) { out[0] = '\0'; return 0; }
+  tr_fmt_pad(out, (uint32_t)y, 4); out[4] = '-';
+  tr_fmt_pad(out + 5, mo, 2); out[7] = '-';
+  tr_fmt_pad(out + 8, d, 2); out[10] = 'T';
+  tr_fmt_pad(out + 11, sod / 3600, 2); out[13] = ':';
+  tr_fmt_pad(out + 14, (sod / 60) % 60, 2); out[16] = ':';
+  tr_fmt_pad(out + 17, sod % 60, 2); out[19] = '.';
+  tr_fmt_pad(out + 20, (uint32_t)(epochMs % 1000ULL), 3); out[23] = 'Z';
+  out[24] = '\0';
+  return 24;
+}
+
+// ----------------- Field encoding -----------------
+// Every request body is a cached prefix followed by the optional position fields. Each wire
+// format lists its fields (order, key, value kind) in one table and a single engine walks it.
+
+enum {
+  TR_K_FIXED,    // double with table decimals; NaN omits
+  TR_K_KNOTS,    // speed in km/h written as integer knots; NaN omits
+  TR_K_INT,      // int32; negative omits
+  TR_K_BATT,     // OsmAnd battery: batt=<n>&charge=<bool>; negative omits
+  TR_K_FLAG,     // int32 written as true/false; negative omits
+  TR_K_TRUE,     // bool; key only, when true
+  TR_K_EPOCH_MS, // timestamp in ms, 0 = now
+  TR_K_ISO8601,  // timestamp as quoted ISO 8601, 0 = now
+  TR_K_URLSTR,   // string, URL-encoded; empty omits
+  TR_K_JSONSTR   // string, JSON-escaped and quoted; empty omits
+};
+
+typedef struct tr_field_enc_s {
+  uint32_t field;   // TRACCAR_FIELD_* bit
+  uint8_t kind;
+  uint8_t decimals;
+  uint16_t offset;  // value offset in traccar_position_t
+  const char* key;  // written before the value
+  uint8_t key_len;
+} tr_field_enc_t;
+
+#define TR_FIELD(bit, kind, decimals, member, key) \
+  { bit, kind, decimals, (uint16_t)offsetof(traccar_position_t, member), key, (uint8_t)(sizeof(key) - 1) }
+#define TR_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static constexpr tr_field_enc_t kOsmandFields[] = {
+  TR_FIELD(TRACCAR_FIELD_LATITUDE,  TR_K_FIXED, 7, latitude, "&lat="),
+  TR_FIELD(TRACCAR_FIELD_LONGITUDE, TR_K_FIXED, 7, longitude, "&lon="),
+  TR_FIELD(TRACCAR_FIELD_ALTITUDE,  TR_K_FIXED, 1, altitudeMeters, "&altitude="),
+  TR_FIELD(TRACCAR_FIELD_HDOP,      TR_K_FIXED, 2, hdop, "&hdop="),
+  TR_FIELD(TRACCAR_FIELD_SPEED,     TR_K_KNOTS, 0, speedKmh, "&speed="),
+  TR_FIELD(TRACCAR_FIELD_VALID,     TR_K_FLAG, 0, validFlag, "&valid="),
+  TR_FIELD(TRACCAR_FIELD_TIMESTAMP, TR_K_EPOCH_MS, 0, timestampMs, "&timestamp="),
+  TR_FIELD(TRACCAR_FIELD_ACCURACY,  TR_K_FIXED, 1, accuracyMeters, "&accuracy="),
+  TR_FIELD(TRACCAR_FIELD_HEADING,   TR_K_FIXED, 1, headingDeg, "&heading="),
+  TR_FIELD(TRACCAR_FIELD_BATTERY,   TR_K_BATT, 0, batteryPercent, "&batt="),
+  TR_FIELD(TRACCAR_FIELD_DRIVER,    TR_K_URLSTR, 0, driverUniqueId, "&driverUniqueId="),
+  TR_FIELD(TRACCAR_FIELD_CELL,      TR_K_URLSTR, 0, cell, "&cell="),
+  TR_FIELD(TRACCAR_FIELD_WIFI,      TR_K_URLSTR, 0, wifi, "&wifi="),
+  TR_FIELD(TRACCAR_FIELD_EVENT,     TR_K_URLSTR, 0, eventName, "&event="),
+  TR_FIELD(TRACCAR_FIELD_ACTIVITY,  TR_K_URLSTR, 0, activityType, "&activity="),
+  TR_FIELD(TRACCAR_FIELD_ODOMETER,  TR_K_FIXED, 1, odometer, "&odometer="),
+};
+
+static constexpr tr_field_enc_t kJsonFields[] = {
+  TR_FIELD(TRACCAR_FIELD_LATITUDE,  TR_K_FIXED, 7, latitude, ",\"lat\":"),
+  TR_FIELD(TRACCAR_FIELD_LONGITUDE, TR_K_FIXED, 7, longitude, ",\"lon\":"),
+  TR_FIELD(TRACCAR_FIELD_ALTITUDE,  TR_K_FIXED, 1, altitudeMeters, ",\"altitude\":"),
+  TR_FIELD(TRACCAR_FIELD_SPEED,     TR_K_KNOTS, 0, speedKmh, ",\"speed\":"),
+  TR_FIELD(TRACCAR_FIELD_HEADING,   TR_K_FIXED, 1, headingDeg, ",\"heading\":"),
+  TR_FIELD(TRACCAR_FIELD_HDOP,      TR_K_FIXED, 2, hdop, ",\"hdop\":"),
+  TR_FIELD(TRACCAR_FIELD_ACCURACY,  TR_K_FIXED, 1, accuracyMeters, ",\"accuracy\":"),
+  TR_FIELD(TRACCAR_FIELD_VALID,     TR_K_FLAG, 0, validFlag, ",\"valid\":"),
+  TR_FIELD(TRACCAR_FIELD_TIMESTAMP, TR_K_ISO8601, 0, timestampMs, ",\"timestamp\":\""),
+  TR_FIELD(TRACCAR_FIELD_ODOMETER,  TR_K_FIXED, 1, odometer, ",\"odometer\":"),
+  TR_FIELD(TRACCAR_FIELD_BATTERY,   TR_K_INT, 0, batteryPercent, ",\"batt\":"),
+  TR_FIELD(TRACCAR_FIELD_BATTERY,   TR_K_TRUE, 0, charging, ",\"charge\":true"),
+  TR_FIELD(TRACCAR_FIELD_EVENT,     TR_K_JSONSTR, 0, eventName, ",\"event\":\""),
+  TR_FIELD(TRACCAR_FIELD_ACTIVITY,  TR_K_JSONSTR, 0, activityType, ",\"activity\":\""),
+  TR_FIELD(TRACCAR_FIELD_DRIVER,    TR_K_JSONSTR, 0, driverUniqueId, ",\"driverUniqueId\":\""),
+  TR_FIELD(TRACCAR_FIELD_CELL,      TR_K_JSONSTR, 0, cell, ",\"cell\":\""),
+  TR_FIELD(TRACCAR_FIELD_WIFI,      TR_K_JSONSTR, 0, wifi, ",\"wifi\":\""),
+};
+
+static inline double tr_get_f64(const traccar_position_t* p, uint16_t off) { return *(const double*)((const char*)p + off); }
+static inline int32_t tr_get_i32(const traccar_position_t* p, uint16_t off) { return *(const int32_t*)((const char*)p + off); }
+
+// Text fields come from texts when given (same order as the const char* members of the position)
+static_assert(offsetof(traccar_position_t, activityType) - offsetof(traccar_position_t, driverUniqueId) ==
+              4 * sizeof(const char*), "text members of traccar_position_t must stay contiguous");
+static inline traccar_text_t tr_get_text(const traccar_position_t* p, const traccar_texts_t* t, uint16_t off) {
+  if (t) {
+    const traccar_text_t* texts = &t->driverUniqueId;
+    traccar_text_t s = texts[(off - offsetof(traccar_position_t, driverUniqueId)) / sizeof(const char*)];
+    if (!s.data) s.size = 0;
+    return s;
+  }
+  const char* s = *(const char* const*)((const char*)p + off);
+  traccar_text_t r = { s, s ? strlen(s) : 0 };
+  return r;
+}
+
+// The sentinel checks (NaN, negative); a fixed field set skips them. Kinds whose output depends
+// on the value itself (strings, charge, timestamps) decide in their writer.
+static inline bool tr_field_present(const tr_field_enc_t& f, const traccar_position_t* p) {
+  switch (f.kind) {
+    case TR_K_FIXED: case TR_K_KNOTS: return tr_is_provided(tr_get_f64(p, f.offset));
+    case TR_K_INT: case TR_K_BATT: case TR_K_FLAG: return tr_get_i32(p, f.offset) >= 0;
+    default: return true;
+  }
+}
+
+// Writers, one per kind; the encoder picks one at compile time so each stays inlined
+template <uint8_t Kind> void tr_field_write(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t* t,
+                                             char* out, size_t out_size, size_t* idx);
+
+template <> inline void tr_field_write<TR_K_FIXED>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_fixed(out, out_size, idx, tr_get_f64(p, f.offset), f.decimals);
+}
+
+template <> inline void tr_field_write<TR_K_KNOTS>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_i32(out, out_size, idx, tr_speed_knots(tr_get_f64(p, f.offset)));
+}
+
+template <> inline void tr_field_write<TR_K_INT>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_i32(out, out_size, idx, tr_get_i32(p, f.offset));
+}
+
+template <> inline void tr_field_write<TR_K_BATT>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_i32(out, out_size, idx, tr_get_i32(p, f.offset));
+  tr_append(out, out_size, idx, p->charging ? "&charge=true" : "&charge=false");
+}
+
+template <> inline void tr_field_write<TR_K_FLAG>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append(out, out_size, idx, tr_get_i32(p, f.offset) ? "true" : "false");
+}
+
+template <> inline void tr_field_write<TR_K_TRUE>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  if (*((const char*)p + f.offset)) tr_append_n(out, out_size, idx, f.key, f.key_len);
+}
+
+template <> inline void tr_field_write<TR_K_EPOCH_MS>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  uint64_t ts = p->timestampMs ? p->timestampMs : tr_now_ms_or_0();
+  if (!ts) return;
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_u64(out, out_size, idx, ts);
+}
+
+template <> inline void tr_field_write<TR_K_ISO8601>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t*, char* out, size_t out_size, size_t* idx) {
+  char buf[32];
+  uint64_t ts = p->timestampMs ? p->timestampMs : tr_now_ms_or_0();
+  size_t n = tr_format_iso8601_buf(ts, buf, sizeof(buf));
+  if (!n) return;
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  buf[n++] = '"';
+  tr_append_n(out, out_size, idx, buf, n);
+}
+
+template <> inline void tr_field_write<TR_K_URLSTR>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t* t, char* out, size_t out_size, size_t* idx) {
+  traccar_text_t s = tr_get_text(p, t, f.offset);
+  if (!s.size) return;
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_urlenc_n(out, out_size, idx, s.data, s.size);
+}
+
+template <> inline void tr_field_write<TR_K_JSONSTR>(const tr_field_enc_t& f, const traccar_position_t* p, const traccar_texts_t* t, char* out, size_t out_size, size_t* idx) {
+  traccar_text_t s = tr_get_text(p, t, f.offset);
+  if (!s.size) return;
+  tr_append_n(out, out_size, idx, f.key, f.key_len);
+  tr_append_json_str_n(out, out_size, idx, s.data, s.size);
+  tr_append_n(out, out_size, idx, "\"", 1);
+}
+
+// Walks a table at compile time, so every field check and write is inlined with constant key,
+// kind and offset. With a fixed field set (TRACCAR_FIXED_FIELDS) fields outside the set are
+// dropped and, for the ones inside, the presence checks above are never evaluated.
+template <const tr_field_enc_t* Table, size_t I, size_t N, unsigned long Fixed>
+struct tr_table_encoder {
+  static inline void run(const traccar_position_t* p, const traccar_texts_t* t, char* out, size_t out_size, size_t* idx) {
+    if (Fixed ? (Table[I].field & Fixed) != 0 : tr_field_present(Table[I], p))
+      tr_field_write<Table[I].kind>(Table[I], p, t, out, out_size, idx);
+    tr_table_encoder<Table, I + 1, N, Fixed>::run(p, t, out, out_size, idx);
+  }
+};
+
+template <const tr_field_enc_t* Table, size_t N, unsigned long Fixed>
+struct tr_table_encoder<Table, N, N, Fixed> {
+  static inline void run(const traccar_position_t*, const traccar_texts_t*, char*, size_t, size_t*) {}
+};
+
+#define TR_ENCODE_FIELDS(table, p, t, out, out_size, idx) \
+  tr_table_encoder<table, 0, TR_COUNT(table), (TRACCAR_FIXED_FIELDS)>::run(p, t, out, out_size, idx)
+
+void tr_append_fields(traccar_format_t format, const traccar_position_t* pos, char* out, size_t out_size, size_t* idx) {
+  if (format == TRACCAR_FORMAT_JSON) TR_ENCODE_FIELDS(kJsonFields, pos, nullptr, out, out_size, idx);
+  else TR_ENCODE_FIELDS(kOsmandFields, pos, nullptr, out, out_size, idx);
+}
+
+const char* tr_request_path(const traccar_client_t* c) {
+  return c->base_url + c->path_off;
+}
+
+// The builders return the full length like snprintf: out holds at most out_size - 1 bytes of it
+// (always NUL-terminated), and out may be nullptr when out_size is 0
+static size_t tr_build(traccar_format_t format, const char* prefix, size_t prefix_len, const char* suffix,
+                       const traccar_position_t* pos, const traccar_texts_t* texts, char* out, size_t out_size) {
+  size_t idx = 0;
+  if (out_size) out[0] = '\0';
+  tr_append_n(out, out_size, &idx, prefix, prefix_len);
+  if (format == TRACCAR_FORMAT_JSON) TR_ENCODE_FIELDS(kJsonFields, pos, texts, out, out_size, &idx);
+  else TR_ENCODE_FIELDS(kOsmandFields, pos, texts, out, out_size, &idx);
+  if (suffix) tr_append(out, out_size, &idx, suffix);
+  return idx;
+}
+
+size_t traccar_build_osmand_url_ex(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                   char* out, size_t out_size) {
+  if (!c || !pos || (!out && out_size)) return 0;
+  return tr_build(TRACCAR_FORMAT_OSMAND, c->url_prefix, c->url_prefix_len, nullptr, pos, texts, out, out_size);
+}
+
+size_t traccar_build_osmand_form_body_ex(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                         char* out, size_t out_size) {
+  if (!c || !pos || (!out && out_size)) return 0;
+  return tr_build(TRACCAR_FORMAT_OSMAND, c->form_prefix, c->form_prefix_len, nullptr, pos, texts, out, out_size);
+}
+
+size_t traccar_build_json_body_ex(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                  char* out, size_t out_size) {
+  if (!c || !pos || (!out && out_size)) return 0;
+  return tr_build(TRACCAR_FORMAT_JSON, c->json_prefix, c->json_prefix_len, "}", pos, texts, out, out_size);
+}
+
+size_t traccar_build_osmand_url(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
+  return traccar_build_osmand_url_ex(c, pos, nullptr, out, out_size);
+}
+
+size_t traccar_build_osmand_form_body(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
+  return traccar_build_osmand_form_body_ex(c, pos, nullptr, out, out_size);
+}
+
+size_t traccar_build_json_body(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
+  return traccar_build_json_body_ex(c, pos, nullptr, out, out_size);
+}
+
+// Only the position fields go to scratch; the prefix is referenced where the client keeps it
+static size_t tr_build_iov(traccar_format_t format, const char* prefix, size_t prefix_len, const traccar_position_t* pos,
+                           const traccar_texts_t* texts, traccar_iovec_t iov[2], char* scratch, size_t scratch_size) {
+  size_t n = tr_build(format, "", 0, nullptr, pos, texts, scratch, scratch_size);
+  iov[0].base = prefix; iov[0].len = prefix_len;
+  iov[1].base = scratch; iov[1].len = n < scratch_size ? n : scratch_size ? scratch_size - 1 : 0;
+  return prefix_len + n;
+}
+
+size_t traccar_build_osmand_url_iov(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                    traccar_iovec_t iov[2], char* scratch, size_t scratch_size) {
+  if (!c || !pos || !iov || (!scratch && scratch_size)) return 0;
+  return tr_build_iov(TRACCAR_FORMAT_OSMAND, c->url_prefix, c->url_prefix_len, pos, texts, iov, scratch, scratch_size);
+}
+
+size_t traccar_build_osmand_form_body_iov(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                          traccar_iovec_t iov[2], char* scratch, size_t scratch_size) {
+  if (!c || !pos || !iov || (!scratch && scratch_size)) return 0;
+  return tr_build_iov(TRACCAR_FORMAT_OSMAND, c->form_prefix, c->form_prefix_len, pos, texts, iov, scratch, scratch_size);
+}
+
+bool traccar_set_batch_capacity(traccar_client_t* c, size_t bytes) {
+  if (!c) return false;
+  if (bytes && bytes < 1024) bytes = 1024;
+  if (bytes == c->batch_cap) { c->batch_fixed = bytes != 0; return true; }
+  char* p = bytes ? (char*)tr_alloc(c, bytes) : nullptr;
+  if (bytes && !p) return false;
+  tr_free(c, c->batch_buf);
+  c->batch_buf = p; c->batch_cap = bytes;
+  c->batch_fixed = bytes != 0;
+  return true;
+}
+
+// Appends one array element after out[0..*idx), keeping room for the closing ']'.
+// An element that does not fit completely is rolled back.
+static bool tr_json_batch_append(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size, size_t* idx) {
+  size_t start = *idx;
+  if (out_size < start + 4) return false;
+  size_t lim = out_size - 1;
+  if (start > 1) out[(*idx)++] = ',';
+  size_t avail = lim - *idx;
+  size_t n = traccar_build_json_body(c, pos, out + *idx, avail);
+  if (n + 1 >= avail) { *idx = start; out[start] = '\0'; return false; }
+  *idx += n;
+  return true;
+}
+
+size_t traccar_build_json_batch_body(traccar_client_t* c, const traccar_position_t* positions, size_t n,
+                                     char* out, size_t out_size, size_t* out_count) {
+  if (out_count) *out_count = 0;
+  if (!c || !positions || !out || out_size < 3) return 0;
+  size_t idx = 0, i = 0;
+  out[idx++] = '[';
+  while (i < n && tr_json_batch_append(c, &positions[i], out, out_size, &idx)) ++i;
+  out[idx++] = ']'; out[idx] = '\0';
+  if (out_count) *out_count = i;
+  return idx;
+}
+
+#if defined(ARDUINO) || TRACCAR_HAVE_POSIX
+
+// Grows the client's batch buffer; it is kept between sends so steady-state batching does not allocate
+static bool tr_batch_reserve(traccar_client_t* c, size_t need) {
+  if (c->batch_cap >= need) return true;
+  if (c->batch_fixed) return false;
+  size_t cap = c->batch_cap ? c->batch_cap : 1024;
+  while (cap < need) cap *= 2;
+  char* p = (char*)tr_realloc(c, c->batch_buf, c->batch_cap, cap);
+  if (!p) return false;
+  c->batch_buf = p; c->batch_cap = cap;
+  return true;
+}
+
+#if TRACCAR_HAVE_POSIX
+char* tr_client_scratch(traccar_client_t* c, size_t need) {
+  return tr_batch_reserve(c, need) ? c->batch_buf : nullptr;
+}
+#endif
+
+// Builds the JSON batch into the client's growable buffer; returns the body length
+static size_t tr_build_json_batch_growable(traccar_client_t* c, const traccar_position_t* positions, size_t n, size_t* out_count) {
+  *out_count = 0;
+  if (!tr_batch_reserve(c, 4)) return 0;
+  size_t idx = 0, i = 0;
+  c->batch_buf[idx++] = '[';
+  while (i < n) {
+    if (tr_json_batch_append(c, &positions[i], c->batch_buf, c->batch_cap, &idx)) ++i;
+    else if (!tr_batch_reserve(c, c->batch_cap * 2)) break;
+  }
+  c->batch_buf[idx++] = ']'; c->batch_buf[idx] = '\0';
+  *out_count = i;
+  return idx;
+}
+
+typedef size_t (*tr_build_fn)(traccar_client_t*, const traccar_position_t*, const traccar_texts_t*, char*, size_t);
+
+// Builds into buf, or into the batch buffer when the result needs more room than buf has. Only
+// a request that fits neither (the batch buffer is fixed, or cannot grow) is cut; *truncated
+// tells, and the senders then fail rather than send it. Returns where the result is and sets
+// *len to the bytes there.
+static const char* tr_build_sized(traccar_client_t* c, tr_build_fn build, const traccar_position_t* pos,
+                                  const traccar_texts_t* texts, char* buf, size_t size, size_t* len, bool* truncated) {
+  size_t n = build(c, pos, texts, buf, size);
+  char* out = buf;
+  if (n >= size && tr_batch_reserve(c, n + 1)) {
+    out = c->batch_buf; size = c->batch_cap;
+    n = build(c, pos, texts, out, size);
+  }
+  *truncated = n >= size;
+  *len = *truncated ? size - 1 : n;
+  return out;
+}
+
+// Ends a send whose request tr_build_sized had to cut: it is not written
+static bool tr_fail_truncated(traccar_client_t* c, uint64_t t0, int* out_http_code) {
+  tr_trace_send(c, t0, TRACCAR_HTTP_ERROR_TRUNCATED);
+#ifdef ARDUINO
+  if (c->debug) Serial.println("[Traccar] request too long for the buffer, not sent");
+#else
+  if (c->debug) fprintf(stderr, "[Traccar] request too long for the buffer, not sent\n");
+#endif
+  if (out_http_code) *out_http_code = TRACCAR_HTTP_ERROR_TRUNCATED;
+  return false;
+}
+
+#endif
+
+#ifdef ARDUINO
+
+// The HTTPClient outlives each send so its TCP connection can be reused (setReuse keeps it open on end())
+static HTTPClient* tr_http_arduino(traccar_client_t* c) {
+  if (!c->http) {
+    void* mem = tr_alloc(c, sizeof(HTTPClient));
+    void* url = tr_alloc(c, sizeof(String));
+    if (!mem || !url) { tr_free(c, mem); tr_free(c, url); return nullptr; }
+    c->http = new (mem) HTTPClient();
+    c->http_url = new (url) String();
+  }
+  c->http->setReuse(c->keep_alive);
+  c->http->setConnectTimeout(c->timeout_ms);
+  return c->http;
+}
+
+void traccar_disconnect(traccar_client_t* c) {
+  if (!c || !c->http) return;
+  c->http->setReuse(false);
+  c->http->end();
+  c->http_at_base = false;
+}
+
+// HTTPClient::begin takes the URL as a String and parses it. The POST senders all go to
+// base_url, and end() leaves host and URI set on a kept-alive connection, so while that
+// connection lives they skip begin altogether. Other URLs are copied into the client's String,
+// whose buffer is reused once it is large enough, instead of a temporary String per send.
+static bool tr_http_begin(traccar_client_t* c, const char* url) {
+  bool base = url == c->base_url;
+  if (base && c->http_at_base && c->keep_alive && c->http->connected()) return true;
+  *c->http_url = url;
+  bool ok = c->http->begin(*c->http_url);
+  c->http_at_base = ok && base;
+  if (!ok && c->debug) Serial.println("[Traccar] http.begin failed");
+  return ok;
+}
+
+// Ends a send that never reached HTTPClient's request (no client, a URL it rejects, nothing to
+// send), with its code reported and its trace closed like any other
+static bool tr_send_not_made(traccar_client_t* c, uint64_t t0, int code, int* out_http_code) {
+  tr_trace_send(c, t0, code);
+  if (out_http_code) *out_http_code = code;
+  return code == 200;
+}
+
+static bool tr_send_osmand(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  if (!c || !pos || !c->device_id || !*c->device_id) return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_OSMAND);
+  char buf[384]; size_t n; bool cut;
+  const char* url = tr_build_sized(c, traccar_build_osmand_url_ex, pos, texts, buf, sizeof(buf), &n, &cut);
+  uint64_t tt = tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_OSMAND, 1, n, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  HTTPClient* hc = tr_http_arduino(c);
+  if (!hc) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_SEND_FAILED, out_http_code);
+  HTTPClient& http = *hc;
+  if (!tr_http_begin(c, url)) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_UNSUPPORTED, out_http_code);
+  uint64_t ts = tr_stat_clock();
+  int code = http.GET();
+  tr_stat_response(c, code, ts);
+  tr_trace_span(c, TRACCAR_SPAN_EXCHANGE, tt, code);
+  http.end();
+  tr_trace_send(c, t0, code);
+  if (c->debug) Serial.printf("[Traccar] GET %d\n", code);
+  if (out_http_code) *out_http_code = code;
+  return code == 200;
+}
+
+bool traccar_send_osmand_form(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
+  if (!c || !pos || !c->device_id || !*c->device_id) return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_FORM);
+  char buf[384]; size_t n; bool cut;
+  const char* body = tr_build_sized(c, traccar_build_osmand_form_body_ex, pos, nullptr, buf, sizeof(buf), &n, &cut);
+  uint64_t tt = tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_FORM, 1, n, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  HTTPClient* hc = tr_http_arduino(c);
+  if (!hc) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_SEND_FAILED, out_http_code);
+  HTTPClient& http = *hc;
+  if (!tr_http_begin(c, c->base_url)) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_UNSUPPORTED, out_http_code);
+  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
+  uint64_t ts = tr_stat_clock();
+  int code = http.POST((uint8_t*)body, n);
+  tr_stat_response(c, code, ts);
+  tr_trace_span(c, TRACCAR_SPAN_EXCHANGE, tt, code);
+  http.end();
+  tr_trace_send(c, t0, code);
+  if (c->debug) Serial.printf("[Traccar] POST form %d\n", code);
+  if (out_http_code) *out_http_code = code;
+  return code == 200;
+}
+
+static bool tr_send_json(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  if (!c || !pos || !c->device_id || !*c->device_id) return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_JSON);
+  char buf[TRACCAR_JSON_BODY_SIZE]; size_t n; bool cut;
+  const char* body = tr_build_sized(c, traccar_build_json_body_ex, pos, texts, buf, sizeof(buf), &n, &cut);
+  uint64_t tt = tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_JSON, 1, n, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  HTTPClient* hc = tr_http_arduino(c);
+  if (!hc) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_SEND_FAILED, out_http_code);
+  HTTPClient& http = *hc;
+  if (!tr_http_begin(c, c->base_url)) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_UNSUPPORTED, out_http_code);
+  http.addHeader("Content-Type", "application/json");
+
+  if (c->debug) {
+    Serial.printf("[Traccar] POST to: %s\n", c->base_url);
+    Serial.printf("[Traccar] JSON body: %s\n", body);
+  }
+
+  uint64_t ts = tr_stat_clock();
+  int code = http.POST((uint8_t*)body, n);
+  tr_stat_response(c, code, ts);
+  tr_trace_span(c, TRACCAR_SPAN_EXCHANGE, tt, code);
+  http.end();
+  tr_trace_send(c, t0, code);
+  if (c->debug) Serial.printf("[Traccar] POST %d\n", code);
+  if (out_http_code) *out_http_code = code;
+  return code == 200;
+}
+
+bool traccar_send_json_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  if (!c || !positions || !c->device_id || !*c->device_id) return false;
+  if (accepted) memset(accepted, 0, n * sizeof(*accepted));
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_JSON);
+  size_t count = 0;
+  size_t len = tr_build_json_batch_growable(c, positions, n, &count);
+  uint64_t tt = tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  if (count == 0) return tr_send_not_made(c, t0, n ? TRACCAR_HTTP_ERROR_TRUNCATED : 200, out_http_code);
+  tr_stat_request(c, TRACCAR_STATS_JSON, count, len, count < n);
+  HTTPClient* hc = tr_http_arduino(c);
+  if (!hc) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_SEND_FAILED, out_http_code);
+  HTTPClient& http = *hc;
+  if (!tr_http_begin(c, c->base_url)) return tr_send_not_made(c, t0, TRACCAR_HTTP_ERROR_UNSUPPORTED, out_http_code);
+  http.addHeader("Content-Type", "application/json");
+  uint64_t ts = tr_stat_clock();
+  int code = http.POST((uint8_t*)c->batch_buf, len);
+  tr_stat_response(c, code, ts);
+  tr_trace_span(c, TRACCAR_SPAN_EXCHANGE, tt, code);
+  http.end();
+  tr_trace_send(c, t0, code);
+  if (c->debug) Serial.printf("[Traccar] POST batch(%u) %d\n", (unsigned)count, code);
+  if (out_http_code) *out_http_code = code;
+  if (code != 200) return false;
+  if (accepted) for (size_t i = 0; i < count; ++i) accepted[i] = true;
+  return count == n;
+}
 
-struct traccar_client_s {
-  char* host;      // includes scheme, e.g. http://example
-  uint16_t port;   // 5055
-  char* device_id; // id
-  char* base_path; // "/"
-  bool debug;
-  uint16_t timeout_ms;
+// HTTPClient cannot pipeline, so the batch runs back to back on the kept-alive connection
+bool traccar_send_osmand_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  if (!c || !positions || !c->device_id || !*c->device_id) return false;
+  size_t ok = 0; int last = 200;
+  for (size_t i = 0; i < n; ++i) {
+    int code = 0;
+    bool sent = traccar_send_osmand(c, &positions[i], &code);
+    if (accepted) accepted[i] = sent;
+    if (sent) ++ok; else last = code;
+  }
+  if (out_http_code) *out_http_code = last;
+  return ok == n;
+}
+
+// No event loop here: the request is sent synchronously and cb runs before this returns
+bool traccar_send_async(traccar_client_t* c, traccar_format_t format, const traccar_position_t* pos,
+                        traccar_send_cb cb, void* user) {
+  if (!c || !pos) return false;
+  int code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+  if (format == TRACCAR_FORMAT_JSON) traccar_send_json(c, pos, &code);
+  else traccar_send_osmand(c, pos, &code);
+  if (cb) cb(c, user, code);
+  return true;
+}
+
+int traccar_poll(traccar_client_t* c, int timeout_ms) { (void)c; (void)timeout_ms; return 0; }
+int traccar_async_fd(traccar_client_t* c) { (void)c; return -1; }
+
+#elif TRACCAR_HAVE_POSIX
+// ----------------- POSIX host transport (HTTP/1.1, keep-alive) -----------------
+
+// Incremental HTTP/1.1 response parser: consumes bytes until the end of one response
+enum {
+  TR_RESP_STATUS, TR_RESP_HEADERS, TR_RESP_BODY, TR_RESP_CHUNK_SIZE, TR_RESP_CHUNK_DATA,
+  TR_RESP_CHUNK_CRLF, TR_RESP_TRAILERS, TR_RESP_UNTIL_CLOSE, TR_RESP_DONE, TR_RESP_ERROR
 };
 
-static inline bool tr_is_provided(double v) {
-  return !isnan(v);
+typedef struct tr_http_resp_s {
+  int state;
+  int code;
+  bool chunked;
+  bool has_length;
+  bool close;       // server wants the connection closed after this response
+  uint64_t remaining;
+  size_t line_len;
+  char line[128];   // longer header lines are truncated (only the names/values below matter)
+} tr_http_resp_t;
+
+static void tr_resp_reset(tr_http_resp_t* r) {
+  memset(r, 0, sizeof(*r));
+  r->state = TR_RESP_STATUS;
 }
 
-static char* tr_strdup(const char* s) {
-  if (!s) return nullptr;
-  size_t n = strlen(s) + 1;
-  char* p = (char*)malloc(n);
-  if (p) memcpy(p, s, n);
-  return p;
+static bool tr_header_is(const char* line, const char* name, const char** value) {
+  size_t n = strlen(name);
+  if (strncasecmp(line, name, n) != 0 || line[n] != ':') return false;
+  const char* v = line + n + 1;
+  while (*v == ' ' || *v == '\t') ++v;
+  *value = v;
+  return true;
 }
 
-static size_t tr_append(char* out, size_t out_size, size_t* idx, const char* s) {
-  size_t n = strlen(s);
-  if (*idx >= out_size) return 0;
-  size_t avail = out_size - *idx;
-  size_t tocpy = (n < avail ? n : avail - 1);
-  if (tocpy > 0) memcpy(out + *idx, s, tocpy);
-  *idx += tocpy;
-  out[(*idx < out_size) ? *idx : out_size-1] = '\0';
-  return tocpy;
+static void tr_resp_line(tr_http_resp_t* r) {
+  const char* line = r->line;
+  const char* v;
+  switch (r->state) {
+    case TR_RESP_STATUS:
+      if (strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) { r->state = TR_RESP_ERROR; return; }
+      r->code = atoi(line + 9);
+      r->close = (line[7] == '0');
+      r->state = TR_RESP_HEADERS;
+      return;
+    case TR_RESP_HEADERS:
+      if (*line) {
+        if (tr_header_is(line, "Content-Length", &v)) { r->has_length = true; r->remaining = strtoull(v, nullptr, 10); }
+        else if (tr_header_is(line, "Transfer-Encoding", &v)) r->chunked = (strstr(v, "chunked") != nullptr);
+        else if (tr_header_is(line, "Connection", &v)) {
+          if (strncasecmp(v, "close", 5) == 0) r->close = true;
+          else if (strncasecmp(v, "keep-alive", 10) == 0) r->close = false;
+        }
+        return;
+      }
+      if (r->code >= 100 && r->code < 200) { tr_resp_reset(r); return; } // interim response
+      if (r->code == 204 || r->code == 304) r->state = TR_RESP_DONE;
+      else if (r->chunked) r->state = TR_RESP_CHUNK_SIZE;
+      else if (r->has_length) r->state = r->remaining ? TR_RESP_BODY : TR_RESP_DONE;
+      else { r->state = TR_RESP_UNTIL_CLOSE; r->close = true; }
+      return;
+    case TR_RESP_CHUNK_SIZE:
+      r->remaining = strtoull(line, nullptr, 16);
+      r->state = r->remaining ? TR_RESP_CHUNK_DATA : TR_RESP_TRAILERS;
+      return;
+    case TR_RESP_CHUNK_CRLF:
+      r->state = TR_RESP_CHUNK_SIZE;
+      return;
+    case TR_RESP_TRAILERS:
+      if (!*line) r->state = TR_RESP_DONE;
+      return;
+    default:
+      return;
+  }
+}
+
+// Returns the number of bytes consumed; stops right after the end of the response
+static size_t tr_resp_feed(tr_http_resp_t* r, const char* data, size_t len) {
+  size_t i = 0;
+  while (i < len && r->state != TR_RESP_DONE && r->state != TR_RESP_ERROR) {
+    if (r->state == TR_RESP_BODY || r->state == TR_RESP_CHUNK_DATA) {
+      size_t n = len - i;
+      if (n > r->remaining) n = (size_t)r->remaining;
+      r->remaining -= n; i += n;
+      if (r->remaining == 0) r->state = (r->state == TR_RESP_BODY) ? TR_RESP_DONE : TR_RESP_CHUNK_CRLF;
+      continue;
+    }
+    if (r->state == TR_RESP_UNTIL_CLOSE) return len; // finished by EOF
+    char ch = data[i++];
+    if (ch == '\n') {
+      if (r->line_len && r->line[r->line_len-1] == '\r') r->line_len--;
+      r->line[r->line_len] = '\0';
+      tr_resp_line(r);
+      r->line_len = 0;
+    } else if (r->line_len < sizeof(r->line) - 1) {
+      r->line[r->line_len++] = ch;
+    }
+  }
+  return i;
 }
 
-static inline bool tr_is_unreserved(char c) {
-  if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) return true;
-  switch (c) { case '-': case '.': case '_': case '~': return true; default: return false; }
+// Blocking reads and writes on fd give up after timeout_ms
+static void tr_socket_timeouts(int fd, uint16_t timeout_ms) {
+  struct timeval tv; tv.tv_sec = timeout_ms / 1000; tv.tv_usec = (timeout_ms % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
 }
 
-static void tr_append_urlenc(char* out, size_t out_size, size_t* idx, const char* s) {
-  static const char hex[] = "0123456789ABCDEF";
-  for (const unsigned char* p = (const unsigned char*)s; p && *p; ++p) {
-    unsigned char c = *p;
-    if (tr_is_unreserved((char)c)) {
-      char ch[2] = {(char)c, '\0'};
-      tr_append(out, out_size, idx, ch);
-    } else if (c == ' ') {
-      tr_append(out, out_size, idx, "%20");
-    } else {
-      char enc[4]; enc[0] = '%'; enc[1] = hex[(c >> 4) & 0xF]; enc[2] = hex[c & 0xF]; enc[3] = '\0';
-      tr_append(out, out_size, idx, enc);
+int tr_connect(const char* name, uint16_t port, uint16_t timeout_ms, uint64_t* resolved_us) {
+  char service[8]; snprintf(service, sizeof(service), "%u", (unsigned)port);
+  struct addrinfo hints; memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = nullptr;
+  if (getaddrinfo(name, service, &hints, &res) != 0) return -1;
+  if (resolved_us) *resolved_us = tr_clock_us();
+  int fd = -1;
+  for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    int rc = connect(fd, ai->ai_addr, ai->ai_addrlen);
+    if (rc != 0 && errno == EINPROGRESS) {
+      struct pollfd pfd = { fd, POLLOUT, 0 };
+      int err = 0; socklen_t errlen = sizeof(err);
+      if (poll(&pfd, 1, timeout_ms) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errlen) == 0 && err == 0) rc = 0;
     }
+    if (rc == 0) { fcntl(fd, F_SETFL, flags); break; }
+    close(fd); fd = -1;
   }
+  freeaddrinfo(res);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  tr_socket_timeouts(fd, timeout_ms);
+  return fd;
 }
 
-static void tr_build_base_url(const traccar_client_t* c, char* out, size_t out_size) {
-  size_t idx = 0; out[0] = '\0';
-  if (c->host && *c->host) tr_append(out, out_size, &idx, c->host);
-  if (c->port) {
-    char buf[12]; snprintf(buf, sizeof(buf), ":%u", (unsigned)c->port);
-    tr_append(out, out_size, &idx, buf);
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+bool tr_write_all(int fd, struct iovec* iov, int iovcnt) {
+  while (iovcnt > 0) {
+    struct msghdr msg; memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov; msg.msg_iovlen = iovcnt;
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0) { if (errno == EINTR) continue; return false; }
+    while (iovcnt > 0 && (size_t)n >= iov->iov_len) { n -= (ssize_t)iov->iov_len; ++iov; --iovcnt; }
+    if (iovcnt > 0) { iov->iov_base = (char*)iov->iov_base + n; iov->iov_len -= (size_t)n; }
   }
-  if (c->base_path && *c->base_path) {
-    if (c->base_path[0] != '/') tr_append(out, out_size, &idx, "/");
-    tr_append(out, out_size, &idx, c->base_path);
+  return true;
+}
+
+void traccar_disconnect(traccar_client_t* c) {
+  if (!c || c->fd < 0) return;
+  close(c->fd);
+  c->fd = -1;
+}
+
+// Formats what follows the request target: the protocol and the headers; returns the length or
+// -1 if it does not fit
+static int tr_request_tail(const traccar_client_t* c, bool keep_alive, const char* content_type, size_t body_len,
+                           char* out, size_t out_size) {
+  int hn;
+  if (content_type) {
+    hn = snprintf(out, out_size, " HTTP/1.1\r\nHost: %s:%u\r\nConnection: %s\r\n"
+                  "Content-Type: %s\r\nContent-Length: %u\r\n\r\n",
+                  c->conn_name, (unsigned)c->conn_port, keep_alive ? "keep-alive" : "close",
+                  content_type, (unsigned)body_len);
+  } else {
+    hn = snprintf(out, out_size, " HTTP/1.1\r\nHost: %s:%u\r\nConnection: %s\r\n\r\n",
+                  c->conn_name, (unsigned)c->conn_port, keep_alive ? "keep-alive" : "close");
   }
-  if (idx == 0 || out[idx-1] != '/') tr_append(out, out_size, &idx, "/");
+  return (hn < 0 || (size_t)hn >= out_size) ? -1 : hn;
 }
 
-static uint64_t tr_now_ms_or_0() {
-  time_t now = time(nullptr);
-  if (now > 100000) return (uint64_t)now * 1000ULL;
-  return 0;
+// Formats the request line and headers; returns the header length or -1 if it does not fit
+static int tr_request_head(const traccar_client_t* c, bool keep_alive, const char* method, const char* path,
+                           const char* content_type, size_t body_len, char* out, size_t out_size) {
+  int n = snprintf(out, out_size, "%s %s", method, path);
+  if (n < 0 || (size_t)n >= out_size) return -1;
+  int tn = tr_request_tail(c, keep_alive, content_type, body_len, out + n, out_size - (size_t)n);
+  return tn < 0 ? -1 : n + tn;
 }
 
-traccar_client_t* traccar_create(const char* host_url, uint16_t port, const char* device_id) {
-  traccar_client_t* c = (traccar_client_t*)calloc(1, sizeof(*c));
-  if (!c) return nullptr;
-  c->host = tr_strdup(host_url);
-  c->port = port;
-  c->device_id = tr_strdup(device_id);
-  c->base_path = tr_strdup("/");
-  c->debug = false;
-  c->timeout_ms = 4000;
-  return c;
+// Receive buffer shared by consecutive (pipelined) responses on one connection
+typedef struct tr_rx_s {
+  char buf[512];
+  size_t off;
+  size_t len;
+  size_t received; // total bytes read on this exchange
+  uint64_t first_us; // when its first bytes arrived (tracing only, else 0)
+} tr_rx_t;
+
+// Reads one complete response; returns 0 or a negative TRACCAR_HTTP_ERROR_* code
+static int tr_read_response(traccar_client_t* c, tr_rx_t* rx, tr_http_resp_t* resp) {
+  for (;;) {
+    if (rx->off < rx->len) {
+      rx->off += tr_resp_feed(resp, rx->buf + rx->off, rx->len - rx->off);
+      if (resp->state == TR_RESP_DONE) return 0;
+      if (resp->state == TR_RESP_ERROR) return TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+      continue;
+    }
+    ssize_t n = recv(c->fd, rx->buf, sizeof(rx->buf), 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK) ? TRACCAR_HTTP_ERROR_READ_TIMEOUT : TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+    if (n == 0) {
+      if (resp->state != TR_RESP_UNTIL_CLOSE) return TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+      resp->state = TR_RESP_DONE;
+      return 0;
+    }
+    if (!rx->received) rx->first_us = tr_trace_clock(c);
+    rx->off = 0; rx->len = (size_t)n; rx->received += (size_t)n;
+  }
 }
 
-void traccar_destroy(traccar_client_t* c) {
-  if (!c) return;
-  free(c->host);
-  free(c->device_id);
-  free(c->base_path);
-  free(c);
+// Response stages of one exchange: the wait until its first byte (first_us, 0 if none came) and
+// the reading of the rest
+static void tr_trace_response(traccar_client_t* c, uint64_t written, uint64_t first_us, int code) {
+  if (!written) return; // not tracing
+  if (!first_us) {
+    tr_trace_span(c, TRACCAR_SPAN_WAIT, written, code);
+    return;
+  }
+  tr_trace_record(c, TRACCAR_SPAN_WAIT, written, first_us, 0);
+  tr_trace_span(c, TRACCAR_SPAN_READ, first_us, code);
 }
 
-void traccar_set_base_path(traccar_client_t* c, const char* base_path) {
-  if (!c) return;
-  free(c->base_path);
-  c->base_path = tr_strdup((base_path && *base_path) ? base_path : "/");
+// Opens the client's blocking connection
+static bool tr_open(traccar_client_t* c) {
+  uint64_t t0 = tr_stat_clock();
+  uint64_t tt = tr_trace_clock(c), resolved = 0;
+  c->fd = tr_connect(c->conn_name, c->conn_port, c->timeout_ms, tt ? &resolved : nullptr);
+  if (tt) {
+    if (resolved) tr_trace_record(c, TRACCAR_SPAN_RESOLVE, tt, resolved, 0);
+    tr_trace_span(c, resolved ? TRACCAR_SPAN_CONNECT : TRACCAR_SPAN_RESOLVE, resolved ? resolved : tt,
+                  c->fd < 0 ? TRACCAR_HTTP_ERROR_CONNECTION_REFUSED : 0);
+  }
+  if (c->fd < 0) return false;
+  tr_stat_connect(c, t0);
+  return true;
 }
 
-void traccar_set_debug(traccar_client_t* c, bool enabled) {
-  if (!c) return;
-  c->debug = enabled;
+#define TR_REQ_PARTS 4 // pieces of a request target or body
+
+// One request/response on the persistent connection. The target and the body come in pieces
+// (e.g. a cached prefix and the encoded fields) and go out with the headers in one writev, so
+// the request is never assembled. A reused connection that turns out to be stale (closed by the
+// server while idle) is reopened once before giving up.
+static int tr_http_exchange(traccar_client_t* c, const char* method, const struct iovec* target, int target_cnt,
+                            const char* content_type, const struct iovec* body, int body_cnt) {
+  if (!c->conn_ok) return TRACCAR_HTTP_ERROR_UNSUPPORTED;
+  size_t body_len = 0;
+  for (int i = 0; i < body_cnt; ++i) body_len += body[i].iov_len;
+  char tail[512];
+  int tn = tr_request_tail(c, c->keep_alive, content_type, body_len, tail, sizeof(tail));
+  if (tn < 0) return TRACCAR_HTTP_ERROR_SEND_FAILED;
+
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    bool reused = (c->fd >= 0);
+    if (!reused && !tr_open(c)) return TRACCAR_HTTP_ERROR_CONNECTION_REFUSED;
+    struct iovec iov[3 + 2 * TR_REQ_PARTS];
+    int n = 0;
+    iov[n].iov_base = (void*)method; iov[n++].iov_len = strlen(method);
+    iov[n].iov_base = (void*)" "; iov[n++].iov_len = 1;
+    for (int i = 0; i < target_cnt; ++i) iov[n++] = target[i];
+    iov[n].iov_base = tail; iov[n++].iov_len = (size_t)tn;
+    for (int i = 0; i < body_cnt; ++i) iov[n++] = body[i];
+    uint64_t t0 = tr_stat_clock(), tt = tr_trace_clock(c);
+    bool wrote = tr_write_all(c->fd, iov, n);
+    tt = tr_trace_span(c, TRACCAR_SPAN_WRITE, tt, wrote ? 0 : TRACCAR_HTTP_ERROR_SEND_FAILED);
+    if (!wrote) {
+      traccar_disconnect(c);
+      if (reused) { tr_stat_retry(c, 1); continue; }
+      return TRACCAR_HTTP_ERROR_SEND_FAILED;
+    }
+    tr_rx_t rx; rx.off = rx.len = rx.received = 0; rx.first_us = 0;
+    tr_http_resp_t resp; tr_resp_reset(&resp);
+    int err = tr_read_response(c, &rx, &resp);
+    tr_trace_response(c, tt, rx.first_us, err ? err : resp.code);
+    if (err) {
+      traccar_disconnect(c);
+      if (reused && rx.received == 0) { tr_stat_retry(c, 1); continue; }
+      return err;
+    }
+    tr_stat_rtt(c, t0);
+    if (resp.close || !c->keep_alive || rx.off < rx.len) traccar_disconnect(c); // unsolicited trailing bytes
+    return resp.code;
+  }
+  return TRACCAR_HTTP_ERROR_CONNECTION_LOST;
 }
 
-void traccar_set_timeout_ms(traccar_client_t* c, uint16_t timeout_ms) {
-  if (!c) return;
-  c->timeout_ms = timeout_ms;
+int tr_http_request_v(traccar_client_t* c, const char* method, const struct iovec* target, int target_cnt,
+                      const char* content_type, const struct iovec* body, int body_cnt) {
+  int code = tr_http_exchange(c, method, target, target_cnt, content_type, body, body_cnt);
+  tr_stat_result(c, code);
+  return code;
 }
 
-size_t traccar_build_osmand_url(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
-  if (!c || !pos || !out || out_size == 0) return 0;
-  size_t idx = 0; out[0] = '\0';
-  char base[192]; tr_build_base_url(c, base, sizeof(base));
-  tr_append(out, out_size, &idx, base);
-  tr_append(out, out_size, &idx, "?");
-  tr_append(out, out_size, &idx, "id=");
-  if (c->device_id) tr_append_urlenc(out, out_size, &idx, c->device_id); else tr_append(out, out_size, &idx, "");
-  char buf[48];
-  if (tr_is_provided(pos->latitude))  { snprintf(buf, sizeof(buf), "&lat=%.7f", pos->latitude); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->longitude)) { snprintf(buf, sizeof(buf), "&lon=%.7f", pos->longitude); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->altitudeMeters)) { snprintf(buf, sizeof(buf), "&altitude=%.1f", pos->altitudeMeters); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->hdop)) { snprintf(buf, sizeof(buf), "&hdop=%.2f", pos->hdop); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->speedKmh)) { 
-#if TRACCAR_SPEED_ROUND_DOWN
-    snprintf(buf, sizeof(buf), "&speed=%d", (int)floor(pos->speedKmh / 1.852));
-#else
-    snprintf(buf, sizeof(buf), "&speed=%d", (int)round(pos->speedKmh / 1.852));
-#endif
-    tr_append(out, out_size, &idx, buf); 
-  }
-  if (pos->validFlag >= 0) tr_append(out, out_size, &idx, pos->validFlag ? "&valid=true" : "&valid=false");
-  uint64_t ts = pos->timestampMs ? pos->timestampMs : tr_now_ms_or_0();
-  if (ts) { snprintf(buf, sizeof(buf), "&timestamp=%llu", (unsigned long long)ts); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->accuracyMeters)) { snprintf(buf, sizeof(buf), "&accuracy=%.1f", pos->accuracyMeters); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->headingDeg)) { snprintf(buf, sizeof(buf), "&heading=%.1f", pos->headingDeg); tr_append(out, out_size, &idx, buf); }
-  if (pos->batteryPercent >= 0) {
-    snprintf(buf, sizeof(buf), "&batt=%d", (int)pos->batteryPercent); tr_append(out, out_size, &idx, buf);
-    tr_append(out, out_size, &idx, pos->charging ? "&charge=true" : "&charge=false");
-  }
-  if (pos->driverUniqueId && *pos->driverUniqueId) { tr_append(out, out_size, &idx, "&driverUniqueId="); tr_append_urlenc(out, out_size, &idx, pos->driverUniqueId); }
-  if (pos->cell && *pos->cell) { tr_append(out, out_size, &idx, "&cell="); tr_append_urlenc(out, out_size, &idx, pos->cell); }
-  if (pos->wifi && *pos->wifi) { tr_append(out, out_size, &idx, "&wifi="); tr_append_urlenc(out, out_size, &idx, pos->wifi); }
-  if (pos->eventName && *pos->eventName) { tr_append(out, out_size, &idx, "&event="); tr_append_urlenc(out, out_size, &idx, pos->eventName); }
-  if (pos->activityType && *pos->activityType) { tr_append(out, out_size, &idx, "&activity="); tr_append_urlenc(out, out_size, &idx, pos->activityType); }
-  if (tr_is_provided(pos->odometer)) { snprintf(buf, sizeof(buf), "&odometer=%.1f", pos->odometer); tr_append(out, out_size, &idx, buf); }
-  return idx;
+int tr_http_request(traccar_client_t* c, const char* method, const char* path,
+                    const char* content_type, const char* body, size_t body_len) {
+  struct iovec target = { (void*)path, strlen(path) };
+  struct iovec data = { (void*)body, body ? body_len : 0 };
+  return tr_http_request_v(c, method, &target, 1, content_type, &data, data.iov_len ? 1 : 0);
 }
 
-size_t traccar_build_osmand_form_body(traccar_client_t* c, const traccar_position_t* pos, char* out, size_t out_size) {
-  if (!c || !pos || !out || out_size == 0) return 0;
-  size_t idx = 0; out[0] = '\0';
-  char buf[48];
-  tr_append(out, out_size, &idx, "id="); if (c->device_id) tr_append_urlenc(out, out_size, &idx, c->device_id);
-  if (tr_is_provided(pos->latitude))  { snprintf(buf, sizeof(buf), "&lat=%.7f", pos->latitude); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->longitude)) { snprintf(buf, sizeof(buf), "&lon=%.7f", pos->longitude); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->altitudeMeters)) { snprintf(buf, sizeof(buf), "&altitude=%.1f", pos->altitudeMeters); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->hdop)) { snprintf(buf, sizeof(buf), "&hdop=%.2f", pos->hdop); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->speedKmh)) { 
-#if TRACCAR_SPEED_ROUND_DOWN
-    snprintf(buf, sizeof(buf), "&speed=%d", (int)floor(pos->speedKmh / 1.852));
-#else
-    snprintf(buf, sizeof(buf), "&speed=%d", (int)round(pos->speedKmh / 1.852));
-#endif
-    tr_append(out, out_size, &idx, buf); 
-  }
-  if (pos->validFlag >= 0) tr_append(out, out_size, &idx, pos->validFlag ? "&valid=true" : "&valid=false");
-  uint64_t ts = pos->timestampMs ? pos->timestampMs : tr_now_ms_or_0();
-  if (ts) { snprintf(buf, sizeof(buf), "&timestamp=%llu", (unsigned long long)ts); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->accuracyMeters)) { snprintf(buf, sizeof(buf), "&accuracy=%.1f", pos->accuracyMeters); tr_append(out, out_size, &idx, buf); }
-  if (tr_is_provided(pos->headingDeg)) { snprintf(buf, sizeof(buf), "&heading=%.1f", pos->headingDeg); tr_append(out, out_size, &idx, buf); }
-  if (pos->batteryPercent >= 0) {
-    snprintf(buf, sizeof(buf), "&batt=%d", (int)pos->batteryPercent); tr_append(out, out_size, &idx, buf);
-    tr_append(out, out_size, &idx, pos->charging ? "&charge=true" : "&charge=false");
-  }
-  if (pos->driverUniqueId && *pos->driverUniqueId) { tr_append(out, out_size, &idx, "&driverUniqueId="); tr_append_urlenc(out, out_size, &idx, pos->driverUniqueId); }
-  if (pos->cell && *pos->cell) { tr_append(out, out_size, &idx, "&cell="); tr_append_urlenc(out, out_size, &idx, pos->cell); }
-  if (pos->wifi && *pos->wifi) { tr_append(out, out_size, &idx, "&wifi="); tr_append_urlenc(out, out_size, &idx, pos->wifi); }
-  if (pos->eventName && *pos->eventName) { tr_append(out, out_size, &idx, "&event="); tr_append_urlenc(out, out_size, &idx, pos->eventName); }
-  if (pos->activityType && *pos->activityType) { tr_append(out, out_size, &idx, "&activity="); tr_append_urlenc(out, out_size, &idx, pos->activityType); }
-  if (tr_is_provided(pos->odometer)) { snprintf(buf, sizeof(buf), "&odometer=%.1f", pos->odometer); tr_append(out, out_size, &idx, buf); }
-  return idx;
+static inline struct iovec tr_iov(const char* p, size_t n) {
+  struct iovec v = { (void*)p, n };
+  return v;
 }
 
-#ifdef ARDUINO
+static size_t tr_build_osmand_fields(traccar_client_t*, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                     char* out, size_t out_size) {
+  return tr_build(TRACCAR_FORMAT_OSMAND, "", 0, nullptr, pos, texts, out, out_size);
+}
 
-static String tr_make_base_url_arduino(const traccar_client_t* c) {
-  String base; base.reserve(128);
-  if (c->host && *c->host) base += c->host;
-  if (c->port) { base += ":"; base += String(c->port); }
-  if (c->base_path && *c->base_path) {
-    if (c->base_path[0] != '/') base += "/";
-    base += c->base_path;
-  }
-  if (base.length() == 0 || base[base.length()-1] != '/') base += "/";
-  return base;
+static size_t tr_build_json_fields(traccar_client_t*, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                   char* out, size_t out_size) {
+  return tr_build(TRACCAR_FORMAT_JSON, "", 0, nullptr, pos, texts, out, out_size);
 }
 
-bool traccar_send_osmand(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
-  if (!c || !pos || !c->device_id || !*c->device_id) return false;
-  char url[384]; traccar_build_osmand_url(c, pos, url, sizeof(url));
-  HTTPClient http;
-  http.setConnectTimeout(c->timeout_ms);
-  if (!http.begin(String(url))) {
-    if (c->debug) Serial.println("[Traccar] http.begin failed");
-    return false;
-  }
-  int code = http.GET();
-  http.end();
-  if (c->debug) Serial.printf("[Traccar] GET %d\n", code);
+static bool tr_finish_send(traccar_client_t* c, const char* what, uint64_t t0, int code, int* out_http_code) {
+  tr_trace_send(c, t0, code);
+  if (c->debug) fprintf(stderr, "[Traccar] %s %d\n", what, code);
   if (out_http_code) *out_http_code = code;
   return code == 200;
 }
 
+// The cached prefixes and the encoded fields are written as they are; only the fields are encoded
+// per send, on the stack or, when they need more room, in the batch buffer
+static bool tr_send_osmand(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  if (!c || !pos || !c->device_id || !*c->device_id) return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_OSMAND);
+  char buf[384]; size_t n; bool cut;
+  const char* fields = tr_build_sized(c, tr_build_osmand_fields, pos, texts, buf, sizeof(buf), &n, &cut);
+  tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_OSMAND, 1, c->url_prefix_len + n, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  struct iovec target[2] = { tr_iov(c->url_prefix + c->path_off, c->url_prefix_len - c->path_off), tr_iov(fields, n) };
+  int code = tr_http_request_v(c, "GET", target, 2, nullptr, nullptr, 0);
+  return tr_finish_send(c, "GET", t0, code, out_http_code);
+}
+
 bool traccar_send_osmand_form(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
   if (!c || !pos || !c->device_id || !*c->device_id) return false;
-  String base = tr_make_base_url_arduino(c);
-  HTTPClient http;
-  http.setConnectTimeout(c->timeout_ms);
-  if (!http.begin(base)) {
-    if (c->debug) Serial.println("[Traccar] http.begin failed");
-    return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_FORM);
+  char buf[384]; size_t n; bool cut;
+  const char* fields = tr_build_sized(c, tr_build_osmand_fields, pos, nullptr, buf, sizeof(buf), &n, &cut);
+  tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_FORM, 1, c->form_prefix_len + n, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  struct iovec target = tr_iov(c->base_url + c->path_off, c->base_url_len - c->path_off);
+  struct iovec body[2] = { tr_iov(c->form_prefix, c->form_prefix_len), tr_iov(fields, n) };
+  int code = tr_http_request_v(c, "POST", &target, 1, "application/x-www-form-urlencoded", body, 2);
+  return tr_finish_send(c, "POST form", t0, code, out_http_code);
+}
+
+static bool tr_send_json(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  if (!c || !pos || !c->device_id || !*c->device_id) return false;
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_JSON);
+  char buf[TRACCAR_JSON_BODY_SIZE]; size_t n; bool cut;
+  const char* fields = tr_build_sized(c, tr_build_json_fields, pos, texts, buf, sizeof(buf), &n, &cut);
+  tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  tr_stat_request(c, TRACCAR_STATS_JSON, 1, c->json_prefix_len + n + 1, cut);
+  if (cut) return tr_fail_truncated(c, t0, out_http_code);
+  if (c->debug) {
+    fprintf(stderr, "[Traccar] POST to: %s\n", c->base_url);
+    fprintf(stderr, "[Traccar] JSON body: %s%.*s}\n", c->json_prefix, (int)n, fields);
   }
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  char bodyBuf[384]; traccar_build_osmand_form_body(c, pos, bodyBuf, sizeof(bodyBuf));
-  int code = http.POST((uint8_t*)bodyBuf, strlen(bodyBuf));
-  http.end();
-  if (c->debug) Serial.printf("[Traccar] POST form %d\n", code);
+  struct iovec target = tr_iov(c->base_url + c->path_off, c->base_url_len - c->path_off);
+  struct iovec body[3] = { tr_iov(c->json_prefix, c->json_prefix_len), tr_iov(fields, n), tr_iov("}", 1) };
+  int code = tr_http_request_v(c, "POST", &target, 1, "application/json", body, 3);
+  return tr_finish_send(c, "POST", t0, code, out_http_code);
+}
+
+
+static bool tr_finish_batch(traccar_client_t* c, const char* what, uint64_t t0, size_t n, size_t ok, int code,
+                            int* out_http_code) {
+  tr_trace_send(c, t0, code);
+  if (c->debug) fprintf(stderr, "[Traccar] %s batch %u/%u %d\n", what, (unsigned)ok, (unsigned)n, code);
   if (out_http_code) *out_http_code = code;
-  return code == 200;
+  return ok == n;
 }
 
-static String tr_format_iso8601(uint64_t epochMs) {
-  if (epochMs == 0) return String("");
-  time_t sec = (time_t)(epochMs / 1000ULL);
-  struct tm tmv; gmtime_r(&sec, &tmv);
-  char buf[32]; int ms = (int)(epochMs % 1000ULL);
-  snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
-           tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday,
-           tmv.tm_hour, tmv.tm_min, tmv.tm_sec, ms);
-  return String(buf);
+bool traccar_send_json_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  if (!c || !positions || !c->device_id || !*c->device_id) return false;
+  if (accepted) memset(accepted, 0, n * sizeof(*accepted));
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_JSON);
+  size_t count = 0;
+  size_t len = tr_build_json_batch_growable(c, positions, n, &count);
+  tr_trace_span(c, TRACCAR_SPAN_BUILD, t0, 0);
+  if (count == 0) return tr_finish_batch(c, "POST", t0, n, 0, n ? TRACCAR_HTTP_ERROR_TRUNCATED : 200, out_http_code);
+  tr_stat_request(c, TRACCAR_STATS_JSON, count, len, count < n);
+  int code = tr_http_request(c, "POST", c->base_url + c->path_off, "application/json", c->batch_buf, len);
+  if (code != 200) return tr_finish_batch(c, "POST", t0, n, 0, code, out_http_code);
+  if (accepted) for (size_t i = 0; i < count; ++i) accepted[i] = true;
+  return tr_finish_batch(c, "POST", t0, n, count, code, out_http_code); // accepted and false tell a partial fit
 }
 
-bool traccar_send_json(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
-  if (!c || !pos || !c->device_id || !*c->device_id) return false;
-  String base = tr_make_base_url_arduino(c);
-  HTTPClient http;
-  http.setConnectTimeout(c->timeout_ms);
-  if (!http.begin(base)) {
-    if (c->debug) Serial.println("[Traccar] http.begin failed");
-    return false;
+#define TR_PIPELINE_DEPTH 32 // requests per write; bounds the buffer and the work redone after a reset
+
+// Encodes one GET request in place at batch_buf + at, growing the buffer to fit it once its
+// length is known; returns its length (0 if it does not fit) and sets *url_len to that of its URL
+static size_t tr_batch_get(traccar_client_t* c, size_t at, const traccar_position_t* pos, size_t* url_len) {
+  const char* target = c->url_prefix + c->path_off;
+  size_t target_len = c->url_prefix_len - c->path_off;
+  size_t need = 1024;
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    if (!tr_batch_reserve(c, at + need)) return 0;
+    char* p = c->batch_buf + at;
+    size_t avail = c->batch_cap - at;
+    memcpy(p, "GET ", 4);
+    size_t tn = tr_build(TRACCAR_FORMAT_OSMAND, target, target_len, nullptr, pos, nullptr, p + 4, avail - 4);
+    if (tn < avail - 4) {
+      int hn = tr_request_tail(c, true, nullptr, 0, p + 4 + tn, avail - 4 - tn);
+      if (hn >= 0) { *url_len = c->path_off + tn; return 4 + tn + (size_t)hn; }
+    }
+    need = 4 + tn + 512;
   }
-  http.addHeader("Content-Type", "application/json");
+  return 0;
+}
 
-  uint64_t ts = pos->timestampMs ? pos->timestampMs : tr_now_ms_or_0();
-  String tsIso = tr_format_iso8601(ts);
-
-  String body; body.reserve(384);
-  body += "{";
-  body += "\"id\":\""; body += c->device_id; body += "\"";
-  
-  if (tr_is_provided(pos->latitude)) { body += ",\"lat\":"; body += String(pos->latitude, 7); }
-  if (tr_is_provided(pos->longitude)) { body += ",\"lon\":"; body += String(pos->longitude, 7); }
-  if (tr_is_provided(pos->altitudeMeters)) { body += ",\"altitude\":"; body += String(pos->altitudeMeters, 1); }
-  if (tr_is_provided(pos->speedKmh)) { 
-#if TRACCAR_SPEED_ROUND_DOWN
-    body += ",\"speed\":"; body += String((int)floor(pos->speedKmh / 1.852)); // convert km/h to knots, rounded down
+bool traccar_send_osmand_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  if (!c || !positions || !c->device_id || !*c->device_id) return false;
+  if (accepted) memset(accepted, 0, n * sizeof(*accepted));
+  uint64_t t0 = tr_trace_begin(c, TRACCAR_STATS_OSMAND); // one traced send for the whole batch
+  if (!c->conn_ok) return tr_finish_batch(c, "GET", t0, n, 0, TRACCAR_HTTP_ERROR_UNSUPPORTED, out_http_code);
+  size_t done = 0, ok = 0, encoded = 0; // encoded: positions counted in the stats
+  int last = 200;
+  bool retried_stale = false;
+  while (done < n) {
+    // Encode up to TR_PIPELINE_DEPTH complete GET requests back to back
+    size_t count = 0, len = 0;
+    uint64_t tt = tr_trace_clock(c);
+    while (count < TR_PIPELINE_DEPTH && done + count < n) {
+      size_t un;
+      size_t rn = tr_batch_get(c, len, &positions[done + count], &un);
+      if (!rn) break;
+      if (done + count >= encoded) { tr_stat_request(c, TRACCAR_STATS_OSMAND, 1, un, false); ++encoded; }
+      len += rn; ++count;
+    }
+    tr_trace_span(c, TRACCAR_SPAN_BUILD, tt, 0);
+    if (count == 0) { last = TRACCAR_HTTP_ERROR_TRUNCATED; break; } // the next one does not fit the buffer
+    bool reused = (c->fd >= 0);
+    if (!reused && !tr_open(c)) { last = TRACCAR_HTTP_ERROR_CONNECTION_REFUSED; tr_stat_result(c, last); break; }
+    struct iovec iov; iov.iov_base = c->batch_buf; iov.iov_len = len;
+    uint64_t ts = tr_stat_clock();
+    tt = tr_trace_clock(c);
+    bool wrote = tr_write_all(c->fd, &iov, 1);
+    tt = tr_trace_span(c, TRACCAR_SPAN_WRITE, tt, wrote ? 0 : TRACCAR_HTTP_ERROR_SEND_FAILED);
+    if (!wrote) {
+      traccar_disconnect(c);
+      if (reused && !retried_stale) { retried_stale = true; tr_stat_retry(c, count); continue; }
+      last = TRACCAR_HTTP_ERROR_SEND_FAILED;
+      tr_stat_result(c, last);
+      break;
+    }
+    // Responses arrive in request order; the server may close early, leaving the rest unanswered
+    tr_rx_t rx; rx.off = rx.len = rx.received = 0; rx.first_us = 0;
+    size_t got = 0; int err = 0, code = 200; bool closed = false;
+    while (got < count && !closed) {
+      tr_http_resp_t resp; tr_resp_reset(&resp);
+      err = tr_read_response(c, &rx, &resp);
+      if (err) break;
+      tr_stat_response(c, resp.code, ts);
+      if (resp.code == 200) { ++ok; if (accepted) accepted[done + got] = true; }
+      else last = code = resp.code;
+      closed = resp.close;
+      ++got;
+    }
+    tr_trace_response(c, tt, rx.first_us, got < count ? (err ? err : TRACCAR_HTTP_ERROR_CONNECTION_LOST) : code);
+    if (got < count || closed) traccar_disconnect(c);
+    if (got == 0) {
+      if (reused && rx.received == 0 && !retried_stale) { retried_stale = true; tr_stat_retry(c, count); continue; }
+      last = err ? err : TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+      tr_stat_result(c, last);
+      break;
+    }
+    done += got;
+  }
+  if (!c->keep_alive) traccar_disconnect(c);
+  return tr_finish_batch(c, "GET", t0, n, ok, ok == n ? 200 : last, out_http_code);
+}
+
+// ----------------- Asynchronous sends (POSIX) -----------------
+// Requests are encoded into tx back to back and written on a dedicated non-blocking connection,
+// at most pipeline_depth of them unanswered at a time. Responses arrive in request order, so
+// each complete response finishes reqs[head]. Bytes of a request are kept until it is answered
+// so that unanswered requests can be written again on a new connection.
+//
+// Results are not reported where they are found: a finished request moves to the done ring and
+// its callback runs from tr_async_dispatch once the connection state is no longer in use, so a
+// callback may queue requests, poll, change the server or destroy the client.
+
+typedef struct tr_async_req_s {
+  traccar_send_cb cb;
+  void* user;
+  size_t end;           // end of the encoded request in tx
+  uint64_t queued_us;   // submission time, for the latency stats
+} tr_async_req_t;
+
+struct tr_async_s {
+  int ep;               // epoll instance watching fd (Linux), -1 elsewhere
+  int fd;               // non-blocking connection, -1 when closed
+  bool connecting;
+  uint32_t events;      // interest registered for fd
+  char* tx;             // encoded requests; the oldest unanswered one starts at tx_head
+  size_t tx_head, tx_len, tx_cap;
+  size_t tx_sent;       // bytes of tx written on the current connection
+  tr_async_req_t reqs[TRACCAR_ASYNC_QUEUE_SIZE]; // ring, oldest first
+  size_t head, count;
+  struct { traccar_send_cb cb; void* user; int code; } done[TRACCAR_ASYNC_QUEUE_SIZE]; // results not yet reported
+  size_t done_head, done_count; // count + done_count never exceeds the queue size
+  bool dispatching;     // a callback is running
+  bool destroy_pending; // traccar_destroy was called from a callback
+  size_t inflight;      // requests (from head) written at least partially
+  size_t answered;      // responses received on the current connection
+  tr_http_resp_t resp;  // response to reqs[head]
+  bool resp_started;
+  uint64_t deadline_ms; // outstanding work without progress until then times out
+  uint64_t connect_us;  // start of the pending connect, for the latency stats
+  char rx[2048];
+};
+
+static inline uint64_t tr_mono_ms() { return tr_clock_us() / 1000ULL; }
+
+static tr_async_t* tr_async_get(traccar_client_t* c) {
+  if (c->async) return c->async;
+  tr_async_t* a = (tr_async_t*)tr_alloc(c, sizeof(*a));
+  if (!a) return nullptr;
+  memset(a, 0, sizeof(*a));
+  a->fd = -1;
+#ifdef __linux__
+  a->ep = epoll_create1(EPOLL_CLOEXEC);
+  if (a->ep < 0) { tr_free(c, a); return nullptr; }
 #else
-    body += ",\"speed\":"; body += String((int)round(pos->speedKmh / 1.852)); // convert km/h to knots, rounded
-#endif
-  }
-  if (tr_is_provided(pos->headingDeg)) { body += ",\"heading\":"; body += String(pos->headingDeg, 1); }
-  if (tr_is_provided(pos->hdop)) { body += ",\"hdop\":"; body += String(pos->hdop, 2); }
-  if (tr_is_provided(pos->accuracyMeters)) { body += ",\"accuracy\":"; body += String(pos->accuracyMeters, 1); }
-  if (pos->validFlag >= 0) { body += ",\"valid\":"; body += (pos->validFlag ? "true" : "false"); }
-  if (tsIso.length()) { body += ",\"timestamp\":\""; body += tsIso; body += "\""; }
-  if (tr_is_provided(pos->odometer)) { body += ",\"odometer\":"; body += String(pos->odometer, 1); }
-  if (pos->batteryPercent >= 0) { body += ",\"batt\":"; body += String(pos->batteryPercent); }
-  if (pos->charging) { body += ",\"charge\":true"; }
-  if (pos->eventName && *pos->eventName) { body += ",\"event\":\""; body += pos->eventName; body += "\""; }
-  if (pos->activityType && *pos->activityType) { body += ",\"activity\":\""; body += pos->activityType; body += "\""; }
-  if (pos->driverUniqueId && *pos->driverUniqueId) { body += ",\"driverUniqueId\":\""; body += pos->driverUniqueId; body += "\""; }
-  if (pos->cell && *pos->cell) { body += ",\"cell\":\""; body += pos->cell; body += "\""; }
-  if (pos->wifi && *pos->wifi) { body += ",\"wifi\":\""; body += pos->wifi; body += "\""; }
-  
-  body += "}";
+  a->ep = -1;
+#endif
+  tr_resp_reset(&a->resp);
+  c->async = a;
+  return a;
+}
 
-  if (c->debug) {
-    Serial.printf("[Traccar] POST to: %s\n", base.c_str());
-    Serial.printf("[Traccar] JSON body: %s\n", body.c_str());
+static inline tr_async_req_t* tr_async_req(tr_async_t* a, size_t i) {
+  return &a->reqs[(a->head + i) % TRACCAR_ASYNC_QUEUE_SIZE];
+}
+
+// End of the last request that may be on the wire given the pipeline depth
+static size_t tr_async_write_limit(const traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  if (!a->count) return a->tx_head;
+  size_t n = a->count < c->pipeline_depth ? a->count : c->pipeline_depth;
+  return tr_async_req(a, n - 1)->end;
+}
+
+static void tr_async_watch(traccar_client_t* c) {
+#ifdef __linux__
+  tr_async_t* a = c->async;
+  if (a->fd < 0) return;
+  uint32_t want = (uint32_t)EPOLLIN | ((a->connecting || a->tx_sent < tr_async_write_limit(c)) ? (uint32_t)EPOLLOUT : 0u);
+  if (want == a->events) return;
+  struct epoll_event ev; memset(&ev, 0, sizeof(ev));
+  ev.events = want; ev.data.fd = a->fd;
+  epoll_ctl(a->ep, a->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, a->fd, &ev);
+  a->events = want;
+#else
+  (void)c;
+#endif
+}
+
+// Removes reqs[head]; its result is reported by the next tr_async_dispatch
+static void tr_async_complete(traccar_client_t* c, int code) {
+  tr_async_t* a = c->async;
+  tr_async_req_t r = *tr_async_req(a, 0);
+  a->tx_head = r.end;
+  a->head = (a->head + 1) % TRACCAR_ASYNC_QUEUE_SIZE;
+  a->count--;
+  if (a->inflight) a->inflight--;
+  if (!a->count) a->tx_head = a->tx_len = a->tx_sent = 0;
+  tr_stat_response(c, code, r.queued_us);
+  if (c->debug) fprintf(stderr, "[Traccar] async %d\n", code);
+  if (!r.cb) return;
+  size_t i = (a->done_head + a->done_count++) % TRACCAR_ASYNC_QUEUE_SIZE;
+  a->done[i].cb = r.cb; a->done[i].user = r.user; a->done[i].code = code;
+}
+
+// Runs the callbacks of finished requests in order. A nested call (traccar_poll from a
+// callback) leaves them to the outer loop. Returns true if a callback destroyed the client.
+static bool tr_async_dispatch(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  if (a->dispatching) return false;
+  a->dispatching = true;
+  while (a->done_count) {
+    size_t i = a->done_head;
+    a->done_head = (a->done_head + 1) % TRACCAR_ASYNC_QUEUE_SIZE;
+    a->done_count--;
+    a->done[i].cb(c, a->done[i].user, a->done[i].code);
   }
+  a->dispatching = false;
+  if (!a->destroy_pending) return false;
+  a->destroy_pending = false;
+  traccar_destroy(c);
+  return true;
+}
 
-  int code = http.POST(body);
-  http.end();
-  if (c->debug) Serial.printf("[Traccar] POST %d\n", code);
-  if (out_http_code) *out_http_code = code;
-  return code == 200;
+// Closes the connection; unanswered requests stay queued and are written again on the next one
+static void tr_async_close(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  if (a->fd >= 0) close(a->fd); // also drops it from the epoll set
+  a->fd = -1;
+  a->connecting = false;
+  a->events = 0;
+  a->tx_sent = a->tx_head;
+  a->inflight = 0;
+  a->answered = 0;
+  a->resp_started = false;
+  tr_resp_reset(&a->resp);
+}
+
+static void tr_async_fail(traccar_client_t* c, size_t n, int code) {
+  while (n-- && c->async->count) tr_async_complete(c, code);
+}
+
+// A dropped connection. On a reused connection nothing of the next response has arrived yet,
+// so the server most likely closed it while idle: reconnect and write the requests again.
+// Otherwise the unanswered requests fail.
+static void tr_async_lost(traccar_client_t* c, int code) {
+  tr_async_t* a = c->async;
+  size_t inflight = a->inflight;
+  bool stale = a->answered > 0 && !a->resp_started;
+  tr_async_close(c);
+  if (stale) tr_stat_retry(c, inflight);
+  else tr_async_fail(c, inflight ? inflight : 1, code);
+}
+
+// Starts a non-blocking connect; name resolution itself still blocks
+static bool tr_async_connect(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  char service[8]; snprintf(service, sizeof(service), "%u", (unsigned)c->conn_port);
+  struct addrinfo hints; memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* res = nullptr;
+  a->connect_us = tr_stat_clock();
+  if (getaddrinfo(c->conn_name, service, &hints, &res) != 0) return false;
+  int fd = -1;
+  bool connecting = false;
+  for (struct addrinfo* ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+    if (errno == EINPROGRESS) { connecting = true; break; }
+    close(fd); fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd < 0) return false;
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+  setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+  a->fd = fd;
+  a->connecting = connecting;
+  a->deadline_ms = tr_mono_ms() + c->timeout_ms;
+  if (!connecting) tr_stat_connect(c, a->connect_us);
+  return true;
+}
+
+static bool tr_async_connected(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  struct pollfd pfd = { a->fd, POLLOUT, 0 };
+  if (poll(&pfd, 1, 0) != 1) return false;
+  int err = 0; socklen_t errlen = sizeof(err);
+  if (getsockopt(a->fd, SOL_SOCKET, SO_ERROR, &err, &errlen) != 0 || err != 0) {
+    tr_async_close(c);
+    tr_async_fail(c, a->count, TRACCAR_HTTP_ERROR_CONNECTION_REFUSED);
+    return false;
+  }
+  a->connecting = false;
+  tr_stat_connect(c, a->connect_us);
+  return true;
+}
+
+static void tr_async_flush(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  size_t limit = tr_async_write_limit(c);
+  while (a->tx_sent < limit) {
+    ssize_t n = send(a->fd, a->tx + a->tx_sent, limit - a->tx_sent, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      tr_async_lost(c, TRACCAR_HTTP_ERROR_SEND_FAILED);
+      return;
+    }
+    a->tx_sent += (size_t)n;
+    a->deadline_ms = tr_mono_ms() + c->timeout_ms;
+  }
+  // Requests with at least one byte on the wire
+  size_t start = a->tx_head;
+  a->inflight = 0;
+  while (a->inflight < a->count && start < a->tx_sent) start = tr_async_req(a, a->inflight++)->end;
+}
+
+static void tr_async_read(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  while (a->fd >= 0) {
+    ssize_t n = recv(a->fd, a->rx, sizeof(a->rx), 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) tr_async_lost(c, TRACCAR_HTTP_ERROR_CONNECTION_LOST);
+      return;
+    }
+    if (n == 0) {
+      if (a->resp.state == TR_RESP_UNTIL_CLOSE && a->inflight) {
+        int code = a->resp.code;
+        tr_async_close(c);
+        tr_async_complete(c, code);
+      } else {
+        tr_async_lost(c, TRACCAR_HTTP_ERROR_CONNECTION_LOST);
+      }
+      return;
+    }
+    a->deadline_ms = tr_mono_ms() + c->timeout_ms;
+    size_t off = 0;
+    while (off < (size_t)n) {
+      if (!a->inflight) { tr_async_close(c); return; } // unsolicited bytes
+      a->resp_started = true;
+      off += tr_resp_feed(&a->resp, a->rx + off, (size_t)n - off);
+      if (a->resp.state == TR_RESP_ERROR) { tr_async_lost(c, TRACCAR_HTTP_ERROR_CONNECTION_LOST); return; }
+      if (a->resp.state != TR_RESP_DONE) continue;
+      int code = a->resp.code;
+      bool close_after = a->resp.close;
+      tr_resp_reset(&a->resp);
+      a->resp_started = false;
+      a->answered++;
+      if (close_after) tr_async_close(c); // later requests were not processed; resent on a new connection
+      tr_async_complete(c, code);
+      if (close_after) return;
+    }
+  }
+}
+
+// Does all the work possible without waiting
+static void tr_async_step(traccar_client_t* c) {
+  tr_async_t* a = c->async;
+  for (int round = 0; round < 4 && a->count; ++round) {
+    if (a->fd < 0 && !tr_async_connect(c)) {
+      tr_async_fail(c, a->count, TRACCAR_HTTP_ERROR_CONNECTION_REFUSED);
+      break;
+    }
+    if (a->connecting && !tr_async_connected(c)) break;
+    tr_async_flush(c);
+    if (a->fd >= 0) tr_async_read(c);
+    if (a->fd >= 0) break; // otherwise reconnect for what is still queued
+  }
+  if (a->fd >= 0 && a->count && tr_mono_ms() >= a->deadline_ms) {
+    bool connecting = a->connecting;
+    size_t n = connecting ? a->count : a->inflight;
+    tr_async_close(c);
+    tr_async_fail(c, n, connecting ? TRACCAR_HTTP_ERROR_CONNECTION_REFUSED : TRACCAR_HTTP_ERROR_READ_TIMEOUT);
+  }
+  if (a->fd >= 0 && !a->count && !c->keep_alive) tr_async_close(c);
+  tr_async_watch(c);
+}
+
+// Makes room for need more bytes, first by dropping the bytes of answered requests
+static bool tr_async_reserve(const traccar_client_t* c, tr_async_t* a, size_t need) {
+  if (a->tx_head && a->tx_len + need > a->tx_cap) {
+    size_t shift = a->tx_head;
+    memmove(a->tx, a->tx + shift, a->tx_len - shift);
+    a->tx_len -= shift; a->tx_sent -= shift; a->tx_head = 0;
+    for (size_t i = 0; i < a->count; ++i) tr_async_req(a, i)->end -= shift;
+  }
+  if (a->tx_len + need <= a->tx_cap) return true;
+  size_t cap = a->tx_cap ? a->tx_cap : 4096;
+  while (cap < a->tx_len + need) cap *= 2;
+  char* p = (char*)tr_realloc(c, a->tx, a->tx_len, cap);
+  if (!p) return false;
+  a->tx = p; a->tx_cap = cap;
+  return true;
+}
+
+bool traccar_send_async(traccar_client_t* c, traccar_format_t format, const traccar_position_t* pos,
+                        traccar_send_cb cb, void* user) {
+  if (!c || !pos || !c->device_id || !*c->device_id || !c->conn_ok) return false;
+  tr_async_t* a = tr_async_get(c);
+  if (!a || a->destroy_pending || a->count + a->done_count >= TRACCAR_ASYNC_QUEUE_SIZE) return false;
+  char buf[TRACCAR_JSON_BODY_SIZE];
+  const char* path = c->base_url + c->path_off;
+  const char* type = nullptr;
+  const char* body = nullptr;
+  size_t n = 0; bool cut;
+  if (format == TRACCAR_FORMAT_JSON) {
+    body = tr_build_sized(c, traccar_build_json_body_ex, pos, nullptr, buf, sizeof(buf), &n, &cut);
+    type = "application/json";
+    tr_stat_request(c, TRACCAR_STATS_JSON, 1, n, cut);
+  } else {
+    size_t un;
+    path = tr_build_sized(c, traccar_build_osmand_url_ex, pos, nullptr, buf, sizeof(buf), &un, &cut) + c->path_off;
+    tr_stat_request(c, TRACCAR_STATS_OSMAND, 1, un, cut);
+  }
+  if (cut) return false; // as TRACCAR_HTTP_ERROR_TRUNCATED, counted in stats.truncations
+  if (!tr_async_reserve(c, a, 640 + n + (type ? 0 : strlen(path)))) return false;
+  int hn = tr_request_head(c, true, type ? "POST" : "GET", path, type, n, a->tx + a->tx_len, a->tx_cap - a->tx_len);
+  if (hn < 0) return false;
+  a->tx_len += (size_t)hn;
+  if (type) { memcpy(a->tx + a->tx_len, body, n); a->tx_len += n; }
+  tr_async_req_t* r = &a->reqs[(a->head + a->count) % TRACCAR_ASYNC_QUEUE_SIZE];
+  r->cb = cb; r->user = user; r->end = a->tx_len; r->queued_us = tr_stat_clock();
+  a->count++;
+  // Start writing right away; results are only reported from traccar_poll
+  if (a->fd < 0) tr_async_connect(c);
+  if (a->fd >= 0 && !a->connecting) tr_async_flush(c);
+  if (a->fd >= 0) tr_async_watch(c);
+  return true;
 }
 
+int traccar_poll(traccar_client_t* c, int timeout_ms) {
+  if (!c || !c->async) return 0;
+  tr_async_t* a = c->async;
+  tr_async_step(c);
+  if (a->count && a->fd >= 0 && timeout_ms != 0) {
+    uint64_t now = tr_mono_ms();
+    int wait = a->deadline_ms > now ? (int)(a->deadline_ms - now) : 0;
+    if (timeout_ms > 0 && timeout_ms < wait) wait = timeout_ms;
+#ifdef __linux__
+    struct epoll_event ev[4];
+    epoll_wait(a->ep, ev, 4, wait);
 #else
-// Non-Arduino host build stubs (no HTTP)
-bool traccar_send_osmand(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
-  (void)c; (void)pos; if (out_http_code) *out_http_code = 0; return false;
+    struct pollfd pfd = { a->fd, (short)(POLLIN | ((a->connecting || a->tx_sent < tr_async_write_limit(c)) ? POLLOUT : 0)), 0 };
+    poll(&pfd, 1, wait);
+#endif
+    tr_async_step(c);
+  }
+  if (tr_async_dispatch(c)) return 0;
+  return (int)(a->count + a->done_count);
 }
-bool traccar_send_json(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
-  (void)c; (void)pos; if (out_http_code) *out_http_code = 0; return false;
+
+int traccar_async_fd(traccar_client_t* c) {
+  if (!c) return -1;
+  tr_async_t* a = tr_async_get(c);
+  if (!a) return -1;
+#ifdef __linux__
+  return a->ep;
+#else
+  return a->fd;
+#endif
+}
+
+// Pending requests complete with TRACCAR_HTTP_ERROR_NOT_CONNECTED. Called from a callback the
+// state stays (the running dispatch reports those results and still needs it) and a destroy is
+// only recorded. Returns true when c is gone or about to be, so the caller must not touch it.
+static bool tr_async_free(traccar_client_t* c, bool destroying) {
+  tr_async_t* a = c->async;
+  if (!a) return false;
+  if (a->destroy_pending) return true;
+  tr_async_close(c);
+  tr_async_fail(c, a->count, TRACCAR_HTTP_ERROR_NOT_CONNECTED);
+  if (a->dispatching) {
+    a->destroy_pending = destroying;
+    return destroying;
+  }
+  if (tr_async_dispatch(c)) return true;
+  if (a->ep >= 0) close(a->ep);
+  tr_free(c, a->tx);
+  tr_free(c, a);
+  c->async = nullptr;
+  return false;
+}
+
+#else
+// Non-Arduino, non-POSIX build stubs (no HTTP)
+void traccar_disconnect(traccar_client_t* c) { (void)c; }
+bool traccar_send_async(traccar_client_t* c, traccar_format_t format, const traccar_position_t* pos, traccar_send_cb cb, void* user) {
+  (void)c; (void)format; (void)pos; (void)cb; (void)user; return false;
+}
+int traccar_poll(traccar_client_t* c, int timeout_ms) { (void)c; (void)timeout_ms; return 0; }
+int traccar_async_fd(traccar_client_t* c) { (void)c; return -1; }
+bool traccar_send_json_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  (void)c; (void)positions; if (accepted) memset(accepted, 0, n * sizeof(*accepted)); if (out_http_code) *out_http_code = 0; return false;
+}
+bool traccar_send_osmand_batch(traccar_client_t* c, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code) {
+  (void)c; (void)positions; if (accepted) memset(accepted, 0, n * sizeof(*accepted)); if (out_http_code) *out_http_code = 0; return false;
+}
+static bool tr_send_osmand(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  (void)c; (void)pos; (void)texts; if (out_http_code) *out_http_code = 0; return false;
+}
+static bool tr_send_json(traccar_client_t* c, const traccar_position_t* pos, const traccar_texts_t* texts, int* out_http_code) {
+  (void)c; (void)pos; (void)texts; if (out_http_code) *out_http_code = 0; return false;
 }
 bool traccar_send_osmand_form(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
   (void)c; (void)pos; if (out_http_code) *out_http_code = 0; return false;
 }
 #endif
 
-#ifdef ARDUINO
-// ----------------- C++ Arduino wrapper -----------------
-
-static inline bool isProvided(double v) { return !isnan(v); }
+bool traccar_send_osmand(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
+  return tr_send_osmand(c, pos, nullptr, out_http_code);
+}
 
-TraccarClient::TraccarClient()
-  : _host(""), _port(5055), _deviceId(""), _basePath("/"), _debug(false), _connectTimeoutMs(4000) {}
+bool traccar_send_json(traccar_client_t* c, const traccar_position_t* pos, int* out_http_code) {
+  return tr_send_json(c, pos, nullptr, out_http_code);
+}
 
-TraccarClient::TraccarClient(const String& hostUrl, uint16_t port, const String& deviceId)
-  : _host(hostUrl), _port(port), _deviceId(deviceId), _basePath("/"), _debug(false), _connectTimeoutMs(4000) {}
-
-void TraccarClient::setHost(const String& hostUrl) { _host = hostUrl; }
-void TraccarClient::setPort(uint16_t port) { _port = port; }
-void TraccarClient::setDeviceId(const String& deviceId) { _deviceId = deviceId; }
-void TraccarClient::setBasePath(const String& basePath) { _basePath = basePath.length() ? basePath : "/"; }
-void TraccarClient::setDebug(bool enabled) { _debug = enabled; }
-void TraccarClient::setTimeoutMs(uint16_t connectTimeoutMs) { _connectTimeoutMs = connectTimeoutMs; }
-
-String TraccarClient::makeBaseUrl() const {
-  String base; base.reserve(_host.length() + 16 + _basePath.length());
-  base += _host;
-  if (_port) { base += ":"; base += String(_port); }
-  if (_basePath.length()) {
-    if (_basePath[0] != '/') base += "/";
-    base += _basePath;
-  }
-  if (base.length() == 0 || base[base.length()-1] != '/') base += "/";
-  return base;
-}
-
-String TraccarClient::formatIso8601(uint64_t epochMs) {
-  if (epochMs == 0) return String("");
-  time_t sec = (time_t)(epochMs / 1000ULL);
-  struct tm tmv;
-  gmtime_r(&sec, &tmv);
-  char buf[32];
-  int ms = (int)(epochMs % 1000ULL);
-  snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
-           tmv.tm_year + 1900, tmv.tm_mon + 1, tmv.tm_mday,
-           tmv.tm_hour, tmv.tm_min, tmv.tm_sec, ms);
-  return String(buf);
+bool traccar_send_ex(traccar_client_t* c, traccar_format_t format, const traccar_position_t* pos,
+                     const traccar_texts_t* texts, int* out_http_code) {
+  if (format == TRACCAR_FORMAT_JSON) return tr_send_json(c, pos, texts, out_http_code);
+  return tr_send_osmand(c, pos, texts, out_http_code);
 }
 
-String TraccarClient::buildOsmAndUrl(const TraccarPosition& pos) const {
+#ifdef ARDUINO
+// ----------------- C++ Arduino wrapper -----------------
+
+// View of a TraccarPosition as the C struct; string fields borrow the String buffers
+static traccar_position_t tr_c_position(const TraccarPosition& pos) {
   traccar_position_t p{};
   p.latitude = pos.latitude;
   p.longitude = pos.longitude;
@@ -384,134 +2490,85 @@ String TraccarClient::buildOsmAndUrl(const TraccarPosition& pos) const {
   p.eventName = pos.eventName.length() ? pos.eventName.c_str() : nullptr;
   p.activityType = pos.activityType.length() ? pos.activityType.c_str() : nullptr;
   p.odometer = pos.odometer;
+  return p;
+}
+
+// The class is a thin layer over a traccar_client_t: configuration, cached request prefixes
+// and the kept-alive connection all live in the C client.
+TraccarClient::TraccarClient()
+  : _core(traccar_create("", 5055, "")) {}
+
+TraccarClient::TraccarClient(const String& hostUrl, uint16_t port, const String& deviceId)
+  : _core(traccar_create(hostUrl.c_str(), port, deviceId.c_str())) {}
 
-  traccar_client_t tmp{0};
-  tmp.host = (char*)_host.c_str();
-  tmp.port = _port;
-  tmp.device_id = (char*)_deviceId.c_str();
-  tmp.base_path = (char*)_basePath.c_str();
-  tmp.debug = _debug;
-  tmp.timeout_ms = _connectTimeoutMs;
+// Copies share configuration only; each instance owns its own connection
+TraccarClient::TraccarClient(const TraccarClient& other)
+  : _core(nullptr) {
+  *this = other;
+}
+
+TraccarClient& TraccarClient::operator=(const TraccarClient& other) {
+  if (this == &other || !other._core) return *this;
+  traccar_destroy(_core);
+  const traccar_client_t* o = other._core;
+  _core = traccar_create(o->host, o->port, o->device_id);
+  traccar_set_base_path(_core, o->base_path);
+  traccar_set_debug(_core, o->debug);
+  traccar_set_timeout_ms(_core, o->timeout_ms);
+  traccar_set_keep_alive(_core, o->keep_alive);
+  return *this;
+}
+
+TraccarClient::~TraccarClient() {
+  traccar_destroy(_core);
+}
+
+void TraccarClient::setHost(const String& hostUrl) { traccar_set_host(_core, hostUrl.c_str()); }
+void TraccarClient::setPort(uint16_t port) { traccar_set_port(_core, port); }
+void TraccarClient::setDeviceId(const String& deviceId) { traccar_set_device_id(_core, deviceId.c_str()); }
+void TraccarClient::setBasePath(const String& basePath) { traccar_set_base_path(_core, basePath.c_str()); }
+void TraccarClient::setDebug(bool enabled) { traccar_set_debug(_core, enabled); }
+void TraccarClient::setTimeoutMs(uint16_t connectTimeoutMs) { traccar_set_timeout_ms(_core, connectTimeoutMs); }
+
+traccar_stats_t TraccarClient::getStats() const {
+  traccar_stats_t stats;
+  traccar_get_stats(_core, &stats);
+  return stats;
+}
 
-  char url[384]; traccar_build_osmand_url(&tmp, &p, url, sizeof(url));
-  return String(url);
+void TraccarClient::resetStats() { traccar_reset_stats(_core); }
+
+bool TraccarClient::setTrace(size_t capacity) { return traccar_set_trace(_core, capacity); }
+
+size_t TraccarClient::getSpans(traccar_span_t* out, size_t max) const { return traccar_get_spans(_core, out, max); }
+
+bool TraccarClient::ready() const {
+  return _core && *_core->host && *_core->device_id;
+}
+
+String TraccarClient::buildOsmAndUrl(const TraccarPosition& pos) const {
+  if (!_core) return String("");
+  traccar_position_t p = tr_c_position(pos);
+  char buf[384]; size_t n; bool cut;
+  return String(tr_build_sized(_core, traccar_build_osmand_url_ex, &p, nullptr, buf, sizeof(buf), &n, &cut));
 }
 
 bool TraccarClient::sendOsmAnd(const TraccarPosition& pos, int* outHttpCode) const {
-  if (_host.length() == 0 || _deviceId.length() == 0) return false;
-  String url = buildOsmAndUrl(pos);
-  HTTPClient http;
-  http.setConnectTimeout(_connectTimeoutMs);
-  if (!http.begin(url)) {
-    if (_debug) Serial.println("[Traccar] http.begin failed");
-    return false;
-  }
-  int code = http.GET();
-  http.end();
-  if (_debug) Serial.printf("[Traccar] GET %d\n", code);
-  if (outHttpCode) *outHttpCode = code;
-  return (code == 200);
+  if (!ready()) return false;
+  traccar_position_t p = tr_c_position(pos);
+  return traccar_send_osmand(_core, &p, outHttpCode);
 }
 
 bool TraccarClient::sendJson(const TraccarPosition& pos, int* outHttpCode) const {
-  if (_host.length() == 0 || _deviceId.length() == 0) return false;
-  String base = makeBaseUrl();
-  HTTPClient http;
-  http.setConnectTimeout(_connectTimeoutMs);
-  if (!http.begin(base)) {
-    if (_debug) Serial.println("[Traccar] http.begin failed");
-    return false;
-  }
-  http.addHeader("Content-Type", "application/json");
-
-  uint64_t ts = pos.timestampMs ? pos.timestampMs : tr_now_ms_or_0();
-  String tsIso = formatIso8601(ts);
-
-  String body; body.reserve(384);
-  body += "{";
-  body += "\"id\":\""; body += _deviceId; body += "\"";
-  
-  if (isProvided(pos.latitude)) { body += ",\"lat\":"; body += String(pos.latitude, 7); }
-  if (isProvided(pos.longitude)) { body += ",\"lon\":"; body += String(pos.longitude, 7); }
-  if (isProvided(pos.altitudeMeters)) { body += ",\"altitude\":"; body += String(pos.altitudeMeters, 1); }
-  if (isProvided(pos.speedKmh)) { 
-#if TRACCAR_SPEED_ROUND_DOWN
-    body += ",\"speed\":"; body += String((int)floor(pos.speedKmh / 1.852)); // convert km/h to knots, rounded down
-#else
-    body += ",\"speed\":"; body += String((int)round(pos.speedKmh / 1.852)); // convert km/h to knots, rounded
-#endif
-  }
-  if (isProvided(pos.headingDeg)) { body += ",\"heading\":"; body += String(pos.headingDeg, 1); }
-  if (isProvided(pos.hdop)) { body += ",\"hdop\":"; body += String(pos.hdop, 2); }
-  if (isProvided(pos.accuracyMeters)) { body += ",\"accuracy\":"; body += String(pos.accuracyMeters, 1); }
-  if (pos.validFlag >= 0) { body += ",\"valid\":"; body += (pos.validFlag ? "true" : "false"); }
-  if (tsIso.length()) { body += ",\"timestamp\":\""; body += tsIso; body += "\""; }
-  if (isProvided(pos.odometer)) { body += ",\"odometer\":"; body += String(pos.odometer, 1); }
-  if (pos.batteryPercent >= 0) { body += ",\"batt\":"; body += String(pos.batteryPercent); }
-  if (pos.charging) { body += ",\"charge\":true"; }
-  if (pos.eventName.length()) { body += ",\"event\":\""; body += pos.eventName; body += "\""; }
-  if (pos.activityType.length()) { body += ",\"activity\":\""; body += pos.activityType; body += "\""; }
-  if (pos.driverUniqueId.length()) { body += ",\"driverUniqueId\":\""; body += pos.driverUniqueId; body += "\""; }
-  if (pos.cell.length()) { body += ",\"cell\":\""; body += pos.cell; body += "\""; }
-  if (pos.wifi.length()) { body += ",\"wifi\":\""; body += pos.wifi; body += "\""; }
-  
-  body += "}";
-
-  if (_debug) {
-    Serial.printf("[Traccar] POST to: %s\n", base.c_str());
-    Serial.printf("[Traccar] JSON body: %s\n", body.c_str());
-  }
-
-  int code = http.POST(body);
-  http.end();
-  if (_debug) Serial.printf("[Traccar] POST %d\n", code);
-  if (outHttpCode) *outHttpCode = code;
-  return (code == 200);
+  if (!ready()) return false;
+  traccar_position_t p = tr_c_position(pos);
+  return traccar_send_json(_core, &p, outHttpCode);
 }
 
 bool TraccarClient::sendOsmAndForm(const TraccarPosition& pos, int* outHttpCode) const {
-  if (_host.length() == 0 || _deviceId.length() == 0) return false;
-  traccar_position_t p{};
-  p.latitude = pos.latitude;
-  p.longitude = pos.longitude;
-  p.altitudeMeters = pos.altitudeMeters;
-  p.speedKmh = pos.speedKmh;
-  p.headingDeg = pos.headingDeg;
-  p.hdop = pos.hdop;
-  p.accuracyMeters = pos.accuracyMeters;
-  p.timestampMs = pos.timestampMs;
-  p.batteryPercent = pos.batteryPercent;
-  p.validFlag = pos.validFlag;
-  p.charging = pos.charging;
-  p.driverUniqueId = pos.driverUniqueId.length() ? pos.driverUniqueId.c_str() : nullptr;
-  p.cell = pos.cell.length() ? pos.cell.c_str() : nullptr;
-  p.wifi = pos.wifi.length() ? pos.wifi.c_str() : nullptr;
-  p.eventName = pos.eventName.length() ? pos.eventName.c_str() : nullptr;
-  p.activityType = pos.activityType.length() ? pos.activityType.c_str() : nullptr;
-  p.odometer = pos.odometer;
-
-  traccar_client_t tmp{0};
-  tmp.host = (char*)_host.c_str();
-  tmp.port = _port;
-  tmp.device_id = (char*)_deviceId.c_str();
-  tmp.base_path = (char*)_basePath.c_str();
-  tmp.debug = _debug;
-  tmp.timeout_ms = _connectTimeoutMs;
-
-  String base = makeBaseUrl();
-  HTTPClient http;
-  http.setConnectTimeout(_connectTimeoutMs);
-  if (!http.begin(base)) {
-    if (_debug) Serial.println("[Traccar] http.begin failed");
-    return false;
-  }
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  char bodyBuf[384]; traccar_build_osmand_form_body(&tmp, &p, bodyBuf, sizeof(bodyBuf));
-  int code = http.POST((uint8_t*)bodyBuf, strlen(bodyBuf));
-  http.end();
-  if (_debug) Serial.printf("[Traccar] POST form %d\n", code);
-  if (outHttpCode) *outHttpCode = code;
-  return (code == 200);
+  if (!ready()) return false;
+  traccar_position_t p = tr_c_position(pos);
+  return traccar_send_osmand_form(_core, &p, outHttpCode);
 }
 
  
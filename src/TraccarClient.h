@@ -10,11 +10,77 @@
 #define TRACCAR_SPEED_ROUND_DOWN 0  // 1 = floor (round down), 0 = normal rounding
 #endif
 
+// Stack buffer used by the single-position JSON senders
+#ifndef TRACCAR_JSON_BODY_SIZE
+#define TRACCAR_JSON_BODY_SIZE 768
+#endif
+
+// Requests an async client can hold queued or in flight
+#ifndef TRACCAR_ASYNC_QUEUE_SIZE
+#define TRACCAR_ASYNC_QUEUE_SIZE 64
+#endif
+
+// Bytes inside each client for its configuration: host, device id and base path plus the request
+// prefixes encoded from them. A longer configuration takes one block from the client's allocator.
+#ifndef TRACCAR_CONFIG_SIZE
+#define TRACCAR_CONFIG_SIZE 512
+#endif
+
+// Send statistics (traccar_get_stats); 0 compiles the counters and timing out
+#ifndef TRACCAR_STATS
+#define TRACCAR_STATS 1
+#endif
+
+// Per-stage request tracing (traccar_set_trace); 0 compiles the span recording out
+#ifndef TRACCAR_TRACE
+#define TRACCAR_TRACE 1
+#endif
+
+// URL-encoding and JSON-escaping with SSE2 / NEON where the target has them; 0 builds only the
+// portable byte loop
+#ifndef TRACCAR_SIMD
+#define TRACCAR_SIMD 1
+#endif
+
+// Position fields, as bits for TRACCAR_FIXED_FIELDS
+#define TRACCAR_FIELD_LATITUDE   (1UL << 0)
+#define TRACCAR_FIELD_LONGITUDE  (1UL << 1)
+#define TRACCAR_FIELD_ALTITUDE   (1UL << 2)
+#define TRACCAR_FIELD_SPEED      (1UL << 3)
+#define TRACCAR_FIELD_HEADING    (1UL << 4)
+#define TRACCAR_FIELD_HDOP       (1UL << 5)
+#define TRACCAR_FIELD_ACCURACY   (1UL << 6)
+#define TRACCAR_FIELD_TIMESTAMP  (1UL << 7)
+#define TRACCAR_FIELD_BATTERY    (1UL << 8)  // batteryPercent and charging
+#define TRACCAR_FIELD_VALID      (1UL << 9)
+#define TRACCAR_FIELD_DRIVER     (1UL << 10)
+#define TRACCAR_FIELD_CELL       (1UL << 11)
+#define TRACCAR_FIELD_WIFI       (1UL << 12)
+#define TRACCAR_FIELD_EVENT      (1UL << 13)
+#define TRACCAR_FIELD_ACTIVITY   (1UL << 14)
+#define TRACCAR_FIELD_ODOMETER   (1UL << 15)
+
+// Fixed field set: when every position always carries the same fields, define this to their
+// TRACCAR_FIELD_* mask and the builders are compiled for exactly that set, without the per-field
+// NaN/-1 checks. Fields outside the set are never sent. 0 = encode whatever each position provides.
+#ifndef TRACCAR_FIXED_FIELDS
+#define TRACCAR_FIXED_FIELDS 0
+#endif
+
+// Host builds (Linux/macOS) get a POSIX socket transport; other targets without Arduino keep no-op senders
+#ifndef TRACCAR_HAVE_POSIX
+#if !defined(ARDUINO) && (defined(__unix__) || defined(__APPLE__))
+#define TRACCAR_HAVE_POSIX 1
+#else
+#define TRACCAR_HAVE_POSIX 0
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// C-friendly position structure
+// C-friendly position structure. Infinities are omitted like NAN; any finite value is sent in full.
 typedef struct traccar_position_s {
   double latitude;       // degrees; NAN to omit
   double longitude;      // degrees; NAN to omit
@@ -36,26 +102,235 @@ typedef struct traccar_position_s {
   double odometer;       // meters; NAN to omit
 } traccar_position_t;
 
+// Negative transport error codes reported through out_http_code (same values as ESP32 HTTPClient)
+#define TRACCAR_HTTP_ERROR_CONNECTION_REFUSED  (-1)
+#define TRACCAR_HTTP_ERROR_SEND_FAILED         (-3)
+#define TRACCAR_HTTP_ERROR_NOT_CONNECTED       (-4)
+#define TRACCAR_HTTP_ERROR_CONNECTION_LOST     (-5)
+#define TRACCAR_HTTP_ERROR_UNSUPPORTED         (-9)
+#define TRACCAR_HTTP_ERROR_READ_TIMEOUT        (-11)
+// Not an HTTPClient code: the request did not fit its buffer (a fixed or exhausted batch buffer)
+// and was not sent, as cut short it would lose fields or be malformed
+#define TRACCAR_HTTP_ERROR_TRUNCATED           (-12)
+
+// Wire format used by the queueing/batching layers
+typedef enum traccar_format_e {
+  TRACCAR_FORMAT_OSMAND = 0, // GET query string
+  TRACCAR_FORMAT_JSON = 1    // POST application/json
+} traccar_format_t;
+
+// Latency histogram with power-of-two buckets: buckets[0] counts samples below 64 us, buckets[i]
+// those in [64 << (i-1), 64 << i) us and the last bucket everything from ~16.8 s up
+#define TRACCAR_LATENCY_BUCKETS 20
+typedef struct traccar_histogram_s {
+  uint64_t buckets[TRACCAR_LATENCY_BUCKETS];
+  uint64_t count;
+  uint64_t sum_us;
+  uint64_t max_us;
+} traccar_histogram_t;
+
+// Request kinds counted by traccar_stats_t
+enum { TRACCAR_STATS_OSMAND = 0, TRACCAR_STATS_FORM = 1, TRACCAR_STATS_JSON = 2, TRACCAR_STATS_KINDS = 3 };
+
+// Counters of one client since creation (or traccar_reset_stats)
+typedef struct traccar_stats_s {
+  uint64_t requests[TRACCAR_STATS_KINDS];  // HTTP requests encoded, by TRACCAR_STATS_* kind
+  uint64_t positions[TRACCAR_STATS_KINDS]; // positions they carried (a JSON batch carries many)
+  uint64_t status[6];      // responses by class: status[2] = 2xx .. status[5] = 5xx, status[0] others
+  uint64_t errors[12];     // transport failures by -TRACCAR_HTTP_ERROR_* (errors[1] = refused, ...)
+  uint64_t bytes_encoded;  // request targets and bodies built for sends
+  uint64_t truncations;    // encodings that did not fit their buffer: the send failed with
+                           // TRACCAR_HTTP_ERROR_TRUNCATED, or a batch carried fewer positions
+  uint64_t connects;       // connections opened
+  uint64_t retries;        // requests written again after a keep-alive connection went stale
+  traccar_histogram_t connect_latency; // TCP connect (host builds only)
+  traccar_histogram_t request_latency; // request written .. response complete (async: queued .. answered)
+} traccar_stats_t;
+
+// Stages of a send recorded by the trace (traccar_span_t.stage)
+enum {
+  TRACCAR_SPAN_SEND = 0,     // the whole send; kind and code are set
+  TRACCAR_SPAN_BUILD = 1,    // encoding the request
+  TRACCAR_SPAN_RESOLVE = 2,  // DNS lookup of a new connection (host builds)
+  TRACCAR_SPAN_CONNECT = 3,  // TCP connect (host builds)
+  TRACCAR_SPAN_WRITE = 4,    // writing the request (host builds)
+  TRACCAR_SPAN_WAIT = 5,     // request written .. first response byte (host builds)
+  TRACCAR_SPAN_READ = 6,     // first response byte .. response complete (host builds)
+  TRACCAR_SPAN_EXCHANGE = 7, // connect .. response complete, in one piece (Arduino HTTPClient)
+  TRACCAR_SPAN_STAGES = 8
+};
+
+// One timed stage of a send
+typedef struct traccar_span_s {
+  uint64_t start_us;    // monotonic clock; only differences between spans are meaningful
+  uint32_t duration_us;
+  uint32_t request;     // numbers the sends of the client: the spans of one send share it
+  uint8_t stage;        // TRACCAR_SPAN_*
+  uint8_t kind;         // TRACCAR_STATS_* kind of the send
+  int16_t code;         // HTTP status or TRACCAR_HTTP_ERROR_* where the stage has one, else 0
+} traccar_span_t;
+
 // Opaque client handle
 typedef struct traccar_client_s traccar_client_t;
 
-// Lifecycle
+// Memory hooks for a client. alloc returns nullptr on failure; free may be nullptr (nothing is
+// returned, as with an arena). Memory must be aligned for any type, like malloc's.
+typedef struct traccar_allocator_s {
+  void* (*alloc)(void* user, size_t size);
+  void (*free)(void* user, void* ptr);
+  void* user;
+} traccar_allocator_t;
+
+// Bump allocator over a caller-provided buffer, for long-running firmware that wants the client
+// out of the heap entirely: size it traccar_client_size() plus the batch capacity (and, on host
+// builds, the async state if traccar_send_async is used).
+typedef struct traccar_arena_s {
+  uint8_t* base;
+  size_t size;
+  size_t used;
+} traccar_arena_t;
+void traccar_arena_init(traccar_arena_t* arena, void* buf, size_t size);
+traccar_allocator_t traccar_arena_allocator(traccar_arena_t* arena);
+
+// Lifecycle. A client is one block holding its configuration (see TRACCAR_CONFIG_SIZE); setters
+// rewrite it in place. traccar_create_ex takes its memory from allocator (nullptr = malloc/free).
 traccar_client_t* traccar_create(const char* host_url, uint16_t port, const char* device_id);
+traccar_client_t* traccar_create_ex(const char* host_url, uint16_t port, const char* device_id,
+                                    const traccar_allocator_t* allocator);
 void traccar_destroy(traccar_client_t* client);
+size_t traccar_client_size(void); // bytes of the client block
 
 // Configuration
+void traccar_set_host(traccar_client_t* client, const char* host_url);
+void traccar_set_port(traccar_client_t* client, uint16_t port);
+void traccar_set_device_id(traccar_client_t* client, const char* device_id);
 void traccar_set_base_path(traccar_client_t* client, const char* base_path);
 void traccar_set_debug(traccar_client_t* client, bool enabled);
 void traccar_set_timeout_ms(traccar_client_t* client, uint16_t timeout_ms);
+void traccar_set_keep_alive(traccar_client_t* client, bool enabled); // default true: reuse one connection across sends
+void traccar_set_pipeline_depth(traccar_client_t* client, unsigned depth); // default 8 unanswered async requests
+// Allocates the batch buffer once at bytes (at least 1024) and keeps it at that size: batch sends
+// then never allocate, and a batch that does not fit is sent in part (accepted tells which).
+// 0 restores the default buffer, which grows to the largest batch seen.
+bool traccar_set_batch_capacity(traccar_client_t* client, size_t bytes);
+
+// Closes the persistent connection (if any); the next send reconnects
+void traccar_disconnect(traccar_client_t* client);
 
 // Operations
 bool traccar_send_osmand(traccar_client_t* client, const traccar_position_t* pos, int* out_http_code);
 bool traccar_send_json(traccar_client_t* client, const traccar_position_t* pos, int* out_http_code);
 bool traccar_send_osmand_form(traccar_client_t* client, const traccar_position_t* pos, int* out_http_code);
 
-// Utility: build OsmAnd URL into provided buffer (returns length written, not including NUL)
+// Batch operations: upload n positions at once. accepted (optional, n entries) reports each item;
+// out_http_code receives 200 or the last failing code. Returns true when every item was accepted.
+// Positions that do not fit a fixed batch buffer are not sent: the code is that of the part that
+// was, or TRACCAR_HTTP_ERROR_TRUNCATED if none fitted.
+// JSON sends one POST whose body is an array of the single-position objects; OsmAnd pipelines
+// one GET per position over the persistent connection (one write, responses read in order).
+bool traccar_send_json_batch(traccar_client_t* client, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code);
+bool traccar_send_osmand_batch(traccar_client_t* client, const traccar_position_t* positions, size_t n, bool* accepted, int* out_http_code);
+
+// Asynchronous sends: traccar_send_async encodes the position, queues the request and returns
+// without waiting for the network. Requests are pipelined on their own keep-alive connection, at
+// most pipeline_depth unanswered at a time, and cb receives each result (HTTP code or a negative
+// TRACCAR_HTTP_ERROR_*) in submission order from traccar_poll. Returns false if the request was
+// not queued (queue of TRACCAR_ASYNC_QUEUE_SIZE full, unsupported host, request too long for the
+// buffers as for TRACCAR_HTTP_ERROR_TRUNCATED); cb is then not called.
+// cb runs after the connection work of that call is done, so it may call anything on the client:
+// traccar_send_async and traccar_poll (results found by a nested poll are reported by the outer
+// one), traccar_set_host/traccar_set_port (the remaining requests then complete with
+// TRACCAR_HTTP_ERROR_NOT_CONNECTED) and traccar_destroy (takes effect when cb returns, after the
+// remaining callbacks have run; the client must not be used by the caller of traccar_poll after
+// a callback destroyed it). traccar_set_host/port and traccar_destroy report pending requests
+// to their callbacks before returning.
+// On Arduino the request is sent synchronously and cb runs before traccar_send_async returns.
+typedef void (*traccar_send_cb)(traccar_client_t* client, void* user, int http_code);
+bool traccar_send_async(traccar_client_t* client, traccar_format_t format, const traccar_position_t* pos,
+                        traccar_send_cb cb, void* user);
+// Runs the event loop: waits up to timeout_ms (0 = not at all, -1 = until the next timeout) for
+// network activity, then completes what it can. Returns the number of requests still pending.
+int traccar_poll(traccar_client_t* client, int timeout_ms);
+// Descriptor that becomes readable when traccar_poll has work to do (an epoll instance on Linux,
+// the connection socket elsewhere), for use in an external event loop; -1 if unavailable
+int traccar_async_fd(traccar_client_t* client);
+
+// Statistics. Recording costs a few plain stores per request: a client is used by one thread at
+// a time, so the counters have a single writer, and traccar_get_stats may read them from any
+// thread. All zero when built with TRACCAR_STATS 0.
+void traccar_get_stats(const traccar_client_t* client, traccar_stats_t* out);
+void traccar_reset_stats(traccar_client_t* client); // from the thread using the client
+// Adds the counters of from into into (e.g. to total several clients)
+void traccar_stats_merge(traccar_stats_t* into, const traccar_stats_t* from);
+// Upper bound (us) of the bucket holding the q-quantile (0..1) of the samples; 0 when empty
+uint64_t traccar_histogram_percentile(const traccar_histogram_t* h, double q);
+
+// Tracing. The blocking senders record a span per stage (build, resolve, connect, write, wait for
+// the server, read) into a ring of capacity spans allocated here from the client's allocator, so
+// a slow send shows where its time went; the oldest spans are overwritten. 0 frees the ring and
+// stops recording, which then costs one branch per stage. Returns false if the ring cannot be
+// allocated or the library was built with TRACCAR_TRACE 0. From the thread using the client,
+// like the getters below.
+bool traccar_set_trace(traccar_client_t* client, size_t capacity);
+// Copies up to max of the most recent spans, oldest first; returns how many were copied
+size_t traccar_get_spans(const traccar_client_t* client, traccar_span_t* out, size_t max);
+// Formats spans as Chrome trace events ("ph":"X", times in us) separated by commas, for the
+// "traceEvents" array of a trace (chrome://tracing, Perfetto); tid tells clients apart. Same
+// return as the builders below.
+size_t traccar_trace_events_json(const traccar_span_t* spans, size_t n, uint32_t tid, char* out, size_t out_size);
+// The client's recorded spans as a complete Chrome trace document. Returns the full length like
+// the builders below, but a document cut to fit drops the newest events whole and stays closed,
+// so what was written always parses (it is empty if not even an empty document fits).
+size_t traccar_trace_export_chrome(const traccar_client_t* client, char* out, size_t out_size);
+
+// Utility: build OsmAnd URL into provided buffer. Like snprintf, the output is NUL-terminated and
+// cut to fit, and the return is the full length (NUL excluded): a return >= out_size means the
+// output was truncated, and out may be nullptr with out_size 0 to query the size to allocate.
 size_t traccar_build_osmand_url(traccar_client_t* client, const traccar_position_t* pos, char* out, size_t out_size);
 size_t traccar_build_osmand_form_body(traccar_client_t* client, const traccar_position_t* pos, char* out, size_t out_size);
+// Utility: build the JSON body (no heap allocation; string fields are JSON-escaped; same return)
+size_t traccar_build_json_body(traccar_client_t* client, const traccar_position_t* pos, char* out, size_t out_size);
+// Utility: build a JSON array body in one pass; only complete elements are written and
+// *out_count (optional) receives how many positions fit
+size_t traccar_build_json_batch_body(traccar_client_t* client, const traccar_position_t* positions, size_t n,
+                                     char* out, size_t out_size, size_t* out_count);
+
+// Text fields as pointer and length, for strings that are not NUL-terminated (slices of a
+// received buffer, std::string_view). A field with size 0 is omitted.
+typedef struct traccar_text_s {
+  const char* data;
+  size_t size;
+} traccar_text_t;
+typedef struct traccar_texts_s {
+  traccar_text_t driverUniqueId, cell, wifi, eventName, activityType;
+} traccar_texts_t;
+
+// The builders and senders above with the text fields read from texts (when not nullptr)
+// instead of the const char* members of pos
+size_t traccar_build_osmand_url_ex(traccar_client_t* client, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                   char* out, size_t out_size);
+size_t traccar_build_osmand_form_body_ex(traccar_client_t* client, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                         char* out, size_t out_size);
+size_t traccar_build_json_body_ex(traccar_client_t* client, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                  char* out, size_t out_size);
+bool traccar_send_ex(traccar_client_t* client, traccar_format_t format, const traccar_position_t* pos,
+                     const traccar_texts_t* texts, int* out_http_code);
+
+// One piece of a scatter-gather output; same layout as struct iovec, so an array of them can
+// be cast and handed to writev/sendmsg
+typedef struct traccar_iovec_s {
+  const void* base;
+  size_t len;
+} traccar_iovec_t;
+
+// Scatter-gather builders: iov[0] is the cached prefix (URL up to "?id=<device>" or the form's
+// "id=<device>"), owned by the client and valid until it is reconfigured, and iov[1] the encoded
+// fields, written into scratch (not NUL-terminated). Nothing is copied but the fields. Returns
+// the full length; above iov[0].len + iov[1].len, the fields did not fit into scratch.
+size_t traccar_build_osmand_url_iov(traccar_client_t* client, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                    traccar_iovec_t iov[2], char* scratch, size_t scratch_size);
+size_t traccar_build_osmand_form_body_iov(traccar_client_t* client, const traccar_position_t* pos, const traccar_texts_t* texts,
+                                          traccar_iovec_t iov[2], char* scratch, size_t scratch_size);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -67,7 +342,6 @@ size_t traccar_build_osmand_form_body(traccar_client_t* client, const traccar_po
 #include <Arduino.h>
 #include <time.h>
 
- 
 
 struct TraccarPosition {
   double latitude;
@@ -99,6 +373,9 @@ class TraccarClient {
 public:
   TraccarClient();
   TraccarClient(const String& hostUrl, uint16_t port, const String& deviceId);
+  TraccarClient(const TraccarClient& other);
+  TraccarClient& operator=(const TraccarClient& other);
+  ~TraccarClient();
 
   void setHost(const String& hostUrl);
   void setPort(uint16_t port);
@@ -111,18 +388,18 @@ public:
   bool sendJson(const TraccarPosition& pos, int* outHttpCode = nullptr) const;
   bool sendOsmAndForm(const TraccarPosition& pos, int* outHttpCode = nullptr) const;
 
+  traccar_stats_t getStats() const;
+  void resetStats();
+
+  bool setTrace(size_t capacity); // see traccar_set_trace
+  size_t getSpans(traccar_span_t* out, size_t max) const;
+
   String buildOsmAndUrl(const TraccarPosition& pos) const;
 
 private:
-  String makeBaseUrl() const; // host[:port][basePath]
-  static String formatIso8601(uint64_t epochMs);
-
-  String _host;      // with schema, e.g. "http://example.com"
-  uint16_t _port;    // e.g. 5055
-  String _deviceId;  // device id string
-  String _basePath;  // usually "/"
-  bool _debug;
-  uint16_t _connectTimeoutMs;
+  bool ready() const; // host and device id configured
+
+  traccar_client_t* _core; // configuration, cached request prefixes and connection
 };
 
  
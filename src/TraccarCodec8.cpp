@@ -0,0 +1,224 @@
+#include "TraccarCodec8.h"
+#include "TraccarInternal.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TR_C8_HEADER   10 // preamble, data length, codec id, record count
+#define TR_C8_TRAILER  5  // record count, CRC
+#define TR_C8_RECORD   40 // largest record: 30 bytes + battery, HDOP and odometer elements
+
+static inline uint8_t* tr_be16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; return p + 2; }
+static inline uint8_t* tr_be32(uint8_t* p, uint32_t v) { p = tr_be16(p, (uint16_t)(v >> 16)); return tr_be16(p, (uint16_t)v); }
+static inline uint8_t* tr_be64(uint8_t* p, uint64_t v) { p = tr_be32(p, (uint32_t)(v >> 32)); return tr_be32(p, (uint32_t)v); }
+
+// CRC-16/IBM (poly 0xA001 reflected, init 0) over codec id .. second record count, a nibble at a
+// time: 32 bytes of table instead of 512, at a quarter of the bitwise loop's steps
+static const uint16_t kCrc16Nibble[16] = {
+  0x0000, 0xCC01, 0xD801, 0x1400, 0xF001, 0x3C00, 0x2800, 0xE401,
+  0xA001, 0x6C00, 0x7800, 0xB401, 0x5000, 0x9C01, 0x8801, 0x4400,
+};
+
+static uint16_t tr_crc16_ibm(const uint8_t* p, size_t n) {
+  uint16_t crc = 0;
+  while (n--) {
+    crc ^= *p++;
+    crc = (uint16_t)((crc >> 4) ^ kCrc16Nibble[crc & 0x0F]);
+    crc = (uint16_t)((crc >> 4) ^ kCrc16Nibble[crc & 0x0F]);
+  }
+  return crc;
+}
+
+static long long tr_c8_round(double v, long long lo, long long hi) {
+  if (isnan(v)) return 0;
+  long long r = llround(v);
+  return r < lo ? lo : r > hi ? hi : r;
+}
+
+// Degrees in [0, 360): fmod keeps the sign, and 359.6 rounds to 0 rather than 360
+static uint16_t tr_c8_angle(double h) {
+  if (!isfinite(h)) return 0;
+  h = fmod(h, 360.0);
+  if (h < 0) h += 360.0;
+  long long r = llround(h);
+  return (uint16_t)(r >= 360 ? r - 360 : r);
+}
+
+// Writes one AVL record; out must hold TR_C8_RECORD bytes. Returns the end of the record.
+static uint8_t* tr_c8_record(const traccar_position_t* p, uint8_t* out) {
+  bool has_fix = !isnan(p->latitude) && !isnan(p->longitude);
+  uint64_t ts = p->timestampMs ? p->timestampMs : tr_now_ms_or_0();
+  out = tr_be64(out, ts);
+  *out++ = 0; // priority: low
+  out = tr_be32(out, has_fix ? (uint32_t)(int32_t)lround(p->longitude * 1e7) : 0);
+  out = tr_be32(out, has_fix ? (uint32_t)(int32_t)lround(p->latitude * 1e7) : 0);
+  out = tr_be16(out, (uint16_t)(int16_t)tr_c8_round(p->altitudeMeters, -32768, 32767));
+  out = tr_be16(out, tr_c8_angle(p->headingDeg));
+  *out++ = (has_fix && p->validFlag != 0) ? TRACCAR_CODEC8_SATELLITES : 0;
+  out = tr_be16(out, (uint16_t)tr_c8_round(p->speedKmh, 0, 65535));
+
+  bool battery = p->batteryPercent >= 0, hdop = !isnan(p->hdop), odometer = !isnan(p->odometer);
+  *out++ = 0; // event IO id: periodic record
+  *out++ = (uint8_t)(battery + hdop + odometer);
+  *out++ = battery;
+  if (battery) { *out++ = 113; *out++ = (uint8_t)(p->batteryPercent > 100 ? 100 : p->batteryPercent); }
+  *out++ = hdop;
+  if (hdop) { *out++ = 182; out = tr_be16(out, (uint16_t)tr_c8_round(p->hdop * 10.0, 0, 65535)); }
+  *out++ = odometer;
+  if (odometer) { *out++ = 16; out = tr_be32(out, (uint32_t)tr_c8_round(p->odometer, 0, 0xFFFFFFFFLL)); }
+  *out++ = 0; // no 8-byte elements
+  return out;
+}
+
+size_t traccar_codec8_build_login(const char* imei, uint8_t* out, size_t out_size) {
+  size_t len = imei ? strlen(imei) : 0;
+  if (!out || len == 0 || len > 0xFFFF || out_size < len + 2) return 0;
+  tr_be16(out, (uint16_t)len);
+  memcpy(out + 2, imei, len);
+  return len + 2;
+}
+
+size_t traccar_codec8_build_packet(const traccar_position_t* positions, size_t n, uint8_t* out,
+                                   size_t out_size, size_t* out_count) {
+  if (out_count) *out_count = 0;
+  if (!positions || !out || out_size < TR_C8_HEADER + TR_C8_TRAILER) return 0;
+  uint8_t* p = out + TR_C8_HEADER;
+  uint8_t* end = out + out_size - TR_C8_TRAILER;
+  size_t count = 0;
+  uint8_t rec[TR_C8_RECORD];
+  for (; count < n && count < 255; ++count) {
+    size_t len = (size_t)(tr_c8_record(&positions[count], rec) - rec);
+    if ((size_t)(end - p) < len) break;
+    memcpy(p, rec, len);
+    p += len;
+  }
+  if (count == 0) return 0;
+  *p++ = (uint8_t)count;
+  tr_be32(out, 0);
+  tr_be32(out + 4, (uint32_t)(p - (out + 8)));
+  out[8] = 0x08;
+  out[9] = (uint8_t)count;
+  p = tr_be32(p, tr_crc16_ibm(out + 8, (size_t)(p - (out + 8))));
+  if (out_count) *out_count = count;
+  return (size_t)(p - out);
+}
+
+#if TRACCAR_HAVE_POSIX
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+struct traccar_codec8_s {
+  char* name;
+  uint16_t port;
+  uint16_t timeout_ms;
+  int fd;
+  uint8_t login[2 + 64];
+  size_t login_len;
+};
+
+traccar_codec8_t* traccar_codec8_create(const char* host_url, uint16_t port, const char* imei) {
+  traccar_codec8_t* s = (traccar_codec8_t*)calloc(1, sizeof(*s));
+  if (!s) return nullptr;
+  s->fd = -1;
+  s->timeout_ms = 5000;
+  s->login_len = traccar_codec8_build_login(imei, s->login, sizeof(s->login));
+  const char* h = host_url ? host_url : "";
+  const char* scheme = strstr(h, "://");
+  if (scheme) h = scheme + 3;
+  size_t hn = strcspn(h, ":/");
+  s->port = port ? port : (h[hn] == ':') ? (uint16_t)atoi(h + hn + 1) : 5027;
+  s->name = (char*)malloc(hn + 1);
+  if (!s->name || hn == 0 || s->login_len == 0) { traccar_codec8_destroy(s); return nullptr; }
+  memcpy(s->name, h, hn);
+  s->name[hn] = '\0';
+  return s;
+}
+
+void traccar_codec8_destroy(traccar_codec8_t* s) {
+  if (!s) return;
+  traccar_codec8_disconnect(s);
+  free(s->name);
+  free(s);
+}
+
+void traccar_codec8_set_timeout_ms(traccar_codec8_t* s, uint16_t timeout_ms) {
+  if (s) s->timeout_ms = timeout_ms;
+}
+
+void traccar_codec8_disconnect(traccar_codec8_t* s) {
+  if (!s || s->fd < 0) return;
+  close(s->fd);
+  s->fd = -1;
+}
+
+// Reads exactly n bytes; *got receives how many arrived. Returns 0 or a TRACCAR_HTTP_ERROR_* code.
+static int tr_c8_read(int fd, uint8_t* out, size_t n, size_t* got) {
+  *got = 0;
+  while (*got < n) {
+    ssize_t r = recv(fd, out + *got, n - *got, 0);
+    if (r > 0) { *got += (size_t)r; continue; }
+    if (r < 0 && errno == EINTR) continue;
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return TRACCAR_HTTP_ERROR_READ_TIMEOUT;
+    return TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+  }
+  return 0;
+}
+
+static int tr_c8_login(traccar_codec8_t* s) {
+  s->fd = tr_connect(s->name, s->port, s->timeout_ms);
+  if (s->fd < 0) return TRACCAR_HTTP_ERROR_CONNECTION_REFUSED;
+  struct iovec iov = { s->login, s->login_len };
+  uint8_t reply;
+  size_t got;
+  int err = tr_write_all(s->fd, &iov, 1) ? tr_c8_read(s->fd, &reply, 1, &got) : TRACCAR_HTTP_ERROR_SEND_FAILED;
+  if (err == 0 && reply != 0x01) err = TRACCAR_HTTP_ERROR_CONNECTION_REFUSED;
+  if (err != 0) traccar_codec8_disconnect(s);
+  return err;
+}
+
+// Sends one packet and returns the acknowledged record count, or a negative error. A connection
+// that was idle may have been closed by the server: if it fails before any acknowledgement byte
+// arrives, the packet is sent once more on a fresh connection.
+static long tr_c8_exchange(traccar_codec8_t* s, const uint8_t* packet, size_t len) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    bool reused = s->fd >= 0;
+    if (!reused) {
+      int err = tr_c8_login(s);
+      if (err) return err;
+    }
+    struct iovec iov = { (void*)packet, len };
+    uint8_t ack[4];
+    size_t got = 0;
+    int err = tr_write_all(s->fd, &iov, 1) ? tr_c8_read(s->fd, ack, sizeof(ack), &got)
+                                            : TRACCAR_HTTP_ERROR_SEND_FAILED;
+    if (err == 0) return (long)((uint32_t)ack[0] << 24 | (uint32_t)ack[1] << 16 | (uint32_t)ack[2] << 8 | ack[3]);
+    traccar_codec8_disconnect(s);
+    if (!reused || got > 0 || err == TRACCAR_HTTP_ERROR_READ_TIMEOUT) return err;
+  }
+  return TRACCAR_HTTP_ERROR_CONNECTION_LOST;
+}
+
+size_t traccar_codec8_send(traccar_codec8_t* s, const traccar_position_t* positions, size_t n, int* out_error) {
+  if (out_error) *out_error = 0;
+  if (!s || !positions) {
+    if (out_error && n) *out_error = TRACCAR_HTTP_ERROR_SEND_FAILED;
+    return 0;
+  }
+  uint8_t packet[TRACCAR_CODEC8_PACKET_SIZE];
+  size_t sent = 0;
+  while (sent < n) {
+    size_t count;
+    size_t len = traccar_codec8_build_packet(positions + sent, n - sent, packet, sizeof(packet), &count);
+    long acked = len ? tr_c8_exchange(s, packet, len) : TRACCAR_HTTP_ERROR_SEND_FAILED;
+    if (acked < 0) { if (out_error) *out_error = (int)acked; break; }
+    // The server names how many records it took; the rest of the packet goes out again
+    sent += (size_t)acked < count ? (size_t)acked : count;
+    if (acked == 0) { if (out_error) *out_error = TRACCAR_HTTP_ERROR_SEND_FAILED; break; }
+  }
+  return sent;
+}
+
+#endif // TRACCAR_HAVE_POSIX
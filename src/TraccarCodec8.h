@@ -0,0 +1,58 @@
+#ifndef TRACCAR_CODEC8_H
+#define TRACCAR_CODEC8_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Teltonika Codec 8 binary protocol (Traccar's "teltonika" port, 5027 by default)
+//
+// Positions travel as AVL records over a raw TCP connection: the device logs in once with its
+// IMEI, then sends packets of up to 255 records and the server answers each packet with the
+// number of records it accepted. A record carries time, coordinates, altitude, heading and speed
+// in 30 bytes plus these IO elements when the position has them:
+//   113 battery %, 182 HDOP (x10), 16 odometer (m)
+// String fields (driver, cell, wifi, event, activity), accuracy and charging are not carried.
+// Satellites are unknown, so the record reports 0 for invalid or coordinate-less fixes (the
+// server then marks the position invalid) and TRACCAR_CODEC8_SATELLITES otherwise.
+
+#ifndef TRACCAR_CODEC8_SATELLITES
+#define TRACCAR_CODEC8_SATELLITES 4
+#endif
+
+// Largest packet the sender builds; Teltonika servers accept at least 1280 bytes
+#ifndef TRACCAR_CODEC8_PACKET_SIZE
+#define TRACCAR_CODEC8_PACKET_SIZE 1280
+#endif
+
+// Utility: build the login message (2-byte length + IMEI); 0 if it does not fit
+size_t traccar_codec8_build_login(const char* imei, uint8_t* out, size_t out_size);
+// Utility: build one AVL data packet with as many leading positions as fit (at most 255);
+// *out_count (optional) receives how many. Returns the packet length, 0 if none fit.
+size_t traccar_codec8_build_packet(const traccar_position_t* positions, size_t n, uint8_t* out,
+                                   size_t out_size, size_t* out_count);
+
+// Persistent sender (POSIX builds only)
+typedef struct traccar_codec8_s traccar_codec8_t;
+
+// host_url may carry a scheme and port ("tcp://host:5027"); port 0 keeps the one in host_url
+traccar_codec8_t* traccar_codec8_create(const char* host_url, uint16_t port, const char* imei);
+void traccar_codec8_destroy(traccar_codec8_t* sender);
+void traccar_codec8_set_timeout_ms(traccar_codec8_t* sender, uint16_t timeout_ms);
+// Closes the connection (if any); the next send reconnects and logs in again
+void traccar_codec8_disconnect(traccar_codec8_t* sender);
+
+// Sends n positions in as few packets as possible and waits for each acknowledgement. Returns
+// how many leading positions the server accepted; *out_error (optional) receives 0 when all of
+// them were, otherwise a negative TRACCAR_HTTP_ERROR_* code (CONNECTION_REFUSED if the server
+// rejected the IMEI).
+size_t traccar_codec8_send(traccar_codec8_t* sender, const traccar_position_t* positions, size_t n,
+                           int* out_error);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_CODEC8_H
@@ -0,0 +1,113 @@
+#include "TraccarFilter.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#define TR_EARTH_RADIUS_M   6371008.8
+#define TR_DEG_TO_RAD       0.017453292519943295
+#define TR_TURN_MIN_KMH     5.0 // headings below this speed are GPS noise
+
+struct traccar_filter_s {
+  double max_error_m;
+  double heading_threshold;
+  uint32_t max_interval_ms;
+  // Last reported fix
+  bool has_ref;
+  double lat, lon;
+  double speed_ms;   // 0 when unknown
+  double heading;    // degrees; NAN when unknown
+  uint64_t time_ms;
+};
+
+// Longitude difference or position into [-180, 180]
+static double tr_wrap_lon(double d) {
+  d = fmod(d + 180.0, 360.0);
+  return (d < 0.0 ? d + 360.0 : d) - 180.0;
+}
+
+// Distance on a local equirectangular projection; accurate to well under 1% at filter scales,
+// also across the antimeridian
+static double tr_distance_m(double lat1, double lon1, double lat2, double lon2) {
+  double x = tr_wrap_lon(lon2 - lon1) * TR_DEG_TO_RAD * cos((lat1 + lat2) * 0.5 * TR_DEG_TO_RAD);
+  double y = (lat2 - lat1) * TR_DEG_TO_RAD;
+  return sqrt(x * x + y * y) * TR_EARTH_RADIUS_M;
+}
+
+static double tr_heading_delta(double a, double b) {
+  double d = fmod(fabs(a - b), 360.0);
+  return d > 180.0 ? 360.0 - d : d;
+}
+
+traccar_filter_t* traccar_filter_create(double max_error_m, uint32_t max_interval_ms) {
+  traccar_filter_t* f = (traccar_filter_t*)calloc(1, sizeof(*f));
+  if (!f) return nullptr;
+  f->max_error_m = max_error_m;
+  f->max_interval_ms = max_interval_ms;
+  f->heading_threshold = 30.0;
+  return f;
+}
+
+void traccar_filter_destroy(traccar_filter_t* f) {
+  free(f);
+}
+
+void traccar_filter_set_max_error(traccar_filter_t* f, double max_error_m) {
+  if (!f) return;
+  f->max_error_m = max_error_m;
+}
+
+void traccar_filter_set_max_interval(traccar_filter_t* f, uint32_t max_interval_ms) {
+  if (!f) return;
+  f->max_interval_ms = max_interval_ms;
+}
+
+void traccar_filter_set_heading_threshold(traccar_filter_t* f, double degrees) {
+  if (!f) return;
+  f->heading_threshold = degrees;
+}
+
+void traccar_filter_reset(traccar_filter_t* f) {
+  if (!f) return;
+  f->has_ref = false;
+}
+
+static bool tr_filter_keep(traccar_filter_t* f, const traccar_position_t* pos, uint64_t t) {
+  f->has_ref = true;
+  f->lat = pos->latitude;
+  f->lon = pos->longitude;
+  f->speed_ms = isnan(pos->speedKmh) ? 0.0 : pos->speedKmh / 3.6;
+  if (!isnan(pos->headingDeg)) f->heading = pos->headingDeg;
+  else if (f->speed_ms == 0.0) f->heading = NAN;
+  f->time_ms = t;
+  return true;
+}
+
+bool traccar_filter_accept(traccar_filter_t* f, const traccar_position_t* pos) {
+  if (!f || !pos) return true;
+  if (isnan(pos->latitude) || isnan(pos->longitude)) return true;
+  uint64_t t = pos->timestampMs ? pos->timestampMs : (uint64_t)time(nullptr) * 1000ULL;
+  if (!f->has_ref || t < f->time_ms) return tr_filter_keep(f, pos, t);
+  if (pos->eventName && *pos->eventName) return tr_filter_keep(f, pos, t);
+  uint64_t dt_ms = t - f->time_ms;
+  if (f->max_interval_ms && dt_ms >= f->max_interval_ms) return tr_filter_keep(f, pos, t);
+
+  // Where the last report says we should be now
+  double lat = f->lat, lon = f->lon;
+  if (f->speed_ms > 0.0 && !isnan(f->heading)) {
+    double d = f->speed_ms * (double)dt_ms / 1000.0 / TR_EARTH_RADIUS_M;
+    double h = f->heading * TR_DEG_TO_RAD;
+    double c = cos(f->lat * TR_DEG_TO_RAD);
+    if (c < 0.01) c = 0.01; // near the poles
+    lat += d * cos(h) / TR_DEG_TO_RAD;
+    lon = tr_wrap_lon(lon + d * sin(h) / (TR_DEG_TO_RAD * c));
+  }
+  if (tr_distance_m(lat, lon, pos->latitude, pos->longitude) > f->max_error_m) return tr_filter_keep(f, pos, t);
+
+  if (!isnan(f->heading_threshold) && !isnan(f->heading) && !isnan(pos->headingDeg) &&
+      !isnan(pos->speedKmh) && pos->speedKmh >= TR_TURN_MIN_KMH &&
+      tr_heading_delta(f->heading, pos->headingDeg) > f->heading_threshold) {
+    return tr_filter_keep(f, pos, t);
+  }
+  return false;
+}
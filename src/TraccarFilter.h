@@ -0,0 +1,39 @@
+#ifndef TRACCAR_FILTER_H
+#define TRACCAR_FILTER_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reporting filter: decides which fixes are worth uploading
+//
+// The filter dead-reckons from the last reported fix (its position, speed and heading) and lets a
+// new fix through only when it is farther than max_error_m from that prediction, when the heading
+// turned by more than the heading threshold, when it carries an event, or when max_interval_ms
+// passed since the last report (heartbeat). Parked or steadily moving vehicles therefore report
+// rarely, turns and speed changes immediately. State is a few numbers; each fix is O(1).
+//
+//   if (traccar_filter_accept(filter, &pos)) traccar_send_osmand(client, &pos, &code);
+typedef struct traccar_filter_s traccar_filter_t;
+
+traccar_filter_t* traccar_filter_create(double max_error_m, uint32_t max_interval_ms);
+void traccar_filter_destroy(traccar_filter_t* filter);
+
+void traccar_filter_set_max_error(traccar_filter_t* filter, double max_error_m);
+void traccar_filter_set_max_interval(traccar_filter_t* filter, uint32_t max_interval_ms); // 0 = no heartbeat
+void traccar_filter_set_heading_threshold(traccar_filter_t* filter, double degrees);      // default 30; NAN = off
+
+// Returns true when pos should be sent, and then takes it as the new reference. Fixes without
+// coordinates always pass and leave the reference unchanged. Times come from timestampMs (the
+// wall clock when 0).
+bool traccar_filter_accept(traccar_filter_t* filter, const traccar_position_t* pos);
+// Forgets the reference: the next fix is always accepted (e.g. after a failed upload)
+void traccar_filter_reset(traccar_filter_t* filter);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_FILTER_H
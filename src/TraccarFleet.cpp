@@ -0,0 +1,288 @@
+#include "TraccarFleet.h"
+#include "TraccarInternal.h"
+
+#if TRACCAR_HAVE_POSIX
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Interned devices live in fixed-size chunks that never move, so a handle can be resolved without
+// locking while other threads register new ids. Only registration and the id lookup table take
+// the lock.
+#define TR_FLEET_CHUNK      256
+#define TR_FLEET_CHUNKS     ((TRACCAR_FLEET_MAX_DEVICES + TR_FLEET_CHUNK - 1) / TR_FLEET_CHUNK)
+#define TR_FLEET_ARENA      16384 // string block size
+#define TR_FLEET_BODY_SIZE  (TRACCAR_JSON_BODY_SIZE + 256)
+
+typedef struct tr_device_s {
+  const char* id;        // as registered
+  const char* form;      // "id=<url-encoded id>"
+  const char* json;      // {"id":"<escaped id>"
+  uint16_t form_len;
+  uint16_t json_len;
+  uint32_t hash;
+} tr_device_t;
+
+typedef struct tr_arena_s {
+  struct tr_arena_s* next;
+  size_t used, size;
+  char data[1];
+} tr_arena_t;
+
+struct traccar_fleet_s {
+  // Connection pool: each pooled client owns one keep-alive connection
+  traccar_client_t** clients;
+  size_t pool_size;
+  size_t* idle;          // stack of idle client indices
+  size_t idle_count;
+  pthread_mutex_t pool_lock;
+  pthread_cond_t pool_cond;
+  size_t trace_cap;      // spans per pooled client, 0 when not tracing
+
+  // Interned devices
+  pthread_mutex_t dev_lock;
+  tr_device_t* chunks[TR_FLEET_CHUNKS];
+  uint32_t device_count; // published with release ordering once the entry is complete
+  uint32_t* table;       // open addressing, handle + 1 (0 = empty)
+  uint32_t table_size;   // power of two
+  tr_arena_t* arena;
+};
+
+static uint32_t tr_fnv1a(const char* s) {
+  uint32_t h = 2166136261u;
+  for (; *s; ++s) { h ^= (uint8_t)*s; h *= 16777619u; }
+  return h;
+}
+
+static char* tr_arena_alloc(traccar_fleet_t* f, size_t n) {
+  tr_arena_t* a = f->arena;
+  if (!a || a->size - a->used < n) {
+    size_t size = n > TR_FLEET_ARENA ? n : TR_FLEET_ARENA;
+    a = (tr_arena_t*)malloc(offsetof(tr_arena_t, data) + size);
+    if (!a) return nullptr;
+    a->next = f->arena; a->used = 0; a->size = size;
+    f->arena = a;
+  }
+  char* p = a->data + a->used;
+  a->used += n;
+  return p;
+}
+
+static inline tr_device_t* tr_fleet_entry(const traccar_fleet_t* f, uint32_t handle) {
+  return &f->chunks[handle / TR_FLEET_CHUNK][handle % TR_FLEET_CHUNK];
+}
+
+static bool tr_fleet_grow_table(traccar_fleet_t* f) {
+  uint32_t size = f->table_size ? f->table_size * 2 : 1024;
+  uint32_t* t = (uint32_t*)calloc(size, sizeof(*t));
+  if (!t) return false;
+  for (uint32_t i = 0; i < f->device_count; ++i) {
+    uint32_t s = tr_fleet_entry(f, i)->hash & (size - 1);
+    while (t[s]) s = (s + 1) & (size - 1);
+    t[s] = i + 1;
+  }
+  free(f->table);
+  f->table = t;
+  f->table_size = size;
+  return true;
+}
+
+traccar_fleet_t* traccar_fleet_create(const char* host_url, uint16_t port, size_t pool_size) {
+  if (pool_size == 0) pool_size = 1;
+  traccar_fleet_t* f = (traccar_fleet_t*)calloc(1, sizeof(*f));
+  if (!f) return nullptr;
+  pthread_mutex_init(&f->pool_lock, nullptr);
+  pthread_cond_init(&f->pool_cond, nullptr);
+  pthread_mutex_init(&f->dev_lock, nullptr);
+  f->clients = (traccar_client_t**)calloc(pool_size, sizeof(*f->clients));
+  f->idle = (size_t*)calloc(pool_size, sizeof(*f->idle));
+  if (!f->clients || !f->idle) { traccar_fleet_destroy(f); return nullptr; }
+  f->pool_size = pool_size;
+  for (size_t i = 0; i < pool_size; ++i) {
+    f->clients[i] = traccar_create(host_url, port, "");
+    if (!f->clients[i]) { traccar_fleet_destroy(f); return nullptr; }
+    f->idle[f->idle_count++] = i;
+  }
+  return f;
+}
+
+void traccar_fleet_destroy(traccar_fleet_t* f) {
+  if (!f) return;
+  for (size_t i = 0; f->clients && i < f->pool_size; ++i) traccar_destroy(f->clients[i]);
+  for (size_t i = 0; i < TR_FLEET_CHUNKS; ++i) free(f->chunks[i]);
+  while (f->arena) { tr_arena_t* next = f->arena->next; free(f->arena); f->arena = next; }
+  free(f->table);
+  free(f->clients);
+  free(f->idle);
+  pthread_mutex_destroy(&f->pool_lock);
+  pthread_cond_destroy(&f->pool_cond);
+  pthread_mutex_destroy(&f->dev_lock);
+  free(f);
+}
+
+void traccar_fleet_set_base_path(traccar_fleet_t* f, const char* base_path) {
+  if (!f) return;
+  for (size_t i = 0; i < f->pool_size; ++i) traccar_set_base_path(f->clients[i], base_path);
+}
+
+void traccar_fleet_set_timeout_ms(traccar_fleet_t* f, uint16_t timeout_ms) {
+  if (!f) return;
+  for (size_t i = 0; i < f->pool_size; ++i) traccar_set_timeout_ms(f->clients[i], timeout_ms);
+}
+
+// Builds the encoded forms of a new id into the arena; called with dev_lock held
+static bool tr_fleet_add(traccar_fleet_t* f, const char* device_id, uint32_t hash, uint32_t handle) {
+  char tmp[1024];
+  size_t idx = 0, form_len, json_len;
+  tmp[0] = '\0';
+  tr_append_n(tmp, sizeof(tmp), &idx, "id=", 3);
+  tr_append_urlenc(tmp, sizeof(tmp), &idx, device_id);
+  form_len = idx;
+  tr_append_n(tmp, sizeof(tmp), &idx, "{\"id\":\"", 7);
+  tr_append_json_str(tmp, sizeof(tmp), &idx, device_id);
+  tr_append_n(tmp, sizeof(tmp), &idx, "\"", 1);
+  json_len = idx - form_len;
+  if (idx + 1 >= sizeof(tmp)) return false; // id too long
+  size_t id_len = strlen(device_id);
+  char* p = tr_arena_alloc(f, id_len + 1 + idx);
+  if (!p) return false;
+
+  tr_device_t** chunk = &f->chunks[handle / TR_FLEET_CHUNK];
+  if (!*chunk && !(*chunk = (tr_device_t*)calloc(TR_FLEET_CHUNK, sizeof(tr_device_t)))) return false;
+  tr_device_t* d = &(*chunk)[handle % TR_FLEET_CHUNK];
+  memcpy(p, device_id, id_len + 1);
+  memcpy(p + id_len + 1, tmp, idx);
+  d->id = p;
+  d->form = p + id_len + 1; d->form_len = (uint16_t)form_len;
+  d->json = d->form + form_len; d->json_len = (uint16_t)json_len;
+  d->hash = hash;
+  return true;
+}
+
+traccar_device_t traccar_fleet_device(traccar_fleet_t* f, const char* device_id) {
+  if (!f || !device_id || !*device_id) return TRACCAR_NO_DEVICE;
+  uint32_t hash = tr_fnv1a(device_id);
+  traccar_device_t handle = TRACCAR_NO_DEVICE;
+  pthread_mutex_lock(&f->dev_lock);
+  uint32_t mask = f->table_size - 1;
+  for (uint32_t s = hash & mask; f->table_size && f->table[s]; s = (s + 1) & mask) {
+    const tr_device_t* d = tr_fleet_entry(f, f->table[s] - 1);
+    if (d->hash == hash && strcmp(d->id, device_id) == 0) { handle = f->table[s] - 1; break; }
+  }
+  uint32_t n = f->device_count;
+  // New id: the table is kept at most half full
+  if (handle == TRACCAR_NO_DEVICE && n < TRACCAR_FLEET_MAX_DEVICES &&
+      ((n + 1) * 2 <= f->table_size || tr_fleet_grow_table(f)) && tr_fleet_add(f, device_id, hash, n)) {
+    mask = f->table_size - 1;
+    uint32_t s = hash & mask;
+    while (f->table[s]) s = (s + 1) & mask;
+    f->table[s] = n + 1;
+    __atomic_store_n(&f->device_count, n + 1, __ATOMIC_RELEASE);
+    handle = n;
+  }
+  pthread_mutex_unlock(&f->dev_lock);
+  return handle;
+}
+
+// Borrows an idle pooled client, waiting while all of them are busy
+static size_t tr_fleet_acquire(traccar_fleet_t* f) {
+  pthread_mutex_lock(&f->pool_lock);
+  while (f->idle_count == 0) pthread_cond_wait(&f->pool_cond, &f->pool_lock);
+  size_t i = f->idle[--f->idle_count];
+  pthread_mutex_unlock(&f->pool_lock);
+  return i;
+}
+
+static void tr_fleet_release(traccar_fleet_t* f, size_t i) {
+  pthread_mutex_lock(&f->pool_lock);
+  f->idle[f->idle_count++] = i;
+  pthread_cond_signal(&f->pool_cond);
+  pthread_mutex_unlock(&f->pool_lock);
+}
+
+bool traccar_fleet_send(traccar_fleet_t* f, traccar_device_t device, traccar_format_t format,
+                        const traccar_position_t* pos, int* out_http_code) {
+  if (!f || !pos || device >= __atomic_load_n(&f->device_count, __ATOMIC_ACQUIRE)) {
+    if (out_http_code) *out_http_code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+    return false;
+  }
+  const tr_device_t* d = tr_fleet_entry(f, device);
+  size_t slot = tr_fleet_acquire(f);
+  traccar_client_t* c = f->clients[slot];
+  // Only the position fields are encoded; the device's cached id prefix is written from where it is.
+  // Fields too long for the stack (long wifi/cell lists) go to the pooled client's batch buffer,
+  // which is kept, so they cost one allocation per pool client rather than one per send.
+  char stack[TR_FLEET_BODY_SIZE];
+  char* buf = stack;
+  size_t idx = 0;
+  tr_append_fields(format, pos, buf, sizeof(stack), &idx);
+  if (idx >= sizeof(stack)) {
+    size_t n = idx;
+    buf = tr_client_scratch(c, n + 1);
+    if (!buf) { // not sent cut short
+      tr_stat_request(c, format == TRACCAR_FORMAT_JSON ? TRACCAR_STATS_JSON : TRACCAR_STATS_OSMAND, 1, 0, true);
+      tr_fleet_release(f, slot);
+      if (out_http_code) *out_http_code = TRACCAR_HTTP_ERROR_TRUNCATED;
+      return false;
+    }
+    idx = 0;
+    tr_append_fields(format, pos, buf, n + 1, &idx);
+  }
+  const char* path = tr_request_path(c);
+  int code;
+  uint64_t t0 = tr_trace_begin(c, format == TRACCAR_FORMAT_JSON ? TRACCAR_STATS_JSON : TRACCAR_STATS_OSMAND);
+  if (format == TRACCAR_FORMAT_JSON) {
+    struct iovec target = { (void*)path, strlen(path) };
+    struct iovec body[3] = { { (void*)d->json, d->json_len }, { buf, idx }, { (void*)"}", 1 } };
+    tr_stat_request(c, TRACCAR_STATS_JSON, 1, d->json_len + idx + 1, false);
+    code = tr_http_request_v(c, "POST", &target, 1, "application/json", body, 3);
+  } else {
+    struct iovec target[4] = { { (void*)path, strlen(path) }, { (void*)"?", 1 }, { (void*)d->form, d->form_len }, { buf, idx } };
+    tr_stat_request(c, TRACCAR_STATS_OSMAND, 1, target[0].iov_len + 1 + d->form_len + idx, false);
+    code = tr_http_request_v(c, "GET", target, 4, nullptr, nullptr, 0);
+  }
+  tr_trace_send(c, t0, code);
+  tr_fleet_release(f, slot);
+  if (out_http_code) *out_http_code = code;
+  return code == 200;
+}
+
+void traccar_fleet_get_stats(traccar_fleet_t* f, traccar_stats_t* out) {
+  if (!out) return;
+  memset(out, 0, sizeof(*out));
+  for (size_t i = 0; f && i < f->pool_size; ++i) {
+    traccar_stats_t s;
+    traccar_get_stats(f->clients[i], &s);
+    traccar_stats_merge(out, &s);
+  }
+}
+
+bool traccar_fleet_set_trace(traccar_fleet_t* f, size_t capacity) {
+  if (!f) return false;
+  f->trace_cap = 0;
+  for (size_t i = 0; i < f->pool_size; ++i) {
+    if (traccar_set_trace(f->clients[i], capacity)) continue;
+    for (size_t k = 0; k < i; ++k) traccar_set_trace(f->clients[k], 0);
+    return false;
+  }
+  f->trace_cap = capacity;
+  return true;
+}
+
+size_t traccar_fleet_trace_export_chrome(traccar_fleet_t* f, char* out, size_t out_size) {
+  tr_chrome_t d;
+  tr_chrome_begin(&d, out, out_size);
+  traccar_span_t* spans = f && f->trace_cap ? (traccar_span_t*)malloc(f->trace_cap * sizeof(traccar_span_t)) : nullptr;
+  for (size_t i = 0; spans && i < f->pool_size; ++i)
+    tr_chrome_events(&d, spans, traccar_get_spans(f->clients[i], spans, f->trace_cap), (uint32_t)i + 1);
+  free(spans);
+  return tr_chrome_end(&d);
+}
+
+bool traccar_fleet_send_id(traccar_fleet_t* f, const char* device_id, traccar_format_t format,
+                           const traccar_position_t* pos, int* out_http_code) {
+  return traccar_fleet_send(f, traccar_fleet_device(f, device_id), format, pos, out_http_code);
+}
+
+#endif // TRACCAR_HAVE_POSIX
@@ -0,0 +1,57 @@
+#ifndef TRACCAR_FLEET_H
+#define TRACCAR_FLEET_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fleet gateway mode (POSIX builds only)
+//
+// One fleet relays positions for any number of devices over a bounded pool of keep-alive
+// connections. Device ids are interned once: the URL-encoded and JSON-escaped forms are built at
+// registration and each device costs a table entry plus those strings, not a whole client.
+// Sends are thread-safe; each one borrows an idle connection from the pool (waiting for one if
+// all are busy), so up to pool_size requests run in parallel.
+typedef struct traccar_fleet_s traccar_fleet_t;
+typedef uint32_t traccar_device_t;
+
+#define TRACCAR_NO_DEVICE ((traccar_device_t)0xFFFFFFFFu)
+
+#ifndef TRACCAR_FLEET_MAX_DEVICES
+#define TRACCAR_FLEET_MAX_DEVICES 65536
+#endif
+
+traccar_fleet_t* traccar_fleet_create(const char* host_url, uint16_t port, size_t pool_size);
+void traccar_fleet_destroy(traccar_fleet_t* fleet);
+
+// Configuration for every pooled connection; call before sending
+void traccar_fleet_set_base_path(traccar_fleet_t* fleet, const char* base_path);
+void traccar_fleet_set_timeout_ms(traccar_fleet_t* fleet, uint16_t timeout_ms);
+
+// Returns the handle of device_id, registering it on first use; TRACCAR_NO_DEVICE when the id
+// is empty or the table is full. Handles stay valid for the lifetime of the fleet.
+traccar_device_t traccar_fleet_device(traccar_fleet_t* fleet, const char* device_id);
+
+// Sends one position for a registered device (OsmAnd GET or JSON POST)
+bool traccar_fleet_send(traccar_fleet_t* fleet, traccar_device_t device, traccar_format_t format,
+                        const traccar_position_t* pos, int* out_http_code);
+// Same, looking the device up by id
+bool traccar_fleet_send_id(traccar_fleet_t* fleet, const char* device_id, traccar_format_t format,
+                           const traccar_position_t* pos, int* out_http_code);
+
+// Statistics of all pooled connections together (see traccar_get_stats)
+void traccar_fleet_get_stats(traccar_fleet_t* fleet, traccar_stats_t* out);
+
+// Tracing of every pooled connection, capacity spans each (see traccar_set_trace); the export
+// puts each connection on its own Chrome trace thread and is cut to fit like
+// traccar_trace_export_chrome. Neither may run while sends are running.
+bool traccar_fleet_set_trace(traccar_fleet_t* fleet, size_t capacity);
+size_t traccar_fleet_trace_export_chrome(traccar_fleet_t* fleet, char* out, size_t out_size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_FLEET_H
@@ -0,0 +1,353 @@
+#include "TraccarGeofence.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TR_EARTH_RADIUS_M   6371008.8
+#define TR_DEG_TO_RAD       0.017453292519943295
+#define TR_M_PER_DEG        (TR_EARTH_RADIUS_M * TR_DEG_TO_RAD)
+#define TR_GRID_MAX_CELLS   (1u << 20)
+#define TR_GRID_MAX_ITEMS   (1u << 28)
+
+typedef struct tr_fence_s {
+  double min_lat, min_lon, max_lat, max_lon; // bounding box
+  double lat, lon;          // circle centre; polygon origin, from which its vertices are offsets
+  double cos_lat;           // circle: metres per longitude degree over metres per latitude degree
+  double radius_deg;        // circle radius in latitude degrees; 0 for polygons
+  uint32_t id;
+  uint32_t first_point;     // polygon vertices: points[2 * first_point ...], latitude then longitude
+  uint32_t point_count;     // 0 for circles
+  uint32_t enter_name, exit_name; // offsets in names
+} tr_fence_t;
+
+struct traccar_geofence_s {
+  traccar_allocator_t allocator; // alloc == nullptr: malloc/free
+  size_t size;
+  // Grid over the bounding box of all fences
+  double min_lat, min_lon, max_lat, max_lon;
+  double cells_per_lat, cells_per_lon;
+  uint32_t rows, cols;
+  uint32_t count;
+  double hysteresis_m;
+  // Fences the last fix was in (indices)
+  bool primed;
+  uint32_t inside_count;
+  uint32_t inside[TRACCAR_GEOFENCE_MAX_INSIDE];
+  // Sections of the block, in this order after the header
+  tr_fence_t* fences;
+  float* points;            // vertex offsets: float keeps metre precision at fence scale
+  uint32_t* cell_start;     // rows * cols + 1: the fences of cell i are cell_items[start[i] .. start[i + 1])
+  uint32_t* cell_items;
+  char* names;
+};
+
+static inline size_t tr_align8(size_t n) {
+  return (n + 7) & ~(size_t)7;
+}
+
+// Bounding box of a fence definition; false if it is malformed
+static bool tr_fence_bounds(const traccar_fence_t* f, double* min_lat, double* min_lon, double* max_lat, double* max_lon) {
+  if (f->pointCount == 0) {
+    if (!isfinite(f->latitude) || !isfinite(f->longitude) || !(f->radiusMeters > 0)) return false;
+    double r = f->radiusMeters / TR_M_PER_DEG;
+    double c = cos(f->latitude * TR_DEG_TO_RAD);
+    if (c < 0.01) c = 0.01;
+    *min_lat = f->latitude - r; *max_lat = f->latitude + r;
+    *min_lon = f->longitude - r / c; *max_lon = f->longitude + r / c;
+    return true;
+  }
+  if (f->pointCount < 3 || !f->points) return false;
+  *min_lat = *min_lon = INFINITY;
+  *max_lat = *max_lon = -INFINITY;
+  for (size_t i = 0; i < f->pointCount; ++i) {
+    double lat = f->points[2 * i], lon = f->points[2 * i + 1];
+    if (!isfinite(lat) || !isfinite(lon)) return false;
+    if (lat < *min_lat) *min_lat = lat;
+    if (lat > *max_lat) *max_lat = lat;
+    if (lon < *min_lon) *min_lon = lon;
+    if (lon > *max_lon) *max_lon = lon;
+  }
+  return true;
+}
+
+static inline uint32_t tr_grid_index(double v, double min, double cells_per_deg, uint32_t n) {
+  double i = (v - min) * cells_per_deg;
+  if (!(i > 0)) return 0;
+  return i >= n ? n - 1 : (uint32_t)i;
+}
+
+// Grid rows and columns the fence's box overlaps, inclusive
+typedef struct tr_cell_range_s {
+  uint32_t r0, r1, c0, c1;
+} tr_cell_range_t;
+
+static tr_cell_range_t tr_grid_range(const traccar_geofence_t* g, const tr_fence_t* f) {
+  tr_cell_range_t r;
+  r.r0 = tr_grid_index(f->min_lat, g->min_lat, g->cells_per_lat, g->rows);
+  r.r1 = tr_grid_index(f->max_lat, g->min_lat, g->cells_per_lat, g->rows);
+  r.c0 = tr_grid_index(f->min_lon, g->min_lon, g->cells_per_lon, g->cols);
+  r.c1 = tr_grid_index(f->max_lon, g->min_lon, g->cells_per_lon, g->cols);
+  return r;
+}
+
+static const char* tr_event_name(const char* name, bool enter) {
+  return name ? name : enter ? "geofenceEnter" : "geofenceExit";
+}
+
+traccar_geofence_t* traccar_geofence_create(const traccar_fence_t* defs, size_t count,
+                                            const traccar_allocator_t* allocator) {
+  if ((count && !defs) || count > TR_GRID_MAX_ITEMS) return nullptr;
+  // Pass 1: extent, vertices and names, to size the block
+  traccar_geofence_t h;
+  memset(&h, 0, sizeof(h));
+  if (allocator && allocator->alloc) h.allocator = *allocator;
+  h.count = (uint32_t)count;
+  h.min_lat = h.min_lon = INFINITY;
+  h.max_lat = h.max_lon = -INFINITY;
+  size_t points = 0, names = 0;
+  double span = 0; // sum of the fences' box sizes, longitude scaled to latitude degrees
+  for (size_t i = 0; i < count; ++i) {
+    double a, b, c, d;
+    if (!tr_fence_bounds(&defs[i], &a, &b, &c, &d)) return nullptr;
+    h.min_lat = fmin(h.min_lat, a); h.min_lon = fmin(h.min_lon, b);
+    h.max_lat = fmax(h.max_lat, c); h.max_lon = fmax(h.max_lon, d);
+    span += fmax(c - a, (d - b) * cos((a + c) * 0.5 * TR_DEG_TO_RAD));
+    points += defs[i].pointCount;
+    names += strlen(tr_event_name(defs[i].enterEvent, true)) + strlen(tr_event_name(defs[i].exitEvent, false)) + 2;
+  }
+  if (points > TR_GRID_MAX_ITEMS) return nullptr;
+
+  // Square cells on the ground about half an average fence wide, so a fence lands in a few cells
+  // and a cell holds few fences; at most four cells per fence where fences are sparse
+  h.rows = h.cols = 1;
+  if (count) {
+    double ext_lat = fmax(h.max_lat - h.min_lat, 1e-9), ext_lon = fmax(h.max_lon - h.min_lon, 1e-9);
+    double aspect = ext_lon * cos((h.min_lat + h.max_lat) * 0.5 * TR_DEG_TO_RAD) / ext_lat;
+    double size = fmax(span / count * 0.5, 1e-9);
+    double cells = fmax(1.0, fmin(fmin(4.0 * count, TR_GRID_MAX_CELLS), ext_lat * ext_lat * aspect / (size * size)));
+    h.cols = (uint32_t)fmax(1.0, fmin(cells, round(sqrt(cells * fmax(aspect, 1e-6)))));
+    h.rows = (uint32_t)fmax(1.0, fmin(TR_GRID_MAX_CELLS / h.cols, round(cells / h.cols)));
+    h.cells_per_lat = h.rows / ext_lat;
+    h.cells_per_lon = h.cols / ext_lon;
+  }
+  size_t cells = (size_t)h.rows * h.cols, items = 0;
+  for (size_t i = 0; i < count; ++i) {
+    tr_fence_t f;
+    tr_fence_bounds(&defs[i], &f.min_lat, &f.min_lon, &f.max_lat, &f.max_lon);
+    tr_cell_range_t r = tr_grid_range(&h, &f);
+    items += (size_t)(r.r1 - r.r0 + 1) * (r.c1 - r.c0 + 1);
+    if (items > TR_GRID_MAX_ITEMS) return nullptr;
+  }
+
+  size_t off_fences = tr_align8(sizeof(traccar_geofence_t));
+  size_t off_points = off_fences + tr_align8(count * sizeof(tr_fence_t));
+  size_t off_start = off_points + tr_align8(points * 2 * sizeof(float));
+  size_t off_items = off_start + tr_align8((cells + 1) * sizeof(uint32_t));
+  size_t off_names = off_items + tr_align8(items * sizeof(uint32_t));
+  size_t size = off_names + names;
+  char* block = (char*)(h.allocator.alloc ? h.allocator.alloc(h.allocator.user, size) : malloc(size));
+  if (!block) return nullptr;
+  traccar_geofence_t* g = (traccar_geofence_t*)block;
+  *g = h;
+  g->size = size;
+  g->fences = (tr_fence_t*)(block + off_fences);
+  g->points = (float*)(block + off_points);
+  g->cell_start = (uint32_t*)(block + off_start);
+  g->cell_items = (uint32_t*)(block + off_items);
+  g->names = block + off_names;
+
+  // Pass 2: fill the fences, then the grid as a CSR: count, prefix sum, place, shift back
+  uint32_t point = 0;
+  size_t name = 0;
+  memset(g->cell_start, 0, (cells + 1) * sizeof(uint32_t));
+  for (size_t i = 0; i < count; ++i) {
+    const traccar_fence_t* d = &defs[i];
+    tr_fence_t* f = &g->fences[i];
+    memset(f, 0, sizeof(*f));
+    tr_fence_bounds(d, &f->min_lat, &f->min_lon, &f->max_lat, &f->max_lon);
+    f->id = d->id;
+    if (d->pointCount == 0) {
+      f->lat = d->latitude;
+      f->lon = d->longitude;
+      f->cos_lat = cos(d->latitude * TR_DEG_TO_RAD);
+      f->radius_deg = d->radiusMeters / TR_M_PER_DEG;
+    } else {
+      f->lat = f->min_lat;
+      f->lon = f->min_lon;
+      f->first_point = point;
+      f->point_count = (uint32_t)d->pointCount;
+      for (size_t k = 0; k < d->pointCount; ++k, ++point) {
+        g->points[2 * point] = (float)(d->points[2 * k] - f->lat);
+        g->points[2 * point + 1] = (float)(d->points[2 * k + 1] - f->lon);
+      }
+    }
+    const char* enter = tr_event_name(d->enterEvent, true);
+    const char* exit = tr_event_name(d->exitEvent, false);
+    f->enter_name = (uint32_t)name;
+    memcpy(g->names + name, enter, strlen(enter) + 1);
+    name += strlen(enter) + 1;
+    f->exit_name = (uint32_t)name;
+    memcpy(g->names + name, exit, strlen(exit) + 1);
+    name += strlen(exit) + 1;
+    tr_cell_range_t r = tr_grid_range(g, f);
+    for (uint32_t row = r.r0; row <= r.r1; ++row)
+      for (uint32_t col = r.c0; col <= r.c1; ++col) g->cell_start[row * g->cols + col + 1]++;
+  }
+  for (size_t c = 0; c < cells; ++c) g->cell_start[c + 1] += g->cell_start[c];
+  for (uint32_t i = 0; i < g->count; ++i) {
+    tr_cell_range_t r = tr_grid_range(g, &g->fences[i]);
+    for (uint32_t row = r.r0; row <= r.r1; ++row)
+      for (uint32_t col = r.c0; col <= r.c1; ++col) g->cell_items[g->cell_start[row * g->cols + col]++] = i;
+  }
+  for (size_t c = cells; c > 0; --c) g->cell_start[c] = g->cell_start[c - 1];
+  g->cell_start[0] = 0;
+  return g;
+}
+
+void traccar_geofence_destroy(traccar_geofence_t* g) {
+  if (!g) return;
+  if (!g->allocator.alloc) free(g);
+  else if (g->allocator.free) g->allocator.free(g->allocator.user, g);
+}
+
+size_t traccar_geofence_memory(const traccar_geofence_t* g) {
+  return g ? g->size : 0;
+}
+
+void traccar_geofence_set_hysteresis(traccar_geofence_t* g, double meters) {
+  if (!g) return;
+  g->hysteresis_m = meters > 0 ? meters : 0;
+}
+
+void traccar_geofence_reset(traccar_geofence_t* g) {
+  if (!g) return;
+  g->primed = false;
+  g->inside_count = 0;
+}
+
+// ----------------- Tests -----------------
+
+// Crossing number over the float offsets
+static bool tr_polygon_contains(const traccar_geofence_t* g, const tr_fence_t* f, double lat, double lon) {
+  float y = (float)(lat - f->lat), x = (float)(lon - f->lon);
+  const float* p = g->points + 2 * (size_t)f->first_point;
+  bool in = false;
+  for (uint32_t i = 0, j = f->point_count - 1; i < f->point_count; j = i++) {
+    float yi = p[2 * i], xi = p[2 * i + 1], yj = p[2 * j], xj = p[2 * j + 1];
+    if ((yi > y) != (yj > y) && x < (xj - xi) * (y - yi) / (yj - yi) + xi) in = !in;
+  }
+  return in;
+}
+
+// Whether the point is within margin_deg (latitude degrees) of the polygon's boundary
+static bool tr_polygon_near(const traccar_geofence_t* g, const tr_fence_t* f, double lat, double lon, double margin_deg) {
+  double k = cos(lat * TR_DEG_TO_RAD); // longitude to latitude degrees here
+  double y = lat - f->lat, x = (lon - f->lon) * k, m2 = margin_deg * margin_deg;
+  const float* p = g->points + 2 * (size_t)f->first_point;
+  for (uint32_t i = 0, j = f->point_count - 1; i < f->point_count; j = i++) {
+    double ay = p[2 * j], ax = p[2 * j + 1] * k, by = p[2 * i], bx = p[2 * i + 1] * k;
+    double dx = bx - ax, dy = by - ay, len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((x - ax) * dx + (y - ay) * dy) / len2 : 0;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    double ex = ax + t * dx - x, ey = ay + t * dy - y;
+    if (ex * ex + ey * ey <= m2) return true;
+  }
+  return false;
+}
+
+// margin_deg > 0 widens the fence (hysteresis for a fence the device is in)
+static bool tr_fence_contains(const traccar_geofence_t* g, const tr_fence_t* f, double lat, double lon, double margin_deg) {
+  if (f->point_count == 0) {
+    double dy = lat - f->lat, dx = (lon - f->lon) * f->cos_lat, r = f->radius_deg + margin_deg;
+    return dx * dx + dy * dy <= r * r;
+  }
+  if (lat < f->min_lat || lat > f->max_lat || lon < f->min_lon || lon > f->max_lon) {
+    if (margin_deg <= 0) return false;
+    return tr_polygon_near(g, f, lat, lon, margin_deg);
+  }
+  if (tr_polygon_contains(g, f, lat, lon)) return true;
+  return margin_deg > 0 && tr_polygon_near(g, f, lat, lon, margin_deg);
+}
+
+static inline bool tr_in_box(const tr_fence_t* f, double lat, double lon) {
+  return lat >= f->min_lat && lat <= f->max_lat && lon >= f->min_lon && lon <= f->max_lon;
+}
+
+// Candidates of the point's cell; false if the point is outside every fence's box
+static bool tr_grid_lookup(const traccar_geofence_t* g, double lat, double lon, const uint32_t** begin, const uint32_t** end) {
+  if (!(lat >= g->min_lat && lat <= g->max_lat && lon >= g->min_lon && lon <= g->max_lon)) return false;
+  uint32_t cell = tr_grid_index(lat, g->min_lat, g->cells_per_lat, g->rows) * g->cols +
+                  tr_grid_index(lon, g->min_lon, g->cells_per_lon, g->cols);
+  *begin = g->cell_items + g->cell_start[cell];
+  *end = g->cell_items + g->cell_start[cell + 1];
+  return true;
+}
+
+size_t traccar_geofence_query(const traccar_geofence_t* g, double lat, double lon, uint32_t* ids, size_t max) {
+  const uint32_t *it, *end;
+  if (!g || !tr_grid_lookup(g, lat, lon, &it, &end)) return 0;
+  size_t n = 0;
+  for (; it < end; ++it) {
+    const tr_fence_t* f = &g->fences[*it];
+    if (!tr_in_box(f, lat, lon) || !tr_fence_contains(g, f, lat, lon, 0)) continue;
+    if (ids && n < max) ids[n] = f->id;
+    ++n;
+  }
+  return n;
+}
+
+static bool tr_has(const uint32_t* list, uint32_t n, uint32_t v) {
+  for (uint32_t i = 0; i < n; ++i) if (list[i] == v) return true;
+  return false;
+}
+
+size_t traccar_geofence_update(traccar_geofence_t* g, traccar_position_t* pos,
+                               traccar_geofence_event_t* events, size_t max_events) {
+  if (!g || !pos || isnan(pos->latitude) || isnan(pos->longitude)) return 0;
+  double lat = pos->latitude, lon = pos->longitude;
+  uint32_t now[TRACCAR_GEOFENCE_MAX_INSIDE];
+  uint32_t n = 0;
+  const uint32_t *it, *end;
+  if (tr_grid_lookup(g, lat, lon, &it, &end)) {
+    for (; it < end && n < TRACCAR_GEOFENCE_MAX_INSIDE; ++it) {
+      const tr_fence_t* f = &g->fences[*it];
+      if (tr_in_box(f, lat, lon) && tr_fence_contains(g, f, lat, lon, 0)) now[n++] = *it;
+    }
+  }
+  // A fence the device is in is kept until the fix is hysteresis_m outside it
+  double margin = g->hysteresis_m / TR_M_PER_DEG;
+  if (margin > 0) {
+    for (uint32_t i = 0; i < g->inside_count && n < TRACCAR_GEOFENCE_MAX_INSIDE; ++i) {
+      uint32_t k = g->inside[i];
+      if (!tr_has(now, n, k) && tr_fence_contains(g, &g->fences[k], lat, lon, margin)) now[n++] = k;
+    }
+  }
+
+  size_t transitions = 0;
+  const char* first = nullptr;
+  if (g->primed) {
+    for (int enter = 1; enter >= 0; --enter) {
+      const uint32_t* from = enter ? now : g->inside;
+      uint32_t from_n = enter ? n : g->inside_count;
+      for (uint32_t i = 0; i < from_n; ++i) {
+        bool other = enter ? tr_has(g->inside, g->inside_count, from[i]) : tr_has(now, n, from[i]);
+        if (other) continue;
+        const tr_fence_t* f = &g->fences[from[i]];
+        const char* name = g->names + (enter ? f->enter_name : f->exit_name);
+        if (transitions < max_events && events) {
+          events[transitions].id = f->id;
+          events[transitions].enter = enter != 0;
+          events[transitions].name = name;
+        }
+        if (!first) first = name;
+        ++transitions;
+      }
+    }
+  }
+  memcpy(g->inside, now, n * sizeof(now[0]));
+  g->inside_count = n;
+  g->primed = true;
+  if (first && (!pos->eventName || !pos->eventName[0])) pos->eventName = first;
+  return transitions;
+}
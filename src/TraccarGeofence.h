@@ -0,0 +1,79 @@
+#ifndef TRACCAR_GEOFENCE_H
+#define TRACCAR_GEOFENCE_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// On-device geofences: circles and polygons in a uniform grid index, so enter/exit events are
+// decided on the device instead of by the server, and fixes between events can be sent rarely
+//
+// The index is built once from an array of fences into one block (fences, vertices, grid and
+// event names), from the given allocator. A fix is tested only against the fences whose bounding
+// box overlaps its grid cell. traccar_geofence_update tracks which fences the device is in and
+// sets eventName on the fix when that changes:
+//
+//   traccar_geofence_t* fences = traccar_geofence_create(defs, n, nullptr);
+//   traccar_geofence_update(fences, &pos, nullptr, 0);   // may set pos.eventName
+//   if (pos.eventName || traccar_filter_accept(filter, &pos)) traccar_send_osmand(client, &pos, &code);
+//
+// Coordinates are degrees; polygons are tested in the plane of latitude/longitude, which is exact
+// enough for fences of city scale (they must not cross the antimeridian).
+typedef struct traccar_geofence_s traccar_geofence_t;
+
+// Fences a device can be in at once; more overlapping fences are not tracked
+#ifndef TRACCAR_GEOFENCE_MAX_INSIDE
+#define TRACCAR_GEOFENCE_MAX_INSIDE 32
+#endif
+
+typedef struct traccar_fence_s {
+  uint32_t id;             // reported in events
+  // Circle, when pointCount is 0
+  double latitude;
+  double longitude;
+  double radiusMeters;
+  // Polygon: pointCount latitude/longitude pairs, implicitly closed
+  const double* points;
+  size_t pointCount;
+  // eventName on entry / exit, copied into the index; nullptr = "geofenceEnter" / "geofenceExit"
+  const char* enterEvent;
+  const char* exitEvent;
+} traccar_fence_t;
+
+typedef struct traccar_geofence_event_s {
+  uint32_t id;
+  bool enter;              // false: exit
+  const char* name;        // the fence's enter or exit event; valid as long as the index
+} traccar_geofence_event_t;
+
+// nullptr if a fence is malformed (no coordinates, radius <= 0, polygon of fewer than 3 points)
+// or memory runs out. allocator: nullptr = malloc/free.
+traccar_geofence_t* traccar_geofence_create(const traccar_fence_t* fences, size_t count,
+                                            const traccar_allocator_t* allocator);
+void traccar_geofence_destroy(traccar_geofence_t* geofence);
+size_t traccar_geofence_memory(const traccar_geofence_t* geofence); // bytes of the block
+
+// Ids of the fences containing the point, up to max; returns how many contain it
+size_t traccar_geofence_query(const traccar_geofence_t* geofence, double latitude, double longitude,
+                              uint32_t* ids, size_t max);
+
+// A fence is left only once the fix is farther than meters outside it, so GPS noise along a
+// boundary does not produce enter/exit pairs (default 0)
+void traccar_geofence_set_hysteresis(traccar_geofence_t* geofence, double meters);
+
+// Compares the fences containing pos with those of the previous fix and returns the number of
+// transitions, writing up to max_events of them (entries first). The first fix after creation
+// or reset only sets the state. If pos has coordinates and no eventName yet, eventName is set to
+// the first transition's event name. Fixes without coordinates change nothing.
+size_t traccar_geofence_update(traccar_geofence_t* geofence, traccar_position_t* pos,
+                               traccar_geofence_event_t* events, size_t max_events);
+// Forgets the state, e.g. when the device was off for a while
+void traccar_geofence_reset(traccar_geofence_t* geofence);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_GEOFENCE_H
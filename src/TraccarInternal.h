@@ -0,0 +1,86 @@
+#ifndef TRACCAR_INTERNAL_H
+#define TRACCAR_INTERNAL_H
+
+// Helpers shared between the library's translation units; not part of the public API
+
+#include "TraccarClient.h"
+
+// Appends n bytes of s at out[*idx], always NUL-terminated, and advances *idx by n even past
+// out_size (what did not fit is dropped), so *idx ends at the full length; returns bytes copied
+size_t tr_append_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n);
+// Appends s URL-encoded / JSON-escaped (without quotes) at out[*idx], always NUL-terminated;
+// the _n forms take n bytes of s, NULs included
+void tr_append_urlenc(char* out, size_t out_size, size_t* idx, const char* s);
+void tr_append_json_str(char* out, size_t out_size, size_t* idx, const char* s);
+void tr_append_urlenc_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n);
+void tr_append_json_str_n(char* out, size_t out_size, size_t* idx, const char* s, size_t n);
+
+// Appends the optional position fields in the given wire format: "&key=value..." for OsmAnd,
+// ",\"key\":value..." for JSON (the caller writes the id prefix and the closing brace)
+void tr_append_fields(traccar_format_t format, const traccar_position_t* pos, char* out, size_t out_size, size_t* idx);
+
+// Copies src into dst with its string fields in strings[0..size); fields that no longer fit are
+// dropped (set to nullptr)
+void tr_copy_position(traccar_position_t* dst, const traccar_position_t* src, char* strings, size_t size);
+
+// CRC-32 (IEEE) with a 16-entry table; pass the previous result as crc to continue it over more bytes
+uint32_t tr_crc32(const uint8_t* p, size_t n, uint32_t crc = 0);
+
+// Wall clock in ms, or 0 while the clock is not set
+uint64_t tr_now_ms_or_0();
+
+// Records one encoded request in the client's stats (kind: TRACCAR_STATS_*)
+void tr_stat_request(traccar_client_t* c, int kind, size_t positions, size_t bytes, bool truncated);
+
+// Tracing of a send made outside this file (traccar_set_trace): tr_trace_begin starts the next
+// request number and returns its start, 0 when not tracing; tr_trace_send records the send span
+uint64_t tr_trace_begin(traccar_client_t* c, int kind);
+void tr_trace_send(traccar_client_t* c, uint64_t start, int code);
+
+// Chrome trace document (traccar_trace_export_chrome) written a whole event at a time: events that
+// do not fit before the closing bytes are left out, so what is written always parses (nothing is,
+// when not even an empty document fits). tr_chrome_end closes it and returns its full length.
+typedef struct tr_chrome_s {
+  char* out;
+  size_t keep;     // events end before this offset
+  size_t idx;      // written
+  size_t total;    // full length
+  size_t events;
+  bool cut;
+} tr_chrome_t;
+void tr_chrome_begin(tr_chrome_t* d, char* out, size_t out_size);
+void tr_chrome_events(tr_chrome_t* d, const traccar_span_t* spans, size_t n, uint32_t tid);
+size_t tr_chrome_end(tr_chrome_t* d);
+
+// Request target of the client's base URL (origin-form, e.g. "/" or "/osmand/")
+const char* tr_request_path(const traccar_client_t* c);
+
+#if TRACCAR_HAVE_POSIX
+#include <sys/uio.h>
+
+// Blocking TCP connection with TCP_NODELAY and send/receive timeouts; -1 on failure. resolved_us
+// (optional) is set to the monotonic time the name lookup finished, and left alone if it failed.
+int tr_connect(const char* name, uint16_t port, uint16_t timeout_ms, uint64_t* resolved_us = nullptr);
+// The client's batch buffer with room for need bytes; it is kept between sends, so requests too
+// long for the stack allocate once per client. nullptr if it is fixed and too small or cannot grow.
+char* tr_client_scratch(traccar_client_t* c, size_t need);
+// Writes all iovecs (iov is modified); false on error
+bool tr_write_all(int fd, struct iovec* iov, int iovcnt);
+
+// One request/response on the client's persistent connection; returns the HTTP status code or a
+// negative TRACCAR_HTTP_ERROR_* code
+int tr_http_request(traccar_client_t* c, const char* method, const char* path,
+                    const char* content_type, const char* body, size_t body_len);
+// Same with the target and the body in pieces (up to 4 each), written with the headers in one
+// writev
+int tr_http_request_v(traccar_client_t* c, const char* method, const struct iovec* target, int target_cnt,
+                      const char* content_type, const struct iovec* body, int body_cnt);
+
+// traccar_shm_submit in its two steps, so that the tests can stall a producer between them:
+// tr_shm_claim takes the next ticket (false if the ring is full or its uploader gone),
+// tr_shm_publish copies pos into its slot and publishes it (false if the uploader skipped it)
+bool tr_shm_claim(struct traccar_shm_producer_s* p, uint64_t* ticket);
+bool tr_shm_publish(struct traccar_shm_producer_s* p, uint64_t ticket, const traccar_position_t* pos);
+#endif
+
+#endif // TRACCAR_INTERNAL_H
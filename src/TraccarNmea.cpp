@@ -0,0 +1,393 @@
+#include "TraccarNmea.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TR_NMEA_MAX_FIELDS 24
+
+// Sentence types merged into a fix
+enum { TR_NMEA_RMC = 1, TR_NMEA_GGA = 2, TR_NMEA_GSA = 4, TR_NMEA_VTG = 8 };
+
+struct traccar_nmea_s {
+  traccar_nmea_cb cb;
+  void* user;
+  traccar_nmea_counts_t counts;
+  // Fix being merged
+  traccar_position_t pos;
+  int32_t fix_time;     // ms since midnight UTC; -1 until a timed sentence of the fix
+  int valid_rank;       // sentence that set validFlag: 3 RMC, 2 GGA, 1 GSA
+  int hdop_rank;        // sentence that set hdop: 2 GGA, 1 GSA
+  uint8_t seen;         // TR_NMEA_* of this fix
+  uint8_t expected;     // those of the previous fix; the fix is complete once they are in
+  bool emitted;
+  int64_t date_days;    // from the last RMC; -1 until then
+  // Sentence straddling two chunks
+  size_t len;
+  char buf[TRACCAR_NMEA_MAX_SENTENCE];
+};
+
+typedef struct tr_nmea_fields_s {
+  int count;
+  const char* s[TR_NMEA_MAX_FIELDS];
+  const char* e[TR_NMEA_MAX_FIELDS];
+} tr_nmea_fields_t;
+
+static const double kPow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+                                 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+static void tr_nmea_clear(traccar_nmea_t* n) {
+  traccar_position_t* p = &n->pos;
+  memset(p, 0, sizeof(*p));
+  p->latitude = NAN; p->longitude = NAN; p->altitudeMeters = NAN; p->speedKmh = NAN;
+  p->headingDeg = NAN; p->hdop = NAN; p->accuracyMeters = NAN; p->odometer = NAN;
+  p->batteryPercent = -1; p->validFlag = -1;
+  n->valid_rank = 0;
+  n->hdop_rank = 0;
+  n->seen = 0;
+  n->emitted = false;
+}
+
+traccar_nmea_t* traccar_nmea_create(traccar_nmea_cb cb, void* user) {
+  traccar_nmea_t* n = (traccar_nmea_t*)calloc(1, sizeof(*n));
+  if (!n) return nullptr;
+  n->cb = cb;
+  n->user = user;
+  traccar_nmea_reset(n);
+  return n;
+}
+
+void traccar_nmea_destroy(traccar_nmea_t* n) {
+  free(n);
+}
+
+void traccar_nmea_reset(traccar_nmea_t* n) {
+  if (!n) return;
+  tr_nmea_clear(n);
+  n->fix_time = -1;
+  n->expected = 0;
+  n->date_days = -1;
+  n->len = 0;
+}
+
+void traccar_nmea_get_counts(const traccar_nmea_t* n, traccar_nmea_counts_t* out) {
+  if (!out) return;
+  if (n) *out = n->counts;
+  else memset(out, 0, sizeof(*out));
+}
+
+// ----------------- Fields -----------------
+
+// XOR of s[0..n), eight bytes at a time; folding the word gives the same byte in any byte order
+static uint8_t tr_nmea_xor(const char* s, size_t n) {
+  uint64_t acc = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, 8);
+    acc ^= w;
+  }
+  acc ^= acc >> 32; acc ^= acc >> 16; acc ^= acc >> 8;
+  uint8_t x = (uint8_t)acc;
+  for (; i < n; ++i) x ^= (uint8_t)s[i];
+  return x;
+}
+
+static int tr_nmea_hex(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = (char)(c | 0x20);
+  return (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+}
+
+// Decimal number ("4807.038", "-12.5"); false when the field is empty or malformed
+static bool tr_nmea_num(const char* s, const char* e, double* out) {
+  bool neg = false;
+  if (s < e && (*s == '-' || *s == '+')) neg = *s++ == '-';
+  uint64_t mant = 0;
+  int digits = 0, frac = -1;
+  for (; s < e; ++s) {
+    if (*s >= '0' && *s <= '9') {
+      if (digits < 18) { mant = mant * 10 + (uint64_t)(*s - '0'); ++digits; if (frac >= 0) ++frac; }
+      else if (frac < 0) return false; // too large for a receiver to mean it
+    } else if (*s == '.' && frac < 0) {
+      frac = 0;
+    } else {
+      return false;
+    }
+  }
+  if (!digits) return false;
+  double v = (double)mant / kPow10[frac > 0 ? frac : 0];
+  *out = neg ? -v : v;
+  return true;
+}
+
+static inline int tr_nmea_2digits(const char* s) {
+  return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+static bool tr_nmea_digits(const char* s, int n) {
+  for (int i = 0; i < n; ++i) if (s[i] < '0' || s[i] > '9') return false;
+  return true;
+}
+
+// "hhmmss[.sss]" as ms since midnight; -1 if malformed
+static int32_t tr_nmea_time(const char* s, const char* e) {
+  if (e - s < 6 || !tr_nmea_digits(s, 6)) return -1;
+  int h = tr_nmea_2digits(s), m = tr_nmea_2digits(s + 2), sec = tr_nmea_2digits(s + 4);
+  if (h > 23 || m > 59 || sec > 60) return -1;
+  int32_t ms = ((h * 60 + m) * 60 + sec) * 1000;
+  if (e - s > 7 && s[6] == '.') {
+    int scale = 100;
+    for (const char* p = s + 7; p < e && scale && *p >= '0' && *p <= '9'; ++p, scale /= 10) ms += (*p - '0') * scale;
+  }
+  return ms;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t tr_nmea_days(int y, int m, int d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+static bool tr_field_num(const tr_nmea_fields_t* f, int i, double* out) {
+  return i < f->count && tr_nmea_num(f->s[i], f->e[i], out);
+}
+
+static char tr_field_char(const tr_nmea_fields_t* f, int i) {
+  return (i < f->count && f->e[i] > f->s[i]) ? *f->s[i] : '\0';
+}
+
+// "ddmm.mmmm" in field i and its hemisphere in field i + 1, as signed degrees
+static bool tr_field_coord(const tr_nmea_fields_t* f, int i, double* out) {
+  double v;
+  char h = tr_field_char(f, i + 1);
+  if (!tr_field_num(f, i, &v) || !h) return false;
+  double deg = floor(v / 100.0);
+  *out = (deg + (v - deg * 100.0) / 60.0) * ((h == 'S' || h == 'W') ? -1.0 : 1.0);
+  return true;
+}
+
+// ----------------- Merging -----------------
+
+static void tr_nmea_emit(traccar_nmea_t* n) {
+  n->emitted = true;
+  if (isnan(n->pos.latitude) || isnan(n->pos.longitude)) return;
+  if (n->date_days >= 0 && n->fix_time >= 0)
+    n->pos.timestampMs = (uint64_t)n->date_days * 86400000ULL + (uint64_t)n->fix_time;
+  n->counts.positions++;
+  if (n->cb) n->cb(n->user, &n->pos);
+}
+
+// Closes the fix being merged (emitting it if that has not happened yet) and starts the next one
+static void tr_nmea_close(traccar_nmea_t* n) {
+  n->expected = n->seen;
+  if (!n->emitted && n->seen) tr_nmea_emit(n);
+  tr_nmea_clear(n);
+  n->fix_time = -1;
+}
+
+// Places a sentence in a fix: a new UTC time starts the next fix. A sentence without time after
+// the fix went out is a late one of that fix (a receiver may send GSA once per constellation),
+// not the first of the next: opening the next fix with it would let its values fill that fix.
+// Returns false for a late sentence, which is not merged. Untimed ones are not counted in seen
+// either, so that a receiver leading with them does not make the next fix wait for them.
+static bool tr_nmea_begin(traccar_nmea_t* n, int32_t t, uint8_t type) {
+  if (t >= 0) {
+    if (n->fix_time >= 0 && t != n->fix_time) tr_nmea_close(n);
+    else if (n->fix_time < 0 && n->emitted) tr_nmea_close(n);
+    n->fix_time = t;
+  } else if (n->emitted) {
+    return false;
+  }
+  if (n->emitted) {
+    n->seen |= type;
+    return false;
+  }
+  return true;
+}
+
+static void tr_nmea_end(traccar_nmea_t* n, uint8_t type) {
+  n->seen |= type;
+  if (n->expected && (n->seen & n->expected) == n->expected) tr_nmea_emit(n);
+}
+
+static void tr_nmea_valid(traccar_nmea_t* n, int rank, bool valid) {
+  if (rank <= n->valid_rank) return;
+  n->valid_rank = rank;
+  n->pos.validFlag = valid ? 1 : 0;
+}
+
+static void tr_nmea_set(double* field, double v) {
+  if (isnan(*field)) *field = v;
+}
+
+// GGA's HDOP is that of the fix; GSA's is of the satellites it lists, which with several
+// constellations is one of several GSA, so it only stands in when GGA has none
+static void tr_nmea_hdop(traccar_nmea_t* n, int rank, double v) {
+  if (rank <= n->hdop_rank) return;
+  n->hdop_rank = rank;
+  n->pos.hdop = v;
+}
+
+static void tr_nmea_rmc(traccar_nmea_t* n, const tr_nmea_fields_t* f) {
+  int32_t t = f->count > 1 ? tr_nmea_time(f->s[1], f->e[1]) : -1;
+  if (t < 0 || !tr_nmea_begin(n, t, TR_NMEA_RMC)) return;
+  double v;
+  if (f->count > 9 && f->e[9] - f->s[9] >= 6 && tr_nmea_digits(f->s[9], 6)) {
+    int yy = tr_nmea_2digits(f->s[9] + 4);
+    n->date_days = tr_nmea_days(yy < 80 ? 2000 + yy : 1900 + yy, tr_nmea_2digits(f->s[9] + 2), tr_nmea_2digits(f->s[9]));
+  }
+  if (tr_field_coord(f, 3, &v)) tr_nmea_set(&n->pos.latitude, v);
+  if (tr_field_coord(f, 5, &v)) tr_nmea_set(&n->pos.longitude, v);
+  if (tr_field_num(f, 7, &v)) tr_nmea_set(&n->pos.speedKmh, v * 1.852);
+  if (tr_field_num(f, 8, &v)) tr_nmea_set(&n->pos.headingDeg, v);
+  // Status A/V; NMEA 2.3 adds a mode where N also means no fix
+  tr_nmea_valid(n, 3, tr_field_char(f, 2) == 'A' && tr_field_char(f, 12) != 'N');
+  tr_nmea_end(n, TR_NMEA_RMC);
+}
+
+static void tr_nmea_gga(traccar_nmea_t* n, const tr_nmea_fields_t* f) {
+  int32_t t = f->count > 1 ? tr_nmea_time(f->s[1], f->e[1]) : -1;
+  if (t < 0 || !tr_nmea_begin(n, t, TR_NMEA_GGA)) return;
+  double v;
+  if (tr_field_coord(f, 2, &v)) tr_nmea_set(&n->pos.latitude, v);
+  if (tr_field_coord(f, 4, &v)) tr_nmea_set(&n->pos.longitude, v);
+  char quality = tr_field_char(f, 6);
+  if (quality) tr_nmea_valid(n, 2, quality != '0');
+  if (tr_field_num(f, 8, &v)) tr_nmea_hdop(n, 2, v);
+  if (tr_field_num(f, 9, &v)) tr_nmea_set(&n->pos.altitudeMeters, v);
+  tr_nmea_end(n, TR_NMEA_GGA);
+}
+
+static void tr_nmea_gsa(traccar_nmea_t* n, const tr_nmea_fields_t* f) {
+  if (!tr_nmea_begin(n, -1, TR_NMEA_GSA)) return;
+  double v;
+  char mode = tr_field_char(f, 2);
+  if (mode) tr_nmea_valid(n, 1, mode != '1');
+  if (tr_field_num(f, 16, &v)) tr_nmea_hdop(n, 1, v);
+  tr_nmea_end(n, TR_NMEA_GSA);
+}
+
+static void tr_nmea_vtg(traccar_nmea_t* n, const tr_nmea_fields_t* f) {
+  if (!tr_nmea_begin(n, -1, TR_NMEA_VTG)) return;
+  double v;
+  // "course,T,course,M,knots,N,kmh,K" since NMEA 2.3, "course,course,knots,kmh" before
+  bool units = tr_field_char(f, 2) == 'T';
+  if (tr_field_num(f, 1, &v)) tr_nmea_set(&n->pos.headingDeg, v);
+  if (tr_field_num(f, units ? 7 : 4, &v)) tr_nmea_set(&n->pos.speedKmh, v);
+  tr_nmea_end(n, TR_NMEA_VTG);
+}
+
+// One sentence from '$' to its end of line (exclusive)
+static void tr_nmea_sentence(traccar_nmea_t* n, const char* s, size_t len) {
+  if (len && s[len - 1] == '\r') --len;
+  const char* end = s + len;
+  const char* star = (const char*)memchr(s, '*', len);
+  if (star) {
+    int hi, lo;
+    if (end - star != 3 || (hi = tr_nmea_hex(star[1])) < 0 || (lo = tr_nmea_hex(star[2])) < 0) {
+      n->counts.dropped++;
+      return;
+    }
+    if (tr_nmea_xor(s + 1, (size_t)(star - s - 1)) != (uint8_t)(hi << 4 | lo)) {
+      n->counts.checksum_errors++;
+      return;
+    }
+    end = star;
+  }
+  tr_nmea_fields_t f;
+  f.count = 0;
+  for (const char* p = s + 1; f.count < TR_NMEA_MAX_FIELDS;) {
+    const char* c = (const char*)memchr(p, ',', (size_t)(end - p));
+    f.s[f.count] = p;
+    f.e[f.count] = c ? c : end;
+    ++f.count;
+    if (!c) break;
+    p = c + 1;
+  }
+  n->counts.sentences++;
+  // Talker (GP, GN, GL, ...) and type; proprietary sentences ($P...) are ignored
+  if (f.e[0] - f.s[0] != 5 || f.s[0][0] == 'P') return;
+  const char* type = f.s[0] + 2;
+  if (!memcmp(type, "RMC", 3)) tr_nmea_rmc(n, &f);
+  else if (!memcmp(type, "GGA", 3)) tr_nmea_gga(n, &f);
+  else if (!memcmp(type, "GSA", 3)) tr_nmea_gsa(n, &f);
+  else if (!memcmp(type, "VTG", 3)) tr_nmea_vtg(n, &f);
+}
+
+// ----------------- Stream -----------------
+
+size_t traccar_nmea_feed(traccar_nmea_t* n, const void* data, size_t len) {
+  if (!n || !data) return 0;
+  uint64_t before = n->counts.positions;
+  const char* p = (const char*)data;
+  const char* end = p + len;
+  const size_t max = sizeof(n->buf);
+  if (n->len) {
+    // Complete the sentence left over from the previous chunk
+    size_t room = max - n->len;
+    size_t scan = (size_t)(end - p) < room + 1 ? (size_t)(end - p) : room + 1;
+    const char* nl = (const char*)memchr(p, '\n', scan);
+    const char* stop = nl ? nl : p + scan;
+    const char* restart = (const char*)memchr(p, '$', (size_t)(stop - p));
+    if (restart) {
+      n->counts.dropped++;
+      n->len = 0;
+      p = restart;
+    } else if (nl) {
+      memcpy(n->buf + n->len, p, (size_t)(nl - p));
+      size_t total = n->len + (size_t)(nl - p);
+      n->len = 0;
+      tr_nmea_sentence(n, n->buf, total);
+      p = nl + 1;
+    } else if (scan <= room) {
+      memcpy(n->buf + n->len, p, scan);
+      n->len += scan;
+      return 0;
+    } else {
+      n->counts.dropped++;
+      n->len = 0;
+      p += scan;
+    }
+  }
+  // Whole sentences are parsed where they are; memchr finds the delimiters
+  while (p < end) {
+    const char* start = (const char*)memchr(p, '$', (size_t)(end - p));
+    if (!start) break;
+    size_t avail = (size_t)(end - start);
+    size_t scan = avail < max + 1 ? avail : max + 1;
+    const char* nl = (const char*)memchr(start, '\n', scan);
+    const char* stop = nl ? nl : start + scan;
+    const char* restart = (const char*)memchr(start + 1, '$', (size_t)(stop - start - 1));
+    if (restart) {
+      n->counts.dropped++;
+      p = restart;
+    } else if (nl) {
+      tr_nmea_sentence(n, start, (size_t)(nl - start));
+      p = nl + 1;
+    } else if (avail <= max) {
+      memcpy(n->buf, start, avail);
+      n->len = avail;
+      break;
+    } else {
+      n->counts.dropped++;
+      p = start + scan;
+    }
+  }
+  return (size_t)(n->counts.positions - before);
+}
+
+size_t traccar_nmea_flush(traccar_nmea_t* n) {
+  if (!n) return 0;
+  uint64_t before = n->counts.positions;
+  if (n->len) {
+    size_t len = n->len;
+    n->len = 0;
+    tr_nmea_sentence(n, n->buf, len);
+  }
+  if (!n->emitted && n->seen) tr_nmea_emit(n);
+  return (size_t)(n->counts.positions - before);
+}
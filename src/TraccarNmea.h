@@ -0,0 +1,57 @@
+#ifndef TRACCAR_NMEA_H
+#define TRACCAR_NMEA_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming NMEA 0183 parser: raw receiver bytes in, traccar_position_t out
+//
+// Feed it chunks of any size as they arrive from a UART or a file. Sentences are checksummed and
+// parsed straight from the chunk; only one that straddles two chunks is copied, into a buffer of
+// one sentence. RMC, GGA, GSA and VTG of the same fix (same UTC time) are merged into one position
+// (coordinates, speed, heading, altitude, HDOP, validity, timestamp; GGA's HDOP over GSA's), which
+// goes to the callback as soon as the sentences the receiver sends per fix are in: the parser
+// learns that set from the previous fix, so there is no wait for the next one. Untimed sentences
+// after that belong to the fix already out. Nothing is allocated after creation.
+//
+//   static void on_fix(void* user, const traccar_position_t* pos) { ... }
+//   traccar_nmea_t* nmea = traccar_nmea_create(on_fix, NULL);
+//   traccar_nmea_feed(nmea, buf, n);
+typedef struct traccar_nmea_s traccar_nmea_t;
+
+// Longest sentence kept, '$' to checksum; NMEA allows 82 bytes, some receivers send more
+#ifndef TRACCAR_NMEA_MAX_SENTENCE
+#define TRACCAR_NMEA_MAX_SENTENCE 128
+#endif
+
+// Called from traccar_nmea_feed / traccar_nmea_flush; pos is only valid during the call. Its
+// string fields are nullptr and the fields NMEA does not carry are omitted (NAN / -1); the
+// timestamp is 0 until a date has been seen.
+typedef void (*traccar_nmea_cb)(void* user, const traccar_position_t* pos);
+
+typedef struct traccar_nmea_counts_s {
+  uint64_t sentences;        // well-formed sentences, of any type
+  uint64_t checksum_errors;
+  uint64_t dropped;          // cut by a new '$' or longer than TRACCAR_NMEA_MAX_SENTENCE
+  uint64_t positions;        // passed to the callback
+} traccar_nmea_counts_t;
+
+traccar_nmea_t* traccar_nmea_create(traccar_nmea_cb cb, void* user);
+void traccar_nmea_destroy(traccar_nmea_t* nmea);
+
+// Parses the next len bytes of the stream; returns how many positions were emitted
+size_t traccar_nmea_feed(traccar_nmea_t* nmea, const void* data, size_t len);
+// Parses a last sentence without line end and emits the fix being merged (e.g. at the end of a file)
+size_t traccar_nmea_flush(traccar_nmea_t* nmea);
+// Forgets any partial sentence and fix (e.g. after the receiver was reset)
+void traccar_nmea_reset(traccar_nmea_t* nmea);
+void traccar_nmea_get_counts(const traccar_nmea_t* nmea, traccar_nmea_counts_t* out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_NMEA_H
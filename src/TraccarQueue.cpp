@@ -0,0 +1,309 @@
+#include "TraccarQueue.h"
+#include "TraccarInternal.h"
+
+#if TRACCAR_HAVE_POSIX
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// File layout: [header page][data ring of `capacity` bytes]
+// The header holds two generation-stamped copies of the head so that updating it is atomic
+// with respect to crashes: a torn copy fails its CRC and the other one is used.
+#define TR_QUEUE_MAGIC     0x51435254u // "TRCQ"
+#define TR_QUEUE_VERSION   1u
+#define TR_QUEUE_HDR_SIZE  4096u
+#define TR_QUEUE_MIN_CAP   4096u
+#define TR_REC_COMMIT      0x5AFEC0DEu
+#define TR_REC_PAD         1u          // skip to the start of the ring
+#define TR_QUEUE_BATCH_MAX 64
+#define TR_QUEUE_NSTR      5
+
+typedef struct tr_queue_head_s {
+  uint64_t head;     // absolute offset of the oldest live record
+  uint64_t head_seq; // sequence number expected at head
+  uint64_t gen;
+  uint32_t crc;
+  uint32_t reserved;
+} tr_queue_head_t;
+
+typedef struct tr_queue_hdr_s {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  tr_queue_head_t heads[2];
+} tr_queue_hdr_t;
+
+// Record header; the payload follows and the whole record is padded to 8 bytes.
+// commit is stored last: a record is live only if commit and crc both match.
+typedef struct tr_rec_hdr_s {
+  uint32_t len;   // payload bytes
+  uint32_t crc;   // over the payload
+  uint64_t seq;
+  uint32_t flags;
+  uint32_t commit;
+} tr_rec_hdr_t;
+
+// Fixed part of the payload; strings (NUL-terminated) follow in field order
+typedef struct tr_rec_fixed_s {
+  double latitude, longitude, altitudeMeters, speedKmh, headingDeg, hdop, accuracyMeters, odometer;
+  uint64_t timestampMs;
+  int32_t batteryPercent;
+  int32_t validFlag;
+  uint16_t strLen[TR_QUEUE_NSTR]; // 0 = absent, otherwise length + 1
+  uint8_t charging;
+  uint8_t reserved[5];
+} tr_rec_fixed_t;
+
+struct traccar_queue_s {
+  int fd;
+  uint8_t* map;
+  size_t map_size;
+  tr_queue_hdr_t* hdr;
+  uint8_t* data;
+  uint64_t cap;
+  uint64_t head, head_seq;
+  uint64_t tail, tail_seq;
+  uint64_t gen;
+  size_t count;
+};
+
+static inline uint64_t tr_align8(uint64_t v) { return (v + 7) & ~(uint64_t)7; }
+
+static inline const char* tr_pos_str(const traccar_position_t* pos, int i) {
+  switch (i) {
+    case 0: return pos->driverUniqueId;
+    case 1: return pos->cell;
+    case 2: return pos->wifi;
+    case 3: return pos->eventName;
+    default: return pos->activityType;
+  }
+}
+
+static uint32_t tr_head_crc(const tr_queue_head_t* h) {
+  return tr_crc32((const uint8_t*)h, offsetof(tr_queue_head_t, crc));
+}
+
+static void tr_queue_store_head(traccar_queue_t* q) {
+  tr_queue_head_t* h = &q->hdr->heads[++q->gen & 1];
+  h->head = q->head;
+  h->head_seq = q->head_seq;
+  h->gen = q->gen;
+  h->crc = tr_head_crc(h);
+}
+
+// Committed record at absolute offset off, or nullptr; follows the pad record at the end of a lap
+static const tr_rec_hdr_t* tr_queue_record(const traccar_queue_t* q, uint64_t* off, uint64_t seq) {
+  for (int hop = 0; hop < 2; ++hop) {
+    uint64_t pos = *off % q->cap;
+    if (q->cap - pos < sizeof(tr_rec_hdr_t)) { *off += q->cap - pos; continue; }
+    const tr_rec_hdr_t* r = (const tr_rec_hdr_t*)(q->data + pos);
+    if (__atomic_load_n(&r->commit, __ATOMIC_ACQUIRE) != (TR_REC_COMMIT ^ (uint32_t)seq) || r->seq != seq) return nullptr;
+    if (r->flags & TR_REC_PAD) { *off += q->cap - pos; continue; }
+    if (r->len > q->cap - pos - sizeof(*r)) return nullptr;
+    if (tr_crc32((const uint8_t*)(r + 1), r->len) != r->crc) return nullptr;
+    return r;
+  }
+  return nullptr;
+}
+
+// Recovery walks only the live region: from the persisted head until the first record that
+// is missing, torn or from an older lap (sequence mismatch).
+static void tr_queue_recover(traccar_queue_t* q) {
+  const tr_queue_head_t* best = nullptr;
+  for (int i = 0; i < 2; ++i) {
+    const tr_queue_head_t* h = &q->hdr->heads[i];
+    if (h->crc == tr_head_crc(h) && (!best || h->gen > best->gen)) best = h;
+  }
+  q->head = best ? best->head : 0;
+  q->head_seq = best ? best->head_seq : 1;
+  q->gen = best ? best->gen : 0;
+  q->tail = q->head; q->tail_seq = q->head_seq; q->count = 0;
+  for (;;) {
+    uint64_t off = q->tail;
+    const tr_rec_hdr_t* r = tr_queue_record(q, &off, q->tail_seq);
+    if (!r || off + tr_align8(sizeof(*r) + r->len) - q->head > q->cap) break;
+    q->tail = off + tr_align8(sizeof(*r) + r->len);
+    q->tail_seq++;
+    q->count++;
+  }
+}
+
+traccar_queue_t* traccar_queue_open(const char* path, size_t capacity_bytes) {
+  if (!path) return nullptr;
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0) { close(fd); return nullptr; }
+  tr_queue_hdr_t existing; memset(&existing, 0, sizeof(existing));
+  bool valid = (size_t)st.st_size > TR_QUEUE_HDR_SIZE &&
+               pread(fd, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing) &&
+               existing.magic == TR_QUEUE_MAGIC && existing.version == TR_QUEUE_VERSION &&
+               existing.capacity + TR_QUEUE_HDR_SIZE == (uint64_t)st.st_size;
+  if (!valid && st.st_size != 0) {
+    close(fd); // not a queue this build can read: left untouched
+    return nullptr;
+  }
+  uint64_t cap = valid ? existing.capacity : tr_align8(capacity_bytes < TR_QUEUE_MIN_CAP ? TR_QUEUE_MIN_CAP : capacity_bytes);
+  size_t map_size = (size_t)(TR_QUEUE_HDR_SIZE + cap);
+  if (!valid && ftruncate(fd, (off_t)map_size) != 0) { close(fd); return nullptr; }
+  void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) { close(fd); return nullptr; }
+  traccar_queue_t* q = (traccar_queue_t*)calloc(1, sizeof(*q));
+  if (!q) { munmap(map, map_size); close(fd); return nullptr; }
+  q->fd = fd;
+  q->map = (uint8_t*)map;
+  q->map_size = map_size;
+  q->hdr = (tr_queue_hdr_t*)map;
+  q->data = q->map + TR_QUEUE_HDR_SIZE;
+  q->cap = cap;
+  if (!valid) {
+    q->hdr->magic = TR_QUEUE_MAGIC;
+    q->hdr->version = TR_QUEUE_VERSION;
+    q->hdr->capacity = cap;
+    q->head = 0; q->head_seq = 1;
+    tr_queue_store_head(q);
+    msync(q->map, TR_QUEUE_HDR_SIZE, MS_SYNC);
+  }
+  tr_queue_recover(q);
+  return q;
+}
+
+void traccar_queue_close(traccar_queue_t* q) {
+  if (!q) return;
+  msync(q->map, q->map_size, MS_SYNC);
+  munmap(q->map, q->map_size);
+  close(q->fd);
+  free(q);
+}
+
+size_t traccar_queue_count(const traccar_queue_t* q) {
+  return q ? q->count : 0;
+}
+
+bool traccar_queue_push(traccar_queue_t* q, const traccar_position_t* pos) {
+  if (!q || !pos) return false;
+  size_t slen[TR_QUEUE_NSTR];
+  uint64_t payload = sizeof(tr_rec_fixed_t);
+  for (int i = 0; i < TR_QUEUE_NSTR; ++i) {
+    const char* str = tr_pos_str(pos, i);
+    slen[i] = (str && *str) ? strlen(str) : 0;
+    if (slen[i] >= 0xFFFF) return false;
+    if (slen[i]) payload += slen[i] + 1;
+  }
+  uint64_t need = tr_align8(sizeof(tr_rec_hdr_t) + payload);
+  uint64_t pos_in = q->tail % q->cap;
+  uint64_t pad = (q->cap - pos_in < need) ? q->cap - pos_in : 0;
+  if (q->tail + pad + need - q->head > q->cap) return false;
+
+  uint64_t seq = q->tail_seq;
+  tr_rec_hdr_t* r = (tr_rec_hdr_t*)(q->data + (pad ? 0 : pos_in));
+  tr_rec_fixed_t fx; memset(&fx, 0, sizeof(fx));
+  fx.latitude = pos->latitude; fx.longitude = pos->longitude; fx.altitudeMeters = pos->altitudeMeters;
+  fx.speedKmh = pos->speedKmh; fx.headingDeg = pos->headingDeg; fx.hdop = pos->hdop;
+  fx.accuracyMeters = pos->accuracyMeters; fx.odometer = pos->odometer;
+  fx.timestampMs = pos->timestampMs; fx.batteryPercent = pos->batteryPercent;
+  fx.validFlag = pos->validFlag; fx.charging = pos->charging ? 1 : 0;
+  for (int i = 0; i < TR_QUEUE_NSTR; ++i) fx.strLen[i] = (uint16_t)(slen[i] ? slen[i] + 1 : 0);
+  uint8_t* p = (uint8_t*)(r + 1);
+  memcpy(p, &fx, sizeof(fx)); p += sizeof(fx);
+  for (int i = 0; i < TR_QUEUE_NSTR; ++i) {
+    if (!slen[i]) continue;
+    memcpy(p, tr_pos_str(pos, i), slen[i] + 1); p += slen[i] + 1;
+  }
+  r->len = (uint32_t)payload;
+  r->crc = tr_crc32((const uint8_t*)(r + 1), (size_t)payload);
+  r->seq = seq;
+  r->flags = 0;
+  // Whatever lies where the next record goes may be a committed record from beyond a torn one,
+  // carrying the very sequence number that comes next: it is cleared before this one is committed
+  uint64_t next = q->tail + pad + need, at = next % q->cap, skip = 0;
+  if (q->cap - at < sizeof(tr_rec_hdr_t)) { skip = q->cap - at; at = 0; }
+  if (next + skip + sizeof(tr_rec_hdr_t) - q->head <= q->cap)
+    __atomic_store_n(&((tr_rec_hdr_t*)(q->data + at))->commit, 0u, __ATOMIC_RELAXED);
+  __atomic_store_n(&r->commit, TR_REC_COMMIT ^ (uint32_t)seq, __ATOMIC_RELEASE);
+
+  // The pad marker is committed after the record it leads to, so a lap end is never followed
+  // by an unwritten record
+  if (pad >= sizeof(tr_rec_hdr_t)) {
+    tr_rec_hdr_t* m = (tr_rec_hdr_t*)(q->data + pos_in);
+    m->len = 0; m->crc = 0; m->seq = seq; m->flags = TR_REC_PAD;
+    __atomic_store_n(&m->commit, TR_REC_COMMIT ^ (uint32_t)seq, __ATOMIC_RELEASE);
+  }
+  q->tail += pad + need;
+  q->tail_seq++;
+  q->count++;
+  return true;
+}
+
+size_t traccar_queue_peek(traccar_queue_t* q, traccar_position_t* out, size_t max) {
+  if (!q || !out) return 0;
+  uint64_t off = q->head, seq = q->head_seq;
+  size_t n = 0;
+  while (n < max && n < q->count) {
+    const tr_rec_hdr_t* r = tr_queue_record(q, &off, seq);
+    if (!r) break;
+    const uint8_t* p = (const uint8_t*)(r + 1);
+    tr_rec_fixed_t fx; memcpy(&fx, p, sizeof(fx)); p += sizeof(fx);
+    traccar_position_t* o = &out[n];
+    o->latitude = fx.latitude; o->longitude = fx.longitude; o->altitudeMeters = fx.altitudeMeters;
+    o->speedKmh = fx.speedKmh; o->headingDeg = fx.headingDeg; o->hdop = fx.hdop;
+    o->accuracyMeters = fx.accuracyMeters; o->odometer = fx.odometer;
+    o->timestampMs = fx.timestampMs; o->batteryPercent = fx.batteryPercent;
+    o->validFlag = fx.validFlag; o->charging = fx.charging != 0;
+    const char* strs[TR_QUEUE_NSTR];
+    for (int i = 0; i < TR_QUEUE_NSTR; ++i) {
+      strs[i] = fx.strLen[i] ? (const char*)p : nullptr;
+      p += fx.strLen[i];
+    }
+    o->driverUniqueId = strs[0]; o->cell = strs[1]; o->wifi = strs[2];
+    o->eventName = strs[3]; o->activityType = strs[4];
+    off += tr_align8(sizeof(*r) + r->len);
+    seq++; n++;
+  }
+  return n;
+}
+
+void traccar_queue_pop(traccar_queue_t* q, size_t n) {
+  if (!q || n == 0) return;
+  while (n-- && q->count) {
+    uint64_t off = q->head;
+    const tr_rec_hdr_t* r = tr_queue_record(q, &off, q->head_seq);
+    if (!r) break;
+    q->head = off + tr_align8(sizeof(*r) + r->len);
+    q->head_seq++;
+    q->count--;
+  }
+  tr_queue_store_head(q);
+  msync(q->map, TR_QUEUE_HDR_SIZE, MS_SYNC);
+}
+
+size_t traccar_queue_drain(traccar_queue_t* q, traccar_client_t* client, traccar_format_t format, size_t max_batch) {
+  if (!q || !client) return 0;
+  if (max_batch == 0 || max_batch > TR_QUEUE_BATCH_MAX) max_batch = TR_QUEUE_BATCH_MAX;
+  traccar_position_t batch[TR_QUEUE_BATCH_MAX];
+  bool accepted[TR_QUEUE_BATCH_MAX];
+  size_t delivered = 0;
+  while (q->count) {
+    size_t n = traccar_queue_peek(q, batch, max_batch);
+    if (n == 0) break;
+    if (format == TRACCAR_FORMAT_JSON) traccar_send_json_batch(client, batch, n, accepted, nullptr);
+    else traccar_send_osmand_batch(client, batch, n, accepted, nullptr);
+    // Only the accepted prefix is removed so delivery stays in order
+    size_t k = 0;
+    while (k < n && accepted[k]) ++k;
+    traccar_queue_pop(q, k);
+    delivered += k;
+    if (k < n) break;
+  }
+  return delivered;
+}
+
+bool traccar_queue_sync(traccar_queue_t* q) {
+  return q && msync(q->map, q->map_size, MS_SYNC) == 0;
+}
+
+#endif // TRACCAR_HAVE_POSIX
@@ -0,0 +1,49 @@
+#ifndef TRACCAR_QUEUE_H
+#define TRACCAR_QUEUE_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Durable store-and-forward queue (POSIX builds only)
+//
+// Positions are appended to a fixed-size memory-mapped ring file. Each record carries a CRC and
+// is made visible by a commit word written last, so a record torn by a crash or power loss is
+// simply not recovered. Delivery is at-least-once: a batch whose removal did not reach the disk
+// before a crash is sent again on restart.
+//
+// A queue is not thread-safe: push, peek, pop, drain and sync must come from one thread at a
+// time (for instance the sampling loop pushing and draining in turn), or be serialised by the
+// caller.
+typedef struct traccar_queue_s traccar_queue_t;
+
+// Opens (or creates) the ring file. capacity_bytes applies only when the file is created; an
+// existing non-empty file that is not a queue this build can read is left untouched (nullptr).
+traccar_queue_t* traccar_queue_open(const char* path, size_t capacity_bytes);
+void traccar_queue_close(traccar_queue_t* queue);
+
+// Appends one position; O(1), no allocation, no syscalls. Returns false when the ring is full.
+bool traccar_queue_push(traccar_queue_t* queue, const traccar_position_t* pos);
+size_t traccar_queue_count(const traccar_queue_t* queue);
+
+// Decodes up to max oldest positions without removing them. String fields point into the
+// mapping and stay valid until the records are popped.
+size_t traccar_queue_peek(traccar_queue_t* queue, traccar_position_t* out, size_t max);
+// Removes the n oldest positions and persists the new head
+void traccar_queue_pop(traccar_queue_t* queue, size_t n);
+
+// Sends queued positions in order, max_batch per request, until the queue is empty or a
+// position is not accepted. Returns the number of positions delivered and removed. Blocks on
+// the network; no other call may run on the queue meanwhile (see above).
+size_t traccar_queue_drain(traccar_queue_t* queue, traccar_client_t* client, traccar_format_t format, size_t max_batch);
+
+// Flushes the mapping to storage (blocking); call outside the sampling loop for power-loss safety
+bool traccar_queue_sync(traccar_queue_t* queue);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_QUEUE_H
@@ -0,0 +1,212 @@
+#include "TraccarRetry.h"
+#include "TraccarInternal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct tr_retry_slot_s {
+  traccar_position_t pos;   // string fields point into strings
+  uint64_t due_ms;          // next attempt
+  uint64_t submitted_ms;
+  uint32_t failures;
+  char strings[TRACCAR_RETRY_STRING_BYTES];
+} tr_retry_slot_t;
+
+struct traccar_retry_s {
+  traccar_client_t* client;
+  traccar_format_t format;
+  uint32_t base_ms, max_ms, expiry_ms;
+  unsigned breaker_failures;
+  uint32_t breaker_open_ms;
+  // Breaker: open_until != 0 means open until then, half-open (one probe) after it
+  unsigned fail_streak;
+  uint64_t open_until;
+  uint64_t rng;
+  traccar_retry_counts_t counts;
+  // Preallocated slots, a stack of the free ones and a binary min-heap of the pending ones by due_ms
+  size_t capacity;
+  tr_retry_slot_t* slots;
+  uint32_t* free_list;
+  size_t free_count;
+  uint32_t* heap;
+  size_t count;
+};
+
+traccar_retry_t* traccar_retry_create(traccar_client_t* client, traccar_format_t format, size_t capacity) {
+  if (!client || capacity == 0 || capacity > 0xFFFFFFFFu) return nullptr;
+  traccar_retry_t* r = (traccar_retry_t*)calloc(1, sizeof(*r));
+  if (!r) return nullptr;
+  r->client = client;
+  r->format = format;
+  r->base_ms = 1000;
+  r->max_ms = 300000;
+  r->expiry_ms = 24UL * 3600UL * 1000UL;
+  r->breaker_failures = 5;
+  r->breaker_open_ms = 60000;
+  r->rng = ((uint64_t)(uintptr_t)r ^ tr_now_ms_or_0()) | 1;
+  r->capacity = capacity;
+  r->slots = (tr_retry_slot_t*)calloc(capacity, sizeof(*r->slots));
+  r->free_list = (uint32_t*)calloc(capacity, sizeof(*r->free_list));
+  r->heap = (uint32_t*)calloc(capacity, sizeof(*r->heap));
+  if (!r->slots || !r->free_list || !r->heap) { traccar_retry_destroy(r); return nullptr; }
+  for (size_t i = 0; i < capacity; ++i) r->free_list[i] = (uint32_t)(capacity - 1 - i);
+  r->free_count = capacity;
+  return r;
+}
+
+void traccar_retry_destroy(traccar_retry_t* r) {
+  if (!r) return;
+  free(r->slots);
+  free(r->free_list);
+  free(r->heap);
+  free(r);
+}
+
+void traccar_retry_set_backoff(traccar_retry_t* r, uint32_t base_ms, uint32_t max_ms) {
+  if (!r) return;
+  r->base_ms = base_ms ? base_ms : 1;
+  r->max_ms = max_ms > r->base_ms ? max_ms : r->base_ms;
+}
+
+void traccar_retry_set_expiry(traccar_retry_t* r, uint32_t expiry_ms) {
+  if (!r) return;
+  r->expiry_ms = expiry_ms;
+}
+
+void traccar_retry_set_breaker(traccar_retry_t* r, unsigned failures, uint32_t open_ms) {
+  if (!r) return;
+  r->breaker_failures = failures;
+  r->breaker_open_ms = open_ms;
+}
+
+// ----------------- Heap -----------------
+
+static inline uint64_t tr_retry_due(const traccar_retry_t* r, size_t i) {
+  return r->slots[r->heap[i]].due_ms;
+}
+
+static void tr_retry_push(traccar_retry_t* r, uint32_t slot) {
+  size_t i = r->count++;
+  uint64_t due = r->slots[slot].due_ms;
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (tr_retry_due(r, parent) <= due) break;
+    r->heap[i] = r->heap[parent];
+    i = parent;
+  }
+  r->heap[i] = slot;
+}
+
+static uint32_t tr_retry_pop(traccar_retry_t* r) {
+  uint32_t top = r->heap[0];
+  uint32_t last = r->heap[--r->count];
+  uint64_t due = r->slots[last].due_ms;
+  size_t i = 0;
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= r->count) break;
+    if (child + 1 < r->count && tr_retry_due(r, child + 1) < tr_retry_due(r, child)) ++child;
+    if (due <= tr_retry_due(r, child)) break;
+    r->heap[i] = r->heap[child];
+    i = child;
+  }
+  if (r->count) r->heap[i] = last;
+  return top;
+}
+
+// ----------------- Scheduling -----------------
+
+static uint32_t tr_retry_random(traccar_retry_t* r) {
+  r->rng ^= r->rng << 13; r->rng ^= r->rng >> 7; r->rng ^= r->rng << 17;
+  return (uint32_t)(r->rng >> 32);
+}
+
+// Delay before the next attempt after the given number of failures: base doubled per failure up
+// to the cap, of which the upper half is random
+static uint32_t tr_retry_delay(traccar_retry_t* r, uint32_t failures) {
+  uint64_t d = r->base_ms;
+  for (uint32_t i = 1; i < failures && d < r->max_ms; ++i) d *= 2;
+  if (d > r->max_ms) d = r->max_ms;
+  uint32_t half = (uint32_t)(d / 2);
+  return (uint32_t)(d - half) + tr_retry_random(r) % (half + 1);
+}
+
+bool traccar_retry_submit(traccar_retry_t* r, const traccar_position_t* pos, uint64_t now_ms) {
+  if (!r || !pos) return false;
+  if (r->free_count == 0) { r->counts.overflowed++; return false; }
+  uint32_t slot = r->free_list[--r->free_count];
+  tr_retry_slot_t* s = &r->slots[slot];
+  tr_copy_position(&s->pos, pos, s->strings, sizeof(s->strings));
+  // The fix keeps its own time; otherwise the server would stamp it with the retry's time
+  if (!s->pos.timestampMs) s->pos.timestampMs = tr_now_ms_or_0();
+  s->failures = 1;
+  s->submitted_ms = now_ms;
+  s->due_ms = now_ms + tr_retry_delay(r, 1);
+  tr_retry_push(r, slot);
+  return true;
+}
+
+// Rejections that retrying cannot fix; timeouts and rate limiting are worth another attempt
+static inline bool tr_retry_permanent(int code) {
+  return code >= 400 && code < 500 && code != 408 && code != 429;
+}
+
+bool traccar_retry_breaker_open(const traccar_retry_t* r, uint64_t now_ms) {
+  return r && r->open_until && now_ms < r->open_until;
+}
+
+size_t traccar_retry_run(traccar_retry_t* r, uint64_t now_ms, size_t max_sends) {
+  if (!r) return 0;
+  size_t delivered = 0, sent = 0;
+  while (r->count && sent < max_sends && tr_retry_due(r, 0) <= now_ms) {
+    tr_retry_slot_t* s = &r->slots[r->heap[0]];
+    if (r->expiry_ms && now_ms >= s->submitted_ms && now_ms - s->submitted_ms >= r->expiry_ms) {
+      r->free_list[r->free_count++] = tr_retry_pop(r);
+      r->counts.expired++;
+      continue;
+    }
+    if (traccar_retry_breaker_open(r, now_ms)) break;
+    bool probe = r->open_until != 0;
+    uint32_t slot = tr_retry_pop(r);
+    int code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+    if (r->format == TRACCAR_FORMAT_JSON) traccar_send_json(r->client, &s->pos, &code);
+    else traccar_send_osmand(r->client, &s->pos, &code);
+    ++sent;
+    if (code == 200 || tr_retry_permanent(code)) {
+      // The server answered: the breaker closes either way
+      if (code == 200) { r->counts.delivered++; ++delivered; }
+      else r->counts.rejected++;
+      r->free_list[r->free_count++] = slot;
+      r->fail_streak = 0;
+      r->open_until = 0;
+      continue;
+    }
+    r->counts.retried++;
+    s->failures++;
+    s->due_ms = now_ms + tr_retry_delay(r, s->failures);
+    tr_retry_push(r, slot);
+    if (probe || (r->breaker_failures && ++r->fail_streak >= r->breaker_failures)) {
+      r->open_until = now_ms + (r->breaker_open_ms ? r->breaker_open_ms : 1);
+      r->fail_streak = 0;
+      r->counts.breaker_trips++;
+      break;
+    }
+  }
+  return delivered;
+}
+
+uint64_t traccar_retry_next_due(const traccar_retry_t* r) {
+  if (!r || !r->count) return UINT64_MAX;
+  uint64_t due = tr_retry_due(r, 0);
+  return r->open_until > due ? r->open_until : due;
+}
+
+size_t traccar_retry_pending(const traccar_retry_t* r) {
+  return r ? r->count : 0;
+}
+
+void traccar_retry_get_counts(const traccar_retry_t* r, traccar_retry_counts_t* out) {
+  if (!out) return;
+  if (r) *out = r->counts;
+  else memset(out, 0, sizeof(*out));
+}
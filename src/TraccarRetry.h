@@ -0,0 +1,68 @@
+#ifndef TRACCAR_RETRY_H
+#define TRACCAR_RETRY_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Retry scheduler: keeps positions whose upload failed and sends them again later
+//
+// Pending positions sit in a min-heap ordered by their next attempt time. A failed attempt
+// reschedules the position with exponential backoff and jitter (half the delay fixed, half random),
+// so devices that lost the server at the same moment do not come back in lockstep. Positions
+// older than the expiry are dropped. After a run of consecutive failures a circuit breaker stops
+// sending for a while and then lets a single probe through; its success closes the breaker.
+// Every slot is allocated at creation: submit and each attempt are O(log n) without allocation.
+//
+// Time is passed in by the caller (any monotonic ms clock), so the scheduler can be driven from
+// a main loop or a simulated clock:
+//
+//   if (!traccar_send_osmand(client, &pos, &code)) traccar_retry_submit(retry, &pos, now);
+//   traccar_retry_run(retry, now, 4);
+typedef struct traccar_retry_s traccar_retry_t;
+
+// String fields of a position are copied into a slot buffer of this size; fields that no longer
+// fit are dropped from the retried position
+#ifndef TRACCAR_RETRY_STRING_BYTES
+#define TRACCAR_RETRY_STRING_BYTES 128
+#endif
+
+typedef struct traccar_retry_counts_s {
+  uint64_t delivered;   // accepted by the server
+  uint64_t retried;     // failed attempts that were rescheduled
+  uint64_t expired;     // dropped after the expiry
+  uint64_t rejected;    // dropped after a 4xx answer that retrying cannot fix
+  uint64_t overflowed;  // submits refused because every slot was taken
+  uint64_t breaker_trips;
+} traccar_retry_counts_t;
+
+// capacity: positions that can be pending at once; sends go through client in the given format
+traccar_retry_t* traccar_retry_create(traccar_client_t* client, traccar_format_t format, size_t capacity);
+void traccar_retry_destroy(traccar_retry_t* retry);
+
+// Delay after the first failure and the cap it doubles up to (defaults 1 s and 5 min)
+void traccar_retry_set_backoff(traccar_retry_t* retry, uint32_t base_ms, uint32_t max_ms);
+// Age after which a pending position is dropped (default 24 h; 0 = never)
+void traccar_retry_set_expiry(traccar_retry_t* retry, uint32_t expiry_ms);
+// Consecutive failures that open the breaker and how long it stays open (defaults 5 and 60 s;
+// failures 0 = no breaker)
+void traccar_retry_set_breaker(traccar_retry_t* retry, unsigned failures, uint32_t open_ms);
+
+// Queues a position for its first retry at now_ms + base delay; false when every slot is taken
+bool traccar_retry_submit(traccar_retry_t* retry, const traccar_position_t* pos, uint64_t now_ms);
+// Attempts up to max_sends positions that are due at now_ms (earliest first) and returns how
+// many were delivered. Nothing is sent while the breaker is open.
+size_t traccar_retry_run(traccar_retry_t* retry, uint64_t now_ms, size_t max_sends);
+// Time of the next attempt (the breaker's reopening if it is later); UINT64_MAX when idle
+uint64_t traccar_retry_next_due(const traccar_retry_t* retry);
+size_t traccar_retry_pending(const traccar_retry_t* retry);
+bool traccar_retry_breaker_open(const traccar_retry_t* retry, uint64_t now_ms);
+void traccar_retry_get_counts(const traccar_retry_t* retry, traccar_retry_counts_t* out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_RETRY_H
@@ -0,0 +1,206 @@
+#include "TraccarSender.h"
+#include "TraccarInternal.h"
+
+#if TRACCAR_HAVE_POSIX
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TR_SENDER_MAX_BATCH 256
+
+// Bounded MPSC ring (sequence-numbered slots): a producer claims ticket t by advancing tail when
+// slots[t & mask].seq == t, fills the slot and publishes it by setting seq = t + 1. The sender
+// consumes ticket t once seq == t + 1 and frees the slot for the next lap with seq = t + capacity.
+typedef struct tr_sender_slot_s {
+  uint64_t seq;
+  traccar_position_t pos;   // string fields point into strings
+  char strings[TRACCAR_SENDER_STRING_BYTES];
+} tr_sender_slot_t;
+
+struct traccar_sender_s {
+  // Written by producers; each group on its own cache line
+  alignas(64) uint64_t tail;  // next ticket to claim
+  alignas(64) uint64_t full;
+  // Written by the sender thread
+  alignas(64) uint64_t head;  // next ticket to consume
+  uint32_t sleeping;          // 1 while the sender waits on the wake pipe
+  uint64_t delivered, failed, batches;
+  // Set at creation
+  alignas(64) traccar_client_t* client;
+  traccar_format_t format;
+  size_t max_batch;
+  traccar_sender_cb cb;
+  void* user;
+  uint64_t mask;
+  tr_sender_slot_t* slots;
+  traccar_position_t* batch;  // contiguous copy of the slots being sent
+  bool* accepted;
+  int wake[2];
+  uint32_t stop;
+  bool started;
+  pthread_t thread;
+};
+
+static inline void tr_sender_count(uint64_t* v, uint64_t n) {
+  __atomic_store_n(v, __atomic_load_n(v, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline bool tr_sender_ready(traccar_sender_t* s, uint64_t ticket) {
+  return __atomic_load_n(&s->slots[ticket & s->mask].seq, __ATOMIC_ACQUIRE) == ticket + 1;
+}
+
+// Sends the published slots from head on, up to max_batch; returns how many were consumed
+static size_t tr_sender_drain(traccar_sender_t* s) {
+  uint64_t head = s->head;
+  size_t n = 0;
+  size_t max = __atomic_load_n(&s->max_batch, __ATOMIC_RELAXED);
+  while (n < max && tr_sender_ready(s, head + n)) {
+    s->batch[n] = s->slots[(head + n) & s->mask].pos;
+    ++n;
+  }
+  if (!n) return 0;
+  int code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+  memset(s->accepted, 0, n * sizeof(*s->accepted));
+  if (s->format == TRACCAR_FORMAT_JSON) traccar_send_json_batch(s->client, s->batch, n, s->accepted, &code);
+  else traccar_send_osmand_batch(s->client, s->batch, n, s->accepted, &code);
+  size_t ok = 0;
+  for (size_t i = 0; i < n; ++i) ok += s->accepted[i];
+  tr_sender_count(&s->delivered, ok);
+  tr_sender_count(&s->failed, n - ok);
+  tr_sender_count(&s->batches, 1);
+  if (s->cb) s->cb(s->user, s->batch, n, s->accepted, code);
+  for (size_t i = 0; i < n; ++i)
+    __atomic_store_n(&s->slots[(head + i) & s->mask].seq, head + i + s->mask + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&s->head, head + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+static void* tr_sender_main(void* arg) {
+  traccar_sender_t* s = (traccar_sender_t*)arg;
+  for (;;) {
+    if (tr_sender_drain(s)) continue;
+    if (__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) break;
+    // Announce the sleep, then look again: a producer publishing in between sees the flag
+    __atomic_store_n(&s->sleeping, 1, __ATOMIC_SEQ_CST);
+    uint64_t seq = __atomic_load_n(&s->slots[s->head & s->mask].seq, __ATOMIC_SEQ_CST);
+    if (seq != s->head + 1 && !__atomic_load_n(&s->stop, __ATOMIC_SEQ_CST)) {
+      struct pollfd pfd = { s->wake[0], POLLIN, 0 };
+      poll(&pfd, 1, -1);
+      char buf[64];
+      while (read(s->wake[0], buf, sizeof(buf)) > 0) {}
+    }
+    __atomic_store_n(&s->sleeping, 0, __ATOMIC_RELAXED);
+  }
+  return nullptr;
+}
+
+static void tr_sender_wake(traccar_sender_t* s) {
+  char b = 1;
+  ssize_t n = write(s->wake[1], &b, 1); // EAGAIN: the pipe is full, which wakes the sender anyway
+  (void)n;
+}
+
+traccar_sender_t* traccar_sender_create(traccar_client_t* client, traccar_format_t format, size_t capacity,
+                                        traccar_sender_cb cb, void* user) {
+  if (!client || capacity == 0 || capacity > ((size_t)1 << 30)) return nullptr;
+  size_t cap = 2;
+  while (cap < capacity) cap *= 2;
+  void* mem = nullptr;
+  if (posix_memalign(&mem, 64, sizeof(traccar_sender_t)) != 0) return nullptr;
+  traccar_sender_t* s = (traccar_sender_t*)mem;
+  memset(s, 0, sizeof(*s));
+  s->wake[0] = s->wake[1] = -1;
+  s->client = client;
+  s->format = format;
+  s->max_batch = 32;
+  s->cb = cb;
+  s->user = user;
+  s->mask = cap - 1;
+  s->slots = (tr_sender_slot_t*)calloc(cap, sizeof(*s->slots));
+  s->batch = (traccar_position_t*)calloc(TR_SENDER_MAX_BATCH, sizeof(*s->batch));
+  s->accepted = (bool*)calloc(TR_SENDER_MAX_BATCH, sizeof(*s->accepted));
+  if (!s->slots || !s->batch || !s->accepted || pipe(s->wake) != 0) { traccar_sender_destroy(s); return nullptr; }
+  for (int i = 0; i < 2; ++i) {
+    fcntl(s->wake[i], F_SETFL, fcntl(s->wake[i], F_GETFL, 0) | O_NONBLOCK);
+    fcntl(s->wake[i], F_SETFD, FD_CLOEXEC);
+  }
+  for (size_t i = 0; i < cap; ++i) s->slots[i].seq = i;
+  if (pthread_create(&s->thread, nullptr, tr_sender_main, s) != 0) { traccar_sender_destroy(s); return nullptr; }
+  s->started = true;
+  return s;
+}
+
+void traccar_sender_destroy(traccar_sender_t* s) {
+  if (!s) return;
+  if (s->started) {
+    __atomic_store_n(&s->stop, 1, __ATOMIC_SEQ_CST);
+    tr_sender_wake(s);
+    pthread_join(s->thread, nullptr);
+  }
+  if (s->wake[0] >= 0) close(s->wake[0]);
+  if (s->wake[1] >= 0) close(s->wake[1]);
+  free(s->slots);
+  free(s->batch);
+  free(s->accepted);
+  free(s);
+}
+
+void traccar_sender_set_max_batch(traccar_sender_t* s, size_t max_batch) {
+  if (!s) return;
+  if (max_batch == 0) max_batch = 1;
+  __atomic_store_n(&s->max_batch, max_batch < TR_SENDER_MAX_BATCH ? max_batch : TR_SENDER_MAX_BATCH, __ATOMIC_RELAXED);
+}
+
+bool traccar_sender_submit(traccar_sender_t* s, const traccar_position_t* pos) {
+  if (!s || !pos) return false;
+  uint64_t t = __atomic_load_n(&s->tail, __ATOMIC_RELAXED);
+  tr_sender_slot_t* slot;
+  for (;;) {
+    slot = &s->slots[t & s->mask];
+    int64_t diff = (int64_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - t);
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&s->tail, &t, t + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (diff < 0) {
+      __atomic_fetch_add(&s->full, 1, __ATOMIC_RELAXED);
+      return false;
+    } else {
+      t = __atomic_load_n(&s->tail, __ATOMIC_RELAXED);
+    }
+  }
+  tr_copy_position(&slot->pos, pos, slot->strings, sizeof(slot->strings));
+  // Sequentially consistent with the sender's store of sleeping and its last look at the ring:
+  // either it sees this slot or this sees it sleeping
+  __atomic_store_n(&slot->seq, t + 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&s->sleeping, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&s->sleeping, 0, __ATOMIC_ACQ_REL))
+    tr_sender_wake(s);
+  return true;
+}
+
+bool traccar_sender_flush(traccar_sender_t* s, uint32_t timeout_ms) {
+  if (!s) return true;
+  uint64_t target = __atomic_load_n(&s->tail, __ATOMIC_ACQUIRE);
+  for (uint32_t waited = 0; __atomic_load_n(&s->head, __ATOMIC_ACQUIRE) < target; ++waited) {
+    if (waited >= timeout_ms) return false;
+    struct timespec ts = { 0, 1000000 };
+    nanosleep(&ts, nullptr);
+  }
+  return true;
+}
+
+void traccar_sender_get_counts(const traccar_sender_t* s, traccar_sender_counts_t* out) {
+  if (!out) return;
+  memset(out, 0, sizeof(*out));
+  if (!s) return;
+  out->submitted = __atomic_load_n(&s->tail, __ATOMIC_RELAXED);
+  out->full = __atomic_load_n(&s->full, __ATOMIC_RELAXED);
+  out->delivered = __atomic_load_n(&s->delivered, __ATOMIC_RELAXED);
+  out->failed = __atomic_load_n(&s->failed, __ATOMIC_RELAXED);
+  out->batches = __atomic_load_n(&s->batches, __ATOMIC_RELAXED);
+}
+
+#endif // TRACCAR_HAVE_POSIX
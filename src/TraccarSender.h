@@ -0,0 +1,57 @@
+#ifndef TRACCAR_SENDER_H
+#define TRACCAR_SENDER_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Background sender with a multi-producer submission queue (POSIX builds only)
+//
+// A client is not thread-safe. A sender takes one over and gives it a thread of its own: any
+// number of threads submit positions into a bounded lock-free ring, and the sender thread
+// drains it and uploads what it found as one batch (JSON array POST or pipelined OsmAnd GETs).
+// Submitting copies the position, string fields included, into a preallocated slot: it never
+// allocates, locks or waits on the network. A syscall is made only to wake an idle sender.
+typedef struct traccar_sender_s traccar_sender_t;
+
+// String bytes kept per slot; string fields that do not fit are dropped from the copy
+#ifndef TRACCAR_SENDER_STRING_BYTES
+#define TRACCAR_SENDER_STRING_BYTES 256
+#endif
+
+// Called on the sender thread after each batch; accepted[i] tells whether positions[i] was
+// taken by the server. The positions are only valid during the call.
+typedef void (*traccar_sender_cb)(void* user, const traccar_position_t* positions, size_t n,
+                                  const bool* accepted, int http_code);
+
+typedef struct traccar_sender_counts_s {
+  uint64_t submitted;   // accepted into the ring
+  uint64_t full;        // submits refused because the ring was full
+  uint64_t delivered;   // accepted by the server
+  uint64_t failed;      // sent but not accepted
+  uint64_t batches;
+} traccar_sender_counts_t;
+
+// capacity is rounded up to a power of two. The client must not be used elsewhere until the
+// sender is destroyed; cb (optional) receives the outcome of every batch.
+traccar_sender_t* traccar_sender_create(traccar_client_t* client, traccar_format_t format, size_t capacity,
+                                        traccar_sender_cb cb, void* user);
+// Stops the thread after it has made one attempt at everything already submitted
+void traccar_sender_destroy(traccar_sender_t* sender);
+
+// Positions per request (default 32)
+void traccar_sender_set_max_batch(traccar_sender_t* sender, size_t max_batch);
+
+// Thread-safe and lock-free. Returns false when the ring is full.
+bool traccar_sender_submit(traccar_sender_t* sender, const traccar_position_t* pos);
+// Waits until everything submitted so far has been attempted; false on timeout
+bool traccar_sender_flush(traccar_sender_t* sender, uint32_t timeout_ms);
+void traccar_sender_get_counts(const traccar_sender_t* sender, traccar_sender_counts_t* out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_SENDER_H
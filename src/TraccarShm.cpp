@@ -0,0 +1,441 @@
+#include "TraccarShm.h"
+#include "TraccarInternal.h"
+
+#if TRACCAR_HAVE_POSIX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#define TR_SHM_MAGIC 0x54524b52u // "RKRT"
+#define TR_SHM_VERSION 2
+#define TR_SHM_MAX_BATCH 256
+#define TR_SHM_TEXTS 5
+#define TR_SHM_SKIPPED (1ULL << 63) // seq | ticket of a slot skipped while its producer may still write
+#define TR_SHM_MAX_SKIPPED 16       // skipped slots awaiting their producer; no more are skipped
+
+static_assert(TRACCAR_SHM_STRING_BYTES < 65535, "string offsets are 16-bit");
+
+// Same ring as traccar_sender_t, but everything lives in the shared segment and holds no
+// pointers: each process maps it at its own address, so string fields are kept as offsets
+typedef struct alignas(64) tr_shm_slot_s {
+  uint64_t seq;
+  uint32_t owner;                    // pid of the producer filling it, 0 once it is out of it
+  traccar_position_t pos;            // string fields nullptr; see text
+  uint16_t text[TR_SHM_TEXTS];       // offset + 1 in strings of each string field, 0 = none
+  char strings[TRACCAR_SHM_STRING_BYTES];
+} tr_shm_slot_t;
+
+typedef struct tr_shm_header_s {
+  // Set by the uploader before magic is published
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_size;
+  uint32_t open;               // 1 while the uploader takes submits
+  uint32_t pid;                // of the uploader: open stays 1 if it crashes
+  uint64_t capacity;
+  // Written by producers; each group on its own cache line
+  alignas(64) uint64_t tail;
+  alignas(64) uint64_t full;
+  // Written by the uploader
+  alignas(64) uint64_t head;
+  uint32_t sleeping;           // futex word: 1 while the uploader waits
+  uint64_t heartbeat_ms;       // CLOCK_MONOTONIC (system-wide) of the uploader's last loop
+  uint64_t delivered, failed, batches, skipped;
+} tr_shm_header_t;
+
+struct traccar_shm_daemon_s {
+  char* name;
+  tr_shm_header_t* hdr;
+  tr_shm_slot_t* slots;
+  size_t map_size;
+  uint64_t mask;
+  traccar_client_t* client;
+  traccar_format_t format;
+  size_t max_batch;
+  traccar_shm_cb cb;
+  void* user;
+  traccar_position_t* batch;  // the slots being sent, string fields pointing into the mapping
+  bool* accepted;
+  uint32_t stop;
+  uint64_t skipped[TR_SHM_MAX_SKIPPED]; // tickets of skipped slots not yet handed to the next lap
+  size_t skipped_n;
+};
+
+struct traccar_shm_producer_s {
+  tr_shm_header_t* hdr;
+  tr_shm_slot_t* slots;
+  size_t map_size;
+  uint64_t mask;
+  uint32_t pid;                 // recorded in the slots it fills
+};
+
+static inline tr_shm_slot_t* tr_shm_slots(tr_shm_header_t* h) {
+  return (tr_shm_slot_t*)((char*)h + sizeof(tr_shm_header_t));
+}
+
+static inline void tr_shm_count(uint64_t* v, uint64_t n) {
+  __atomic_store_n(v, __atomic_load_n(v, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static uint64_t tr_shm_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+// Sleeps while *word is 1, at most timeout_ms. Shared futexes work across processes; without
+// them the uploader naps a millisecond at a time.
+static void tr_shm_wait(uint32_t* word, uint32_t timeout_ms) {
+#ifdef __linux__
+  struct timespec ts = { (time_t)(timeout_ms / 1000), (long)(timeout_ms % 1000) * 1000000L };
+  syscall(SYS_futex, word, FUTEX_WAIT, 1, &ts, nullptr, 0);
+#else
+  (void)word; (void)timeout_ms;
+  struct timespec ts = { 0, 1000000 };
+  nanosleep(&ts, nullptr);
+#endif
+}
+
+// Whether the process is still there: kill(pid, 0) only fails with ESRCH once it is gone (EPERM
+// for a process of another user). Pids are only meaningful within one PID namespace.
+static bool tr_shm_pid_alive(uint32_t pid) {
+  return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+}
+
+static void tr_shm_wake(uint32_t* word) {
+#ifdef __linux__
+  syscall(SYS_futex, word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+static inline const char** tr_shm_text_field(traccar_position_t* p, int i) {
+  const char** fields[TR_SHM_TEXTS] = { &p->driverUniqueId, &p->cell, &p->wifi, &p->eventName, &p->activityType };
+  return fields[i];
+}
+
+// ----------------- Uploader -----------------
+
+static inline bool tr_shm_ready(traccar_shm_daemon_t* d, uint64_t ticket) {
+  return __atomic_load_n(&d->slots[ticket & d->mask].seq, __ATOMIC_ACQUIRE) == ticket + 1;
+}
+
+// Sends the published slots from head on, up to max_batch; returns how many were consumed
+static size_t tr_shm_drain(traccar_shm_daemon_t* d) {
+  tr_shm_header_t* h = d->hdr;
+  uint64_t head = h->head;
+  size_t n = 0;
+  size_t max = __atomic_load_n(&d->max_batch, __ATOMIC_RELAXED);
+  while (n < max && tr_shm_ready(d, head + n)) {
+    tr_shm_slot_t* slot = &d->slots[(head + n) & d->mask];
+    traccar_position_t* p = &d->batch[n];
+    *p = slot->pos;
+    for (int i = 0; i < TR_SHM_TEXTS; ++i) {
+      uint16_t off = slot->text[i];
+      *tr_shm_text_field(p, i) = (off && off <= sizeof(slot->strings)) ? slot->strings + off - 1 : nullptr;
+    }
+    ++n;
+  }
+  if (!n) return 0;
+  int code = TRACCAR_HTTP_ERROR_SEND_FAILED;
+  memset(d->accepted, 0, n * sizeof(*d->accepted));
+  if (d->format == TRACCAR_FORMAT_JSON) traccar_send_json_batch(d->client, d->batch, n, d->accepted, &code);
+  else traccar_send_osmand_batch(d->client, d->batch, n, d->accepted, &code);
+  size_t ok = 0;
+  for (size_t i = 0; i < n; ++i) ok += d->accepted[i];
+  tr_shm_count(&h->delivered, ok);
+  tr_shm_count(&h->failed, n - ok);
+  tr_shm_count(&h->batches, 1);
+  if (d->cb) d->cb(d->user, d->batch, n, d->accepted, code);
+  for (size_t i = 0; i < n; ++i) {
+    tr_shm_slot_t* slot = &d->slots[(head + i) & d->mask];
+    __atomic_store_n(&slot->owner, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, head + i + d->mask + 1, __ATOMIC_RELEASE);
+  }
+  __atomic_store_n(&h->head, head + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+// Moves head past the slot of ticket head unless its producer publishes first. The slot is
+// marked skipped rather than freed: a producer that stalled (rather than died) may still be
+// copying into it, so it only goes to the next lap once tr_shm_reap finds that producer out of it.
+static void tr_shm_skip(traccar_shm_daemon_t* d, uint64_t head) {
+  if (d->skipped_n == TR_SHM_MAX_SKIPPED) return;
+  uint64_t expected = head;
+  if (__atomic_compare_exchange_n(&d->slots[head & d->mask].seq, &expected, head | TR_SHM_SKIPPED, false,
+                                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    d->skipped[d->skipped_n++] = head;
+    tr_shm_count(&d->hdr->skipped, 1);
+    __atomic_store_n(&d->hdr->head, head + 1, __ATOMIC_RELEASE);
+  }
+}
+
+// Hands skipped slots to the next lap once their producer is out: it found the slot skipped and
+// cleared owner, it never recorded itself (it will find the slot skipped before writing), or its
+// process is gone. The load of owner is sequentially consistent with the skip and with the
+// producer's store of owner and its look at seq.
+static void tr_shm_reap(traccar_shm_daemon_t* d) {
+  for (size_t i = 0; i < d->skipped_n;) {
+    uint64_t t = d->skipped[i];
+    tr_shm_slot_t* slot = &d->slots[t & d->mask];
+    uint32_t owner = __atomic_load_n(&slot->owner, __ATOMIC_SEQ_CST);
+    if (owner && tr_shm_pid_alive(owner)) { ++i; continue; }
+    __atomic_store_n(&slot->owner, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, t + d->mask + 1, __ATOMIC_RELEASE);
+    d->skipped[i] = d->skipped[--d->skipped_n];
+  }
+}
+
+// Whether name is the ring of an uploader that is still running, which must not be replaced: its
+// producers would keep feeding it while new ones open the replacement. A segment that cannot be
+// read counts as in use; one of another layout version, or whose uploader is gone, does not.
+static bool tr_shm_in_use(const char* name) {
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return errno != ENOENT;
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(tr_shm_header_t))
+    map = mmap(nullptr, sizeof(tr_shm_header_t), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  const tr_shm_header_t* h = (const tr_shm_header_t*)map;
+  bool live = __atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) == TR_SHM_MAGIC && h->version == TR_SHM_VERSION &&
+              __atomic_load_n(&h->open, __ATOMIC_ACQUIRE) && tr_shm_pid_alive(__atomic_load_n(&h->pid, __ATOMIC_RELAXED));
+  munmap(map, sizeof(tr_shm_header_t));
+  return live;
+}
+
+traccar_shm_daemon_t* traccar_shm_daemon_create(const char* name, traccar_client_t* client, traccar_format_t format,
+                                                size_t capacity, traccar_shm_cb cb, void* user) {
+  if (!name || name[0] != '/' || !client || capacity == 0 || capacity > ((size_t)1 << 24)) return nullptr;
+  size_t cap = 2;
+  while (cap < capacity) cap *= 2;
+  traccar_shm_daemon_t* d = (traccar_shm_daemon_t*)calloc(1, sizeof(*d));
+  if (!d) return nullptr;
+  d->name = strdup(name);
+  d->client = client;
+  d->format = format;
+  d->max_batch = 32;
+  d->cb = cb;
+  d->user = user;
+  d->mask = cap - 1;
+  d->batch = (traccar_position_t*)calloc(TR_SHM_MAX_BATCH, sizeof(*d->batch));
+  d->accepted = (bool*)calloc(TR_SHM_MAX_BATCH, sizeof(*d->accepted));
+  if (!d->name || !d->batch || !d->accepted) { traccar_shm_daemon_destroy(d); return nullptr; }
+
+  if (tr_shm_in_use(name)) { traccar_shm_daemon_destroy(d); errno = EBUSY; return nullptr; }
+  shm_unlink(name); // a segment left by an uploader that crashed; its producers must reopen
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0660);
+  if (fd < 0) { traccar_shm_daemon_destroy(d); return nullptr; }
+  fchmod(fd, 0660); // past the umask: producers usually run as other users of the group
+  size_t size = sizeof(tr_shm_header_t) + cap * sizeof(tr_shm_slot_t);
+  void* map = MAP_FAILED;
+  if (ftruncate(fd, (off_t)size) == 0) map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) { shm_unlink(name); traccar_shm_daemon_destroy(d); return nullptr; }
+  d->hdr = (tr_shm_header_t*)map;
+  d->map_size = size;
+  d->slots = tr_shm_slots(d->hdr);
+  // ftruncate zero-fills the segment
+  for (size_t i = 0; i < cap; ++i) d->slots[i].seq = i;
+  d->hdr->version = TR_SHM_VERSION;
+  d->hdr->slot_size = (uint32_t)sizeof(tr_shm_slot_t);
+  d->hdr->capacity = cap;
+  d->hdr->pid = (uint32_t)getpid();
+  d->hdr->heartbeat_ms = tr_shm_now_ms();
+  d->hdr->open = 1;
+  __atomic_store_n(&d->hdr->magic, TR_SHM_MAGIC, __ATOMIC_RELEASE);
+  return d;
+}
+
+void traccar_shm_daemon_destroy(traccar_shm_daemon_t* d) {
+  if (!d) return;
+  if (d->hdr) {
+    __atomic_store_n(&d->hdr->open, 0, __ATOMIC_RELEASE);
+    munmap(d->hdr, d->map_size);
+    shm_unlink(d->name);
+  }
+  free(d->name);
+  free(d->batch);
+  free(d->accepted);
+  free(d);
+}
+
+void traccar_shm_daemon_set_max_batch(traccar_shm_daemon_t* d, size_t max_batch) {
+  if (!d) return;
+  if (max_batch == 0) max_batch = 1;
+  __atomic_store_n(&d->max_batch, max_batch < TR_SHM_MAX_BATCH ? max_batch : TR_SHM_MAX_BATCH, __ATOMIC_RELAXED);
+}
+
+int traccar_shm_daemon_run(traccar_shm_daemon_t* d) {
+  if (!d) return -1;
+  tr_shm_header_t* h = d->hdr;
+  uint64_t stall_ticket = UINT64_MAX, stall_since = 0;
+  while (!__atomic_load_n(&d->stop, __ATOMIC_ACQUIRE)) {
+    __atomic_store_n(&h->heartbeat_ms, tr_shm_now_ms(), __ATOMIC_RELAXED);
+    if (d->skipped_n) tr_shm_reap(d);
+    if (tr_shm_drain(d)) continue;
+    uint64_t head = h->head;
+    if (__atomic_load_n(&h->tail, __ATOMIC_ACQUIRE) != head) {
+      // Claimed but not published: normally a producer between its two atomics
+      uint64_t now = tr_shm_now_ms();
+      if (stall_ticket != head) { stall_ticket = head; stall_since = now; }
+      else if (now - stall_since >= TRACCAR_SHM_STALL_MS) { tr_shm_skip(d, head); continue; }
+    }
+    // Announce the sleep, then look again: a producer publishing in between sees the flag
+    __atomic_store_n(&h->sleeping, 1, __ATOMIC_SEQ_CST);
+    uint64_t seq = __atomic_load_n(&d->slots[head & d->mask].seq, __ATOMIC_SEQ_CST);
+    if (seq != head + 1 && !__atomic_load_n(&d->stop, __ATOMIC_SEQ_CST)) tr_shm_wait(&h->sleeping, 100);
+    __atomic_store_n(&h->sleeping, 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&h->open, 0, __ATOMIC_SEQ_CST);
+  while (tr_shm_drain(d)) {}
+  return 0;
+}
+
+void traccar_shm_daemon_stop(traccar_shm_daemon_t* d) {
+  if (!d) return;
+  __atomic_store_n(&d->stop, 1, __ATOMIC_SEQ_CST);
+  if (d->hdr) {
+    __atomic_store_n(&d->hdr->sleeping, 0, __ATOMIC_SEQ_CST);
+    tr_shm_wake(&d->hdr->sleeping);
+  }
+}
+
+static void tr_shm_counts(const tr_shm_header_t* h, traccar_shm_counts_t* out) {
+  memset(out, 0, sizeof(*out));
+  if (!h) return;
+  out->submitted = __atomic_load_n(&h->tail, __ATOMIC_RELAXED);
+  out->full = __atomic_load_n(&h->full, __ATOMIC_RELAXED);
+  out->delivered = __atomic_load_n(&h->delivered, __ATOMIC_RELAXED);
+  out->failed = __atomic_load_n(&h->failed, __ATOMIC_RELAXED);
+  out->batches = __atomic_load_n(&h->batches, __ATOMIC_RELAXED);
+  out->skipped = __atomic_load_n(&h->skipped, __ATOMIC_RELAXED);
+}
+
+void traccar_shm_daemon_get_counts(const traccar_shm_daemon_t* d, traccar_shm_counts_t* out) {
+  if (out) tr_shm_counts(d ? d->hdr : nullptr, out);
+}
+
+// ----------------- Producers -----------------
+
+traccar_shm_producer_t* traccar_shm_open(const char* name) {
+  if (!name) return nullptr;
+  int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(tr_shm_header_t))
+    map = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return nullptr;
+  tr_shm_header_t* h = (tr_shm_header_t*)map;
+  uint64_t cap = h->capacity;
+  if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != TR_SHM_MAGIC || h->version != TR_SHM_VERSION ||
+      h->slot_size != sizeof(tr_shm_slot_t) || cap < 2 || (cap & (cap - 1)) ||
+      sizeof(tr_shm_header_t) + cap * sizeof(tr_shm_slot_t) > (size_t)st.st_size) {
+    munmap(map, (size_t)st.st_size);
+    return nullptr;
+  }
+  traccar_shm_producer_t* p = (traccar_shm_producer_t*)calloc(1, sizeof(*p));
+  if (!p) { munmap(map, (size_t)st.st_size); return nullptr; }
+  p->hdr = h;
+  p->slots = tr_shm_slots(h);
+  p->map_size = (size_t)st.st_size;
+  p->mask = cap - 1;
+  p->pid = (uint32_t)getpid();
+  return p;
+}
+
+void traccar_shm_close(traccar_shm_producer_t* p) {
+  if (!p) return;
+  munmap(p->hdr, p->map_size);
+  free(p);
+}
+
+// Open, and the uploader alive: its heartbeat is recent, or (while it is busy with a slow send
+// or not running yet) its process still exists
+static bool tr_shm_alive(const tr_shm_header_t* h) {
+  if (!__atomic_load_n(&h->open, __ATOMIC_ACQUIRE)) return false;
+  if (tr_shm_now_ms() - __atomic_load_n(&h->heartbeat_ms, __ATOMIC_RELAXED) < TRACCAR_SHM_STALL_MS) return true;
+  return tr_shm_pid_alive(__atomic_load_n(&h->pid, __ATOMIC_RELAXED));
+}
+
+bool tr_shm_claim(traccar_shm_producer_t* p, uint64_t* ticket) {
+  tr_shm_header_t* h = p->hdr;
+  if (!tr_shm_alive(h)) return false;
+  uint64_t t = __atomic_load_n(&h->tail, __ATOMIC_RELAXED);
+  tr_shm_slot_t* slot;
+  for (;;) {
+    slot = &p->slots[t & p->mask];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    int64_t diff = (int64_t)((seq & ~TR_SHM_SKIPPED) - t);
+    if (diff == 0 && !(seq & TR_SHM_SKIPPED)) {
+      if (__atomic_compare_exchange_n(&h->tail, &t, t + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (diff < 0) { // not consumed yet, or skipped a lap ago and still held by its producer
+      __atomic_fetch_add(&h->full, 1, __ATOMIC_RELAXED);
+      return false;
+    } else {
+      t = __atomic_load_n(&h->tail, __ATOMIC_RELAXED);
+    }
+  }
+  __atomic_store_n(&slot->owner, p->pid, __ATOMIC_SEQ_CST);
+  *ticket = t;
+  return true;
+}
+
+bool tr_shm_publish(traccar_shm_producer_t* p, uint64_t t, const traccar_position_t* pos) {
+  tr_shm_header_t* h = p->hdr;
+  tr_shm_slot_t* slot = &p->slots[t & p->mask];
+  // A producer that stalled past TRACCAR_SHM_STALL_MS since its claim finds the slot skipped and
+  // leaves it to the uploader without writing to it
+  uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_SEQ_CST);
+  if (seq != t) {
+    if (seq == (t | TR_SHM_SKIPPED)) __atomic_store_n(&slot->owner, 0, __ATOMIC_RELEASE);
+    return false;
+  }
+  tr_copy_position(&slot->pos, pos, slot->strings, sizeof(slot->strings));
+  for (int i = 0; i < TR_SHM_TEXTS; ++i) {
+    const char** f = tr_shm_text_field(&slot->pos, i);
+    slot->text[i] = *f ? (uint16_t)(*f - slot->strings + 1) : 0;
+    *f = nullptr;
+  }
+  // Published with a CAS: it fails only if the uploader skipped the slot meanwhile, which then
+  // waits for owner to be cleared before reusing it. Sequentially consistent with the uploader's
+  // store of sleeping and its last look at the ring.
+  uint64_t expected = t;
+  if (!__atomic_compare_exchange_n(&slot->seq, &expected, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&slot->owner, 0, __ATOMIC_RELEASE);
+    return false;
+  }
+  if (__atomic_load_n(&h->sleeping, __ATOMIC_SEQ_CST) && __atomic_exchange_n(&h->sleeping, 0, __ATOMIC_ACQ_REL))
+    tr_shm_wake(&h->sleeping);
+  return true;
+}
+
+bool traccar_shm_submit(traccar_shm_producer_t* p, const traccar_position_t* pos) {
+  uint64_t t;
+  return p && pos && tr_shm_claim(p, &t) && tr_shm_publish(p, t, pos);
+}
+
+bool traccar_shm_is_open(const traccar_shm_producer_t* p) {
+  return p && __atomic_load_n(&p->hdr->open, __ATOMIC_ACQUIRE) && tr_shm_pid_alive(__atomic_load_n(&p->hdr->pid, __ATOMIC_RELAXED));
+}
+
+void traccar_shm_get_counts(const traccar_shm_producer_t* p, traccar_shm_counts_t* out) {
+  if (out) tr_shm_counts(p ? p->hdr : nullptr, out);
+}
+
+#endif // TRACCAR_HAVE_POSIX
@@ -0,0 +1,85 @@
+#ifndef TRACCAR_SHM_H
+#define TRACCAR_SHM_H
+
+#include "TraccarClient.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared-memory submission ring for multi-process gateways (POSIX builds only)
+//
+// One uploader process owns the client and creates a named ring in POSIX shared memory; any
+// number of other processes (GNSS daemon, OBD reader, alarm handler, ...) open it by name and
+// submit positions, which the uploader sends in batches over its one connection, in the order
+// they were submitted across all processes. The ring is the sequence-numbered MPSC ring of
+// traccar_sender_t laid out in the shared segment: a submit copies the position into a slot and
+// publishes it with atomics only. A syscall is made only to wake an idle uploader (a futex on
+// Linux; elsewhere the uploader polls every millisecond).
+//
+//   uploader:  d = traccar_shm_daemon_create("/traccar", client, TRACCAR_FORMAT_OSMAND, 1024);
+//              traccar_shm_daemon_run(d);               // until traccar_shm_daemon_stop
+//   producers: p = traccar_shm_open("/traccar");
+//              traccar_shm_submit(p, &pos);
+typedef struct traccar_shm_daemon_s traccar_shm_daemon_t;
+typedef struct traccar_shm_producer_s traccar_shm_producer_t;
+
+// String bytes kept per slot; string fields that do not fit are dropped from the copy
+#ifndef TRACCAR_SHM_STRING_BYTES
+#define TRACCAR_SHM_STRING_BYTES 256
+#endif
+
+// A slot claimed but not published for this long (its producer died mid-submit) is skipped so
+// the ring keeps moving. It is reused only once its producer has given it up or is gone, so a
+// producer that was merely stalled never writes into a slot of the next lap. An uploader whose
+// heartbeat is this old is checked for by pid on each submit.
+#ifndef TRACCAR_SHM_STALL_MS
+#define TRACCAR_SHM_STALL_MS 2000
+#endif
+
+// Called in the uploader after each batch, as traccar_sender_cb
+typedef void (*traccar_shm_cb)(void* user, const traccar_position_t* positions, size_t n,
+                               const bool* accepted, int http_code);
+
+typedef struct traccar_shm_counts_s {
+  uint64_t submitted;   // accepted into the ring, by all producers
+  uint64_t full;        // submits refused because the ring was full
+  uint64_t delivered;   // accepted by the server
+  uint64_t failed;      // sent but not accepted
+  uint64_t batches;
+  uint64_t skipped;     // slots abandoned by a producer that died mid-submit
+} traccar_shm_counts_t;
+
+// Creates the segment name ("/traccar"; replacing a stale one left by a crashed uploader) with a
+// ring of capacity slots, rounded up to a power of two, readable and writable by the owner and
+// group. Fails (errno EBUSY) while another uploader runs on that name. The client must not be used elsewhere until the daemon is destroyed; cb is optional.
+traccar_shm_daemon_t* traccar_shm_daemon_create(const char* name, traccar_client_t* client, traccar_format_t format,
+                                                size_t capacity, traccar_shm_cb cb, void* user);
+// Marks the ring closed, so producers' submits fail, and removes the segment
+void traccar_shm_daemon_destroy(traccar_shm_daemon_t* daemon);
+// Positions per request (default 32, at most 256)
+void traccar_shm_daemon_set_max_batch(traccar_shm_daemon_t* daemon, size_t max_batch);
+// Uploads in the calling thread until traccar_shm_daemon_stop, then closes the ring to producers
+// and makes one attempt at what was already submitted; returns 0, or -1 if daemon is null
+int traccar_shm_daemon_run(traccar_shm_daemon_t* daemon);
+// Async-signal-safe: can be called from a SIGTERM handler or another thread
+void traccar_shm_daemon_stop(traccar_shm_daemon_t* daemon);
+void traccar_shm_daemon_get_counts(const traccar_shm_daemon_t* daemon, traccar_shm_counts_t* out);
+
+// Maps the ring of a running uploader; nullptr if there is none or it was built with another
+// slot layout (library version or TRACCAR_SHM_STRING_BYTES)
+traccar_shm_producer_t* traccar_shm_open(const char* name);
+void traccar_shm_close(traccar_shm_producer_t* producer);
+// Thread-safe and lock-free. Returns false when the ring is full or the uploader has closed it
+// or died; after a restart of the uploader, producers reopen the ring. Producers and uploader
+// must share a PID namespace.
+bool traccar_shm_submit(traccar_shm_producer_t* producer, const traccar_position_t* pos);
+// Whether the uploader that created the ring still has it open and its process is running
+bool traccar_shm_is_open(const traccar_shm_producer_t* producer);
+void traccar_shm_get_counts(const traccar_shm_producer_t* producer, traccar_shm_counts_t* out);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // TRACCAR_SHM_H